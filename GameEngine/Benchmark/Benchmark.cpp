@@ -0,0 +1,816 @@
+// Benchmarks for the game engine. Each scene builds a synthetic level in a headless engine, simulates a fixed number of
+// frames and reports the frames per second, the time spent in each system of the frame and the number of allocations.
+// The results are written as JSON so that they can be compared between commits.
+// With --zero-allocations <warm-up frames>, the steady-state scenes are instead checked to not allocate in any frame after
+// the warm-up frames. The first frame that allocates is reported together with the sites that allocated, and the program
+// exits with a nonzero status.
+// With --startup <runs>, the time to the first frame is instead measured: a windowed engine is created the specified number
+// of times with a level of static sprites and run until its first simulated frame has been rendered. The mean time of each
+// phase of the startup timeline (see StartupTimeline) is written as JSON. This mode needs a display.
+// With --level-load <runs>, the time to load a level is instead measured: a binary level file (see LevelFile) with the
+// specified number of sprites is written and loaded the specified number of times, and the mean time of reading the file
+// and of creating the level is compared to the time of building the same level in code, sprite by sprite.
+// With --rollback <frames kept>, the history of the world (see Engine::KeepHistory) is instead measured on the uniform
+// sprites scene: the time of a frame with and without the history, the memory of the history once it is full, and the
+// time to restore a frame and to simulate forward again from it for frames from one frame back to the oldest frame kept.
+// Each resimulation is checked to end with the same state hash as before the rollback, and the engine is checked to refuse
+// to roll back while a script is sleeping. The program exits with a nonzero status if a check fails.
+// With --network <ticks>, the snapshots of a server (see SnapshotServer) are instead measured on loopback: a level of moving
+// sprites like the uniform sprites scene is sent to a number of clients (see SnapshotClient) in each tick, and the time of a
+// tick of the server and of an update of a client are reported together with the bytes sent to each client, for the whole
+// first snapshot and for the deltas after it. The replicas of the clients are checked to end at the positions of the sprites.
+//
+// Built from this file together with all sources of the engine except main.cpp, with -DGAMEENGINE_ALLOCATION_COUNTING
+// (without it the allocations are reported as 0 and --zero-allocations refuses to run).
+// Usage: Benchmark [--frames <frames>] [--sprites <sprites>] [--scene <name>] [--output <file>] [--zero-allocations <warm-up frames>]
+//                  [--startup <runs>] [--level-load <runs>] [--rollback <frames kept>] [--network <ticks>]
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include "../GameEngine/Engine.h"
+#include "../GameEngine/AllocationCounter.h"
+#include "../GameEngine/LevelFile.h"
+
+using namespace std;
+
+// The size of the window and the frame rate used by all scenes.
+static const int WINDOW_WIDTH = 800;
+static const int WINDOW_HEIGHT = 640;
+static const int FPS = 60;
+
+// The number of frames simulated before the measurement starts.
+static const int WARM_UP_FRAMES = 10;
+
+// The file the level load benchmark writes its level to, which is removed afterwards.
+static const char* LEVEL_LOAD_PATH = "benchmark_level.gelv";
+
+// The seed used by the engine of each scene, so that every run simulates exactly the same frames.
+static const unsigned int SEED = 4711;
+
+// The number of clients the network benchmark sends snapshots to.
+static const int NETWORK_CLIENTS = 4;
+
+// A synthetic scene: a name and a function that fills the level of a headless engine, where the number is the size of the scene.
+// A steady-state scene does not create or remove anything once it is set up, which means that its frames should not allocate.
+struct Scene {
+    string name;
+    function<void(Engine*, Level*, int)> set_up;
+    bool is_steady_state;
+};
+
+// The measurements of one scene.
+struct SceneResult {
+    string name;
+    int size, frames;
+    double seconds;
+    long allocations, bytes;
+    int sprites;
+    vector<pair<string, double>> system_times;
+};
+
+// The measurements of the startup of a windowed engine, averaged over all runs. Times are in milliseconds.
+struct StartupResult {
+    int runs, size;
+    double time_to_first_frame, max_time_to_first_frame;
+    vector<pair<string, double>> phase_times;
+};
+
+// Keeps the sprites of a level within the window by moving sprites that have left one side of the window to the opposite side.
+// Sprites only move a few pixels each frame, so they are moved before the window considers them to be outside.
+void WrapSprites(Level* level) {
+    const vector<Sprite*>& sprites = level->GetSprites();
+    for (int i = 0; i < sprites.size(); i++) {
+        Sprite* sprite = sprites[i];
+        if (sprite->GetX() >= WINDOW_WIDTH) {
+            sprite->SetX(1 - sprite->GetWidth());
+        } else if (sprite->GetX() <= -sprite->GetWidth()) {
+            sprite->SetX(WINDOW_WIDTH - 1);
+        }
+        if (sprite->GetY() >= WINDOW_HEIGHT) {
+            sprite->SetY(1 - sprite->GetHeight());
+        } else if (sprite->GetY() <= -sprite->GetHeight()) {
+            sprite->SetY(WINDOW_HEIGHT - 1);
+        }
+    }
+}
+
+// Returns a random velocity between -2 and 2 that is never zero.
+int RandomVelocity(Engine* engine) {
+    int velocity = engine->GetRandom(4) - 2;
+    return velocity >= 0 ? velocity + 1 : velocity;
+}
+
+// Moving sprites spread out evenly over the window, which gives few collisions.
+void SetUpUniformSprites(Engine* engine, Level* level, int size) {
+    int columns = 1;
+    while (columns * columns < size) {
+        columns++;
+    }
+    for (int i = 0; i < size; i++) {
+        int x = (i % columns) * WINDOW_WIDTH / columns;
+        int y = (i / columns) * WINDOW_HEIGHT / columns;
+        level->AddSprite(MovingSprite::GetInstance("uniform", "resources/game/level1_enemy.png", x, y, 16, 16, RandomVelocity(engine), RandomVelocity(engine)));
+    }
+    engine->AddSystem("benchmark.wrap", bind(WrapSprites, level), {}, {"sprites"});
+}
+
+// Moving sprites packed into four clusters, which gives many collisions.
+void SetUpClusteredSprites(Engine* engine, Level* level, int size) {
+    for (int i = 0; i < size; i++) {
+        int cluster = i % 4;
+        int x = (cluster % 2 + 1) * WINDOW_WIDTH / 3 + engine->GetRandom(80) - 40;
+        int y = (cluster / 2 + 1) * WINDOW_HEIGHT / 3 + engine->GetRandom(80) - 40;
+        level->AddSprite(MovingSprite::GetInstance("clustered", "resources/game/level1_enemy.png", x, y, 16, 16, RandomVelocity(engine), RandomVelocity(engine)));
+    }
+    engine->AddSystem("benchmark.wrap", bind(WrapSprites, level), {}, {"sprites"});
+    engine->SetCollisionListener([](Sprite* sprite1, Sprite* sprite2) {});
+}
+
+// Labels where the oldest tenth are replaced by labels with new text in each frame, which renders a new text texture for each new label.
+void SetUpLabelChurn(Engine* engine, Level* level, int size) {
+    shared_ptr<int> label_counter = make_shared<int>(0);
+    for (int i = 0; i < size; i++) {
+        level->AddSprite(LabelSprite::GetInstance("label", "label " + to_string((*label_counter)++), engine->GetRandom(WINDOW_WIDTH - 100), engine->GetRandom(WINDOW_HEIGHT - 20)));
+    }
+    engine->AddSystem("benchmark.churn", [engine, level, size, label_counter] {
+        vector<Sprite*> sprites = level->GetSprites();
+        for (int i = 0; i < size / 10 + 1 && i < sprites.size(); i++) {
+            level->RemoveSprite(sprites[i]);
+            level->AddSprite(LabelSprite::GetInstance("label", "label " + to_string((*label_counter)++), engine->GetRandom(WINDOW_WIDTH - 100), engine->GetRandom(WINDOW_HEIGHT - 20)));
+        }
+    }, {}, {"sprites"});
+}
+
+// Sprites spawned at the top of the window at a high rate that fall out of the window within a second, where some are
+// also removed at random before they leave the window.
+void SetUpSpawnDespawn(Engine* engine, Level* level, int size) {
+    engine->AddSystem("benchmark.spawn", [engine, level, size] {
+        for (int i = 0; i < size / 20 + 1; i++) {
+            level->AddSprite(MovingSprite::GetInstance("falling", "resources/game/level1_bullet.png", engine->GetRandom(WINDOW_WIDTH), 0, 19, 43, 0, 16 + engine->GetRandom(16)));
+        }
+        vector<Sprite*> sprites = level->GetSprites();
+        for (int i = 0; i < sprites.size() / 20; i++) {
+            level->RemoveSprite(sprites[engine->GetRandom((int)sprites.size())]);
+        }
+    }, {}, {"sprites"});
+}
+
+// Thousands of time listeners: ten level time listeners for each sprite with different delays, and a time listener for each
+// sprite that toggles its visibility.
+void SetUpTimeListeners(Engine* engine, Level* level, int size) {
+    shared_ptr<long> call_count = make_shared<long>(0);
+    for (int i = 0; i < size * 10; i++) {
+        level->AddTimeListener([call_count] { (*call_count)++; }, i + 1);
+    }
+    for (int i = 0; i < size; i++) {
+        Sprite* sprite = StaticSprite::GetInstance("timed", "resources/game/level1_enemy.png", engine->GetRandom(WINDOW_WIDTH - 16), engine->GetRandom(WINDOW_HEIGHT - 16), 16, 16);
+        sprite->AddTimeListener([](Sprite* sprite) { sprite->SetIsVisible(!sprite->GetIsVisible()); }, engine->GetRandom(1000));
+        level->AddSprite(sprite);
+    }
+}
+
+// Runs a scene in a new headless engine: simulates the warm up frames and then measures the specified number of frames.
+SceneResult RunScene(const Scene& scene, int size, int frames) {
+    Engine* engine = new Engine("Benchmark", FPS, WINDOW_WIDTH, WINDOW_HEIGHT, true);
+    engine->SetDeterministic(SEED);
+    Level* level = new Level(0);
+    engine->AddLevel(level);
+    engine->SetCurrentLevel(level);
+    scene.set_up(engine, level, size);
+    for (int i = 0; i < WARM_UP_FRAMES; i++) {
+        engine->Step();
+    }
+    vector<string> system_names = engine->GetSystemNames();
+    vector<double> start_times;
+    for (int i = 0; i < system_names.size(); i++) {
+        start_times.push_back(engine->GetSystemTime(system_names[i]));
+    }
+    long start_allocations = AllocationCounter::GetAllocationCount();
+    long start_bytes = AllocationCounter::GetAllocatedBytes();
+    chrono::steady_clock::time_point start_time = chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        engine->Step();
+    }
+    chrono::steady_clock::time_point stop_time = chrono::steady_clock::now();
+    SceneResult result;
+    result.name = scene.name;
+    result.size = size;
+    result.frames = frames;
+    result.seconds = chrono::duration<double>(stop_time - start_time).count();
+    result.allocations = AllocationCounter::GetAllocationCount() - start_allocations;
+    result.bytes = AllocationCounter::GetAllocatedBytes() - start_bytes;
+    result.sprites = (int)level->GetSprites().size();
+    for (int i = 0; i < system_names.size(); i++) {
+        result.system_times.push_back(make_pair(system_names[i], (engine->GetSystemTime(system_names[i]) - start_times[i]) / frames));
+    }
+    delete engine;
+    return result;
+}
+
+// Runs a steady-state scene in a new headless engine that fails any frame after the warm-up frames that allocates.
+// Returns true if all frames passed. The allocation sites are captured after the warm-up frames, and the sites of the
+// failing frame are printed (together with the setup of the engine for that frame).
+bool CheckSceneAllocations(const Scene& scene, int size, int frames, int warm_up_frames) {
+    Engine* engine = new Engine("Benchmark", FPS, WINDOW_WIDTH, WINDOW_HEIGHT, true);
+    engine->SetDeterministic(SEED);
+    Level* level = new Level(0);
+    engine->AddLevel(level);
+    engine->SetCurrentLevel(level);
+    scene.set_up(engine, level, size);
+    engine->ExpectNoAllocations(warm_up_frames);
+    bool is_passed = true;
+    try {
+        for (int i = 0; i < warm_up_frames + frames; i++) {
+            if (i == warm_up_frames) {
+                AllocationCounter::ResetSites();
+                AllocationCounter::SetStackCapture(true);
+            }
+            engine->Step();
+        }
+    } catch (const exception& error) {
+        AllocationCounter::SetStackCapture(false);
+        cerr << scene.name << ": " << error.what() << endl;
+        AllocationCounter::PrintTopSites(cerr, 5);
+        is_passed = false;
+    }
+    AllocationCounter::SetStackCapture(false);
+    delete engine;
+    return is_passed;
+}
+
+// Creates a windowed engine with a level of static sprites the specified number of times, and runs each engine until its
+// first simulated frame has been rendered. The engine is stopped by a quit event pushed by a system in the second frame,
+// which is polled after the second iteration of the main event loop has rendered the first simulated frame.
+// The time to the first frame is the end of "engine.first_frame" on the startup timeline, which includes setting up the level.
+StartupResult MeasureStartup(int size, int runs) {
+    StartupResult result;
+    result.runs = runs;
+    result.size = size;
+    result.time_to_first_frame = 0;
+    result.max_time_to_first_frame = 0;
+    for (int run = 0; run < runs; run++) {
+        Engine* engine = new Engine("Benchmark", FPS, WINDOW_WIDTH, WINDOW_HEIGHT);
+        Level* level = new Level(0);
+        for (int i = 0; i < size; i++) {
+            level->AddSprite(StaticSprite::GetInstance("static", "resources/game/level1_enemy.png", engine->GetRandom(WINDOW_WIDTH - 16), engine->GetRandom(WINDOW_HEIGHT - 16), 16, 16));
+        }
+        engine->AddLevel(level);
+        engine->SetCurrentLevel(level);
+        shared_ptr<bool> is_quit_pushed = make_shared<bool>(false);
+        engine->AddSystem("benchmark.quit", [engine, is_quit_pushed] {
+            if (engine->GetFrameCount() >= 2 && !*is_quit_pushed) {
+                SDL_Event event;
+                SDL_zero(event);
+                event.type = SDL_QUIT;
+                SDL_PushEvent(&event);
+                *is_quit_pushed = true;
+            }
+        }, {"time"}, {});
+        engine->Run();
+        StartupTimeline* timeline = engine->GetStartupTimeline();
+        double time_to_first_frame = timeline->GetEndTime("engine.first_frame");
+        result.time_to_first_frame += time_to_first_frame / runs;
+        result.max_time_to_first_frame = max(result.max_time_to_first_frame, time_to_first_frame);
+        vector<StartupTimeline::Phase> phases = timeline->GetPhases();
+        for (int i = 0; i < phases.size(); i++) {
+            int k = 0;
+            while (k < result.phase_times.size() && result.phase_times[k].first != phases[i].name) {
+                k++;
+            }
+            if (k == result.phase_times.size()) {
+                result.phase_times.push_back(make_pair(phases[i].name, 0.0));
+            }
+            result.phase_times[k].second += phases[i].duration / runs;
+        }
+        delete engine;
+    }
+    return result;
+}
+
+// The measurements of loading a level, averaged over all runs. Times are in milliseconds.
+struct LevelLoadResult {
+    int runs, size;
+    long file_bytes;
+    double read_time, create_time, build_in_code_time;
+};
+
+// Returns the milliseconds since the specified time.
+double GetMillisecondsSince(chrono::steady_clock::time_point start_time) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start_time).count();
+}
+
+// Adds the sprite with the specified index of the level loaded by the benchmark: a mix of static, moving and animated
+// sprites with a handful of different tags and images, like the levels of a game.
+void AddLevelLoadSprite(LevelFile* level_file, int index, const vector<string>& animation) {
+    LevelFile::SpriteRecord sprite = {};
+    sprite.type = index % 10 == 0 ? LevelFile::ANIMATED_SPRITE : index % 3 == 0 ? LevelFile::MOVING_SPRITE : LevelFile::STATIC_SPRITE;
+    sprite.x = (index * 37) % (WINDOW_WIDTH - 16);
+    sprite.y = (index * 91) % (WINDOW_HEIGHT - 16);
+    sprite.width = 16;
+    sprite.height = 16;
+    sprite.layer = index % 4;
+    sprite.tag = level_file->AddString("sprite" + to_string(index % 8));
+    if (sprite.type == LevelFile::ANIMATED_SPRITE) {
+        sprite.asset = level_file->AddImages(animation);
+        sprite.asset_count = (Uint32)animation.size();
+        sprite.delay = 100;
+    } else {
+        sprite.asset = level_file->AddString(index % 2 == 0 ? "resources/game/level1_enemy.png" : "resources/game/level1_bullet.png");
+        sprite.asset_count = 1;
+    }
+    if (sprite.type == LevelFile::MOVING_SPRITE) {
+        sprite.dx = 1;
+        sprite.dy = -1;
+    }
+    level_file->AddSprite(sprite);
+}
+
+// Builds the level of the benchmark in code, sprite by sprite, the way levels are built without a level file.
+Level* BuildLevelInCode(int size, const vector<string>& animation) {
+    Level* level = new Level(0);
+    for (int i = 0; i < size; i++) {
+        int x = (i * 37) % (WINDOW_WIDTH - 16);
+        int y = (i * 91) % (WINDOW_HEIGHT - 16);
+        string tag = "sprite" + to_string(i % 8);
+        string image = i % 2 == 0 ? "resources/game/level1_enemy.png" : "resources/game/level1_bullet.png";
+        Sprite* sprite;
+        if (i % 10 == 0) {
+            sprite = AnimatedSprite::GetInstance(tag, animation, 100, x, y, 16, 16);
+        } else if (i % 3 == 0) {
+            sprite = MovingSprite::GetInstance(tag, image, x, y, 16, 16, 1, -1);
+        } else {
+            sprite = StaticSprite::GetInstance(tag, image, x, y, 16, 16);
+        }
+        sprite->SetLayer(i % 4);
+        level->AddSprite(sprite);
+    }
+    return level;
+}
+
+// Writes a level file with the specified number of sprites and measures reading it and creating its level, and building
+// the same level in code.
+LevelLoadResult MeasureLevelLoad(int size, int runs) {
+    vector<string> animation = {"resources/game/player_space_ship1.png", "resources/game/player_space_ship2.png", "resources/game/player_space_ship3.png"};
+    LevelFile* level_file = new LevelFile(0);
+    for (int i = 0; i < size; i++) {
+        AddLevelLoadSprite(level_file, i, animation);
+    }
+    level_file->WriteBinary(LEVEL_LOAD_PATH);
+    delete level_file;
+
+    LevelLoadResult result = {runs, size, 0, 0, 0, 0};
+    ifstream written_file(LEVEL_LOAD_PATH, ios::binary | ios::ate);
+    result.file_bytes = (long)written_file.tellg();
+    for (int run = 0; run < runs; run++) {
+        chrono::steady_clock::time_point start_time = chrono::steady_clock::now();
+        LevelFile* loaded_file = LevelFile::ReadBinary(LEVEL_LOAD_PATH);
+        result.read_time += GetMillisecondsSince(start_time) / runs;
+        start_time = chrono::steady_clock::now();
+        Level* level = loaded_file->CreateLevel();
+        result.create_time += GetMillisecondsSince(start_time) / runs;
+        delete loaded_file;
+        delete level;
+
+        start_time = chrono::steady_clock::now();
+        level = BuildLevelInCode(size, animation);
+        result.build_in_code_time += GetMillisecondsSince(start_time) / runs;
+        delete level;
+    }
+    remove(LEVEL_LOAD_PATH);
+    return result;
+}
+
+// The measurements of restoring frames from the history at one distance (in frames back from the newest frame).
+// Times are in milliseconds.
+struct RollbackDistance {
+    int frames_back;
+    double restore_time, resimulate_time;
+    bool is_deterministic;
+};
+
+// The measurements of the history of the world. Times are in milliseconds.
+struct RollbackResult {
+    int size, frames, history_frames;
+    double step_time, step_with_history_time;
+    long history_bytes;
+    vector<RollbackDistance> distances;
+    bool refuses_while_sleeping;
+};
+
+// A script that sleeps for longer than any benchmark runs.
+Script SleepingScript(Engine* engine) {
+    co_await engine->Delay(1000000);
+}
+
+// Creates a headless engine with the uniform sprites scene and simulates the warm up frames.
+Engine* CreateRollbackEngine(int size) {
+    Engine* engine = new Engine("Benchmark", FPS, WINDOW_WIDTH, WINDOW_HEIGHT, true);
+    engine->SetDeterministic(SEED);
+    Level* level = new Level(0);
+    engine->AddLevel(level);
+    engine->SetCurrentLevel(level);
+    SetUpUniformSprites(engine, level, size);
+    for (int i = 0; i < WARM_UP_FRAMES; i++) {
+        engine->Step();
+    }
+    return engine;
+}
+
+// Returns the mean time (in milliseconds) of simulating the specified number of frames.
+double MeasureSteps(Engine* engine, int frames) {
+    chrono::steady_clock::time_point start_time = chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        engine->Step();
+    }
+    return GetMillisecondsSince(start_time) / frames;
+}
+
+// Measures the frames of the uniform sprites scene without a history, and then with a history that is filled before the
+// frames are measured. Each distance is then restored the specified number of times: the restore alone (followed by simulating
+// the frames again without timing them) and the restore together with simulating the frames again (see Engine::Resimulate).
+RollbackResult MeasureRollback(int size, int frames, int history_frames) {
+    RollbackResult result = {size, frames, history_frames, 0, 0, 0, {}, false};
+    Engine* engine = CreateRollbackEngine(size);
+    result.step_time = MeasureSteps(engine, frames);
+    delete engine;
+
+    engine = CreateRollbackEngine(size);
+    engine->KeepHistory(history_frames);
+    MeasureSteps(engine, history_frames);
+    result.step_with_history_time = MeasureSteps(engine, frames);
+    WorldHistory* history = engine->GetWorldHistory();
+    result.history_bytes = history->GetMemoryUsage();
+    vector<int> distances = {1, 10, 60, history->GetFrameCount() - 1};
+    for (int i = 0; i < distances.size(); i++) {
+        if (distances[i] < 1 || distances[i] >= history->GetFrameCount() || (!result.distances.empty() && distances[i] <= result.distances.back().frames_back)) {
+            continue;
+        }
+        RollbackDistance distance = {distances[i], 0, 0, true};
+        int runs = max(1, 10 / distances[i]);
+        for (int run = 0; run < runs; run++) {
+            int newest_frame = history->GetNewestFrame();
+            Uint64 newest_hash = engine->GetStateHash();
+            chrono::steady_clock::time_point start_time = chrono::steady_clock::now();
+            engine->RestoreFrame(newest_frame - distances[i]);
+            distance.restore_time += GetMillisecondsSince(start_time) / runs;
+            for (int k = 0; k < distances[i]; k++) {
+                engine->Step();
+            }
+            start_time = chrono::steady_clock::now();
+            engine->Resimulate(newest_frame - distances[i]);
+            distance.resimulate_time += GetMillisecondsSince(start_time) / runs;
+            distance.is_deterministic = distance.is_deterministic && engine->GetStateHash() == newest_hash && history->GetNewestFrame() == newest_frame;
+        }
+        result.distances.push_back(distance);
+    }
+
+    engine->StartScript(SleepingScript(engine));
+    engine->Step();
+    int newest_frame = history->GetNewestFrame();
+    try {
+        engine->RestoreFrame(newest_frame - 1);
+    } catch (const runtime_error&) {
+        result.refuses_while_sleeping = !engine->GetCanRollBack() && history->GetNewestFrame() == newest_frame;
+    }
+    delete engine;
+    return result;
+}
+
+// The measurements of sending snapshots to clients. Times are in milliseconds and bytes are per client.
+struct NetworkResult {
+    int size, ticks, clients;
+    double server_tick_time, client_update_time;
+    long full_snapshot_bytes;
+    double delta_bytes_per_tick;
+    long snapshots_applied;
+    bool is_consistent;
+};
+
+// Moves the sprites of a level by one tick, wrapping them within the window.
+void MoveSprites(Level* level) {
+    const vector<Sprite*>& sprites = level->GetSprites();
+    for (int i = 0; i < sprites.size(); i++) {
+        sprites[i]->Update(1000 / FPS);
+    }
+    WrapSprites(level);
+}
+
+// Sends a level of moving sprites laid out like the uniform sprites scene, without an engine since only the snapshots are
+// measured, to the clients for the specified number of ticks after the first tick, which sends the whole snapshot. Each client
+// is updated by a whole tick after each tick of the server, so that its replicas reach the positions of the snapshot.
+NetworkResult MeasureNetwork(int size, int ticks) {
+    NetworkResult result = {size, ticks, NETWORK_CLIENTS, 0, 0, 0, 0, 0, true};
+    mt19937 random_generator(SEED);
+    uniform_int_distribution<int> velocities(-2, 1);
+    Level* level = new Level(0);
+    int columns = 1;
+    while (columns * columns < size) {
+        columns++;
+    }
+    for (int i = 0; i < size; i++) {
+        int x = (i % columns) * WINDOW_WIDTH / columns;
+        int y = (i / columns) * WINDOW_HEIGHT / columns;
+        int dx = velocities(random_generator);
+        int dy = velocities(random_generator);
+        level->AddSprite(MovingSprite::GetInstance("uniform", "resources/game/level1_enemy.png", x, y, 16, 16, dx >= 0 ? dx + 1 : dx, dy >= 0 ? dy + 1 : dy));
+    }
+
+    SnapshotServer* server = new SnapshotServer(0);
+    vector<SnapshotClient*> clients;
+    vector<Level*> client_levels;
+    for (int i = 0; i < NETWORK_CLIENTS; i++) {
+        clients.push_back(new SnapshotClient(server->GetPort(), 1000.0 / FPS));
+        client_levels.push_back(new Level(0));
+    }
+    for (int tick = 1; tick <= ticks + 1; tick++) {
+        MoveSprites(level);
+        chrono::steady_clock::time_point start_time = chrono::steady_clock::now();
+        server->Send(tick, level);
+        double server_time = GetMillisecondsSince(start_time);
+        start_time = chrono::steady_clock::now();
+        for (int i = 0; i < clients.size(); i++) {
+            clients[i]->Update(client_levels[i], 1000.0 / FPS);
+        }
+        double client_time = GetMillisecondsSince(start_time) / clients.size();
+        if (tick == 1) {
+            result.full_snapshot_bytes = server->GetLastBytesSent() / NETWORK_CLIENTS;
+        } else {
+            result.server_tick_time += server_time / ticks;
+            result.client_update_time += client_time / ticks;
+            result.delta_bytes_per_tick += (double)server->GetLastBytesSent() / NETWORK_CLIENTS / ticks;
+        }
+    }
+
+    const vector<Sprite*>& sprites = level->GetSprites();
+    for (int i = 0; i < clients.size(); i++) {
+        result.snapshots_applied += clients[i]->GetSnapshotCount();
+        result.is_consistent = result.is_consistent && clients[i]->GetTick() == ticks + 1 && client_levels[i]->GetSprites().size() == sprites.size();
+        for (int k = 0; k < sprites.size() && result.is_consistent; k++) {
+            Sprite* replica = clients[i]->GetReplica(client_levels[i], sprites[k]->GetId());
+            result.is_consistent = replica != nullptr && replica->GetX() == sprites[k]->GetX() && replica->GetY() == sprites[k]->GetY();
+        }
+        delete clients[i];
+        delete client_levels[i];
+    }
+    delete server;
+    delete level;
+    return result;
+}
+
+// Writes the network measurements as a JSON object.
+void WriteNetworkResult(ostream& out, const NetworkResult& result) {
+    out << "{" << endl << "  \"network\": {" << endl;
+    out << "    \"sprites\": " << result.size << "," << endl;
+    out << "    \"ticks\": " << result.ticks << "," << endl;
+    out << "    \"clients\": " << result.clients << "," << endl;
+    out << "    \"server_tick_ms\": " << result.server_tick_time << "," << endl;
+    out << "    \"server_tick_per_client_ms\": " << result.server_tick_time / result.clients << "," << endl;
+    out << "    \"client_update_ms\": " << result.client_update_time << "," << endl;
+    out << "    \"full_snapshot_bytes\": " << result.full_snapshot_bytes << "," << endl;
+    out << "    \"delta_bytes_per_tick\": " << result.delta_bytes_per_tick << "," << endl;
+    out << "    \"kbit_per_second\": " << result.delta_bytes_per_tick * FPS * 8 / 1000 << "," << endl;
+    out << "    \"snapshots_applied\": " << result.snapshots_applied << "," << endl;
+    out << "    \"consistent\": " << (result.is_consistent ? "true" : "false") << endl;
+    out << "  }" << endl << "}" << endl;
+}
+
+// Writes the rollback measurements as a JSON object.
+void WriteRollbackResult(ostream& out, const RollbackResult& result) {
+    out << "{" << endl << "  \"rollback\": {" << endl;
+    out << "    \"sprites\": " << result.size << "," << endl;
+    out << "    \"frames\": " << result.frames << "," << endl;
+    out << "    \"history_frames\": " << result.history_frames << "," << endl;
+    out << "    \"frame_time_ms\": " << result.step_time << "," << endl;
+    out << "    \"frame_time_with_history_ms\": " << result.step_with_history_time << "," << endl;
+    out << "    \"history_bytes\": " << result.history_bytes << "," << endl;
+    out << "    \"history_bytes_per_frame\": " << (double)result.history_bytes / result.history_frames << "," << endl;
+    out << "    \"restores\": [" << endl;
+    for (int i = 0; i < result.distances.size(); i++) {
+        const RollbackDistance& distance = result.distances[i];
+        out << "      {\"frames_back\": " << distance.frames_back << ", \"restore_ms\": " << distance.restore_time
+            << ", \"resimulate_ms\": " << distance.resimulate_time << ", \"deterministic\": " << (distance.is_deterministic ? "true" : "false")
+            << "}" << (i + 1 < result.distances.size() ? "," : "") << endl;
+    }
+    out << "    ]," << endl;
+    out << "    \"refuses_while_sleeping\": " << (result.refuses_while_sleeping ? "true" : "false") << endl;
+    out << "  }" << endl << "}" << endl;
+}
+
+// Writes the level load measurements as a JSON object.
+void WriteLevelLoadResult(ostream& out, const LevelLoadResult& result) {
+    out << "{" << endl << "  \"level_load\": {" << endl;
+    out << "    \"runs\": " << result.runs << "," << endl;
+    out << "    \"sprites\": " << result.size << "," << endl;
+    out << "    \"file_bytes\": " << result.file_bytes << "," << endl;
+    out << "    \"read_ms\": " << result.read_time << "," << endl;
+    out << "    \"create_level_ms\": " << result.create_time << "," << endl;
+    out << "    \"load_ms\": " << result.read_time + result.create_time << "," << endl;
+    out << "    \"build_in_code_ms\": " << result.build_in_code_time << endl;
+    out << "  }" << endl << "}" << endl;
+}
+
+// Writes the startup measurements as a JSON object.
+void WriteStartupResult(ostream& out, const StartupResult& result) {
+    out << "{" << endl << "  \"startup\": {" << endl;
+    out << "    \"runs\": " << result.runs << "," << endl;
+    out << "    \"sprites\": " << result.size << "," << endl;
+    out << "    \"time_to_first_frame_ms\": " << result.time_to_first_frame << "," << endl;
+    out << "    \"max_time_to_first_frame_ms\": " << result.max_time_to_first_frame << "," << endl;
+    out << "    \"phase_times_ms\": {";
+    for (int i = 0; i < result.phase_times.size(); i++) {
+        out << (i > 0 ? ", " : "") << "\"" << result.phase_times[i].first << "\": " << result.phase_times[i].second;
+    }
+    out << "}" << endl;
+    out << "  }" << endl << "}" << endl;
+}
+
+// Writes the results as a JSON object with one entry for each scene. Times are in milliseconds per frame unless stated otherwise.
+void WriteResults(ostream& out, const vector<SceneResult>& results) {
+    out << "{" << endl << "  \"scenes\": [" << endl;
+    for (int i = 0; i < results.size(); i++) {
+        const SceneResult& result = results[i];
+        out << "    {" << endl;
+        out << "      \"name\": \"" << result.name << "\"," << endl;
+        out << "      \"size\": " << result.size << "," << endl;
+        out << "      \"frames\": " << result.frames << "," << endl;
+        out << "      \"seconds\": " << result.seconds << "," << endl;
+        out << "      \"fps\": " << (result.seconds > 0 ? result.frames / result.seconds : 0) << "," << endl;
+        out << "      \"frame_time_ms\": " << result.seconds * 1000 / result.frames << "," << endl;
+        out << "      \"allocations_per_frame\": " << (double)result.allocations / result.frames << "," << endl;
+        out << "      \"allocated_bytes_per_frame\": " << (double)result.bytes / result.frames << "," << endl;
+        out << "      \"final_sprites\": " << result.sprites << "," << endl;
+        out << "      \"system_times_ms\": {";
+        for (int k = 0; k < result.system_times.size(); k++) {
+            out << (k > 0 ? ", " : "") << "\"" << result.system_times[k].first << "\": " << result.system_times[k].second;
+        }
+        out << "}" << endl;
+        out << "    }" << (i + 1 < results.size() ? "," : "") << endl;
+    }
+    out << "  ]" << endl << "}" << endl;
+}
+
+int main(int argc, const char * argv[]) {
+    int frames = 300;
+    int sprites = 200;
+    string scene_name;
+    string output_path;
+    int zero_allocation_warm_up = -1;
+    int startup_runs = 0;
+    int level_load_runs = 0;
+    int rollback_frames = 0;
+    int network_ticks = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string option = argv[i];
+        if (option == "--frames") {
+            frames = atoi(argv[i + 1]);
+        } else if (option == "--sprites") {
+            sprites = atoi(argv[i + 1]);
+        } else if (option == "--scene") {
+            scene_name = argv[i + 1];
+        } else if (option == "--output") {
+            output_path = argv[i + 1];
+        } else if (option == "--zero-allocations") {
+            zero_allocation_warm_up = atoi(argv[i + 1]);
+        } else if (option == "--startup") {
+            startup_runs = atoi(argv[i + 1]);
+        } else if (option == "--level-load") {
+            level_load_runs = atoi(argv[i + 1]);
+        } else if (option == "--rollback") {
+            rollback_frames = atoi(argv[i + 1]);
+        } else if (option == "--network") {
+            network_ticks = atoi(argv[i + 1]);
+        } else {
+            cerr << "Unknown option " << option << endl;
+            return 1;
+        }
+    }
+    if (frames <= 0 || sprites <= 0) {
+        cerr << "The number of frames and sprites must be positive." << endl;
+        return 1;
+    }
+    if (!AllocationCounter::IsCompiledIn()) {
+        cerr << "The allocations are not counted, build with -DGAMEENGINE_ALLOCATION_COUNTING to measure them." << endl;
+        if (zero_allocation_warm_up >= 0) {
+            return 1;
+        }
+    }
+
+    if (startup_runs > 0) {
+        cerr << "Measuring the startup..." << endl;
+        StartupResult result = MeasureStartup(sprites, startup_runs);
+        if (output_path.empty()) {
+            WriteStartupResult(cout, result);
+        } else {
+            ofstream file(output_path.c_str());
+            if (!file) {
+                cerr << "Failed to open " << output_path << endl;
+                return 1;
+            }
+            WriteStartupResult(file, result);
+        }
+        return 0;
+    }
+
+    if (level_load_runs > 0) {
+        cerr << "Measuring the level load..." << endl;
+        LevelLoadResult result = MeasureLevelLoad(sprites, level_load_runs);
+        if (output_path.empty()) {
+            WriteLevelLoadResult(cout, result);
+        } else {
+            ofstream file(output_path.c_str());
+            if (!file) {
+                cerr << "Failed to open " << output_path << endl;
+                return 1;
+            }
+            WriteLevelLoadResult(file, result);
+        }
+        return 0;
+    }
+
+    if (rollback_frames > 0) {
+        cerr << "Measuring the rollback..." << endl;
+        RollbackResult result = MeasureRollback(sprites, frames, rollback_frames);
+        if (output_path.empty()) {
+            WriteRollbackResult(cout, result);
+        } else {
+            ofstream file(output_path.c_str());
+            if (!file) {
+                cerr << "Failed to open " << output_path << endl;
+                return 1;
+            }
+            WriteRollbackResult(file, result);
+        }
+        bool is_passed = result.refuses_while_sleeping;
+        for (int i = 0; i < result.distances.size(); i++) {
+            is_passed = is_passed && result.distances[i].is_deterministic;
+        }
+        return is_passed ? 0 : 1;
+    }
+
+    if (network_ticks > 0) {
+        cerr << "Measuring the snapshots..." << endl;
+        NetworkResult result = MeasureNetwork(sprites, network_ticks);
+        if (output_path.empty()) {
+            WriteNetworkResult(cout, result);
+        } else {
+            ofstream file(output_path.c_str());
+            if (!file) {
+                cerr << "Failed to open " << output_path << endl;
+                return 1;
+            }
+            WriteNetworkResult(file, result);
+        }
+        return result.is_consistent ? 0 : 1;
+    }
+
+    vector<Scene> scenes = {
+        {"uniform_sprites", SetUpUniformSprites, true},
+        {"clustered_sprites", SetUpClusteredSprites, true},
+        {"label_churn", SetUpLabelChurn, false},
+        {"spawn_despawn", SetUpSpawnDespawn, false},
+        {"time_listeners", SetUpTimeListeners, true}
+    };
+    if (zero_allocation_warm_up >= 0) {
+        int failures = 0;
+        for (int i = 0; i < scenes.size(); i++) {
+            if (scene_name.empty() ? scenes[i].is_steady_state : scene_name == scenes[i].name) {
+                cerr << "Checking " << scenes[i].name << "..." << endl;
+                if (!CheckSceneAllocations(scenes[i], sprites, frames, zero_allocation_warm_up)) {
+                    failures++;
+                }
+            }
+        }
+        cout << (failures == 0 ? "No allocations after the warm-up." : to_string(failures) + " scene(s) allocated after the warm-up.") << endl;
+        return failures == 0 ? 0 : 1;
+    }
+    vector<SceneResult> results;
+    for (int i = 0; i < scenes.size(); i++) {
+        if (scene_name.empty() || scene_name == scenes[i].name) {
+            cerr << "Running " << scenes[i].name << "..." << endl;
+            results.push_back(RunScene(scenes[i], sprites, frames));
+        }
+    }
+    if (results.empty()) {
+        cerr << "Unknown scene " << scene_name << endl;
+        return 1;
+    }
+
+    if (output_path.empty()) {
+        WriteResults(cout, results);
+    } else {
+        ofstream file(output_path.c_str());
+        if (!file) {
+            cerr << "Failed to open " << output_path << endl;
+            return 1;
+        }
+        WriteResults(file, results);
+    }
+    return 0;
+}
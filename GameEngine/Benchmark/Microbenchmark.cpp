@@ -0,0 +1,421 @@
+// Microbenchmarks for the hot functions of the game engine.
+//
+// Built from this file together with all sources of the engine except main.cpp.
+// Usage: Microbenchmark [--sizes <size,size,...>] [--filter <name>] [--repetitions <count>] [--batch-time <ms>] [--json]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include "Microbenchmark.h"
+
+using namespace std;
+
+// The size of the window used by the benchmarks.
+static const int WINDOW_WIDTH = 800;
+static const int WINDOW_HEIGHT = 640;
+
+// The two-sided 95% quantiles of Student's t distribution for 1 to 30 degrees of freedom.
+static const double T_QUANTILES[30] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131,
+                                       2.120, 2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+Microbenchmark::Microbenchmark(int repetitions, double batch_time):repetitions(repetitions), batch_time(batch_time), random_generator(4711), sink(0) {
+}
+
+// Runs the benchmarks matching the filter at each size.
+void Microbenchmark::Run(vector<int> sizes, string filter) {
+    vector<pair<string, function<void(int)>>> benchmarks = {
+        {"sprite_contains_point", bind(&Microbenchmark::SpriteContainsPoint, this, placeholders::_1)},
+        {"sprite_contains_sprite", bind(&Microbenchmark::SpriteContainsSprite, this, placeholders::_1)},
+        {"window_contains_point", bind(&Microbenchmark::WindowContainsPoint, this, placeholders::_1)},
+        {"window_contains_sprite", bind(&Microbenchmark::WindowContainsSprite, this, placeholders::_1)},
+        {"engine_detect_collision", bind(&Microbenchmark::EngineDetectCollision, this, placeholders::_1)},
+        {"level_clean_up_sprites", bind(&Microbenchmark::LevelCleanUpSprites, this, placeholders::_1)},
+        {"level_delegate_event", bind(&Microbenchmark::LevelDelegateEvent, this, placeholders::_1)},
+        {"engine_handle_time", bind(&Microbenchmark::EngineHandleTime, this, placeholders::_1)},
+        {"level_handle_time", bind(&Microbenchmark::LevelHandleTime, this, placeholders::_1)},
+        {"sprite_handle_time", bind(&Microbenchmark::SpriteHandleTime, this, placeholders::_1)},
+        {"level_save_snapshot", bind(&Microbenchmark::LevelSaveSnapshot, this, placeholders::_1)},
+        {"level_restore_snapshot", bind(&Microbenchmark::LevelRestoreSnapshot, this, placeholders::_1)},
+        {"engine_record_history", bind(&Microbenchmark::EngineRecordHistory, this, placeholders::_1)}
+    };
+    for (int i = 0; i < benchmarks.size(); i++) {
+        if (benchmarks[i].first.find(filter) == string::npos) {
+            continue;
+        }
+        for (int k = 0; k < sizes.size(); k++) {
+            cerr << "Running " << benchmarks[i].first << " (" << sizes[k] << ")..." << endl;
+            benchmarks[i].second(sizes[k]);
+        }
+    }
+}
+
+// Prints one row for each measurement.
+void Microbenchmark::PrintResults(ostream& out) {
+    out << left << setw(26) << "benchmark" << right << setw(8) << "size" << setw(12) << "iterations" << setw(14) << "mean (ns)"
+        << setw(14) << "median (ns)" << setw(14) << "stddev (ns)" << setw(14) << "95% ci (ns)" << endl;
+    for (int i = 0; i < results.size(); i++) {
+        out << left << setw(26) << results[i].name << right << setw(8) << results[i].size << setw(12) << results[i].iterations
+            << fixed << setprecision(2) << setw(14) << results[i].mean << setw(14) << results[i].median << setw(14) << results[i].deviation
+            << setw(11) << "+- " << results[i].confidence << endl;
+    }
+}
+
+// Writes the results as a JSON object with one entry for each measurement.
+void Microbenchmark::WriteResults(ostream& out) {
+    out << "{" << endl << "  \"microbenchmarks\": [" << endl;
+    for (int i = 0; i < results.size(); i++) {
+        out << "    {\"name\": \"" << results[i].name << "\", \"size\": " << results[i].size << ", \"iterations\": " << results[i].iterations
+            << ", \"mean_ns\": " << results[i].mean << ", \"median_ns\": " << results[i].median << ", \"stddev_ns\": " << results[i].deviation
+            << ", \"ci95_ns\": " << results[i].confidence << "}" << (i + 1 < results.size() ? "," : "") << endl;
+    }
+    out << "  ]" << endl << "}" << endl;
+}
+
+// Measures a function in four steps:
+// 1. Calibrate the number of iterations by doubling it until a batch takes at least the batch time.
+// 2. Warm up by running one more batch that is not recorded.
+// 3. Run the specified number of repetitions of the batch and record the time per operation of each.
+// 4. Compute the statistics of the recorded times.
+void Microbenchmark::Measure(string name, int size, int operations, function<void(long)> prepare, function<void(long)> iteration) {
+    long iterations = 1;
+    while (TimeBatch(iterations, prepare, iteration) * iterations < batch_time * 1000000 && iterations < (1L << 30)) {
+        iterations *= 2;
+    }
+    TimeBatch(iterations, prepare, iteration);
+    vector<double> times;
+    for (int i = 0; i < repetitions; i++) {
+        times.push_back(TimeBatch(iterations, prepare, iteration) / operations);
+    }
+    Result result;
+    result.name = name;
+    result.size = size;
+    result.iterations = iterations;
+    result.mean = 0;
+    for (int i = 0; i < times.size(); i++) {
+        result.mean += times[i];
+    }
+    result.mean /= times.size();
+    result.deviation = 0;
+    for (int i = 0; i < times.size(); i++) {
+        result.deviation += (times[i] - result.mean) * (times[i] - result.mean);
+    }
+    result.deviation = times.size() > 1 ? sqrt(result.deviation / (times.size() - 1)) : 0;
+    sort(times.begin(), times.end());
+    result.median = times.size() % 2 == 1 ? times[times.size() / 2] : (times[times.size() / 2 - 1] + times[times.size() / 2]) / 2;
+    int degrees_of_freedom = (int)times.size() - 1;
+    double quantile = degrees_of_freedom <= 0 ? 0 : degrees_of_freedom <= 30 ? T_QUANTILES[degrees_of_freedom - 1] : 1.96;
+    result.confidence = quantile * result.deviation / sqrt((double)times.size());
+    results.push_back(result);
+}
+
+// Prepares and times one batch of iterations.
+double Microbenchmark::TimeBatch(long iterations, function<void(long)>& prepare, function<void(long)>& iteration) {
+    if (prepare != nullptr) {
+        prepare(iterations);
+    }
+    chrono::steady_clock::time_point start_time = chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        iteration(i);
+    }
+    chrono::steady_clock::time_point stop_time = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(stop_time - start_time).count() / iterations;
+}
+
+// Sprite::Contains(int, int) for a point that moves between iterations against each of the sprites.
+void Microbenchmark::SpriteContainsPoint(int size) {
+    vector<Sprite*> sprites = CreateSprites(size);
+    Measure("sprite_contains_point", size, size, nullptr, [this, &sprites](long i) {
+        int x = (int)(i * 7 % WINDOW_WIDTH);
+        int y = (int)(i * 13 % WINDOW_HEIGHT);
+        long count = 0;
+        for (int k = 0; k < sprites.size(); k++) {
+            count += sprites[k]->Contains(x, y);
+        }
+        sink = sink + count;
+    });
+    for (int i = 0; i < sprites.size(); i++) {
+        delete sprites[i];
+    }
+}
+
+// Sprite::Contains(Sprite*) for each sprite against another sprite that changes between iterations.
+void Microbenchmark::SpriteContainsSprite(int size) {
+    vector<Sprite*> sprites = CreateSprites(size);
+    Measure("sprite_contains_sprite", size, size, nullptr, [this, &sprites](long i) {
+        long count = 0;
+        for (int k = 0; k < sprites.size(); k++) {
+            count += sprites[k]->Contains(sprites[(k + i + 1) % sprites.size()]);
+        }
+        sink = sink + count;
+    });
+    for (int i = 0; i < sprites.size(); i++) {
+        delete sprites[i];
+    }
+}
+
+// Window::Contains(int, int) for points both inside and outside the window.
+void Microbenchmark::WindowContainsPoint(int size) {
+    Window window("Microbenchmark", WINDOW_WIDTH, WINDOW_HEIGHT, true);
+    vector<SDL_Point> points;
+    for (int i = 0; i < size; i++) {
+        SDL_Point point = {(int)(random_generator() % (WINDOW_WIDTH * 2)) - WINDOW_WIDTH / 2, (int)(random_generator() % (WINDOW_HEIGHT * 2)) - WINDOW_HEIGHT / 2};
+        points.push_back(point);
+    }
+    Measure("window_contains_point", size, size, nullptr, [this, &window, &points](long i) {
+        long count = 0;
+        for (int k = 0; k < points.size(); k++) {
+            count += window.Contains(points[k].x, points[k].y);
+        }
+        sink = sink + count;
+    });
+}
+
+// Window::Contains(Sprite*) for each of the sprites.
+void Microbenchmark::WindowContainsSprite(int size) {
+    Window window("Microbenchmark", WINDOW_WIDTH, WINDOW_HEIGHT, true);
+    vector<Sprite*> sprites = CreateSprites(size);
+    Measure("window_contains_sprite", size, size, nullptr, [this, &window, &sprites](long i) {
+        long count = 0;
+        for (int k = 0; k < sprites.size(); k++) {
+            count += window.Contains(sprites[k]);
+        }
+        sink = sink + count;
+    });
+    for (int i = 0; i < sprites.size(); i++) {
+        delete sprites[i];
+    }
+}
+
+// Engine::DetectCollision for a level with the sprites at random positions and a collision listener that counts the collisions.
+void Microbenchmark::EngineDetectCollision(int size) {
+    Engine engine("Microbenchmark", 60, WINDOW_WIDTH, WINDOW_HEIGHT, true);
+    Level* level = new Level(0);
+    vector<Sprite*> sprites = CreateSprites(size);
+    for (int i = 0; i < sprites.size(); i++) {
+        level->AddSprite(sprites[i]);
+    }
+    engine.AddLevel(level);
+    engine.SetCurrentLevel(level);
+    engine.SetCollisionListener([this](Sprite* sprite1, Sprite* sprite2) {
+        sink = sink + 1;
+    });
+    Measure("engine_detect_collision", size, 1, nullptr, [&engine](long i) {
+        engine.DetectCollision();
+    });
+}
+
+// Level::CleanUpSprites for a level where every other sprite has been marked for removal. Since a level can only be cleaned
+// up once, a new level is created for each iteration before the batch.
+void Microbenchmark::LevelCleanUpSprites(int size) {
+    vector<Level*> levels;
+    function<void(long)> prepare = [this, size, &levels](long iterations) {
+        for (int i = 0; i < levels.size(); i++) {
+            delete levels[i];
+        }
+        levels.clear();
+        for (long i = 0; i < iterations; i++) {
+            Level* level = new Level(0);
+            vector<Sprite*> sprites = CreateSprites(size);
+            for (int k = 0; k < sprites.size(); k++) {
+                sprites[k]->SetIsRemoved(k % 2 == 0);
+                level->AddSprite(sprites[k]);
+            }
+            levels.push_back(level);
+        }
+    };
+    Measure("level_clean_up_sprites", size, 1, prepare, [&levels](long i) {
+        levels[i]->CleanUpSprites();
+    });
+    for (int i = 0; i < levels.size(); i++) {
+        delete levels[i];
+    }
+}
+
+// Level::DelegateEvent for a key event where every sprite of the level has a listener for the key.
+void Microbenchmark::LevelDelegateEvent(int size) {
+    Level level(0);
+    vector<Sprite*> sprites = CreateSprites(size);
+    for (int i = 0; i < sprites.size(); i++) {
+        sprites[i]->AddEventListener([this](SDL_Event& event, Sprite* sprite) {
+            sink = sink + 1;
+        }, SDLK_SPACE);
+        level.AddSprite(sprites[i]);
+    }
+    SDL_Event event;
+    SDL_zero(event);
+    event.type = SDL_KEYDOWN;
+    event.key.keysym.sym = SDLK_SPACE;
+    Measure("level_delegate_event", size, 1, nullptr, [&level, &event](long i) {
+        level.DelegateEvent(event);
+    });
+}
+
+// Engine::HandleTime with the specified number of time listeners with different delays.
+void Microbenchmark::EngineHandleTime(int size) {
+    Engine engine("Microbenchmark", 60, WINDOW_WIDTH, WINDOW_HEIGHT, true);
+    for (int i = 0; i < size; i++) {
+        engine.AddTimeListener([this] { sink = sink + 1; }, i + 1);
+    }
+    int fps = 60;
+    int frame = 0;
+    SDL_Event event = CreateTimeEvent(&fps, &frame);
+    Measure("engine_handle_time", size, 1, nullptr, [&engine, &event, &frame](long i) {
+        frame = (int)i;
+        engine.HandleTime(event);
+    });
+}
+
+// Level::HandleTime with the specified number of time listeners with different delays.
+void Microbenchmark::LevelHandleTime(int size) {
+    Level level(0);
+    for (int i = 0; i < size; i++) {
+        level.AddTimeListener([this] { sink = sink + 1; }, i + 1);
+    }
+    int fps = 60;
+    int frame = 0;
+    SDL_Event event = CreateTimeEvent(&fps, &frame);
+    Measure("level_handle_time", size, 1, nullptr, [&level, &event, &frame](long i) {
+        frame = (int)i;
+        level.HandleTime(event);
+    });
+}
+
+// Sprite::HandleTime with the specified number of time listeners with different delays on one sprite.
+void Microbenchmark::SpriteHandleTime(int size) {
+    vector<Sprite*> sprites = CreateSprites(1);
+    Sprite* sprite = sprites[0];
+    for (int i = 0; i < size; i++) {
+        sprite->AddTimeListener([this](Sprite* sprite) { sink = sink + 1; }, i + 1);
+    }
+    int fps = 60;
+    int frame = 0;
+    SDL_Event event = CreateTimeEvent(&fps, &frame);
+    Measure("sprite_handle_time", size, 1, nullptr, [sprite, &event, &frame](long i) {
+        frame = (int)i;
+        sprite->HandleTime(event);
+    });
+    delete sprite;
+}
+
+// Level::SaveSnapshot into the same buffer each time, as when a snapshot is saved in each frame.
+void Microbenchmark::LevelSaveSnapshot(int size) {
+    Level level(0);
+    vector<Sprite*> sprites = CreateSprites(size);
+    for (int i = 0; i < sprites.size(); i++) {
+        level.AddSprite(sprites[i]);
+    }
+    vector<Uint8> buffer;
+    Measure("level_save_snapshot", size, 1, nullptr, [&level, &buffer](long i) {
+        level.SaveSnapshot(buffer);
+    });
+}
+
+// Level::RestoreSnapshot of a snapshot saved before every sprite was moved, so that the state of every sprite is restored.
+void Microbenchmark::LevelRestoreSnapshot(int size) {
+    Level level(0);
+    vector<Sprite*> sprites = CreateSprites(size);
+    for (int i = 0; i < sprites.size(); i++) {
+        level.AddSprite(sprites[i]);
+    }
+    vector<Uint8> buffer;
+    level.SaveSnapshot(buffer);
+    function<void(long)> prepare = [&level](long iterations) {
+        for (int i = 0; i < level.GetSpriteCount(); i++) {
+            level.GetSprite(i)->SetX(level.GetSprite(i)->GetX() + 1);
+        }
+    };
+    Measure("level_restore_snapshot", size, 1, prepare, [&level, &buffer](long i) {
+        level.RestoreSnapshot(buffer);
+    });
+}
+
+// Engine::RecordHistory of a level where every sprite moves one pixel in each frame, with a full history of ten seconds
+// of frames, so that each frame is encoded against a state where every sprite differs and reuses the storage of the oldest frame.
+void Microbenchmark::EngineRecordHistory(int size) {
+    Engine engine("Microbenchmark", 60, WINDOW_WIDTH, WINDOW_HEIGHT, true);
+    Level* level = new Level(0);
+    vector<Sprite*> sprites = CreateSprites(size);
+    for (int i = 0; i < sprites.size(); i++) {
+        level->AddSprite(sprites[i]);
+    }
+    engine.AddLevel(level);
+    engine.SetCurrentLevel(level);
+    engine.KeepHistory(600);
+    for (int i = 0; i < 600; i++) {
+        engine.frame_counter++;
+        engine.RecordHistory();
+    }
+    Measure("engine_record_history", size, 1, nullptr, [&engine, &sprites](long i) {
+        for (int k = 0; k < sprites.size(); k++) {
+            sprites[k]->SetX(sprites[k]->GetX() + (i % 2 == 0 ? 1 : -1));
+        }
+        engine.frame_counter++;
+        engine.RecordHistory();
+    });
+}
+
+// Creates sprites of 32 x 32 pixels at random positions within the window.
+vector<Sprite*> Microbenchmark::CreateSprites(int size) {
+    vector<Sprite*> sprites;
+    for (int i = 0; i < size; i++) {
+        int x = (int)(random_generator() % (WINDOW_WIDTH - 32));
+        int y = (int)(random_generator() % (WINDOW_HEIGHT - 32));
+        sprites.push_back(StaticSprite::GetInstance("microbenchmark", "resources/game/level1_enemy.png", x, y, 32, 32));
+    }
+    return sprites;
+}
+
+// Creates a time event in the same way as the engine, with pointers to the fps and the frame counter.
+SDL_Event Microbenchmark::CreateTimeEvent(int* fps, int* frame) {
+    SDL_Event event;
+    SDL_zero(event);
+    event.type = Engine::GetTimeEventType();
+    event.user.data1 = fps;
+    event.user.data2 = frame;
+    return event;
+}
+
+int main(int argc, const char * argv[]) {
+    vector<int> sizes = {16, 64, 256};
+    string filter;
+    int repetitions = 20;
+    double batch_time = 5;
+    bool is_json = false;
+    for (int i = 1; i < argc; i++) {
+        string option = argv[i];
+        if (option == "--json") {
+            is_json = true;
+        } else if (i + 1 < argc && option == "--sizes") {
+            sizes.clear();
+            stringstream list(argv[++i]);
+            string size;
+            while (getline(list, size, ',')) {
+                sizes.push_back(atoi(size.c_str()));
+            }
+        } else if (i + 1 < argc && option == "--filter") {
+            filter = argv[++i];
+        } else if (i + 1 < argc && option == "--repetitions") {
+            repetitions = atoi(argv[++i]);
+        } else if (i + 1 < argc && option == "--batch-time") {
+            batch_time = atof(argv[++i]);
+        } else {
+            cerr << "Unknown option " << option << endl;
+            return 1;
+        }
+    }
+    if (repetitions <= 0 || batch_time <= 0) {
+        cerr << "The number of repetitions and the batch time must be positive." << endl;
+        return 1;
+    }
+
+    Microbenchmark benchmark(repetitions, batch_time);
+    benchmark.Run(sizes, filter);
+    if (is_json) {
+        benchmark.WriteResults(cout);
+    } else {
+        benchmark.PrintResults(cout);
+    }
+    return 0;
+}
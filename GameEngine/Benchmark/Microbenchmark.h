@@ -0,0 +1,93 @@
+#ifndef __GameEngine__Microbenchmark__
+#define __GameEngine__Microbenchmark__
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+#include "../GameEngine/Engine.h"
+
+// Measures the hot functions of the engine in isolation at different sizes (the number of sprites or listeners involved).
+// Each measurement is calibrated so that a batch of iterations takes at least the batch time, warmed up with one batch
+// and then repeated. The result of a measurement is the mean, median and standard deviation of the time per operation
+// over the repetitions, together with a 95% confidence interval of the mean.
+// The class is a friend of Engine, Level, Sprite and Window in order to reach their internal functions.
+class Microbenchmark {
+
+public:
+    
+    // Creates a new microbenchmark runner that repeats each measurement the specified number of times with batches
+    // of at least the specified time (in milliseconds).
+    Microbenchmark(int repetitions, double batch_time);
+    
+    // Runs every benchmark whose name contains the filter at each of the specified sizes.
+    void Run(std::vector<int> sizes, std::string filter);
+    
+    // Prints the results as a table.
+    void PrintResults(std::ostream& out);
+    
+    // Writes the results as JSON.
+    void WriteResults(std::ostream& out);
+
+private:
+    
+    // The statistics of one measurement. All times are in nanoseconds per operation.
+    struct Result {
+        std::string name;
+        int size;
+        long iterations;
+        double mean, median, deviation, confidence;
+    };
+    
+    // Private in order to guard against value semantics.
+    Microbenchmark(const Microbenchmark& other_benchmark);
+    
+    // Private in order to guard against value semantics.
+    const Microbenchmark& operator=(const Microbenchmark& other_benchmark);
+    
+    // Measures a function. Before each batch, prepare is called (untimed) with the number of iterations in the batch,
+    // and then the iteration function is called (timed) with the index of each iteration. Each iteration performs the
+    // specified number of operations, which the time is divided by.
+    void Measure(std::string name, int size, int operations, std::function<void(long)> prepare, std::function<void(long)> iteration);
+    
+    // Internal helper function that times one batch and returns the time (in nanoseconds) per iteration.
+    double TimeBatch(long iterations, std::function<void(long)>& prepare, std::function<void(long)>& iteration);
+    
+    // The benchmarks, each of which measures one function at the specified size.
+    void SpriteContainsPoint(int size);
+    void SpriteContainsSprite(int size);
+    void WindowContainsPoint(int size);
+    void WindowContainsSprite(int size);
+    void EngineDetectCollision(int size);
+    void LevelCleanUpSprites(int size);
+    void LevelDelegateEvent(int size);
+    void EngineHandleTime(int size);
+    void LevelHandleTime(int size);
+    void SpriteHandleTime(int size);
+    void LevelSaveSnapshot(int size);
+    void LevelRestoreSnapshot(int size);
+    void EngineRecordHistory(int size);
+    
+    // Internal helper function that creates the specified number of sprites at random positions within the window.
+    std::vector<Sprite*> CreateSprites(int size);
+    
+    // Internal helper function that creates a time event for the specified frame.
+    SDL_Event CreateTimeEvent(int* fps, int* frame);
+    
+    // The number of repetitions of each measurement.
+    int repetitions;
+    
+    // The minimum time (in milliseconds) of each batch.
+    double batch_time;
+    
+    // The results of all measurements, in the order they were run.
+    std::vector<Result> results;
+    
+    // The random generator used to place sprites, seeded with a constant so that each run measures the same layout.
+    std::mt19937 random_generator;
+    
+    // Written with the results of the measured functions so that the compiler cannot remove the calls.
+    volatile long sink;
+};
+
+#endif
@@ -0,0 +1,232 @@
+// Performance regression gate for the game engine. Each scenario replays a recorded session in a headless, deterministic
+// engine and measures the frame times, allocations and draw calls. The results are compared to the committed baseline,
+// and the program exits with a nonzero status if any metric is worse than its baseline by more than its tolerance.
+//
+// Built from this file together with all sources of the engine except main.cpp, with -DGAMEENGINE_ALLOCATION_COUNTING.
+// Run from the Benchmark directory, since the sessions and the baseline are found relative to it.
+// Usage: PerformanceGate [--baseline <file>] [--repetitions <count>] [--update]
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "../GameEngine/Engine.h"
+#include "../GameEngine/SpaceShooter.h"
+#include "../GameEngine/AllocationCounter.h"
+
+using namespace std;
+
+// A scenario: a recorded session, the seed it was recorded with and a function that sets up the game in an engine.
+// The set up function returns a function that cleans up the game after the engine has been deleted.
+struct Scenario {
+    string name;
+    string session_path;
+    unsigned int seed;
+    function<function<void(void)>(Engine*)> set_up;
+};
+
+// A metric of a scenario together with its baseline value and its tolerance (in percent).
+struct Metric {
+    string scenario, name;
+    double baseline, current, tolerance;
+    bool has_baseline, has_current;
+};
+
+// The tolerance (in percent) used for metrics that are not in the baseline yet. Frame times vary between runs and
+// machines, while allocations and draw calls only change when the code changes.
+double GetDefaultTolerance(string metric) {
+    if (metric.find("time") != string::npos) {
+        return 25;
+    } else if (metric.find("allocations") != string::npos) {
+        return 5;
+    }
+    return 2;
+}
+
+// Replays the session of a scenario once and returns the measured metrics by name.
+map<string, double> RunScenario(const Scenario& scenario) {
+    Engine* engine = new Engine(scenario.name, 60, 800, 640, true);
+    engine->SetDeterministic(scenario.seed);
+    engine->ReplayInput(scenario.session_path);
+    function<void(void)> clean_up = scenario.set_up(engine);
+    vector<double> frame_times;
+    long draw_calls = 0;
+    long start_allocations = AllocationCounter::GetAllocationCount();
+    while (true) {
+        chrono::steady_clock::time_point start_time = chrono::steady_clock::now();
+        if (!engine->Step()) {
+            break;
+        }
+        chrono::steady_clock::time_point stop_time = chrono::steady_clock::now();
+        frame_times.push_back(chrono::duration<double, milli>(stop_time - start_time).count());
+        draw_calls += engine->GetDrawCallCount();
+    }
+    long allocations = AllocationCounter::GetAllocationCount() - start_allocations;
+    delete engine;
+    clean_up();
+
+    map<string, double> metrics;
+    if (frame_times.empty()) {
+        return metrics;
+    }
+    double total_time = 0;
+    for (int i = 0; i < frame_times.size(); i++) {
+        total_time += frame_times[i];
+    }
+    sort(frame_times.begin(), frame_times.end());
+    metrics["mean_frame_time_ms"] = total_time / frame_times.size();
+    metrics["p99_frame_time_ms"] = frame_times[(int)ceil(frame_times.size() * 0.99) - 1];
+    metrics["allocations_per_frame"] = (double)allocations / frame_times.size();
+    metrics["draw_calls_per_frame"] = (double)draw_calls / frame_times.size();
+    return metrics;
+}
+
+// Reads the baseline file. Each line that is not empty or a comment (starting with #) holds a scenario, a metric,
+// the baseline value and the tolerance in percent.
+vector<Metric> ReadBaseline(string path) {
+    vector<Metric> metrics;
+    ifstream file(path.c_str());
+    string line;
+    while (getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        stringstream fields(line);
+        Metric metric;
+        if (fields >> metric.scenario >> metric.name >> metric.baseline >> metric.tolerance) {
+            metric.current = 0;
+            metric.has_baseline = true;
+            metric.has_current = false;
+            metrics.push_back(metric);
+        }
+    }
+    return metrics;
+}
+
+// Writes the current values of the metrics as the new baseline, keeping the tolerance of each metric.
+void WriteBaseline(string path, const vector<Metric>& metrics) {
+    ofstream file(path.c_str());
+    file << "# Performance baseline checked by PerformanceGate. One metric on each line: scenario, metric, baseline value and" << endl;
+    file << "# tolerance in percent. A metric regresses if its value exceeds the baseline by more than the tolerance." << endl;
+    file << "# Regenerate with PerformanceGate --update after an intended change." << endl;
+    for (int i = 0; i < metrics.size(); i++) {
+        if (metrics[i].has_current) {
+            file << metrics[i].scenario << " " << metrics[i].name << " " << metrics[i].current << " " << metrics[i].tolerance << endl;
+        }
+    }
+}
+
+// Prints the comparison of each metric and returns the number of regressions.
+int PrintComparison(const vector<Metric>& metrics) {
+    int regressions = 0;
+    cout << left << setw(16) << "scenario" << setw(24) << "metric" << right << setw(12) << "baseline" << setw(12) << "current"
+         << setw(10) << "change" << setw(11) << "tolerance" << "  status" << endl;
+    for (int i = 0; i < metrics.size(); i++) {
+        const Metric& metric = metrics[i];
+        string status;
+        double change = 0;
+        if (!metric.has_current) {
+            status = "missing";
+            regressions++;
+        } else if (!metric.has_baseline) {
+            status = "new";
+        } else {
+            change = metric.baseline != 0 ? (metric.current - metric.baseline) / metric.baseline * 100 : (metric.current > 0 ? 100 : 0);
+            if (metric.current > metric.baseline * (1 + metric.tolerance / 100) + 1e-9) {
+                status = "REGRESSED";
+                regressions++;
+            } else if (metric.current < metric.baseline * (1 - metric.tolerance / 100)) {
+                status = "improved";
+            } else {
+                status = "ok";
+            }
+        }
+        cout << left << setw(16) << metric.scenario << setw(24) << metric.name << right << fixed << setprecision(4)
+             << setw(12) << metric.baseline << setw(12) << metric.current << setprecision(1) << setw(9) << showpos << change << "%"
+             << noshowpos << setw(10) << metric.tolerance << "%  " << status << endl;
+    }
+    return regressions;
+}
+
+int main(int argc, const char * argv[]) {
+    string baseline_path = "baseline.txt";
+    int repetitions = 5;
+    bool is_update = false;
+    for (int i = 1; i < argc; i++) {
+        string option = argv[i];
+        if (option == "--update") {
+            is_update = true;
+        } else if (i + 1 < argc && option == "--baseline") {
+            baseline_path = argv[++i];
+        } else if (i + 1 < argc && option == "--repetitions") {
+            repetitions = atoi(argv[++i]);
+        } else {
+            cerr << "Unknown option " << option << endl;
+            return 2;
+        }
+    }
+    if (repetitions <= 0) {
+        cerr << "The number of repetitions must be positive." << endl;
+        return 2;
+    }
+    if (!AllocationCounter::IsCompiledIn()) {
+        cerr << "The allocations are not counted, build with -DGAMEENGINE_ALLOCATION_COUNTING to compare them." << endl;
+        return 2;
+    }
+
+    vector<Scenario> scenarios = {
+        {"space_shooter", "sessions/space_shooter.inputlog", 1, [](Engine* engine) {
+            SpaceShooter* game = new SpaceShooter(engine);
+            return function<void(void)>([game] { delete game; });
+        }}
+    };
+
+    // Each scenario is run several times and the lowest value of each metric is kept, since noise only makes a run slower.
+    vector<Metric> metrics = ReadBaseline(baseline_path);
+    for (int i = 0; i < scenarios.size(); i++) {
+        map<string, double> best;
+        for (int k = 0; k < repetitions; k++) {
+            cerr << "Replaying " << scenarios[i].name << " (" << k + 1 << "/" << repetitions << ")..." << endl;
+            map<string, double> current = RunScenario(scenarios[i]);
+            for (pair<const string, double>& entry : current) {
+                if (best.count(entry.first) == 0 || entry.second < best[entry.first]) {
+                    best[entry.first] = entry.second;
+                }
+            }
+        }
+        for (pair<const string, double>& entry : best) {
+            bool is_found = false;
+            for (int k = 0; k < metrics.size(); k++) {
+                if (metrics[k].scenario == scenarios[i].name && metrics[k].name == entry.first) {
+                    metrics[k].current = entry.second;
+                    metrics[k].has_current = true;
+                    is_found = true;
+                }
+            }
+            if (!is_found) {
+                Metric metric = {scenarios[i].name, entry.first, 0, entry.second, GetDefaultTolerance(entry.first), false, true};
+                metrics.push_back(metric);
+            }
+        }
+    }
+
+    if (is_update) {
+        WriteBaseline(baseline_path, metrics);
+        cout << "Wrote the baseline to " << baseline_path << endl;
+        return 0;
+    }
+    int regressions = PrintComparison(metrics);
+    if (regressions > 0) {
+        cout << regressions << " metric(s) regressed." << endl;
+        return 1;
+    }
+    cout << "No regressions." << endl;
+    return 0;
+}
@@ -0,0 +1,203 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include "AllocationCounter.h"
+
+#if defined(GAMEENGINE_ALLOCATION_COUNTING) && (defined(__APPLE__) || defined(__GLIBC__))
+#include <execinfo.h>
+#define HAS_BACKTRACE 1
+#endif
+
+// The number of allocations and allocated bytes since the program started. Only the counts themselves need to be atomic,
+// so the increments use relaxed ordering to keep the cost of an allocation as low as possible.
+static std::atomic<long> allocation_count(0);
+static std::atomic<long> allocated_bytes(0);
+
+// The number of allocations and allocated bytes of each thread. No synchronization is needed since only the thread itself reads them.
+static thread_local long thread_allocation_count = 0;
+static thread_local long thread_allocated_bytes = 0;
+
+// The number of frames kept of each call stack, and the number of frames skipped at the top of it (the capture itself
+// and operator new).
+static const int MAX_STACK_DEPTH = 12;
+static const int SKIPPED_FRAMES = 2;
+
+// The number of allocation sites that can be told apart. The table is allocated statically, since capturing a site
+// happens inside operator new and must not allocate itself.
+static const int SITE_TABLE_SIZE = 4096;
+
+// A call stack that allocates, together with the number of allocations and bytes allocated from it.
+struct AllocationSite {
+    void* frames[MAX_STACK_DEPTH];
+    int depth;
+    long count, bytes;
+};
+
+// The captured allocation sites, an open addressing hash table keyed by the call stack.
+static AllocationSite sites[SITE_TABLE_SIZE];
+static std::mutex sites_mutex;
+
+// The number of allocations that could not be attributed to a site because the table was full.
+static long dropped_count = 0;
+
+// A flag to indicate if call stacks are captured.
+static std::atomic<bool> is_capturing_stacks(false);
+
+// Set while the calling thread captures a call stack or prints the sites, so that allocations made by backtrace() or by the
+// report itself are not captured.
+static thread_local bool is_in_capture = false;
+
+#ifdef GAMEENGINE_ALLOCATION_COUNTING
+// Captures the call stack of an allocation and adds it to the site with the same call stack.
+static void CaptureSite(size_t size) {
+#ifdef HAS_BACKTRACE
+    is_in_capture = true;
+    void* frames[MAX_STACK_DEPTH + SKIPPED_FRAMES];
+    int depth = backtrace(frames, MAX_STACK_DEPTH + SKIPPED_FRAMES) - SKIPPED_FRAMES;
+    if (depth > 0) {
+        size_t hash = 14695981039346656037ULL;
+        for (int i = 0; i < depth; i++) {
+            hash = (hash ^ (size_t)frames[SKIPPED_FRAMES + i]) * 1099511628211ULL;
+        }
+        std::lock_guard<std::mutex> lock(sites_mutex);
+        bool is_found = false;
+        for (int probe = 0; probe < SITE_TABLE_SIZE && !is_found; probe++) {
+            AllocationSite& site = sites[(hash + probe) % SITE_TABLE_SIZE];
+            if (site.count == 0) {
+                memcpy(site.frames, frames + SKIPPED_FRAMES, depth * sizeof(void*));
+                site.depth = depth;
+            } else if (site.depth != depth || memcmp(site.frames, frames + SKIPPED_FRAMES, depth * sizeof(void*)) != 0) {
+                continue;
+            }
+            site.count++;
+            site.bytes += size;
+            is_found = true;
+        }
+        if (!is_found) {
+            dropped_count++;
+        }
+    }
+    is_in_capture = false;
+#endif
+}
+
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    thread_allocation_count++;
+    thread_allocated_bytes += size;
+    if (is_capturing_stacks.load(std::memory_order_relaxed) && !is_in_capture) {
+        CaptureSite(size);
+    }
+    void* memory = malloc(size > 0 ? size : 1);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    free(memory);
+}
+#endif
+
+// Returns true if operator new is replaced.
+bool AllocationCounter::IsCompiledIn() {
+#ifdef GAMEENGINE_ALLOCATION_COUNTING
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Returns the number of allocations made since the program started.
+long AllocationCounter::GetAllocationCount() {
+    return allocation_count;
+}
+
+// Returns the number of bytes allocated since the program started.
+long AllocationCounter::GetAllocatedBytes() {
+    return allocated_bytes;
+}
+
+// Returns the number of allocations made by the calling thread.
+long AllocationCounter::GetThreadAllocationCount() {
+    return thread_allocation_count;
+}
+
+// Returns the number of bytes allocated by the calling thread.
+long AllocationCounter::GetThreadAllocatedBytes() {
+    return thread_allocated_bytes;
+}
+
+// Enables or disables capturing call stacks.
+void AllocationCounter::SetStackCapture(bool is_enabled) {
+    is_capturing_stacks = is_enabled;
+}
+
+// Copies the captured sites, sorts them by the number of allocations and prints the first ones. The frames are symbolized
+// with backtrace_symbols, which gives the module and the symbol (if exported) of each frame.
+void AllocationCounter::PrintTopSites(std::ostream& out, [[maybe_unused]] int count) {
+#ifdef HAS_BACKTRACE
+    is_in_capture = true;
+    std::vector<AllocationSite> top_sites;
+    long dropped = 0;
+    {
+        std::lock_guard<std::mutex> lock(sites_mutex);
+        for (int i = 0; i < SITE_TABLE_SIZE; i++) {
+            if (sites[i].count > 0) {
+                top_sites.push_back(sites[i]);
+            }
+        }
+        dropped = dropped_count;
+    }
+    std::sort(top_sites.begin(), top_sites.end(), [](const AllocationSite& lhs, const AllocationSite& rhs) {
+        return lhs.count > rhs.count;
+    });
+    for (int i = 0; i < top_sites.size() && i < count; i++) {
+        out << top_sites[i].count << " allocations, " << top_sites[i].bytes << " bytes:" << std::endl;
+        char** symbols = backtrace_symbols(top_sites[i].frames, top_sites[i].depth);
+        for (int k = 0; k < top_sites[i].depth; k++) {
+            out << "    " << (symbols != nullptr ? symbols[k] : "?") << std::endl;
+        }
+        free(symbols);
+    }
+    if (dropped > 0) {
+        out << dropped << " allocations were not attributed to a site since the site table was full." << std::endl;
+    }
+    is_in_capture = false;
+#else
+    out << "Allocation sites are not available in this build (see AllocationCounter)." << std::endl;
+#endif
+}
+
+// Clears the site table.
+void AllocationCounter::ResetSites() {
+    std::lock_guard<std::mutex> lock(sites_mutex);
+    for (int i = 0; i < SITE_TABLE_SIZE; i++) {
+        sites[i].count = 0;
+        sites[i].bytes = 0;
+        sites[i].depth = 0;
+    }
+    dropped_count = 0;
+}
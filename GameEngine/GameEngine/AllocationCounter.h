@@ -0,0 +1,44 @@
+#ifndef __GameEngine__AllocationCounter__
+#define __GameEngine__AllocationCounter__
+
+#include <iostream>
+
+// Counts the allocations made by the program. If GAMEENGINE_ALLOCATION_COUNTING is defined (for example with
+// -DGAMEENGINE_ALLOCATION_COUNTING), the global operator new and operator delete are replaced in AllocationCounter.cpp,
+// which means that every allocation of the engine and the game is counted (see Metrics). Otherwise the allocator is left
+// alone and costs nothing extra, and all counts are 0. The benchmarks are built with the counting compiled in.
+// Allocations are counted both for the whole program and for each thread, so that the allocations of a piece of code
+// can be measured exactly even while other threads allocate (see Scheduler, which counts the allocations of each system).
+// Optionally, the call stack of each allocation is captured so that the sites that allocate the most can be found.
+class AllocationCounter {
+
+public:
+    
+    // Returns true if the counting is compiled in (see GAMEENGINE_ALLOCATION_COUNTING).
+    static bool IsCompiledIn();
+    
+    // Returns the number of allocations made since the program started.
+    static long GetAllocationCount();
+    
+    // Returns the number of bytes allocated since the program started.
+    static long GetAllocatedBytes();
+    
+    // Returns the number of allocations made by the calling thread since it started.
+    static long GetThreadAllocationCount();
+    
+    // Returns the number of bytes allocated by the calling thread since it started.
+    static long GetThreadAllocatedBytes();
+    
+    // Enables or disables capturing the call stack of each allocation. Capturing a call stack is expensive, so this is meant
+    // for finding the sites that allocate, not for measuring. Only available where backtrace() is (macOS and Linux).
+    static void SetStackCapture(bool is_enabled);
+    
+    // Prints the allocation sites with the most allocations since stack capture was enabled, at most the specified number
+    // of them, each with its number of allocations, bytes and symbolized call stack.
+    static void PrintTopSites(std::ostream& out, int count);
+    
+    // Forgets all captured allocation sites.
+    static void ResetSites();
+};
+
+#endif
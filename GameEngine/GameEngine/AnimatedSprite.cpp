@@ -5,28 +5,59 @@
 
 // Factory function to control object creation.
 AnimatedSprite* AnimatedSprite::GetInstance(std::string tag, std::vector<std::string> images, int image_change_delay, int x_pos, int y_pos, int width, int height) {
-    return new AnimatedSprite(tag, images, image_change_delay, x_pos, y_pos, width, height);
+    return new AnimatedSprite(std::move(tag), std::move(images), image_change_delay, x_pos, y_pos, width, height);
 }
 
-AnimatedSprite::AnimatedSprite(std::string tag, std::vector<std::string> images, int image_change_delay, int x_pos, int y_pos, int width, int height):images(images), image_change_delay(image_change_delay), time_since_last_draw(0), image_index(0), Sprite(tag, x_pos, y_pos, width, height, images[0]) {
-    
+AnimatedSprite::AnimatedSprite(std::string tag, std::vector<std::string> images, int image_change_delay, int x_pos, int y_pos, int width, int height):images(std::move(images)), image_change_delay(image_change_delay), Sprite(std::move(tag), x_pos, y_pos, width, height, images[0]) {
+    type = ANIMATED_SPRITE;
 }
 
-// Draws the sprite changing between each image in the image vector with a given delay.
+// Changes between each image in the image vector with a given delay.
 // Wraps around at the end of the vector.
-void AnimatedSprite::Draw(int time_elapsed) {
-    time_since_last_draw = time_since_last_draw + time_elapsed;
-    if (time_since_last_draw >= image_change_delay) {
-        file_name = images[image_index];
-        SetUpTexture(); //TODO: this could probably be optimized so that all textures needed are loaded once
-        image_index = (image_index == images.size() - 1 ? 0 : image_index + 1);
-        time_since_last_draw = 0;
+void AnimatedSprite::Update(int time_elapsed) {
+    state.time_since_last_draw = state.time_since_last_draw + time_elapsed;
+    if (state.time_since_last_draw >= image_change_delay) {
+        file_name = images[state.image_index];
+        state.texture = textures[state.image_index];
+        state.image_index = (state.image_index == images.size() - 1 ? 0 : state.image_index + 1);
+        state.time_since_last_draw = 0;
     }
-    SDL_RenderCopy(window->GetRenderer(), texture, NULL, &boundary);
+}
+
+// Returns true if the sprite has more than one image, since the image then changes after each delay.
+bool AnimatedSprite::GetIsAnimating() {
+    return images.size() > 1;
+}
+
+// Asks the window for a texture handle for each image in the image vector, so that all textures needed
+// are loaded once instead of each time the image changes.
+void AnimatedSprite::SetUpTexture() {
+    textures.clear();
+    for (int i = 0; i < images.size(); i++) {
+        textures.push_back(window->GetImageTexture(images[i]));
+    }
+    Sprite::SetUpTexture();
+}
+
+// Adds the state of the sprite, including the current image and the time since it changed, to the hash.
+void AnimatedSprite::HashState(StateHash& hash) {
+    Sprite::HashState(hash);
+    hash.Add(state.image_index);
+    hash.Add((Sint64)state.time_since_last_draw);
 }
 
 void AnimatedSprite::MoveRight(Sprite* sprite) {
-    boundary.x = boundary.x + 20;
+    state.boundary.x = state.boundary.x + 20;
+}
+
+// Returns the images to change between.
+const std::vector<std::string>& AnimatedSprite::GetImages() {
+    return images;
+}
+
+// Returns the delay between each change of image.
+int AnimatedSprite::GetImageChangeDelay() {
+    return image_change_delay;
 }
 
 AnimatedSprite::~AnimatedSprite() {
@@ -9,25 +9,40 @@
 
 // Class to represent animated sprites.
 class AnimatedSprite : public Sprite {
-    
+
 public:
     
     // Factory function to control object creation.
     static AnimatedSprite* GetInstance(std::string tag, std::vector<std::string> images, int image_change_delay, int x_pos, int y_pos, int width, int height);
     
-    // Draws the sprite changing between each image in the image vector with a given delay.
-    virtual void Draw(int);
+    // Changes between each image in the image vector with a given delay.
+    virtual void Update(int time_elapsed);
+    
+    // Returns true if the sprite has more than one image to change between.
+    virtual bool GetIsAnimating();
+    
+    // Sets up the textures for all images in the image vector.
+    virtual void SetUpTexture();
+    
+    // Adds the state of the sprite, including the current image and the time since it changed, to the hash.
+    virtual void HashState(StateHash& hash);
     
     void MoveRight(Sprite* sprite);
     
+    // Returns the images to change between.
+    const std::vector<std::string>& GetImages();
+    
+    // Returns the delay (in milliseconds) between each change of image.
+    int GetImageChangeDelay();
+    
     virtual ~AnimatedSprite();
 private:
     AnimatedSprite(std::string tag, std::vector<std::string> images, int image_change_delay, int x_pos, int y_pos, int width, int height); // Guard against value semantic
     AnimatedSprite(const AnimatedSprite& other_sprite); // Guard against value semantic
     const AnimatedSprite& operator=(const AnimatedSprite& other_sprite); // Guard against value semantic
     std::vector<std::string> images;
-    int image_change_delay, image_index;
-    double time_since_last_draw;
+    std::vector<int> textures; // The texture handles for each image in the image vector.
+    int image_change_delay;
 };
 
 #endif
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include "DrawList.h"
+
+DrawList::DrawList():is_sorted(true) {
+}
+
+// Adds a draw command that draws the whole texture to the specified destination.
+void DrawList::Add(int texture, const SDL_Rect* destination, int layer) {
+    DrawCommand command;
+    SDL_zero(command);
+    command.texture = texture;
+    command.layer = layer;
+    command.alpha = 255;
+    if (destination != nullptr) {
+        command.destination = *destination;
+        command.has_destination = true;
+    }
+    Add(command);
+}
+
+// Adds a complete draw command to the list.
+// Keeps track of whether the commands are still in layer order so that Sort can be skipped for the common case
+// where all sprites are in the same layer.
+void DrawList::Add(const DrawCommand& command) {
+    if (!commands.empty() && commands.back().layer > command.layer) {
+        is_sorted = false;
+    }
+    commands.push_back(command);
+}
+
+// Sorts the commands by layer using a stable sort, so that commands within the same layer are drawn in the order they were added.
+// std::stable_sort allocates its temporary buffer on the heap, so with an arena a bottom-up merge sort is used instead,
+// which merges runs of doubling length back and forth between the commands and a buffer allocated from the arena.
+void DrawList::Sort(FrameArena* arena) {
+    if (is_sorted) {
+        return;
+    }
+    if (arena == nullptr) {
+        std::stable_sort(commands.begin(), commands.end(), [](const DrawCommand& lhs, const DrawCommand& rhs) {
+            return lhs.layer < rhs.layer;
+        });
+        is_sorted = true;
+        return;
+    }
+    int size = (int)commands.size();
+    DrawCommand* source = commands.data();
+    DrawCommand* target = (DrawCommand*)arena->Allocate(size * sizeof(DrawCommand), alignof(DrawCommand));
+    for (int width = 1; width < size; width *= 2) {
+        for (int start = 0; start < size; start += 2 * width) {
+            int middle = std::min(start + width, size);
+            int stop = std::min(start + 2 * width, size);
+            int left = start;
+            int right = middle;
+            for (int i = start; i < stop; i++) {
+                if (left < middle && (right >= stop || source[left].layer <= source[right].layer)) {
+                    target[i] = source[left++];
+                } else {
+                    target[i] = source[right++];
+                }
+            }
+        }
+        std::swap(source, target);
+    }
+    if (source != commands.data()) {
+        std::copy(source, source + size, commands.data());
+    }
+    is_sorted = true;
+}
+
+// Removes all commands from the list without releasing the memory allocated by the list.
+void DrawList::Clear() {
+    commands.clear();
+    is_sorted = true;
+}
+
+// Returns all commands in the list.
+const std::vector<DrawCommand>& DrawList::GetCommands() const {
+    return commands;
+}
+
+// Returns the number of commands in the list.
+int DrawList::GetSize() const {
+    return (int)commands.size();
+}
+
+// Compares the commands field by field. The source and destination rectangles are only compared if they are used.
+bool DrawList::IsEqual(const DrawList& other_list) const {
+    if (commands.size() != other_list.commands.size()) {
+        return false;
+    }
+    for (int i = 0; i < commands.size(); i++) {
+        const DrawCommand& command = commands[i];
+        const DrawCommand& other_command = other_list.commands[i];
+        if (command.texture != other_command.texture || command.layer != other_command.layer || command.alpha != other_command.alpha
+            || command.has_source != other_command.has_source || command.has_destination != other_command.has_destination) {
+            return false;
+        }
+        if (command.has_source && !SDL_RectEquals(&command.source, &other_command.source)) {
+            return false;
+        }
+        if (command.has_destination && !SDL_RectEquals(&command.destination, &other_command.destination)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,73 @@
+#ifndef __GameEngine__DrawList__
+#define __GameEngine__DrawList__
+
+#include <vector>
+#include <SDL2/SDL.h>
+#include "FrameArena.h"
+
+// A single immutable draw command produced by the simulation and consumed by the renderer.
+// The texture is referred to by a handle obtained from Window::GetImageTexture or Window::GetTextTexture,
+// which means that a draw command never touches any SDL resources directly.
+struct DrawCommand {
+
+    // The handle of the texture to draw.
+    int texture;
+    
+    // The part of the texture to draw. Only used if has_source is set.
+    SDL_Rect source;
+    
+    // The area of the window to draw to. If has_destination is not set, the texture covers the whole window.
+    SDL_Rect destination;
+    
+    // Flags to indicate if the source and destination rectangles are used.
+    bool has_source, has_destination;
+    
+    // The layer of the command. Commands with a lower layer are drawn first.
+    int layer;
+    
+    // The alpha modulation applied to the texture when drawn.
+    Uint8 alpha;
+};
+
+// A list of draw commands that describes one complete frame.
+// The simulation fills one draw list while the renderer consumes the previous one.
+class DrawList {
+
+public:
+    
+    DrawList();
+    
+    // Adds a draw command that draws the texture to the specified destination.
+    // If the destination is a null pointer, the texture covers the whole window.
+    void Add(int texture, const SDL_Rect* destination, int layer);
+    
+    // Adds a complete draw command to the list.
+    void Add(const DrawCommand& command);
+    
+    // Sorts the commands by layer. Commands within the same layer keep the order they were added in.
+    // If an arena is specified, the temporary memory needed by the sort is allocated from it instead of from the heap.
+    void Sort(FrameArena* arena = nullptr);
+    
+    // Removes all commands from the list. The memory allocated by the list is kept for the next frame.
+    void Clear();
+    
+    // Returns all commands in the list.
+    const std::vector<DrawCommand>& GetCommands() const;
+    
+    // Returns the number of commands in the list.
+    int GetSize() const;
+    
+    // Returns true if the list has the same commands in the same order as the other list, which means that both lists
+    // produce the same frame.
+    bool IsEqual(const DrawList& other_list) const;
+
+private:
+    
+    // The commands in this draw list.
+    std::vector<DrawCommand> commands;
+    
+    // A flag to indicate if the commands have been added out of layer order and needs to be sorted.
+    bool is_sorted;
+};
+
+#endif
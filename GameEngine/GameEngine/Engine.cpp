@@ -1,42 +1,425 @@
 #include "Engine.h"
 #include <sys/time.h>
+#include <iomanip>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+#include "AllocationCounter.h"
+#include "Trace.h"
+#include "LevelFile.h"
 
-Uint32 Engine::time_event_type;
+// The number of seconds of frames and the number of input events kept by the flight recorder.
+static const int FLIGHT_RECORDER_SECONDS = 10;
+static const int FLIGHT_RECORDER_EVENTS = 4096;
 
+// The state of the engine itself at the end of a frame, which is saved at the start of the state of the world in the
+// history, followed by a snapshot of the current level. The level is saved by its index among the levels, or -1.
+// The events emitted in a frame are not saved, since each frame emits the same time event (see EmitTimeEvent).
+struct WorldState {
+    int frame_counter;
+    int level_index;
+    bool is_timelisteners_paused;
+    double time_elapsed;
+    Uint64 state_hash;
+    std::mt19937 random_generator;
+};
+static_assert(std::is_trivially_copyable<WorldState>::value, "The world state is saved by copying its bytes.");
+
+// The sprites replaced by restoring a world state without a current level.
+static const std::vector<Level::ReplacedSprite> NO_REPLACED_SPRITES;
+
+// Returns the type ID of time events. The ID is registered by calling SDL_RegisterEvents the first time this function is called.
+// The initialization of the static variable is thread safe, which means that engines on different threads get the same ID.
 Uint32 Engine::GetTimeEventType() {
+    static Uint32 time_event_type = SDL_RegisterEvents(1);
     return time_event_type;
 }
 
-Engine::Engine(std::string game_name, int fps, int window_width, int window_height):fps(fps), frame_counter(0) {
-    window = new Window(game_name, window_width, window_height);
+// A headless engine has no worker threads for the frame schedule, so all systems are executed on the thread calling Step.
+// The worker threads for tasks are only created if the game launches a task.
+Engine::Engine(std::string game_name, int fps, int window_width, int window_height, bool is_headless):is_timelisteners_paused(false), fps(fps), frame_counter(0), time_elapsed(0), current_level(nullptr), is_frame_requested(false), is_frame_done(false), is_simulation_stopped(false), hitch_threshold(2000.0 / fps), hitch_count(0), flight_recorder(new FlightRecorder(FLIGHT_RECORDER_SECONDS * fps, FLIGHT_RECORDER_EVENTS, fps)), hitch_dump_frame(-1), is_idle_throttling(true), idle_frame_count(0), allocation_check_frame(-1), poll_time(0), render_time(0), wait_time(0), delay_time(0), frame_arena(new FrameArena()), emitted_events(FrameAllocator<SDL_Event>(frame_arena)), delegated_events(FrameAllocator<SDL_Event>(frame_arena)), is_headless(is_headless), random_generator(std::random_device()()), is_deterministic(false), state_hash(0), divergence_frame(-1), render_index(0) {
+    startup_timeline = new StartupTimeline();
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    metrics = new Metrics();
+    frame_times = new FrameTimeHistogram();
+    window = new Window(game_name, window_width, window_height, is_headless, startup_timeline);
+    window->SetMetrics(metrics);
+    thread_pool = is_headless ? nullptr : new ThreadPool(ThreadPool::GetDefaultThreadCount());
+    scheduler = new Scheduler(thread_pool);
+    script_runner = new ScriptRunner();
+    task_pool = nullptr;
+    task_runner = nullptr;
+    AddEngineSystems();
+    StartupTimeline::Record(startup_timeline, "engine.construct", start_time);
 }
 
 // The main event loop of the game engine.
 // Executes the following steps:
 // 1. Get a timestamp at the start of the iteration.
-// 2. Poll all events that has been emitted since the last iteration (and delegate them).
-// 3. Delegate re-drawing of sprites by calling Window::DrawSprites.
-// 4. Increment the frame counter.
-// 5. Check for collisions.
-// 6. Emit a new time event.
-// 7. Ask the current level to clean up all the sprites that have been marked as deleted.
-// 8. Timeout for 1000 / fps milliseconds.
-// 9. Get a timestamp at the end of the iteration.
-// 10. Set the total time that the iteration took.
+// 2. Poll all events that has been emitted since the last iteration (and queue them for the simulation), or queue the
+//    replayed events if the engine is replaying recorded input. Stop if the main event loop has been terminated.
+//    The queued events are recorded in the flight recorder.
+// 3. Start the next simulation frame on the simulation thread (see Engine::SimulateFrame).
+// 4. Render the draw list produced by the previous simulation frame while the simulation is running, followed by the
+//    performance overlay if it is shown. The first time a simulated frame is rendered, it is recorded on the startup timeline.
+// 5. Wait for the simulation frame to finish and swap the draw lists.
+// 6. Timeout for 1000 / fps milliseconds, or if the game is idle, block until the next input event or until the next time
+//    listener or script is due (see Engine::SetIdleThrottling).
+// 7. Get a timestamp at the end of the iteration.
+// 8. Set the total time that the iteration took, and record it in the frame time histogram and the flight recorder
+//    (see Engine::RecordFrameTime). The time blocked while idle is not part of the frame.
+// 9. Skip the frames that passed while idle, and move the frame arena on to the next frame.
+// Since rendering and simulation run at the same time, the time of an iteration is the longest of the two instead of the sum.
+// A headless engine simply calls Step until the main event loop is terminated, at the frame rate if it serves snapshots.
+// When recording input, the frame where the main event loop terminated is recorded last so that a replay ends in the same frame.
 void Engine::Run() {
     is_running = true;
+    if (is_headless) {
+        while (is_running) {
+            std::chrono::steady_clock::time_point frame_start = std::chrono::steady_clock::now();
+            Step();
+            if (snapshot_server != nullptr) {
+                std::this_thread::sleep_until(frame_start + std::chrono::microseconds(1000000 / fps));
+            }
+        }
+        RecordQuit();
+        return;
+    }
+    std::chrono::steady_clock::time_point run_start = std::chrono::steady_clock::now();
+    long iteration = 0;
+    is_simulation_stopped = false;
+    simulation_thread = std::thread(&Engine::RunSimulation, this);
     while (is_running) {
+        TRACE_ZONE("Engine::Run");
+        std::chrono::steady_clock::time_point frame_start = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point phase_start = frame_start;
         long start_time = GetTimestamp();
         PollEvent();
-        window->DrawSprites(time_elapsed);
-        frame_counter++;
-        DetectCollision();
-        EmitTimeEvent();
-        current_level->CleanUpSprites();
-        SDL_Delay(1000 / fps);
+        ReplayEvents();
+        if (!is_running) {
+            break;
+        }
+        RecordInputEvents();
+        poll_time = GetPhaseTime(phase_start);
+        RequestFrame();
+        window->Render(draw_lists[render_index]);
+        if (iteration++ == 1) {
+            RecordFirstFrame(run_start);
+        }
+        double overlay_time = window->GetOverlay() != nullptr ? window->GetOverlay()->GetLastRenderTime() : 0;
+        render_time = GetPhaseTime(phase_start) - overlay_time;
+        WaitForFrame();
+        wait_time = GetPhaseTime(phase_start);
+        int idle_frames = GetIdleFrames();
+        double idle_time = 0;
+        if (idle_frames > 0) {
+            idle_time = WaitWhileIdle(idle_frames);
+        } else {
+            SDL_Delay(1000 / fps);
+        }
+        delay_time = GetPhaseTime(phase_start) - idle_time;
         long stop_time = GetTimestamp();
-        SetTimeElapsed(start_time, stop_time);
+        SetTimeElapsed(start_time, stop_time - (long)idle_time);
+        RecordFrameTime(GetPhaseTime(frame_start) - overlay_time - idle_time);
+        SkipIdleFrames(idle_frames, idle_time);
+        frame_arena->NextFrame();
+    }
+    StopSimulation();
+    RecordQuit();
+    if (simulation_error) {
+        std::exception_ptr error = simulation_error;
+        simulation_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+// Simulates one frame on the calling thread with a fixed time elapsed of 1000 / fps milliseconds.
+// The draw lists are swapped just like after a frame on the simulation thread, so that the last draw list is always the one being rendered.
+bool Engine::Step() {
+    TRACE_ZONE("Engine::Step");
+    std::chrono::steady_clock::time_point frame_start = std::chrono::steady_clock::now();
+    ReplayEvents();
+    if (GetIsReplaying() && input_log->IsFinished()) {
+        input_events.clear();
+        return false;
+    }
+    RecordInputEvents();
+    time_elapsed = 1000.0 / fps;
+    SimulateFrame();
+    input_events.clear();
+    render_index = 1 - render_index;
+    RecordFrameTime(GetPhaseTime(frame_start));
+    frame_arena->NextFrame();
+    return true;
+}
+
+// Returns the number of draw commands in the draw list of the last simulated frame.
+int Engine::GetDrawCallCount() {
+    return draw_lists[render_index].GetSize();
+}
+
+// Returns the metrics of the engine.
+Metrics* Engine::GetMetrics() {
+    return metrics;
+}
+
+// Returns the histogram of frame times.
+FrameTimeHistogram* Engine::GetFrameTimes() {
+    return frame_times;
+}
+
+// Sets the frame time above which a frame is a hitch.
+void Engine::SetHitchThreshold(double hitch_threshold) {
+    this->hitch_threshold = hitch_threshold;
+}
+
+// Opens the file that hitch records are written to.
+void Engine::LogHitches(std::string path) {
+    hitch_log.open(path.c_str());
+    if (!hitch_log) {
+        throw std::runtime_error("Failed to open the hitch log file!");
+    }
+}
+
+// Returns the number of hitches so far.
+int Engine::GetHitchCount() {
+    return hitch_count;
+}
+
+// Returns the flight recorder.
+FlightRecorder* Engine::GetFlightRecorder() {
+    return flight_recorder.get();
+}
+
+// Writes the flight recorder to the file.
+void Engine::DumpFlightRecorder(std::string path) {
+    if (!flight_recorder->Dump(path.c_str(), FlightRecorder::ON_DEMAND)) {
+        throw std::runtime_error("Failed to write the flight recorder file!");
+    }
+}
+
+// Sets the file that the flight recorder is written to on a hitch.
+void Engine::DumpFlightRecorderOnHitch(std::string path) {
+    hitch_dump_path = path;
+}
+
+// Sets the file that the flight recorder is written to on a crash.
+void Engine::DumpFlightRecorderOnCrash(std::string path) {
+    flight_recorder->SetCrashDumpPath(path.c_str());
+}
+
+// Starts the telemetry server.
+void Engine::ServeTelemetry(int port) {
+    if (telemetry_server == nullptr) {
+        telemetry_server.reset(new TelemetryServer(port));
+    }
+}
+
+// Returns the telemetry server.
+TelemetryServer* Engine::GetTelemetryServer() {
+    return telemetry_server.get();
+}
+
+// Starts the snapshot server.
+void Engine::ServeSnapshots(int port) {
+    if (snapshot_server == nullptr) {
+        snapshot_server.reset(new SnapshotServer(port));
+    }
+}
+
+// Returns the snapshot server.
+SnapshotServer* Engine::GetSnapshotServer() {
+    return snapshot_server.get();
+}
+
+// Creates the snapshot client, which expects a snapshot every 1000 / fps milliseconds.
+void Engine::ConnectToServer(int port) {
+    if (snapshot_client == nullptr) {
+        snapshot_client.reset(new SnapshotClient(port, 1000.0 / fps));
+    }
+}
+
+// Returns the snapshot client.
+SnapshotClient* Engine::GetSnapshotClient() {
+    return snapshot_client.get();
+}
+
+// Creates the overlay the first time it is shown, and hands it to the window while it is shown.
+void Engine::SetOverlayVisible(bool is_visible) {
+    if (is_visible && overlay == nullptr) {
+        overlay.reset(new PerformanceOverlay(fps));
     }
+    window->SetOverlay(is_visible ? overlay.get() : nullptr);
+}
+
+// Returns the startup timeline.
+StartupTimeline* Engine::GetStartupTimeline() {
+    return startup_timeline;
+}
+
+// Lets the window initiate the subsystems.
+void Engine::InitSubsystems(Uint32 subsystems) {
+    window->InitSubsystems(subsystems);
+}
+
+// Returns true if the overlay is shown.
+bool Engine::GetIsOverlayVisible() {
+    return window->GetOverlay() != nullptr;
+}
+
+// Enables or disables idle throttling.
+void Engine::SetIdleThrottling(bool is_enabled) {
+    is_idle_throttling = is_enabled;
+}
+
+// Returns true if idle throttling is enabled.
+bool Engine::GetIsIdleThrottling() {
+    return is_idle_throttling;
+}
+
+// Returns the number of frames skipped while idle.
+long Engine::GetIdleFrameCount() {
+    return idle_frame_count;
+}
+
+// Returns the arena for temporary data of the current frame.
+FrameArena* Engine::GetFrameArena() {
+    return frame_arena;
+}
+
+// Returns true if the engine is headless.
+bool Engine::GetIsHeadless() {
+    return is_headless;
+}
+
+// Returns the number of frames simulated so far.
+int Engine::GetFrameCount() {
+    return frame_counter;
+}
+
+// Returns a random number between 0 and range - 1.
+int Engine::GetRandom(int range) {
+    return std::uniform_int_distribution<int>(0, range - 1)(random_generator);
+}
+
+// Puts the engine in deterministic mode and seeds the random generator.
+void Engine::SetDeterministic(unsigned int seed) {
+    is_deterministic = true;
+    random_generator.seed(seed);
+    state_hash = seed;
+}
+
+// Returns true if the engine is in deterministic mode.
+bool Engine::GetIsDeterministic() {
+    return is_deterministic;
+}
+
+// Returns the hash of the state at the end of the last frame.
+Uint64 Engine::GetStateHash() {
+    return state_hash;
+}
+
+// Opens the file that the state hashes are written to, one line with frame number and hash for each frame.
+void Engine::RecordStateHashes(std::string path) {
+    state_hash_log.open(path.c_str());
+    if (!state_hash_log) {
+        throw std::runtime_error("Failed to open the state hash file!");
+    }
+}
+
+// Reads the state hashes written by RecordStateHashes.
+void Engine::VerifyStateHashes(std::string path) {
+    std::ifstream file(path.c_str());
+    if (!file) {
+        throw std::runtime_error("Failed to open the state hash file!");
+    }
+    int frame;
+    Uint64 hash;
+    while (file >> frame >> std::hex >> hash >> std::dec) {
+        if (frame >= reference_state_hashes.size()) {
+            reference_state_hashes.resize(frame + 1, 0);
+        }
+        reference_state_hashes[frame] = hash;
+    }
+    divergence_frame = -1;
+}
+
+// Returns the first frame where the state hash differed from the verified hashes.
+int Engine::GetDivergenceFrame() {
+    return divergence_frame;
+}
+
+// Creates the history, which starts with the next frame.
+void Engine::KeepHistory(int frames) {
+    world_history.reset(new WorldHistory(frames));
+}
+
+// Returns the history of the world.
+WorldHistory* Engine::GetWorldHistory() {
+    return world_history.get();
+}
+
+// Rewinds the history to the frame and applies the state of the world saved at the end of it.
+const std::vector<Level::ReplacedSprite>& Engine::RestoreFrame(int frame) {
+    TRACE_ZONE("Engine::RestoreFrame");
+    CheckRollBack();
+    if (world_history == nullptr || !world_history->Rewind(frame, history_buffer)) {
+        throw std::runtime_error("The frame is not kept in the history!");
+    }
+    return ApplyWorldState(history_buffer);
+}
+
+// Takes a copy of the input of the frames after the frame first, since restoring the frame drops them from the history.
+// Each frame is then simulated just like in Step, but without replaying, recording or timing anything.
+const std::vector<Level::ReplacedSprite>& Engine::Resimulate(int frame) {
+    TRACE_ZONE("Engine::Resimulate");
+    CheckRollBack();
+    if (world_history == nullptr || !world_history->HasFrame(frame)) {
+        throw std::runtime_error("The frame is not kept in the history!");
+    }
+    std::vector<std::vector<SDL_Event>> inputs;
+    for (int i = frame + 1; i <= world_history->GetNewestFrame(); i++) {
+        inputs.push_back(world_history->HasFrame(i) ? world_history->GetInput(i) : std::vector<SDL_Event>());
+    }
+    const std::vector<Level::ReplacedSprite>& replaced_sprites = RestoreFrame(frame);
+    for (int i = 0; i < inputs.size(); i++) {
+        input_events.swap(inputs[i]);
+        time_elapsed = 1000.0 / fps;
+        SimulateFrame();
+        input_events.clear();
+        render_index = 1 - render_index;
+        frame_arena->NextFrame();
+    }
+    return replaced_sprites;
+}
+
+// Scripts and tasks are the only state of the simulation that cannot be saved to the history.
+bool Engine::GetCanRollBack() {
+    return world_history != nullptr && script_runner->GetScriptCount() == 0 && (task_runner == nullptr || task_runner->GetPendingCount() == 0);
+}
+
+// Throws if a script or task is pending. A missing history is reported by the callers as a frame that is not kept.
+void Engine::CheckRollBack() {
+    if (script_runner->GetScriptCount() > 0 || (task_runner != nullptr && task_runner->GetPendingCount() > 0)) {
+        throw std::runtime_error("Cannot roll back while scripts or tasks are pending!");
+    }
+}
+
+// Opens the input log that polled events are recorded to.
+void Engine::RecordInput(std::string path) {
+    input_log.reset();
+    input_log.reset(InputLog::GetRecorder(path));
+}
+
+// Opens the input log that events are replayed from.
+void Engine::ReplayInput(std::string path) {
+    input_log.reset();
+    input_log.reset(InputLog::GetReplay(path));
+}
+
+// Returns true if the engine is replaying recorded input.
+bool Engine::GetIsReplaying() {
+    return input_log != nullptr && !input_log->IsRecording();
 }
 
 // Adds a new level to this game engine.
@@ -44,6 +427,13 @@ void Engine::AddLevel(Level* level) {
     levels.push_back(level);
 }
 
+// Creates the level of the file and adds it like any other level.
+Level* Engine::LoadLevel(std::string path) {
+    Level* level = LevelFile::Load(path);
+    AddLevel(level);
+    return level;
+}
+
 // Sets the current level of this engine by directly calling Window::LoadLevel.
 void Engine::SetCurrentLevel(Level* level) {
     current_level = level;
@@ -56,22 +446,137 @@ Level* Engine::GetCurrentLevel() {
 }
 
 // Sets the collision listener that is called each time a collision occurs.
-void Engine::SetCollisionListener(std::function<void(Sprite*, Sprite*)> listener) {
-    current_collision_listener = listener;
+void Engine::SetCollisionListener(std::function<void(Sprite*, Sprite*)> listener, std::string name) {
+    current_collision_listener = {listener, name != "" ? name : "engine.collision"};
 }
 
 // Adds a new time listener to the internal map that contains all time listeners.
 // The delay is used as key, meaning that two time listeners with the same delay cannot be
 // registered at the same time.
-void Engine::AddTimeListener(std::function<void(void)> listener, int delay) {
-    time_listeners[delay] = listener;
+void Engine::AddTimeListener(std::function<void(void)> listener, int delay, std::string name) {
+    time_listeners[delay] = {listener, name != "" ? name : "engine.time[" + std::to_string(delay) + "ms]"};
 }
 
 // Adds a new event listener to the interal map that contains all event listeners.
 // The keycode is used as key, meaning that two event listeners with the same keycode cannot be
 // registered at the same time.
-void Engine::AddEventListener(std::function<void(void)> listener, int key_code) {
-    event_listeners[key_code] = listener;
+void Engine::AddEventListener(std::function<void(void)> listener, int key_code, std::string name) {
+    event_listeners[key_code] = {listener, name != "" ? name : "engine.event[" + std::to_string(key_code) + "]"};
+}
+
+// Creates the listener profiler the first time profiling is enabled and hands it to the window, which is where the levels
+// and sprites find it. Disabling profiling takes the profiler away from the window but keeps what it has recorded.
+void Engine::SetListenerProfiling(bool is_enabled) {
+    if (is_enabled && listener_profiler == nullptr) {
+        listener_profiler.reset(new ListenerProfiler());
+    }
+    window->SetListenerProfiler(is_enabled ? listener_profiler.get() : nullptr);
+}
+
+// Returns the listener profiler.
+ListenerProfiler* Engine::GetListenerProfiler() {
+    return listener_profiler.get();
+}
+
+// Prints the listeners with the highest total time.
+void Engine::PrintListenerReport(std::ostream& out, int count) {
+    if (listener_profiler == nullptr) {
+        out << "Listener profiling has not been enabled." << std::endl;
+        return;
+    }
+    listener_profiler->PrintReport(out, count);
+}
+
+// Adds a system to the frame schedule.
+void Engine::AddSystem(std::string name, std::function<void(void)> system, std::vector<std::string> reads, std::vector<std::string> writes, std::vector<std::string> dependencies) {
+    scheduler->AddSystem(name, system, reads, writes, dependencies);
+}
+
+// Hands the script over to the script runner, which starts it in the next frame.
+void Engine::StartScript(Script script) {
+    script_runner->Start(std::move(script));
+}
+
+// Returns an awaitable that resumes the script after the specified delay. The delay is converted to frames in the same way
+// as for time listeners.
+ScriptRunner::DelayAwaiter Engine::Delay(int delay) {
+    return script_runner->Delay((long)round(((fps / 1000.0) * delay)));
+}
+
+// Returns an awaitable that resumes the script in the next frame.
+ScriptRunner::DelayAwaiter Engine::NextFrame() {
+    return script_runner->Delay(1);
+}
+
+// Returns an awaitable that resumes the script when the specified key is pressed.
+ScriptRunner::KeyAwaiter Engine::WaitForKey(int key_code) {
+    return script_runner->WaitForKey(key_code);
+}
+
+// Returns an awaitable that resumes the script when sprites with the specified tags collide.
+ScriptRunner::CollisionAwaiter Engine::WaitForCollision(std::string tag1, std::string tag2) {
+    return script_runner->WaitForCollision(tag1, tag2);
+}
+
+// Launches a task on the worker threads.
+Task Engine::RunAsync(std::function<void(void)> work, std::function<void(void)> continuation) {
+    return GetTaskRunner()->Launch(work, continuation);
+}
+
+// Launches a task and ties it to the lifetime of the sprite.
+Task Engine::RunAsync(std::function<void(void)> work, std::function<void(void)> continuation, Sprite* owner) {
+    Task task = GetTaskRunner()->Launch(work, continuation);
+    owner->AddTask(task);
+    return task;
+}
+
+// Launches a task and ties it to the lifetime of the level.
+Task Engine::RunAsync(std::function<void(void)> work, std::function<void(void)> continuation, Level* owner) {
+    Task task = GetTaskRunner()->Launch(work, continuation);
+    owner->AddTask(task);
+    return task;
+}
+
+// Returns the task runner, creating it and its worker threads the first time a task is launched.
+TaskRunner* Engine::GetTaskRunner() {
+    if (task_runner == nullptr) {
+        task_pool = new ThreadPool(ThreadPool::GetDefaultThreadCount());
+        task_runner = new TaskRunner(task_pool);
+    }
+    return task_runner;
+}
+
+// Prints the stages of the frame schedule.
+void Engine::PrintSchedule(std::ostream& out) {
+    scheduler->PrintSchedule(out);
+}
+
+// Prints the time spent in each system of the frame schedule.
+void Engine::PrintSystemTimings(std::ostream& out) {
+    scheduler->PrintTimings(out);
+}
+
+// Returns the names of the systems of the frame schedule.
+std::vector<std::string> Engine::GetSystemNames() {
+    return scheduler->GetSystemNames();
+}
+
+// Returns the total time the named system has taken in all frames so far.
+double Engine::GetSystemTime(std::string name) {
+    return scheduler->GetTotalTime(name);
+}
+
+// Returns the total number of allocations the named system has made in all frames so far.
+long Engine::GetSystemAllocations(std::string name) {
+    return scheduler->GetTotalAllocations(name);
+}
+
+// Sets the first frame where allocations are not allowed. Without the counting compiled in every frame would pass the check.
+void Engine::ExpectNoAllocations(int warm_up_frames) {
+    if (!AllocationCounter::IsCompiledIn()) {
+        throw std::runtime_error("The allocations are not counted, build with -DGAMEENGINE_ALLOCATION_COUNTING to check them!");
+    }
+    allocation_check_frame = frame_counter + warm_up_frames;
 }
 
 // Pauses all time listeners that have been added to the game engine by setting the flag time_listeners_paused.
@@ -99,69 +604,91 @@ void Engine::Quit() {
     is_running = false;
 }
 
-// Sets the time_event_type if not previsouly set by calling SDL_RegisterEvents.
-// Then creates a new event if a new time event type ID could be generated.
+// Creates a new time event if a time event type ID could be registered.
 // The current fps value (user.data1) as well as the frame_counter value (user.data2) is added to the
-// event before it is pushed to SDL by calling SDL_PushEvent.
+// event before it is queued for the next simulation frame.
 void Engine::EmitTimeEvent() {
-    if (time_event_type == 0) {
-        time_event_type = SDL_RegisterEvents(1);
-    }
-    if (time_event_type != ((Uint32)-1)) {
+    TRACE_ZONE("Engine::EmitTimeEvent");
+    if (GetTimeEventType() != ((Uint32)-1)) {
         SDL_Event time_event;
         SDL_zero(time_event);
-        time_event.type = time_event_type;
+        time_event.type = GetTimeEventType();
         time_event.user.code = 0;
         time_event.user.data1 = &fps;
         time_event.user.data2 = &frame_counter;
-        SDL_PushEvent(&time_event);
+        emitted_events.push_back(time_event);
     }
 }
 
 // Called in each iteration of the main event looop. Iterates through each sprite and checks if that sprites contains any of the other sprites.
-// If a collision is detected, then the current collision listener is called (if any).
+// If a collision is detected, then the current collision listener is called (if any) and the scripts waiting for the collision are woken up.
 // This collision detection is only considering overlaping sprite boundaries and does not check for collisions on pixel level.
 // The time complexity for this function is O(N^2) where N is the number of sprites added to the game engine.
+// The number of pairs tested and collisions found are counted in the metrics.
 void Engine::DetectCollision() {
+    TRACE_ZONE("Engine::DetectCollision");
+    ListenerProfiler* profiler = window->GetListenerProfiler();
+    long pairs_tested = 0;
+    long collisions = 0;
+    long invocations = 0;
     for (int i = 0; i < current_level->GetSprites().size(); i++) {
         for (int j = 0; j < current_level->GetSprites().size(); j++) {
-            if (current_level->GetSprites()[i] != current_level->GetSprites()[j] && current_level->GetSprites()[i]->Contains(current_level->GetSprites()[j])) { // TODO: transparent pixels
-                if (current_collision_listener != nullptr) {
-                    current_collision_listener(current_level->GetSprites()[i], current_level->GetSprites()[j]);
+            if (current_level->GetSprites()[i] == current_level->GetSprites()[j]) {
+                continue;
+            }
+            pairs_tested++;
+            if (current_level->GetSprites()[i]->Contains(current_level->GetSprites()[j])) { // TODO: transparent pixels
+                collisions++;
+                if (script_runner->HasCollisionWaiters()) {
+                    script_runner->NotifyCollision(current_level->GetSprites()[i], current_level->GetSprites()[j]);
+                }
+                if (current_collision_listener.function != nullptr) {
+                    ListenerProfiler::Call(profiler, current_collision_listener, current_level->GetSprites()[i], current_level->GetSprites()[j]);
+                    invocations++;
                 }
             }
         }
     }
+    metrics->Add(Metrics::COLLISION_PAIRS_TESTED, pairs_tested);
+    metrics->Add(Metrics::COLLISIONS_REPORTED, collisions);
+    metrics->Add(Metrics::LISTENER_INVOCATIONS, invocations);
 }
 
 // Delegates an event to the correct handler function and propagates the event to the sprites.
 void Engine::DelegateEvent(SDL_Event& event) {
+    TRACE_ZONE("Engine::DelegateEvent");
+    metrics->Add(Metrics::EVENTS_DISPATCHED);
     if (event.type == SDL_MOUSEMOTION || event.type == SDL_MOUSEBUTTONDOWN || event.type == SDL_MOUSEBUTTONUP || event.type == SDL_MOUSEWHEEL) {
         HandleEvent(event, true);
         current_level->DelegateEvent(event);
     } else if (event.type == SDL_KEYDOWN) {
+        script_runner->NotifyKey(event);
         HandleEvent(event, false);
         current_level->DelegateEvent(event);
-    } else if (event.type == Engine::time_event_type) {
+    } else if (event.type == GetTimeEventType()) {
         HandleTime(event);
         current_level->DelegateEvent(event);
     } else if (event.type == SDL_TEXTINPUT) {
         current_level->DelegateEvent(event);
-    } else if (event.type == SDL_QUIT) {
-        Quit();
     }
 }
 
 // Iterates through each event listener and evaluates if the event listener should be called.
 // This is done by checking that the event source corresponds to the key or button registererd for the listner.
 void Engine::HandleEvent(SDL_Event& event, bool mouse_event) {
-    for (std::pair<const int, std::function<void(void)>>& entry : event_listeners) {
+    TRACE_ZONE("Engine::HandleEvent");
+    int invocations = 0;
+    ListenerProfiler* profiler = window->GetListenerProfiler();
+    for (std::pair<const int, NamedListener<std::function<void(void)>>>& entry : event_listeners) {
         if (mouse_event && entry.first == event.type) {
-            entry.second();
+            ListenerProfiler::Call(profiler, entry.second);
+            invocations++;
         } else if (!mouse_event && entry.first == event.key.keysym.sym) {
-            entry.second();
+            ListenerProfiler::Call(profiler, entry.second);
+            invocations++;
         }
     }
+    metrics->Add(Metrics::LISTENER_INVOCATIONS, invocations);
 }
 
 // Iterates through each time listener and evaluates if the time listener should be called.
@@ -170,29 +697,489 @@ void Engine::HandleEvent(SDL_Event& event, bool mouse_event) {
 // if the current fps is set to 30 and the delay for a time event listener is set to 60. Then that specific time event listener
 // should be called every second main event loop iteration.
 void Engine::HandleTime(SDL_Event& event) {
-    for (std::pair<const int, std::function<void(void)>>& entry : time_listeners) {
+    TRACE_ZONE("Engine::HandleTime");
+    int invocations = 0;
+    ListenerProfiler* profiler = window->GetListenerProfiler();
+    for (std::pair<const int, NamedListener<std::function<void(void)>>>& entry : time_listeners) {
         int fps = *((int*)event.user.data1);
         int frame_counter = *((int*)event.user.data2);
         int rhs = (int)(round(((fps / 1000.0 ) * entry.first)));
         if (rhs > 0) {
             int result = frame_counter % rhs;
             if (result == 0) {
-                entry.second();
+                ListenerProfiler::Call(profiler, entry.second);
+                invocations++;
             }
         } else {
-            entry.second();
+            ListenerProfiler::Call(profiler, entry.second);
+            invocations++;
         }
     }
+    metrics->Add(Metrics::LISTENER_INVOCATIONS, invocations);
 }
 
-// Polls all events that have been registered since the last iteration of the main event loop and delegates them.
+// Polls all events that have been registered since the last iteration of the main event loop and queues them
+// for the next simulation frame. Quit events are handled directly since they control the main event loop.
+// Polled events are recorded if the engine is recording input, and ignored if the engine is replaying input.
 void Engine::PollEvent() {
+    TRACE_ZONE("Engine::PollEvent");
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
-        DelegateEvent(event);
+        if (event.type == SDL_QUIT) {
+            Quit();
+        } else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_F3) {
+            if (event.key.repeat == 0) {
+                SetOverlayVisible(!GetIsOverlayVisible());
+            }
+        } else if (input_log == nullptr) {
+            input_events.push_back(event);
+        } else if (input_log->IsRecording()) {
+            input_log->Record(frame_counter, event);
+            input_events.push_back(event);
+        }
+    }
+}
+
+// Queues the replayed events for the frame about to be simulated.
+void Engine::ReplayEvents() {
+    TRACE_ZONE("Engine::ReplayEvents");
+    if (input_log == nullptr || input_log->IsRecording()) {
+        return;
+    }
+    input_log->Replay(frame_counter, input_events);
+    if (input_log->IsFinished()) {
+        Quit();
+    }
+}
+
+// Records a quit event for the current frame if the engine is recording input.
+void Engine::RecordQuit() {
+    if (input_log != nullptr && input_log->IsRecording()) {
+        SDL_Event event;
+        event.type = SDL_QUIT;
+        input_log->Record(frame_counter, event);
+    }
+}
+
+// Waits for frame requests from the main thread and simulates one frame for each request until the simulation is stopped.
+// Any exception thrown during a frame is stored and rethrown on the main thread.
+void Engine::RunSimulation() {
+    std::unique_lock<std::mutex> lock(frame_mutex);
+    while (true) {
+        frame_condition.wait(lock, [this] { return is_frame_requested || is_simulation_stopped; });
+        if (is_simulation_stopped) {
+            break;
+        }
+        is_frame_requested = false;
+        lock.unlock();
+        try {
+            SimulateFrame();
+        } catch (...) {
+            simulation_error = std::current_exception();
+        }
+        lock.lock();
+        is_frame_done = true;
+        frame_condition.notify_all();
+    }
+}
+
+// Simulates one frame by running the frame schedule. The history is recorded and the snapshots are sent after the schedule
+// rather than by systems, so that they hold the state after every system of the frame, including the systems added by the game.
+void Engine::SimulateFrame() {
+    TRACE_ZONE("Engine::SimulateFrame");
+    scheduler->Run();
+    RecordHistory();
+    if (snapshot_server != nullptr) {
+        snapshot_server->Send(frame_counter, current_level);
+    }
+    CheckAllocations();
+}
+
+// Throws if the systems allocated in the last frame. Allocations made outside the systems (polling, rendering, the scheduler
+// itself) are not checked, since they do not belong to the simulation. Stack capture is stopped before the message is built,
+// so that the captured allocation sites end with the ones of the failing frame.
+void Engine::CheckAllocations() {
+    if (allocation_check_frame < 0 || frame_counter <= allocation_check_frame) {
+        return;
+    }
+    long allocations = scheduler->GetLastFrameAllocations();
+    if (allocations == 0) {
+        return;
+    }
+    AllocationCounter::SetStackCapture(false);
+    std::vector<std::string> names = scheduler->GetSystemNames();
+    std::string message = "Frame " + std::to_string(frame_counter) + " allocated " + std::to_string(allocations) + " times after the warm-up:";
+    for (int i = 0; i < names.size(); i++) {
+        long system_allocations = scheduler->GetLastAllocations(names[i]);
+        if (system_allocations > 0) {
+            message += " " + names[i] + " (" + std::to_string(system_allocations) + " allocations, "
+                       + std::to_string(scheduler->GetLastAllocatedBytes(names[i])) + " bytes)";
+        }
+    }
+    throw std::runtime_error(message);
+}
+
+// Adds the engine's own systems to the frame schedule. Since they all write the sprites, they are executed in the following order:
+// 1. Apply the snapshots received from the server if the engine is a client.
+// 2. Delegate all events queued by the main thread.
+// 3. Update the sprites and fill the draw list not being rendered by calling Window::UpdateSprites, then increment the frame counter.
+// 4. Check for collisions.
+// 5. Resume the scripts that are due or have been woken up by a key press or collision.
+// 6. Call the continuations of the tasks that have finished their work.
+// 7. Emit a new time event (may run at the same time as the collision check, the scripts and the continuations).
+// 8. Ask the current level to clean up all the sprites that have been marked as deleted.
+// 9. Compute the state hash if the engine is deterministic.
+// 10. Sample the metrics of the frame.
+void Engine::AddEngineSystems() {
+    AddSystem("engine.network", [this] {
+        if (snapshot_client != nullptr) {
+            snapshot_client->Update(current_level, time_elapsed);
+        }
+    }, {}, {"sprites"});
+    AddSystem("engine.events", std::bind(&Engine::DelegateEvents, this), {"input"}, {"sprites"});
+    AddSystem("engine.update", std::bind(&Engine::UpdateSprites, this), {}, {"sprites", "draw_list", "time"});
+    AddSystem("engine.collision", std::bind(&Engine::DetectCollision, this), {}, {"sprites"});
+    AddSystem("engine.scripts", [this] { script_runner->Update(frame_counter); }, {}, {"sprites"});
+    AddSystem("engine.tasks", [this] {
+        if (task_runner != nullptr) {
+            task_runner->RunContinuations();
+        }
+    }, {}, {"sprites"});
+    AddSystem("engine.time", std::bind(&Engine::EmitTimeEvent, this), {}, {"time"});
+    AddSystem("engine.cleanup", [this] { current_level->CleanUpSprites(); }, {}, {"sprites"});
+    AddSystem("engine.hash", std::bind(&Engine::HashState, this), {"sprites", "time"}, {"hash"});
+    AddSystem("engine.metrics", [this] {
+        metrics->TakeSample(frame_counter, levels, current_level, draw_lists[1 - render_index].GetSize());
+    }, {"sprites", "draw_list"}, {"metrics"});
+}
+
+// Delegates the events emitted by the engine in the previous frame followed by the events queued by the main thread.
+// The emitted events were allocated from the frame arena in the previous frame, which means that they are still valid, while
+// the memory of the events delegated in the previous frame may already have been reused. The list of emitted events therefore
+// starts over with new memory from the current frame instead of reusing it.
+void Engine::DelegateEvents() {
+    TRACE_ZONE("Engine::DelegateEvents");
+    delegated_events = std::move(emitted_events);
+    emitted_events = FrameVector<SDL_Event>(FrameAllocator<SDL_Event>(frame_arena));
+    for (int i = 0; i < delegated_events.size(); i++) {
+        DelegateEvent(delegated_events[i]);
+    }
+    for (int i = 0; i < input_events.size(); i++) {
+        DelegateEvent(input_events[i]);
+    }
+}
+
+// Computes the state hash for the frame from the hash of the previous frame, the frame counter and the state of the current level.
+// Records the hash if a state hash file is open, and compares it to the verified hashes (if any). Only the first
+// difference is reported, since all later hashes differ as well.
+void Engine::HashState() {
+    TRACE_ZONE("Engine::HashState");
+    if (!is_deterministic) {
+        return;
+    }
+    StateHash hash(state_hash);
+    hash.Add(frame_counter);
+    if (current_level != nullptr) {
+        current_level->HashState(hash);
+    }
+    state_hash = hash.GetValue();
+    if (state_hash_log.is_open()) {
+        state_hash_log << frame_counter << " " << std::hex << state_hash << std::dec << "\n";
+    }
+    if (divergence_frame == -1 && frame_counter < reference_state_hashes.size() && reference_state_hashes[frame_counter] != state_hash) {
+        divergence_frame = frame_counter;
+        std::cerr << "State diverged at frame " << frame_counter << " (expected " << std::hex << reference_state_hashes[frame_counter]
+                  << ", got " << state_hash << std::dec << ")" << std::endl;
+    }
+}
+
+// Saves the state of the world to the reused buffer and hands it to the history, which gives back the storage of an old state.
+void Engine::RecordHistory() {
+    TRACE_ZONE("Engine::RecordHistory");
+    if (world_history == nullptr) {
+        return;
+    }
+    SaveWorldState(history_buffer);
+    world_history->Record(frame_counter, history_buffer, input_events);
+}
+
+// Writes the state of the engine followed by a snapshot of the current level, if there is one. The state is value
+// initialized, which zeroes its padding, so that the padding never shows up as a change in the history.
+void Engine::SaveWorldState(std::vector<Uint8>& buffer) {
+    WorldState state = WorldState();
+    state.frame_counter = frame_counter;
+    state.level_index = -1;
+    for (int i = 0; i < levels.size(); i++) {
+        if (levels[i] == current_level) {
+            state.level_index = i;
+        }
+    }
+    state.is_timelisteners_paused = is_timelisteners_paused;
+    state.time_elapsed = time_elapsed;
+    state.state_hash = state_hash;
+    state.random_generator = random_generator;
+    if (current_level != nullptr) {
+        current_level->SaveSnapshot(buffer, sizeof(state));
+    } else {
+        buffer.resize(sizeof(state));
+    }
+    memcpy(buffer.data(), &state, sizeof(state));
+}
+
+// Switches back to the level that was current if the game has switched levels since, and restores its snapshot.
+const std::vector<Level::ReplacedSprite>& Engine::ApplyWorldState(const std::vector<Uint8>& buffer) {
+    WorldState state;
+    memcpy(&state, buffer.data(), sizeof(state));
+    const std::vector<Level::ReplacedSprite>* replaced_sprites = &NO_REPLACED_SPRITES;
+    if (state.level_index >= 0 && state.level_index < levels.size()) {
+        if (levels[state.level_index] != current_level) {
+            SetCurrentLevel(levels[state.level_index]);
+        }
+        replaced_sprites = &current_level->RestoreSnapshot(buffer, sizeof(state));
+    }
+    frame_counter = state.frame_counter;
+    is_timelisteners_paused = state.is_timelisteners_paused;
+    time_elapsed = state.time_elapsed;
+    state_hash = state.state_hash;
+    random_generator = state.random_generator;
+    return *replaced_sprites;
+}
+
+// Updates the sprites into the draw list not currently being rendered and increments the frame counter.
+void Engine::UpdateSprites() {
+    TRACE_ZONE("Engine::UpdateSprites");
+    window->UpdateSprites(time_elapsed, draw_lists[1 - render_index], frame_arena);
+    frame_counter++;
+}
+
+// Starts the next simulation frame. The queued events are not touched by the main thread until the frame is finished.
+void Engine::RequestFrame() {
+    std::lock_guard<std::mutex> lock(frame_mutex);
+    is_frame_requested = true;
+    frame_condition.notify_all();
+}
+
+// Waits for the current simulation frame to finish, clears the delegated events and swaps the draw lists so that the
+// draw list just produced is rendered in the next iteration. Terminates the main event loop if the simulation failed.
+void Engine::WaitForFrame() {
+    TRACE_ZONE("Engine::WaitForFrame");
+    std::unique_lock<std::mutex> lock(frame_mutex);
+    frame_condition.wait(lock, [this] { return is_frame_done; });
+    is_frame_done = false;
+    input_events.clear();
+    render_index = 1 - render_index;
+    if (simulation_error) {
+        Quit();
     }
 }
 
+// Stops the simulation thread and waits for it to terminate.
+void Engine::StopSimulation() {
+    {
+        std::lock_guard<std::mutex> lock(frame_mutex);
+        is_simulation_stopped = true;
+        frame_condition.notify_all();
+    }
+    if (simulation_thread.joinable()) {
+        simulation_thread.join();
+    }
+}
+
+// Records the frame time. The histogram and the flight recorder never allocate, so recording is cheap enough to do in every frame.
+void Engine::RecordFrameTime(double frame_time) {
+    frame_times->Record(frame_time);
+    if (frame_time > hitch_threshold) {
+        hitch_count++;
+        if (hitch_log.is_open()) {
+            LogHitch(frame_time);
+        }
+    }
+    RecordFlight(frame_time);
+    PublishTelemetry();
+    RecordOverlayFrame(frame_time);
+}
+
+// Writes a hitch record for the last frame. The sprite and listener counts are taken from the metrics sampled at the end
+// of the frame, and the system times from the frame schedule. Since the simulation runs while the main thread renders,
+// the time of the systems overlaps the render phase and is only partly spent waiting for the simulation.
+void Engine::LogHitch(double frame_time) {
+    hitch_log << std::fixed << std::setprecision(3) << "Hitch in frame " << frame_counter << ": " << frame_time << " ms (threshold "
+              << hitch_threshold << " ms), " << metrics->GetLast(Metrics::SPRITES) << " sprites, "
+              << metrics->GetLast(Metrics::LISTENER_INVOCATIONS) << " listeners run" << "\n";
+    if (!is_headless) {
+        hitch_log << "    " << std::left << std::setw(24) << "main.poll" << std::right << std::setw(10) << poll_time << " ms\n";
+        hitch_log << "    " << std::left << std::setw(24) << "main.render" << std::right << std::setw(10) << render_time << " ms\n";
+        hitch_log << "    " << std::left << std::setw(24) << "main.wait" << std::right << std::setw(10) << wait_time << " ms\n";
+        hitch_log << "    " << std::left << std::setw(24) << "main.delay" << std::right << std::setw(10) << delay_time << " ms\n";
+    }
+    std::vector<std::string> names = scheduler->GetSystemNames();
+    for (int i = 0; i < names.size(); i++) {
+        hitch_log << "    " << std::left << std::setw(24) << names[i] << std::right << std::setw(10) << scheduler->GetLastTime(names[i]) << " ms"
+                  << std::setw(8) << scheduler->GetLastAllocations(names[i]) << " allocations\n";
+    }
+    hitch_log.flush();
+}
+
+// Records the frame in the flight recorder under the number of the frame simulated in it, which is the number its input
+// events were recorded under. The counts are taken from the metrics sampled at the end of the frame. A hitch
+// is dumped after it has been recorded, so that the dump ends with the frame of the hitch.
+void Engine::RecordFlight(double frame_time) {
+    FlightRecorder::FrameRecord record;
+    record.frame = frame_counter - 1;
+    record.frame_time = (float)frame_time;
+    record.poll_time = (float)poll_time;
+    record.render_time = (float)render_time;
+    record.wait_time = (float)wait_time;
+    record.delay_time = (float)delay_time;
+    record.sprites = (Sint32)metrics->GetLast(Metrics::SPRITES);
+    record.draw_calls = (Sint32)metrics->GetLast(Metrics::DRAW_CALLS);
+    record.events = (Sint32)metrics->GetLast(Metrics::EVENTS_DISPATCHED);
+    record.listener_invocations = (Sint32)metrics->GetLast(Metrics::LISTENER_INVOCATIONS);
+    record.collisions = (Sint32)metrics->GetLast(Metrics::COLLISIONS_REPORTED);
+    record.allocations = (Sint32)metrics->GetLast(Metrics::ALLOCATIONS);
+    flight_recorder->RecordFrame(record);
+    if (frame_time > hitch_threshold && !hitch_dump_path.empty()
+        && (hitch_dump_frame < 0 || flight_recorder->GetFrameCount() - hitch_dump_frame >= fps)) {
+        hitch_dump_frame = flight_recorder->GetFrameCount();
+        flight_recorder->Dump(hitch_dump_path.c_str(), FlightRecorder::ON_HITCH);
+    }
+}
+
+// Fills a snapshot from the frame time histogram and the last sample of the metrics. Computing the percentiles scans the
+// histogram, so a snapshot is only published every fps / 4 frames. The snapshot is a fixed size structure on the stack,
+// which means that publishing never allocates.
+void Engine::PublishTelemetry() {
+    if (telemetry_server == nullptr || frame_counter % std::max(fps / 4, 1) != 0 || metrics->GetSampleCount() == 0) {
+        return;
+    }
+    TelemetryServer::Snapshot snapshot;
+    snapshot.frame = frame_counter;
+    snapshot.fps = fps;
+    snapshot.hitches = hitch_count;
+    snapshot.frame_time_mean = frame_times->GetMean();
+    snapshot.frame_time_p50 = frame_times->GetPercentile(50);
+    snapshot.frame_time_p90 = frame_times->GetPercentile(90);
+    snapshot.frame_time_p99 = frame_times->GetPercentile(99);
+    snapshot.frame_time_max = frame_times->GetMax();
+    const Metrics::Sample& sample = metrics->GetSample(metrics->GetSampleCount() - 1);
+    for (int i = 0; i < Metrics::COUNTER_COUNT; i++) {
+        snapshot.counters[i] = sample.values[i];
+    }
+    snapshot.level_count = std::min((int)sample.level_sprite_counts.size(), TelemetryServer::MAX_LEVELS);
+    for (int i = 0; i < snapshot.level_count; i++) {
+        snapshot.level_sprite_counts[i] = sample.level_sprite_counts[i];
+    }
+    snapshot.tag_count = std::min((int)sample.tag_counts.size(), TelemetryServer::MAX_TAGS);
+    for (int i = 0; i < snapshot.tag_count; i++) {
+        strncpy(snapshot.tags[i], sample.tag_counts[i].first.c_str(), sizeof(snapshot.tags[i]) - 1);
+        snapshot.tags[i][sizeof(snapshot.tags[i]) - 1] = '\0';
+        snapshot.tag_sprite_counts[i] = sample.tag_counts[i].second;
+    }
+    telemetry_server->Publish(snapshot);
+}
+
+// Called after the second iteration of the main event loop has rendered, since the first iteration renders the draw list
+// from before the first simulated frame.
+void Engine::RecordFirstFrame(std::chrono::steady_clock::time_point run_start) {
+    startup_timeline->Record("engine.first_frame", run_start);
+#ifndef NDEBUG
+    startup_timeline->Print(std::cerr);
+#endif
+}
+
+// Hands the frame time, the phase times and the counts of the last frame to the overlay.
+void Engine::RecordOverlayFrame(double frame_time) {
+    if (window->GetOverlay() == nullptr) {
+        return;
+    }
+    PerformanceOverlay::FrameStats stats;
+    stats.frame_time = frame_time;
+    stats.poll_time = poll_time;
+    stats.render_time = render_time;
+    stats.wait_time = wait_time;
+    stats.delay_time = delay_time;
+    stats.sprites = metrics->GetLast(Metrics::SPRITES);
+    stats.draw_calls = metrics->GetLast(Metrics::DRAW_CALLS);
+    stats.texture_bytes = window->GetTextureBytes();
+    overlay->RecordFrame(stats);
+}
+
+// Called by the main thread between two frames, while the simulation thread waits for the next frame request.
+// The frame counter is the frame the time listeners see in the next frame, while the scripts see the frame after it
+// (since the counter is incremented by "engine.update" before "engine.scripts" runs). A frame is only skipped if the
+// draw list just produced is the same as the one rendered in this iteration, since otherwise the screen is out of date.
+// Collisions are not checked: while no sprite moves, the same sprites overlap in every frame. A snapshot client is never idle,
+// since its snapshots arrive over the network rather than as input events.
+int Engine::GetIdleFrames() {
+    if (!is_idle_throttling || is_deterministic || GetIsReplaying() || window->GetOverlay() != nullptr || current_level == nullptr || snapshot_client != nullptr) {
+        return 0;
+    }
+    if (task_runner != nullptr && task_runner->GetPendingCount() > 0) {
+        return 0;
+    }
+    if (current_level->GetIsAnimating() || !draw_lists[render_index].IsEqual(draw_lists[1 - render_index])) {
+        return 0;
+    }
+    int idle_frames = fps;
+    int listener_frame = GetNextTimeListenerFrame(frame_counter);
+    if (listener_frame != -1) {
+        idle_frames = std::min(idle_frames, listener_frame - frame_counter);
+    }
+    listener_frame = current_level->GetNextTimeListenerFrame(frame_counter, fps);
+    if (listener_frame != -1) {
+        idle_frames = std::min(idle_frames, listener_frame - frame_counter);
+    }
+    long script_frame = script_runner->GetNextFrame();
+    if (script_frame != -1) {
+        idle_frames = std::min(idle_frames, (int)(script_frame - frame_counter - 1));
+    }
+    return std::max(idle_frames, 0);
+}
+
+// Finds the earliest frame of the time listeners of the engine, evaluated as in HandleTime.
+int Engine::GetNextTimeListenerFrame(int frame) {
+    int next_frame = -1;
+    for (std::pair<const int, NamedListener<std::function<void(void)>>>& entry : time_listeners) {
+        int rhs = (int)(round(((fps / 1000.0 ) * entry.first)));
+        int listener_frame = rhs > 0 ? frame + (rhs - frame % rhs) % rhs : frame;
+        if (next_frame == -1 || listener_frame < next_frame) {
+            next_frame = listener_frame;
+        }
+    }
+    return next_frame;
+}
+
+// Waits for an event without removing it from the queue, so that it is polled as usual in the next iteration.
+double Engine::WaitWhileIdle(int idle_frames) {
+    TRACE_ZONE("Engine::WaitWhileIdle");
+    std::chrono::steady_clock::time_point idle_start = std::chrono::steady_clock::now();
+    SDL_WaitEventTimeout(nullptr, idle_frames * 1000 / fps);
+    return GetPhaseTime(idle_start);
+}
+
+// Skips the whole frames that passed while blocking, rounded to the nearest frame, but never past the frame where
+// something is due. An input event that arrives early in the wait is thereby delegated in the frame it arrived in.
+void Engine::SkipIdleFrames(int idle_frames, double idle_time) {
+    int skipped_frames = std::min((int)lround(idle_time * fps / 1000.0), idle_frames);
+    frame_counter += skipped_frames;
+    idle_frame_count += skipped_frames;
+}
+
+// Records the queued input events under the number of the frame they are delegated in.
+void Engine::RecordInputEvents() {
+    for (int i = 0; i < input_events.size(); i++) {
+        flight_recorder->RecordEvent(frame_counter, input_events[i]);
+    }
+}
+
+// Returns the time since the start of the phase and sets the start of the next phase to now.
+double Engine::GetPhaseTime(std::chrono::steady_clock::time_point& phase_start) {
+    std::chrono::steady_clock::time_point phase_stop = std::chrono::steady_clock::now();
+    double phase_time = std::chrono::duration<double, std::milli>(phase_stop - phase_start).count();
+    phase_start = phase_stop;
+    return phase_time;
+}
+
 // Returns the current timestamp in milliseconds.
 long Engine::GetTimestamp() {
     timeval time;
@@ -201,13 +1188,33 @@ long Engine::GetTimestamp() {
 }
 
 // Sets the time elapsed between two iterations of the main event loop.
+// In deterministic mode the time elapsed is fixed to 1000 / fps milliseconds regardless of the actual time.
 void Engine::SetTimeElapsed(long start_time, long stop_time) {
-    time_elapsed = (double)(stop_time - start_time);
+    if (is_deterministic) {
+        time_elapsed = 1000.0 / fps;
+    } else {
+        time_elapsed = (double)(stop_time - start_time);
+    }
 }
 
+// The subsystems that are only created on demand are held in unique_ptr and deleted after the rest of the engine, except the
+// overlay, whose textures belong to the renderer of the window and are therefore destroyed before the window.
 Engine::~Engine() {
+    if (task_runner != nullptr) {
+        task_runner->CancelAll();
+        delete task_pool;
+        delete task_runner;
+    }
+    delete script_runner;
+    delete scheduler;
+    delete thread_pool;
+    overlay.reset();
     delete window;
     for (int i = 0; i < levels.size(); i++) {
         delete levels[i];
     }
+    delete metrics;
+    delete frame_times;
+    delete frame_arena;
+    delete startup_timeline;
 }
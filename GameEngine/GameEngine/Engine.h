@@ -4,7 +4,16 @@
 #include <iostream>
 #include <string>
 #include <map>
+#include <vector>
 #include <functional>
+#include <thread>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <random>
+#include <fstream>
+#include <chrono>
 #include <SDL2/SDL.h>
 #include <SDL2_image/SDL_image.h>
 #include <SDL2_ttf/SDL_ttf.h>
@@ -16,23 +25,232 @@
 #include "LabelSprite.h"
 #include "Level.h"
 #include "Window.h"
+#include "DrawList.h"
+#include "ThreadPool.h"
+#include "Scheduler.h"
+#include "Script.h"
+#include "ScriptRunner.h"
+#include "Task.h"
+#include "TaskRunner.h"
+#include "StateHash.h"
+#include "InputLog.h"
+#include "Metrics.h"
+#include "FrameTimeHistogram.h"
+#include "ListenerProfiler.h"
+#include "FrameArena.h"
+#include "FlightRecorder.h"
+#include "TelemetryServer.h"
+#include "StartupTimeline.h"
+#include "WorldHistory.h"
+#include "SnapshotServer.h"
+#include "SnapshotClient.h"
 
 // The core class of the GameEngine framework. Handles the main event loop.
 class Engine {
-    
+
 public:
     
     // Creates a new Engine object and sets the member variable fps.
     // Also creates a new Window object by passing on the width, height and title arguments.
-    Engine(std::string game_name, int fps, int window_width, int window_height);
+    // A headless engine does not open a window, initiate SDL or start any threads of its own. It is driven by calling Step,
+    // which makes it possible to run many independent engines in one process (see SimulationBatch).
+    Engine(std::string game_name, int fps, int window_width, int window_height, bool is_headless = false);
     
     // Starts the main event loop in the game engine.
-    // After being called, the engine will be running until the program terminates
+    // After being called, the engine will be running until the program terminates.
+    // The calling thread polls input and renders while the simulation (listeners, collisions etc.) runs on a separate
+    // simulation thread, which means that all listeners are called from the simulation thread.
     void Run();
     
+    // Simulates one frame on the calling thread without polling input or rendering. Used to drive headless engines.
+    // The time elapsed for the frame is always 1000 / fps milliseconds. If the engine is replaying recorded input, the
+    // replayed events of the frame are queued first. Returns false without simulating anything if the replayed session has ended.
+    bool Step();
+    
+    // Returns the number of draw commands produced by the last simulated frame.
+    int GetDrawCallCount();
+    
+    // Returns the metrics of the engine (see Metrics), which are sampled at the end of each frame.
+    Metrics* GetMetrics();
+    
+    // Returns the arena for temporary data of the current frame (see FrameArena). Memory allocated from it in a listener,
+    // script or system stays valid until the end of the next frame. The arena moves on to the next frame at the end of each
+    // iteration of the main event loop, and at the end of each call to Step.
+    FrameArena* GetFrameArena();
+    
+    // Returns the histogram of the time taken by each frame (see FrameTimeHistogram). In a window the time of a frame is the
+    // time of a whole iteration of the main event loop, and in a headless engine it is the time of a call to Step.
+    FrameTimeHistogram* GetFrameTimes();
+    
+    // Sets the frame time (in milliseconds) above which a frame is recorded as a hitch. The default is two frames (2000 / fps).
+    void SetHitchThreshold(double hitch_threshold);
+    
+    // Writes a record of each hitch to the file at the specified path. A record holds the frame number, the frame time, the
+    // number of sprites and listeners run in the frame and the time of each phase of the frame: polling, rendering, waiting
+    // for the simulation and the delay on the main thread, followed by the time and allocations of each system of the frame schedule.
+    void LogHitches(std::string path);
+    
+    // Returns the number of hitches so far.
+    int GetHitchCount();
+    
+    // Returns the flight recorder of the engine (see FlightRecorder). The recorder is always on and keeps the metrics of the
+    // last ten seconds of frames together with the input events of those frames.
+    FlightRecorder* GetFlightRecorder();
+    
+    // Writes the flight recorder to the file at the specified path. Throws if the file cannot be written.
+    void DumpFlightRecorder(std::string path);
+    
+    // Makes the engine write the flight recorder to the file at the specified path when a frame is a hitch (see
+    // SetHitchThreshold). The file is written at most once per second, so a burst of hitches does not cause more of them.
+    void DumpFlightRecorderOnHitch(std::string path);
+    
+    // Makes the engine write the flight recorder to the file at the specified path if the program crashes (see
+    // FlightRecorder::SetCrashDumpPath).
+    void DumpFlightRecorderOnCrash(std::string path);
+    
+    // Starts serving the metrics on the specified port of localhost (see TelemetryServer), or on a free port if the port is 0.
+    // A snapshot of the metrics is published to the server four times per second at the target frame rate. Throws if the
+    // port cannot be listened on.
+    void ServeTelemetry(int port);
+    
+    // Returns the telemetry server, or a null pointer if the engine does not serve telemetry.
+    TelemetryServer* GetTelemetryServer();
+    
+    // Makes the engine an authoritative server for rendering clients: a snapshot of the current level is sent to the clients
+    // on the specified port of localhost (see SnapshotServer), or on a free port if the port is 0, at the end of each frame.
+    // Meant for headless engines, which then run at the frame rate instead of as fast as possible. Throws if the port
+    // cannot be listened on.
+    void ServeSnapshots(int port);
+    
+    // Returns the snapshot server, or a null pointer if the engine does not serve snapshots.
+    SnapshotServer* GetSnapshotServer();
+    
+    // Makes the engine a rendering client of the server on the specified port of localhost (see SnapshotClient): at the
+    // start of each frame the snapshots received are applied to the current level, whose sprites are then replicas of the
+    // sprites of the server. The game should not add sprites or listeners of its own to that level.
+    void ConnectToServer(int port);
+    
+    // Returns the snapshot client, or a null pointer if the engine is not a client.
+    SnapshotClient* GetSnapshotClient();
+    
+    // Shows or hides the performance overlay (see PerformanceOverlay) on top of the level. The overlay can also be toggled
+    // with F3, which is then not passed on to the game. The time the overlay takes to draw itself is left out of the render
+    // phase and the frame time, so that showing it does not change the numbers it shows. Nothing is drawn in a headless engine.
+    void SetOverlayVisible(bool is_visible);
+    
+    // Returns true if the performance overlay is shown.
+    bool GetIsOverlayVisible();
+    
+    // Enables or disables idle throttling, which is enabled by default. The game is idle when no sprite in the current level
+    // is animating (see Sprite::GetIsAnimating), the last frame drew the same as the frame before it, no task is pending
+    // and no time listener or script is due in the next frame. While the game is idle, the main event loop blocks until the
+    // next input event or until the next time listener or script is due (at most one second) instead of running a frame
+    // every 1000 / fps milliseconds. The frames that passed while blocking are skipped by moving the frame counter forward,
+    // so time listeners and scripts are called at the same time as without throttling. The collision listener is not called
+    // for the skipped frames, in which the same sprites would have kept overlapping.
+    // The engine never idles in deterministic mode, while replaying input or while the overlay is shown. Games with systems
+    // (see AddSystem) that change state without drawing it should disable idle throttling.
+    void SetIdleThrottling(bool is_enabled);
+    
+    // Returns true if idle throttling is enabled.
+    bool GetIsIdleThrottling();
+    
+    // Returns the number of frames skipped while idle so far.
+    long GetIdleFrameCount();
+    
+    // Returns the timeline of the startup of the engine (see StartupTimeline): the construction of the engine and the set up
+    // of the window, followed by "engine.first_frame", which starts when Run is called and ends when the first simulated
+    // frame has been rendered. Debug builds (without NDEBUG) print the timeline to standard error after the first frame.
+    // A headless engine only records its construction.
+    StartupTimeline* GetStartupTimeline();
+    
+    // Initiates the specified SDL subsystems unless they have been initiated already (see Window::InitSubsystems). Only the
+    // video subsystem is initiated when the engine is created, so a game using for example audio or game controllers must
+    // call this before using them. Does nothing in a headless engine.
+    void InitSubsystems(Uint32 subsystems);
+    
+    // Returns true if the engine is headless.
+    bool GetIsHeadless();
+    
+    // Returns the number of frames simulated so far.
+    int GetFrameCount();
+    
+    // Returns a random number between 0 and range - 1 from the engine's own random generator.
+    // Each engine has its own generator, which means that games running in different engines do not affect each other.
+    int GetRandom(int range);
+    
+    // Puts the engine in deterministic mode: the random generator is seeded with the specified seed, the time elapsed for
+    // each frame is fixed to 1000 / fps milliseconds and a hash of the state of all sprites is computed at the end of each frame.
+    // Two runs with the same seed and the same input produce the same hashes. Tasks (see RunAsync) finish depending on the
+    // wall clock and are therefore not deterministic.
+    void SetDeterministic(unsigned int seed);
+    
+    // Returns true if the engine is in deterministic mode.
+    bool GetIsDeterministic();
+    
+    // Returns the hash of the state at the end of the last frame. The hash of each frame is computed from the hash of the
+    // previous frame, which means that a difference in one frame changes the hashes of all later frames.
+    Uint64 GetStateHash();
+    
+    // Writes the frame number and state hash of each frame to the file at the specified path.
+    void RecordStateHashes(std::string path);
+    
+    // Reads the state hashes from a file written by RecordStateHashes and compares them to the hashes of this run.
+    // The first frame where the hashes differ is reported on standard error and returned by GetDivergenceFrame.
+    void VerifyStateHashes(std::string path);
+    
+    // Returns the first frame where the state hash differed from the verified hashes, or -1 if no difference has been found.
+    int GetDivergenceFrame();
+    
+    // Keeps the state of the world at the end of each of the last frames (at most the specified number of them) together
+    // with the input delegated in each frame (see WorldHistory), so that the engine can roll back to any of those frames
+    // with RestoreFrame or Resimulate. The state of the world is the frame counter, the time elapsed, the random generator,
+    // the state hash, which level is current and a snapshot of the current level (see Level::SaveSnapshot). In other words,
+    // rollback covers the sprites and the engine's clock only: scripts (which are suspended at a point in their code and
+    // wait for a frame), tasks and their continuations cannot be saved, so the engine refuses to roll back while any of
+    // them are pending (see RestoreFrame). Listeners are not rolled back either: a time listener is called by frame number
+    // and sees the rewound frame counter, but listeners added or removed since the frame stay added or removed.
+    // Meant for headless engines driven by Step, in deterministic mode when frames are simulated again.
+    void KeepHistory(int frames);
+    
+    // Returns the history of the world, or a null pointer if the engine does not keep one.
+    WorldHistory* GetWorldHistory();
+    
+    // Restores the state of the world at the end of the specified frame and drops the later frames from the history.
+    // The next call to Step simulates the frame after it. Must be called between frames. Throws if the frame is not kept,
+    // or if a script or task is pending, since it would go on from where it is against the rewound world. Returns the
+    // sprites of the current level whose objects were deleted or created by the restore (see Level::RestoreSnapshot),
+    // which a game that holds pointers to sprites uses to rebind them.
+    const std::vector<Level::ReplacedSprite>& RestoreFrame(int frame);
+    
+    // Restores the specified frame as above and then simulates all the frames after it up to the newest frame kept, with
+    // the input kept for each frame (see WorldHistory::SetInput), which makes the history hold the new frames instead.
+    // Returns the sprites replaced by the restore, as above; the sprites the frames simulated again add and remove are
+    // added and removed by the game itself, as in any other frame. Throws as RestoreFrame does.
+    const std::vector<Level::ReplacedSprite>& Resimulate(int frame);
+    
+    // Returns true if the engine can roll back, ie. if it keeps a history and no script or task is pending.
+    bool GetCanRollBack();
+    
+    // Records the input events polled by the engine to the file at the specified path (see InputLog).
+    // Must be called before Run.
+    void RecordInput(std::string path);
+    
+    // Replays the input events recorded in the file at the specified path in place of live input, and quits when the recorded
+    // session ends. Must be called before Run. A headless engine replays the session as fast as possible, and together with
+    // deterministic mode (using the same seed as when recording) the session is simulated exactly as it was played.
+    void ReplayInput(std::string path);
+    
+    // Returns true if the engine is replaying recorded input.
+    bool GetIsReplaying();
+    
     // Adds a level to this game engine.
     void AddLevel(Level* level);
     
+    // Loads a level from a binary level file (see LevelFile), adds it to this game engine and returns it.
+    // Throws if the file cannot be read or is not a valid level file.
+    Level* LoadLevel(std::string path);
+    
     // Sets the current level of this game engine.
     void SetCurrentLevel(Level* level);
     
@@ -42,43 +260,167 @@ public:
     // Sets the collision listener for the game engine by taking in a function pointer as argument (see collision_listener typedef).
     // The function sent to this function will be called each time a collision is detected.
     // Collisions are evaluated for all sprites on each iteration of the main event loop.
-    void SetCollisionListener(std::function<void(Sprite*, Sprite*)> listener);
+    // The name is what the listener is reported as by the listener profiler (see ListenerProfiler), by default "engine.collision".
+    void SetCollisionListener(std::function<void(Sprite*, Sprite*)> listener, std::string name = "");
     
     // Adds a new time event listener to the game engine by taking in a function pointer as argument
     // together with a delay (in milliseconds).
     // This function will then be called repeatedly each time the delay expires. The minimum delay is equal to the fps value. If the delay is set
     // to a value below the fps, then the time event listener will be called in each iteration of the main event loop.
-    void AddTimeListener(std::function<void(void)> listener, int delay);
+    // The name is what the listener is reported as by the listener profiler, by default "engine.time" followed by the delay.
+    void AddTimeListener(std::function<void(void)> listener, int delay, std::string name = "");
     
     // Adds an action listener that is not connected to any specific sprite.
-    void AddEventListener(std::function<void(void)> listener, int key_code);
+    // The name is what the listener is reported as by the listener profiler, by default "engine.event" followed by the key code.
+    void AddEventListener(std::function<void(void)> listener, int key_code, std::string name = "");
+    
+    // Enables or disables the listener profiler. While enabled, each call of a time, event or collision listener registered
+    // with the engine, a level or a sprite is timed and attributed to the name of the listener. While disabled, the listeners
+    // are not timed at all. Must be called before Run or from the simulation thread (for example from a listener).
+    void SetListenerProfiling(bool is_enabled);
+    
+    // Returns the listener profiler, or a null pointer if listener profiling has never been enabled.
+    ListenerProfiler* GetListenerProfiler();
+    
+    // Prints the listeners with the highest total time, at most the specified number of them.
+    void PrintListenerReport(std::ostream& out = std::cout, int count = 10);
+    
+    // Adds a system that is executed once in each frame of the simulation, together with the resources it reads and writes
+    // and the names of the systems that must be executed before it (see Scheduler). Systems that do not share any written
+    // resources with each other are executed in parallel on worker threads.
+    // The engine's own systems are "engine.network" (writes "sprites"), "engine.events" (reads "input", writes "sprites"), "engine.update" (writes "sprites",
+    // "draw_list" and "time"), "engine.collision" (writes "sprites"), "engine.scripts" (writes "sprites"), "engine.tasks" (writes "sprites"),
+    // "engine.time" (writes "time"), "engine.cleanup" (writes "sprites"), "engine.hash" (reads "sprites" and "time", writes "hash")
+    // and "engine.metrics" (reads "sprites" and "draw_list", writes "metrics").
+    void AddSystem(std::string name, std::function<void(void)> system, std::vector<std::string> reads, std::vector<std::string> writes, std::vector<std::string> dependencies = std::vector<std::string>());
+    
+    // Starts a gameplay script (see Script). The script runs on the simulation thread and is resumed by the engine each time
+    // the condition it awaits is fulfilled. Must be called before Run or from a listener, system or another script.
+    void StartScript(Script script);
+    
+    // Returns an awaitable for scripts that resumes the script after the specified delay (in milliseconds).
+    // As with time listeners, the delay is rounded to whole frames and the minimum delay is one frame.
+    ScriptRunner::DelayAwaiter Delay(int delay);
+    
+    // Returns an awaitable for scripts that resumes the script in the next frame.
+    ScriptRunner::DelayAwaiter NextFrame();
+    
+    // Returns an awaitable for scripts that resumes the script when the specified key is pressed. Evaluates to the key event.
+    ScriptRunner::KeyAwaiter WaitForKey(int key_code);
+    
+    // Returns an awaitable for scripts that resumes the script when a sprite with the first tag collides with a sprite with the
+    // second tag. Evaluates to the colliding sprites, in the same order as the tags.
+    ScriptRunner::CollisionAwaiter WaitForCollision(std::string tag1, std::string tag2);
+    
+    // Launches a task that runs the work on one of the engine's worker threads and then calls the continuation on the simulation
+    // thread, in the "engine.tasks" system of the first frame after the work is done. The frame loop never waits for the work.
+    // The work must not touch sprites, levels or the engine; results are handed to the continuation through captured variables.
+    Task RunAsync(std::function<void(void)> work, std::function<void(void)> continuation);
+    
+    // Launches a task as above that is cancelled when the specified sprite is deleted.
+    Task RunAsync(std::function<void(void)> work, std::function<void(void)> continuation, Sprite* owner);
+    
+    // Launches a task as above that is cancelled when the specified level is deleted.
+    Task RunAsync(std::function<void(void)> work, std::function<void(void)> continuation, Level* owner);
+    
+    // Prints the stages of the frame schedule and the systems in each stage.
+    void PrintSchedule(std::ostream& out = std::cout);
+    
+    // Prints the time spent in each system of the frame schedule.
+    void PrintSystemTimings(std::ostream& out = std::cout);
+    
+    // Returns the names of the systems of the frame schedule, in the order they were added.
+    std::vector<std::string> GetSystemNames();
+    
+    // Returns the total time (in milliseconds) the named system has taken in all frames so far, or -1 if there is no such system.
+    double GetSystemTime(std::string name);
+    
+    // Returns the total number of allocations the named system has made in all frames so far, or -1 if there is no such system.
+    long GetSystemAllocations(std::string name);
+    
+    // Makes every frame after the specified number of warm-up frames fail if any of its systems allocates. The frame throws
+    // a std::runtime_error naming the systems that allocated, which Run and Step pass on. Used to keep the frame loop of a
+    // steady-state scene free from allocations (see AllocationCounter::SetStackCapture for finding the allocation sites).
+    // Throws a std::runtime_error if the allocations are not counted (see GAMEENGINE_ALLOCATION_COUNTING).
+    void ExpectNoAllocations(int warm_up_frames);
     
     // Pauses all time listeners that have been added to the game engine.
     void SetTimeListenersPaused(bool is_timelisteners_paused);
     
     // Returns the actual time (in milliseconds) that has elapsed since the last iteration of the main event loop (ie. the actual time between two frames).
     double GetTimeElapsed();
-   
+    
     // Returns the width of the underlaying window.
     int GetWindowWidth();
     
     // Returns the height of the underlaying window.
     int GetWindowHeight();
     
+    // Returns the type ID of events that are emitted as time events. These events are then handled by the time event listeners.
+    // The type ID is registered with SDL the first time this function is called and is the same for all engines.
     static Uint32 GetTimeEventType();
     
     ~Engine();
-    
+
 private:
     
     // Forces the main event loop to terminate in the next iteration.
     void Quit();
     
-    // Polls events (input, system or other game engine events) and delegates them to the
-    // appropriate handler.
+    // Polls events (input, system or other game engine events) and queues them for the next simulation frame.
     void PollEvent();
     
-    // Emits a new time event that is then polled in the next iteration of the main event loop.
+    // Queues the replayed input events for the next simulation frame, and quits if the recorded session has ended.
+    void ReplayEvents();
+    
+    // Records that the main event loop terminated in the current frame, if the engine is recording input.
+    void RecordQuit();
+    
+    // Entry point of the simulation thread. Waits for frame requests and simulates one frame for each request.
+    void RunSimulation();
+    
+    // Simulates one frame by running all systems in the frame schedule, records the history of the world and sends the snapshots.
+    void SimulateFrame();
+    
+    // Throws if any system allocated in the last frame. Does nothing before the warm-up frames are over.
+    void CheckAllocations();
+    
+    // Returns the task runner, creating it the first time a task is launched.
+    TaskRunner* GetTaskRunner();
+    
+    // Adds the engine's own systems to the frame schedule.
+    void AddEngineSystems();
+    
+    // Delegates the events queued by the main thread.
+    void DelegateEvents();
+    
+    // Updates the sprites into the draw list not currently being rendered and increments the frame counter.
+    void UpdateSprites();
+    
+    // Computes the state hash for the frame and records or verifies it. Does nothing unless the engine is deterministic.
+    void HashState();
+    
+    // Saves the state of the world at the end of the frame to the history. Does nothing unless the engine keeps a history.
+    void RecordHistory();
+    
+    // Throws if a script or task is pending, which keeps the engine from rolling back.
+    void CheckRollBack();
+    
+    // Writes the state of the world to the buffer, and restores it from a buffer written by SaveWorldState (returning the
+    // sprites replaced in the current level).
+    void SaveWorldState(std::vector<Uint8>& buffer);
+    const std::vector<Level::ReplacedSprite>& ApplyWorldState(const std::vector<Uint8>& buffer);
+    
+    // Hands the queued events over to the simulation thread and starts the next simulation frame.
+    void RequestFrame();
+    
+    // Waits for the simulation thread to finish the current frame and swaps the draw lists.
+    void WaitForFrame();
+    
+    // Stops the simulation thread and waits for it to terminate.
+    void StopSimulation();
+    
+    // Emits a new time event that is then delegated in the next simulation frame.
     void EmitTimeEvent();
     
     // Detects collisions between sprites and calls the collision listener (if any).
@@ -93,6 +435,45 @@ private:
     // Handles the time events emitted by the game engine. Calls the registererd time listeners (if any).
     void HandleTime(SDL_Event& event);
     
+    // Records the time of a frame in the frame time histogram and writes a hitch record if the frame took longer than the threshold.
+    void RecordFrameTime(double frame_time);
+    
+    // Writes a hitch record for the last frame to the hitch log.
+    void LogHitch(double frame_time);
+    
+    // Records the metrics of the last frame in the flight recorder, and dumps the recorder if the frame was a hitch.
+    void RecordFlight(double frame_time);
+    
+    // Records the input events queued for the frame about to be simulated in the flight recorder.
+    void RecordInputEvents();
+    
+    // Publishes a snapshot of the metrics to the telemetry server, if it is time for one.
+    void PublishTelemetry();
+    
+    // Records the first rendered frame on the startup timeline, and prints the timeline in debug builds.
+    void RecordFirstFrame(std::chrono::steady_clock::time_point run_start);
+    
+    // Records the numbers of the last frame in the performance overlay, if it is shown.
+    void RecordOverlayFrame(double frame_time);
+    
+    // Returns the number of frames after the last simulated frame that would not change anything, at most one second of
+    // frames, or 0 if the game is not idle (see SetIdleThrottling).
+    int GetIdleFrames();
+    
+    // Returns the first frame from the specified frame on in which a time listener of the engine is called, or -1 if the
+    // engine has no time listeners.
+    int GetNextTimeListenerFrame(int frame);
+    
+    // Blocks until an input event arrives or the specified number of idle frames have passed, and returns the time (in
+    // milliseconds) it blocked.
+    double WaitWhileIdle(int idle_frames);
+    
+    // Skips the idle frames that passed in the specified time by moving the frame counter forward.
+    void SkipIdleFrames(int idle_frames, double idle_time);
+    
+    // Internal helper function that returns the time (in milliseconds) since the start of a phase and starts the next phase.
+    static double GetPhaseTime(std::chrono::steady_clock::time_point& phase_start);
+    
     // Internal helper function used to calculate the time elapsed between two main loop iterations.
     long GetTimestamp();
     
@@ -115,13 +496,16 @@ private:
     int frame_counter;
     
     // The collision listener function registered (if any).
-    std::function<void(Sprite*, Sprite*)> current_collision_listener;
+    NamedListener<std::function<void(Sprite*, Sprite*)>> current_collision_listener;
     
     // A data structure to hold all time event listeners registererd (if any) together with the delay for each listener.
-    std::map<int, std::function<void(void)>> time_listeners;
+    std::map<int, NamedListener<std::function<void(void)>>> time_listeners;
     
     // A data structure to hold all action event listeners registererd (if any) together with the keycode for each listener.
-    std::map<int, std::function<void(void)>> event_listeners;
+    std::map<int, NamedListener<std::function<void(void)>>> event_listeners;
+    
+    // The listener profiler, created the first time listener profiling is enabled.
+    std::unique_ptr<ListenerProfiler> listener_profiler;
     
     // A data structure to hold all levels added (if any) to this game engine.
     std::vector<Level*> levels;
@@ -132,7 +516,128 @@ private:
     // The current level.
     Level* current_level;
     
-    // The type ID of events that are emitted as time events. These events are then handled by the time event listeners.
-    static Uint32 time_event_type;
+    // The worker threads used to run systems in parallel. Headless engines have no worker threads.
+    ThreadPool* thread_pool;
+    
+    // The frame schedule, containing the engine's own systems and any systems added by the game.
+    Scheduler* scheduler;
+    
+    // The gameplay scripts started by the game.
+    ScriptRunner* script_runner;
+    
+    // The worker threads used to run the work of tasks launched by the game. Separate from the worker threads used by the
+    // frame schedule, so that a long running task never delays a frame. Created when the first task is launched.
+    ThreadPool* task_pool;
+    
+    // The tasks launched by the game.
+    TaskRunner* task_runner;
+    
+    // The thread that runs the simulation.
+    std::thread simulation_thread;
+    
+    // Guards the hand-over of frames between the main thread and the simulation thread.
+    std::mutex frame_mutex;
+    
+    // Signals a requested or finished frame.
+    std::condition_variable frame_condition;
+    
+    // Flags that control the hand-over of frames between the main thread and the simulation thread.
+    bool is_frame_requested, is_frame_done, is_simulation_stopped;
+    
+    // The events polled by the main thread that are delegated in the next simulation frame.
+    std::vector<SDL_Event> input_events;
+    
+    // The log that input events are recorded to or replayed from (if any).
+    std::unique_ptr<InputLog> input_log;
+    
+    // The counters of the work done in each frame.
+    Metrics* metrics;
+    
+    // The time taken by each frame.
+    FrameTimeHistogram* frame_times;
+    
+    // The frame time (in milliseconds) above which a frame is a hitch, and the number of hitches so far.
+    double hitch_threshold;
+    int hitch_count;
+    
+    // The file that hitch records are written to (if any).
+    std::ofstream hitch_log;
+    
+    // The record of the last frames, the file it is written to on a hitch (if any) and the frame count of the recorder at
+    // the last hitch dump (or -1).
+    std::unique_ptr<FlightRecorder> flight_recorder;
+    std::string hitch_dump_path;
+    long hitch_dump_frame;
+    
+    // The server that the metrics are published to (if any).
+    std::unique_ptr<TelemetryServer> telemetry_server;
+    
+    // The server that snapshots are sent to clients from, or the client that snapshots are received from (if any).
+    std::unique_ptr<SnapshotServer> snapshot_server;
+    std::unique_ptr<SnapshotClient> snapshot_client;
+    
+    // The performance overlay, created the first time it is shown.
+    std::unique_ptr<PerformanceOverlay> overlay;
+    
+    // A flag to indicate if idle throttling is enabled, and the number of frames skipped while idle so far.
+    bool is_idle_throttling;
+    long idle_frame_count;
+    
+    // The first frame where allocations are not allowed, or -1 if allocations are always allowed.
+    int allocation_check_frame;
+    
+    // The time (in milliseconds) of each phase of the last iteration of the main event loop. Always 0 in a headless engine.
+    double poll_time, render_time, wait_time, delay_time;
+    
+    // The arena for temporary data of the current frame.
+    FrameArena* frame_arena;
+    
+    // The events emitted by the engine itself (time events) that are delegated in the next simulation frame.
+    // Kept separate from the SDL event queue so that several engines in one process do not receive each other's events.
+    // Allocated from the frame arena, which keeps them valid until they are delegated in the next frame.
+    FrameVector<SDL_Event> emitted_events;
+    
+    // The events emitted by the engine itself that are being delegated in the current simulation frame.
+    FrameVector<SDL_Event> delegated_events;
+    
+    // A flag to indicate if the engine is headless.
+    bool is_headless;
+    
+    // The timeline of the startup of the engine.
+    StartupTimeline* startup_timeline;
+    
+    // The engine's own random generator.
+    std::mt19937 random_generator;
+    
+    // A flag to indicate if the engine is in deterministic mode.
+    bool is_deterministic;
+    
+    // The state hash at the end of the last frame.
+    Uint64 state_hash;
+    
+    // The file that state hashes are recorded to (if any).
+    std::ofstream state_hash_log;
+    
+    // The state hashes to verify against, indexed by frame number.
+    std::vector<Uint64> reference_state_hashes;
+    
+    // The history of the world (if any), and the buffer that the state of the world is saved to before it is recorded.
+    std::unique_ptr<WorldHistory> world_history;
+    std::vector<Uint8> history_buffer;
+    
+    // The first frame where the state hash differed from the verified hashes, or -1.
+    int divergence_frame;
+    
+    // The double buffered draw lists. The main thread renders one while the simulation thread fills the other.
+    DrawList draw_lists[2];
+    
+    // The index of the draw list currently being rendered.
+    int render_index;
+    
+    // An exception thrown on the simulation thread, rethrown on the main thread when the main event loop terminates.
+    std::exception_ptr simulation_error;
+    
+    // Gives the microbenchmarks access to the internal functions they measure.
+    friend class Microbenchmark;
 };
 #endif
@@ -0,0 +1,127 @@
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "FlightRecorder.h"
+
+// The recorder that dumps on a crash and the path it dumps to. The path is copied into a fixed buffer so that the signal
+// handler does not have to touch any object that might be in the middle of being changed.
+static FlightRecorder* volatile crash_recorder = nullptr;
+static char crash_dump_path[1024];
+
+// The signals that are handled as crashes.
+static const int CRASH_SIGNALS[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT};
+
+// Dumps the crash recorder and raises the signal again. The handler is installed with SA_RESETHAND, so the second time
+// the signal is handled by the default handler, which terminates the program.
+static void HandleCrash(int signal) {
+    FlightRecorder* recorder = crash_recorder;
+    if (recorder != nullptr) {
+        crash_recorder = nullptr;
+        recorder->Dump(crash_dump_path, FlightRecorder::ON_CRASH);
+    }
+    raise(signal);
+}
+
+FlightRecorder::FlightRecorder(int frame_capacity, int event_capacity, int fps):frames(frame_capacity > 0 ? frame_capacity : 1), events(event_capacity > 0 ? event_capacity : 1), frame_count(0), event_count(0), fps(fps) {
+}
+
+// Copies the record into the slot of the oldest frame.
+void FlightRecorder::RecordFrame(const FrameRecord& record) {
+    frames[frame_count % frames.size()] = record;
+    frame_count++;
+}
+
+// Copies the fields of the event that matter for its type into the slot of the oldest event.
+void FlightRecorder::RecordEvent(int frame, const SDL_Event& event) {
+    EventRecord& record = events[event_count % events.size()];
+    record.frame = frame;
+    record.type = event.type;
+    record.code = 0;
+    record.x = 0;
+    record.y = 0;
+    if (event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) {
+        record.code = event.key.keysym.sym;
+    } else if (event.type == SDL_MOUSEBUTTONDOWN || event.type == SDL_MOUSEBUTTONUP) {
+        record.code = event.button.button;
+        record.x = event.button.x;
+        record.y = event.button.y;
+    } else if (event.type == SDL_MOUSEMOTION) {
+        record.x = event.motion.x;
+        record.y = event.motion.y;
+    } else if (event.type == SDL_TEXTINPUT) {
+        record.code = (unsigned char)event.text.text[0];
+    }
+    event_count++;
+}
+
+// Writes the header followed by both ring buffers. Only async signal safe functions are used.
+bool FlightRecorder::Dump(const char* path, DumpReason reason) {
+    int file = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file < 0) {
+        return false;
+    }
+    DumpHeader header;
+    memcpy(header.magic, "GEFR", 4);
+    header.version = VERSION;
+    header.reason = reason;
+    header.frame = GetLastFrame();
+    header.fps = fps;
+    header.frame_count = (Uint32)(frame_count < frames.size() ? frame_count : frames.size());
+    header.event_count = (Uint32)(event_count < events.size() ? event_count : events.size());
+    bool is_written = write(file, &header, sizeof(header)) == sizeof(header)
+                      && WriteRing(file, frames.data(), sizeof(FrameRecord), (int)frames.size(), frame_count)
+                      && WriteRing(file, events.data(), sizeof(EventRecord), (int)events.size(), event_count);
+    return close(file) == 0 && is_written;
+}
+
+// Writes the slots from the oldest record to the newest. Until the buffer is full the oldest record is in the first slot,
+// after that it is in the slot that the next record will be written to.
+bool FlightRecorder::WriteRing(int file, const void* records, size_t record_size, int capacity, long count) {
+    const char* bytes = (const char*)records;
+    if (count < capacity) {
+        return write(file, bytes, count * record_size) == (ssize_t)(count * record_size);
+    }
+    size_t oldest = count % capacity;
+    size_t first_part = (capacity - oldest) * record_size;
+    size_t second_part = oldest * record_size;
+    return write(file, bytes + oldest * record_size, first_part) == (ssize_t)first_part
+           && write(file, bytes, second_part) == (ssize_t)second_part;
+}
+
+// Returns the number of frames the recorder keeps.
+int FlightRecorder::GetFrameCapacity() {
+    return (int)frames.size();
+}
+
+// Returns the number of frames recorded so far.
+long FlightRecorder::GetFrameCount() {
+    return frame_count;
+}
+
+// Returns the frame of the newest frame record.
+int FlightRecorder::GetLastFrame() {
+    return frame_count > 0 ? frames[(frame_count - 1) % frames.size()].frame : -1;
+}
+
+// Copies the path and installs the signal handler for each crash signal.
+void FlightRecorder::SetCrashDumpPath(const char* path) {
+    crash_recorder = nullptr;
+    strncpy(crash_dump_path, path, sizeof(crash_dump_path) - 1);
+    crash_dump_path[sizeof(crash_dump_path) - 1] = '\0';
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = HandleCrash;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    for (int i = 0; i < sizeof(CRASH_SIGNALS) / sizeof(CRASH_SIGNALS[0]); i++) {
+        sigaction(CRASH_SIGNALS[i], &action, nullptr);
+    }
+    crash_recorder = this;
+}
+
+FlightRecorder::~FlightRecorder() {
+    if (crash_recorder == this) {
+        crash_recorder = nullptr;
+    }
+}
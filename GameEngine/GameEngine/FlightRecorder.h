@@ -0,0 +1,105 @@
+#ifndef __GameEngine__FlightRecorder__
+#define __GameEngine__FlightRecorder__
+
+#include <vector>
+#include <SDL2/SDL.h>
+
+// Keeps a record of the last frames so that a crash or a hitch can be analyzed afterwards. The recorder holds the metrics
+// of each frame (times of the phases, sprites, draw calls, events, listeners, allocations) and the input events of each
+// frame in two ring buffers that are allocated once when the recorder is created, so recording never allocates and the
+// memory used is fixed no matter how long the game runs.
+// The records are written to a file when dumped. Dumping only uses open, write and close and never allocates, which means
+// that it is safe to dump from a signal handler (see SetCrashDumpPath). Tools/FlightRecorderDecoder.cpp decodes a dump.
+//
+// The dump file is binary and written in the byte order of the machine: a DumpHeader followed by the frame records
+// (FrameRecord) and the event records (EventRecord), each from the oldest to the newest.
+class FlightRecorder {
+
+public:
+    
+    // The reason a dump was written.
+    enum DumpReason {ON_DEMAND = 0, ON_HITCH = 1, ON_CRASH = 2};
+    
+    // The metrics of one frame. Times are in milliseconds, and the phase times are 0 in a headless engine.
+    struct FrameRecord {
+        Sint32 frame;
+        float frame_time, poll_time, render_time, wait_time, delay_time;
+        Sint32 sprites, draw_calls, events, listener_invocations, collisions, allocations;
+    };
+    
+    // An input event. The code is the key of a keyboard event, the button of a mouse button event or the first character of
+    // a text input event, and the position is the position of a mouse event.
+    struct EventRecord {
+        Sint32 frame;
+        Uint32 type;
+        Sint32 code, x, y;
+    };
+    
+    // The first bytes of a dump: the magic "GEFR", the version of the format, the reason for the dump, the frame the dump
+    // was written in, the number of frames per second and the number of records that follow.
+    struct DumpHeader {
+        char magic[4];
+        Uint32 version;
+        Uint32 reason;
+        Sint32 frame;
+        Uint32 fps;
+        Uint32 frame_count;
+        Uint32 event_count;
+    };
+    
+    // The version of the dump format.
+    static const Uint32 VERSION = 1;
+    
+    // Creates a new recorder that keeps the specified number of frames and input events.
+    FlightRecorder(int frame_capacity, int event_capacity, int fps);
+    
+    // Records the metrics of a frame, replacing the oldest frame if the recorder is full.
+    void RecordFrame(const FrameRecord& record);
+    
+    // Records an input event of a frame, replacing the oldest event if the recorder is full.
+    void RecordEvent(int frame, const SDL_Event& event);
+    
+    // Writes the records to the file at the specified path. Returns false if the file could not be written.
+    bool Dump(const char* path, DumpReason reason);
+    
+    // Returns the number of frames the recorder keeps.
+    int GetFrameCapacity();
+    
+    // Returns the number of frames recorded so far.
+    long GetFrameCount();
+    
+    // Returns the frame of the newest frame record, or -1 if no frame has been recorded.
+    int GetLastFrame();
+    
+    // Makes the recorder dump to the file at the specified path when the program crashes (on SIGSEGV, SIGBUS, SIGILL,
+    // SIGFPE or SIGABRT, which includes uncaught exceptions). The signal is then raised again with its default handler,
+    // so the program still terminates as it would have. Only one recorder at a time dumps on a crash: the last one set up.
+    void SetCrashDumpPath(const char* path);
+    
+    // Stops the recorder from dumping on a crash, if it was the one set up to do so.
+    ~FlightRecorder();
+
+private:
+    
+    // Private in order to guard against value semantics.
+    FlightRecorder(const FlightRecorder& other_recorder);
+    
+    // Private in order to guard against value semantics.
+    const FlightRecorder& operator=(const FlightRecorder& other_recorder);
+    
+    // Internal helper function that writes the records of a ring buffer from the oldest to the newest.
+    static bool WriteRing(int file, const void* records, size_t record_size, int capacity, long count);
+    
+    // The ring buffers of frames and events, allocated when the recorder is created.
+    std::vector<FrameRecord> frames;
+    std::vector<EventRecord> events;
+    
+    // The number of frames and events recorded so far. The next record is written to the slot at this count modulo the capacity.
+    long frame_count;
+    long event_count;
+    
+    // The number of frames per second of the engine, written to the dump so that the decoder can tell seconds from frames.
+    int fps;
+};
+
+#endif
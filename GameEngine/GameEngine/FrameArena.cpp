@@ -0,0 +1,91 @@
+#include <cstdlib>
+#include <new>
+#include "FrameArena.h"
+
+FrameArena::FrameArena(size_t capacity):current_buffer(0), overflow_count(0) {
+    for (int i = 0; i < 2; i++) {
+        buffers[i].capacity = capacity > 0 ? capacity : 1;
+        buffers[i].memory = (char*)malloc(buffers[i].capacity);
+        if (buffers[i].memory == nullptr) {
+            throw std::bad_alloc();
+        }
+        buffers[i].offset = 0;
+        buffers[i].overflow_bytes = 0;
+    }
+}
+
+// Reserves the memory by moving the offset of the current buffer forward with a compare and swap, so that threads
+// allocating at the same time get separate memory without taking a lock. Falls back to the heap if the buffer is full.
+void* FrameArena::Allocate(size_t size, size_t alignment) {
+    Buffer& buffer = buffers[current_buffer];
+    size_t offset = buffer.offset.load(std::memory_order_relaxed);
+    while (true) {
+        size_t start = (offset + alignment - 1) & ~(alignment - 1);
+        if (start + size > buffer.capacity) {
+            return AllocateOverflow(buffer, size, alignment);
+        }
+        if (buffer.offset.compare_exchange_weak(offset, start + size, std::memory_order_relaxed)) {
+            return buffer.memory + start;
+        }
+    }
+}
+
+// Allocates a block on the heap that is freed when the buffer is reset. The block is counted so that the buffer can be
+// grown to fit it the next time.
+void* FrameArena::AllocateOverflow(Buffer& buffer, size_t size, size_t alignment) {
+    void* block = aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    std::lock_guard<std::mutex> lock(overflow_mutex);
+    buffer.overflow_blocks.push_back(block);
+    buffer.overflow_bytes += size + alignment;
+    overflow_count++;
+    return block;
+}
+
+// Switches to the other buffer and resets it. If that buffer overflowed when it was last used, it is replaced by a buffer
+// that is large enough for everything allocated in it (with room to spare).
+void FrameArena::NextFrame() {
+    current_buffer = 1 - current_buffer;
+    Buffer& buffer = buffers[current_buffer];
+    if (!buffer.overflow_blocks.empty()) {
+        for (int i = 0; i < buffer.overflow_blocks.size(); i++) {
+            free(buffer.overflow_blocks[i]);
+        }
+        buffer.overflow_blocks.clear();
+        size_t capacity = (buffer.offset + buffer.overflow_bytes) * 2;
+        free(buffer.memory);
+        buffer.memory = (char*)malloc(capacity);
+        if (buffer.memory == nullptr) {
+            throw std::bad_alloc();
+        }
+        buffer.capacity = capacity;
+        buffer.overflow_bytes = 0;
+    }
+    buffer.offset = 0;
+}
+
+// Returns the number of bytes allocated in the current buffer, not counting overflow blocks.
+size_t FrameArena::GetUsedBytes() {
+    return buffers[current_buffer].offset;
+}
+
+// Returns the capacity of the current buffer.
+size_t FrameArena::GetCapacity() {
+    return buffers[current_buffer].capacity;
+}
+
+// Returns the number of allocations made on the heap.
+long FrameArena::GetOverflowCount() {
+    return overflow_count;
+}
+
+FrameArena::~FrameArena() {
+    for (int i = 0; i < 2; i++) {
+        for (int k = 0; k < buffers[i].overflow_blocks.size(); k++) {
+            free(buffers[i].overflow_blocks[k]);
+        }
+        free(buffers[i].memory);
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef __GameEngine__FrameArena__
+#define __GameEngine__FrameArena__
+
+#include <cstddef>
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+// A linear (bump) allocator for temporary data that only lives for a frame or two. Memory is allocated by moving an offset
+// forward in a preallocated buffer, and nothing is freed individually. Instead, the whole buffer is reset at once when the
+// engine moves on to the next frame (see NextFrame).
+// The arena is double buffered: memory allocated in one frame stays valid during the next frame as well, which means that
+// data produced in one frame can be consumed in the next (for example events emitted by the engine).
+// If a buffer runs out, the allocation falls back to the heap and the buffer is grown the next time it is reset, so that
+// after a few frames a scene with a stable amount of temporary data does not touch the heap at all.
+// Allocating is thread safe, so that systems running in parallel may share the arena.
+class FrameArena {
+
+public:
+    
+    // Creates a new arena where each of the two buffers initially holds the specified number of bytes.
+    FrameArena(size_t capacity = 64 * 1024);
+    
+    // Allocates memory for the current frame. The memory is valid until the end of the next frame.
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    
+    // Moves on to the next frame. The buffer used two frames ago is reset and becomes the current buffer, which invalidates
+    // all memory allocated in it. Must not be called while another thread allocates.
+    void NextFrame();
+    
+    // Returns the number of bytes allocated in the current frame.
+    size_t GetUsedBytes();
+    
+    // Returns the capacity of the current buffer in bytes.
+    size_t GetCapacity();
+    
+    // Returns the number of allocations that did not fit in their buffer and were made on the heap.
+    long GetOverflowCount();
+    
+    ~FrameArena();
+
+private:
+    
+    // One of the two buffers: the preallocated memory, the offset of the next allocation and the heap blocks used
+    // when the memory ran out.
+    struct Buffer {
+        char* memory;
+        size_t capacity;
+        std::atomic<size_t> offset;
+        std::vector<void*> overflow_blocks;
+        size_t overflow_bytes;
+    };
+    
+    // Private in order to guard against value semantics.
+    FrameArena(const FrameArena& other_arena);
+    
+    // Private in order to guard against value semantics.
+    const FrameArena& operator=(const FrameArena& other_arena);
+    
+    // Internal helper function that allocates an overflow block on the heap.
+    void* AllocateOverflow(Buffer& buffer, size_t size, size_t alignment);
+    
+    // The two buffers.
+    Buffer buffers[2];
+    
+    // The index of the buffer used in the current frame.
+    int current_buffer;
+    
+    // The number of allocations made on the heap.
+    long overflow_count;
+    
+    // Guards the overflow blocks.
+    std::mutex overflow_mutex;
+};
+
+// An allocator for standard containers that allocates from a frame arena. Deallocating does nothing, since the memory is
+// reclaimed when the arena is reset, which means that a container using it must not be used after the end of the frame
+// following the one where it last allocated.
+template <typename T>
+class FrameAllocator {
+
+public:
+    
+    typedef T value_type;
+    
+    // Creates an allocator that allocates from the specified arena.
+    FrameAllocator(FrameArena* arena):arena(arena) {
+    }
+    
+    // Creates an allocator for another type that allocates from the same arena (needed by the containers).
+    template <typename U>
+    FrameAllocator(const FrameAllocator<U>& other_allocator):arena(other_allocator.arena) {
+    }
+    
+    // Allocates memory for the specified number of objects from the arena.
+    T* allocate(size_t count) {
+        return (T*)arena->Allocate(count * sizeof(T), alignof(T));
+    }
+    
+    // Does nothing, the memory is reclaimed when the arena is reset.
+    void deallocate(T* memory, size_t count) {
+    }
+    
+    // The arena that memory is allocated from.
+    FrameArena* arena;
+};
+
+// Two frame allocators are equal if they allocate from the same arena.
+template <typename T, typename U>
+bool operator==(const FrameAllocator<T>& lhs, const FrameAllocator<U>& rhs) {
+    return lhs.arena == rhs.arena;
+}
+
+template <typename T, typename U>
+bool operator!=(const FrameAllocator<T>& lhs, const FrameAllocator<U>& rhs) {
+    return lhs.arena != rhs.arena;
+}
+
+// A vector that allocates from a frame arena.
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+#endif
@@ -0,0 +1,105 @@
+#include <bit>
+#include <iomanip>
+#include "FrameTimeHistogram.h"
+
+// The number of linear sub-buckets within each power of two (2^7), which gives a relative error below 1%.
+static const int SUB_BUCKET_BITS = 7;
+static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+
+FrameTimeHistogram::FrameTimeHistogram(double max_time):max_value((long)(max_time * 1000)), count(0), total_value(0), recorded_max_value(0) {
+    if (max_value < 1) {
+        max_value = 1;
+    }
+    counts.resize(GetBucketIndex(max_value) + 1, 0);
+}
+
+// Records a frame time, rounded to whole microseconds and limited to the maximum trackable time.
+void FrameTimeHistogram::Record(double time) {
+    long value = (long)(time * 1000 + 0.5);
+    if (value < 0) {
+        value = 0;
+    } else if (value > max_value) {
+        value = max_value;
+    }
+    counts[GetBucketIndex(value)]++;
+    count++;
+    total_value += value;
+    if (value > recorded_max_value) {
+        recorded_max_value = value;
+    }
+}
+
+// Walks the buckets from the shortest time until the requested number of frames has been counted. The highest time of
+// that bucket is returned, limited to the longest time recorded so that p100 equals the max.
+double FrameTimeHistogram::GetPercentile(double percentile) {
+    if (count == 0) {
+        return 0;
+    }
+    long target = (long)(percentile / 100 * count + 0.5);
+    if (target < 1) {
+        target = 1;
+    } else if (target > count) {
+        target = count;
+    }
+    long counted = 0;
+    for (int i = 0; i < counts.size(); i++) {
+        counted += counts[i];
+        if (counted >= target) {
+            long value = GetBucketValue(i);
+            return (value < recorded_max_value ? value : recorded_max_value) / 1000.0;
+        }
+    }
+    return recorded_max_value / 1000.0;
+}
+
+// Returns the longest frame time recorded.
+double FrameTimeHistogram::GetMax() {
+    return recorded_max_value / 1000.0;
+}
+
+// Returns the mean of all recorded frame times.
+double FrameTimeHistogram::GetMean() {
+    return count > 0 ? (double)total_value / count / 1000.0 : 0;
+}
+
+// Returns the number of recorded frames.
+long FrameTimeHistogram::GetCount() {
+    return count;
+}
+
+// Clears the bucket counts without releasing them.
+void FrameTimeHistogram::Reset() {
+    for (int i = 0; i < counts.size(); i++) {
+        counts[i] = 0;
+    }
+    count = 0;
+    total_value = 0;
+    recorded_max_value = 0;
+}
+
+// Prints the frame time percentiles on one line.
+void FrameTimeHistogram::Print(std::ostream& out) {
+    out << std::fixed << std::setprecision(2) << "frames " << count << ", mean " << GetMean() << " ms, p50 " << GetPercentile(50)
+        << " ms, p90 " << GetPercentile(90) << " ms, p99 " << GetPercentile(99) << " ms, p99.9 " << GetPercentile(99.9)
+        << " ms, max " << GetMax() << " ms" << std::endl;
+}
+
+// Times below 2 * SUB_BUCKET_COUNT microseconds get one bucket each. Above that, each power of two is split into
+// SUB_BUCKET_COUNT buckets by dropping the bits below the SUB_BUCKET_BITS + 1 most significant bits.
+int FrameTimeHistogram::GetBucketIndex(long value) {
+    int shift = (int)std::bit_width((unsigned long)value) - (SUB_BUCKET_BITS + 1);
+    if (shift < 0) {
+        shift = 0;
+    }
+    return shift * SUB_BUCKET_COUNT + (int)(value >> shift);
+}
+
+// The inverse of GetBucketIndex, returning the highest time that maps to the bucket.
+long FrameTimeHistogram::GetBucketValue(int index) {
+    if (index < 2 * SUB_BUCKET_COUNT) {
+        return index;
+    }
+    int shift = index / SUB_BUCKET_COUNT - 1;
+    long sub_bucket = index - shift * SUB_BUCKET_COUNT;
+    return ((sub_bucket + 1) << shift) - 1;
+}
@@ -0,0 +1,60 @@
+#ifndef __GameEngine__FrameTimeHistogram__
+#define __GameEngine__FrameTimeHistogram__
+
+#include <iostream>
+#include <vector>
+
+// A streaming histogram of frame times with logarithmic buckets (in the style of HdrHistogram). Times are recorded in
+// microseconds, and each power of two is split into 128 linear sub-buckets, which means that every recorded time is kept
+// with a relative error below 1% from one microsecond up to the maximum trackable time. Recording a time is a constant time
+// operation that never allocates, and percentiles are computed from the bucket counts without keeping the individual times.
+class FrameTimeHistogram {
+
+public:
+    
+    // Creates a new, empty histogram. Times above the specified maximum (in milliseconds) are recorded as the maximum.
+    FrameTimeHistogram(double max_time = 60000);
+    
+    // Records a frame time (in milliseconds).
+    void Record(double time);
+    
+    // Returns the time (in milliseconds) that the specified percentage (0 - 100) of all recorded frames were at or below,
+    // or 0 if no frame has been recorded.
+    double GetPercentile(double percentile);
+    
+    // Returns the longest frame time recorded (in milliseconds).
+    double GetMax();
+    
+    // Returns the mean of all recorded frame times (in milliseconds).
+    double GetMean();
+    
+    // Returns the number of recorded frames.
+    long GetCount();
+    
+    // Removes all recorded frames.
+    void Reset();
+    
+    // Prints the number of frames, the mean, p50, p90, p99, p99.9 and the max.
+    void Print(std::ostream& out);
+
+private:
+    
+    // Internal helper function that returns the index of the bucket that a time (in microseconds) is counted in.
+    static int GetBucketIndex(long value);
+    
+    // Internal helper function that returns the highest time (in microseconds) counted in a bucket.
+    static long GetBucketValue(int index);
+    
+    // The number of frames counted in each bucket.
+    std::vector<long> counts;
+    
+    // The highest time (in microseconds) that can be recorded.
+    long max_value;
+    
+    // The number of recorded frames, and the sum and maximum of their times (in microseconds).
+    long count;
+    long total_value;
+    long recorded_max_value;
+};
+
+#endif
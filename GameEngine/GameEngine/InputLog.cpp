@@ -0,0 +1,220 @@
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include "InputLog.h"
+
+// The header at the start of every log file, followed by a format version byte.
+static const char INPUT_LOG_MAGIC[4] = {'G', 'E', 'I', 'L'};
+static const Uint8 INPUT_LOG_VERSION = 1;
+
+InputLog::InputLog(bool is_recording):is_recording(is_recording), last_frame(0), position(0), next_frame(0), is_next_quit(false), is_finished(false) {
+}
+
+// Creates a recording log and writes the header to its file.
+InputLog* InputLog::GetRecorder(std::string path) {
+    InputLog* log = new InputLog(true);
+    log->file.open(path.c_str(), std::ios::binary);
+    if (!log->file) {
+        delete log;
+        throw std::runtime_error("Failed to open the input log!");
+    }
+    log->file.write(INPUT_LOG_MAGIC, sizeof(INPUT_LOG_MAGIC));
+    log->WriteByte(INPUT_LOG_VERSION);
+    return log;
+}
+
+// Reads the whole file of a log into memory, checks the header and reads the first record.
+InputLog* InputLog::GetReplay(std::string path) {
+    std::ifstream input(path.c_str(), std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("Failed to open the input log!");
+    }
+    InputLog* log = new InputLog(false);
+    log->data.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    if (log->data.size() < sizeof(INPUT_LOG_MAGIC) + 1 || memcmp(log->data.data(), INPUT_LOG_MAGIC, sizeof(INPUT_LOG_MAGIC)) != 0 || log->data[sizeof(INPUT_LOG_MAGIC)] != INPUT_LOG_VERSION) {
+        delete log;
+        throw std::runtime_error("The input log has an unknown format!");
+    }
+    log->position = sizeof(INPUT_LOG_MAGIC) + 1;
+    try {
+        log->ReadRecord();
+    } catch (...) {
+        delete log;
+        throw;
+    }
+    return log;
+}
+
+// Writes a record for the event: the kind, the number of frames since the previous record and the fields of the event.
+// The file is flushed after each record so that the log is complete even if the game crashes.
+void InputLog::Record(int frame, const SDL_Event& event) {
+    Kind kind;
+    switch (event.type) {
+        case SDL_KEYDOWN: kind = KEY_DOWN; break;
+        case SDL_KEYUP: kind = KEY_UP; break;
+        case SDL_TEXTINPUT: kind = TEXT_INPUT; break;
+        case SDL_MOUSEMOTION: kind = MOUSE_MOTION; break;
+        case SDL_MOUSEBUTTONDOWN: kind = MOUSE_BUTTON_DOWN; break;
+        case SDL_MOUSEBUTTONUP: kind = MOUSE_BUTTON_UP; break;
+        case SDL_MOUSEWHEEL: kind = MOUSE_WHEEL; break;
+        case SDL_QUIT: kind = QUIT; break;
+        default: return;
+    }
+    WriteByte(kind);
+    WriteCount(frame - last_frame);
+    last_frame = frame;
+    if (kind == KEY_DOWN || kind == KEY_UP) {
+        WriteInt(event.key.keysym.sym);
+        WriteInt(event.key.keysym.scancode);
+        WriteCount(event.key.keysym.mod);
+        WriteByte(event.key.repeat);
+    } else if (kind == TEXT_INPUT) {
+        Uint32 length = (Uint32)strnlen(event.text.text, sizeof(event.text.text));
+        WriteCount(length);
+        file.write(event.text.text, length);
+    } else if (kind == MOUSE_MOTION) {
+        WriteInt(event.motion.x);
+        WriteInt(event.motion.y);
+        WriteInt(event.motion.xrel);
+        WriteInt(event.motion.yrel);
+        WriteCount(event.motion.state);
+    } else if (kind == MOUSE_BUTTON_DOWN || kind == MOUSE_BUTTON_UP) {
+        WriteByte(event.button.button);
+        WriteByte(event.button.clicks);
+        WriteInt(event.button.x);
+        WriteInt(event.button.y);
+    } else if (kind == MOUSE_WHEEL) {
+        WriteInt(event.wheel.x);
+        WriteInt(event.wheel.y);
+    }
+    file.flush();
+}
+
+// Adds the events of the specified frame. Events recorded for earlier frames (which can only happen if frames were skipped)
+// are added as well, so that no input is lost. The log is finished when the frame of the quit record is reached.
+void InputLog::Replay(int frame, std::vector<SDL_Event>& events) {
+    while (!is_finished && next_frame <= frame) {
+        if (is_next_quit) {
+            is_finished = true;
+            return;
+        }
+        events.push_back(next_event);
+        ReadRecord();
+    }
+}
+
+// Returns true if all events have been replayed.
+bool InputLog::IsFinished() {
+    return is_finished;
+}
+
+// Returns true if the log is recording events.
+bool InputLog::IsRecording() {
+    return is_recording;
+}
+
+InputLog::~InputLog() {
+    if (file.is_open()) {
+        file.close();
+    }
+}
+
+// Writes a single byte.
+void InputLog::WriteByte(Uint8 value) {
+    file.put((char)value);
+}
+
+// Writes a signed value as a zigzag encoded count, which keeps small negative values (such as relative mouse motion) short.
+void InputLog::WriteInt(Sint32 value) {
+    WriteCount(((Uint32)value << 1) ^ (Uint32)(value >> 31));
+}
+
+// Writes an unsigned value with seven bits in each byte, where the high bit marks that more bytes follow.
+void InputLog::WriteCount(Uint32 value) {
+    while (value >= 0x80) {
+        WriteByte((Uint8)(value | 0x80));
+        value >>= 7;
+    }
+    WriteByte((Uint8)value);
+}
+
+// Reads a single byte.
+Uint8 InputLog::ReadByte() {
+    if (position >= data.size()) {
+        throw std::runtime_error("The input log is truncated!");
+    }
+    return data[position++];
+}
+
+// Reads a value written by WriteInt.
+Sint32 InputLog::ReadInt() {
+    Uint32 value = ReadCount();
+    return (Sint32)((value >> 1) ^ (~(value & 1) + 1));
+}
+
+// Reads a value written by WriteCount.
+Uint32 InputLog::ReadCount() {
+    Uint32 value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        Uint8 byte = ReadByte();
+        value |= (Uint32)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    throw std::runtime_error("The input log is corrupt!");
+}
+
+// Reads the next record into the next event. A log without a quit record (for example if the game crashed while recording)
+// is treated as if the game quit in the frame after the last event.
+void InputLog::ReadRecord() {
+    if (position == data.size()) {
+        next_frame++;
+        is_next_quit = true;
+        return;
+    }
+    Uint8 kind = ReadByte();
+    next_frame += ReadCount();
+    is_next_quit = false;
+    memset(&next_event, 0, sizeof(next_event));
+    if (kind == KEY_DOWN || kind == KEY_UP) {
+        next_event.type = kind == KEY_DOWN ? SDL_KEYDOWN : SDL_KEYUP;
+        next_event.key.state = kind == KEY_DOWN ? SDL_PRESSED : SDL_RELEASED;
+        next_event.key.keysym.sym = ReadInt();
+        next_event.key.keysym.scancode = (SDL_Scancode)ReadInt();
+        next_event.key.keysym.mod = (Uint16)ReadCount();
+        next_event.key.repeat = ReadByte();
+    } else if (kind == TEXT_INPUT) {
+        next_event.type = SDL_TEXTINPUT;
+        Uint32 length = ReadCount();
+        if (length >= sizeof(next_event.text.text)) {
+            throw std::runtime_error("The input log is corrupt!");
+        }
+        for (int i = 0; i < length; i++) {
+            next_event.text.text[i] = (char)ReadByte();
+        }
+    } else if (kind == MOUSE_MOTION) {
+        next_event.type = SDL_MOUSEMOTION;
+        next_event.motion.x = ReadInt();
+        next_event.motion.y = ReadInt();
+        next_event.motion.xrel = ReadInt();
+        next_event.motion.yrel = ReadInt();
+        next_event.motion.state = ReadCount();
+    } else if (kind == MOUSE_BUTTON_DOWN || kind == MOUSE_BUTTON_UP) {
+        next_event.type = kind == MOUSE_BUTTON_DOWN ? SDL_MOUSEBUTTONDOWN : SDL_MOUSEBUTTONUP;
+        next_event.button.state = kind == MOUSE_BUTTON_DOWN ? SDL_PRESSED : SDL_RELEASED;
+        next_event.button.button = ReadByte();
+        next_event.button.clicks = ReadByte();
+        next_event.button.x = ReadInt();
+        next_event.button.y = ReadInt();
+    } else if (kind == MOUSE_WHEEL) {
+        next_event.type = SDL_MOUSEWHEEL;
+        next_event.wheel.x = ReadInt();
+        next_event.wheel.y = ReadInt();
+    } else if (kind == QUIT) {
+        next_event.type = SDL_QUIT;
+        is_next_quit = true;
+    } else {
+        throw std::runtime_error("The input log is corrupt!");
+    }
+}
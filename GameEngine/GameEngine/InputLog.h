@@ -0,0 +1,89 @@
+#ifndef __GameEngine__InputLog__
+#define __GameEngine__InputLog__
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <SDL2/SDL.h>
+
+// A log of the input events (keys, mouse and text input) of a game session together with the frame each event was delivered in.
+// A log is either written while the game is played (see Engine::RecordInput) or read in order to replay the session in place
+// of live input (see Engine::ReplayInput).
+// The log is stored in a compact binary format: a header followed by one record for each event, where each record holds the
+// kind of event, the number of frames since the previous record and the fields of the event that the engine uses.
+class InputLog {
+
+public:
+    
+    // Creates a new log that records events to the file at the specified path.
+    static InputLog* GetRecorder(std::string path);
+    
+    // Reads the log in the file at the specified path in order to replay it.
+    static InputLog* GetReplay(std::string path);
+    
+    // Records an event delivered in the specified frame. Events of other types than keys, mouse, text input and quit are ignored.
+    void Record(int frame, const SDL_Event& event);
+    
+    // Adds the replayed events that were delivered in the specified frame to the events. Quit events are not added,
+    // instead the log is marked as finished when the frame of the quit event is reached.
+    void Replay(int frame, std::vector<SDL_Event>& events);
+    
+    // Returns true if all events in a replayed log have been replayed.
+    bool IsFinished();
+    
+    // Returns true if the log is recording events.
+    bool IsRecording();
+    
+    // Closes the file of the log.
+    ~InputLog();
+
+private:
+    
+    // The kinds of events stored in the log.
+    enum Kind {KEY_DOWN = 1, KEY_UP, TEXT_INPUT, MOUSE_MOTION, MOUSE_BUTTON_DOWN, MOUSE_BUTTON_UP, MOUSE_WHEEL, QUIT};
+    
+    // Creates a new empty log.
+    InputLog(bool is_recording);
+    
+    // Private in order to guard against value semantics.
+    InputLog(const InputLog& other_log);
+    
+    // Private in order to guard against value semantics.
+    const InputLog& operator=(const InputLog& other_log);
+    
+    // Internal helper functions that write values to the file of a recording log.
+    void WriteByte(Uint8 value);
+    void WriteInt(Sint32 value);
+    void WriteCount(Uint32 value);
+    
+    // Internal helper functions that read values from the data of a replayed log.
+    Uint8 ReadByte();
+    Sint32 ReadInt();
+    Uint32 ReadCount();
+    
+    // Internal helper function that reads the next record from the data of a replayed log.
+    void ReadRecord();
+    
+    // A flag to indicate if the log is recording or replaying.
+    bool is_recording;
+    
+    // The file that a recording log is written to.
+    std::ofstream file;
+    
+    // The frame of the last recorded event.
+    int last_frame;
+    
+    // The contents of the file of a replayed log and the position of the next record.
+    std::vector<Uint8> data;
+    size_t position;
+    
+    // The next replayed event, the frame it was delivered in and whether it is a quit event.
+    SDL_Event next_event;
+    int next_frame;
+    bool is_next_quit;
+    
+    // A flag to indicate if all events of a replayed log have been replayed.
+    bool is_finished;
+};
+
+#endif
@@ -2,19 +2,26 @@
 #include "Window.h"
 
 LabelSprite* LabelSprite::GetInstance(std::string tag, std::string message, int x_pos, int y_pos) {
-    return new LabelSprite(tag, message, x_pos, y_pos);
+    return new LabelSprite(std::move(tag), std::move(message), x_pos, y_pos);
 }
 
-LabelSprite::LabelSprite(std::string tag, std::string message, int x_pos, int y_pos):message(message), Sprite(tag, x_pos, y_pos, 25 * message.length(), 50, "") {
+LabelSprite::LabelSprite(std::string tag, std::string message, int x_pos, int y_pos):message(std::move(message)), Sprite(std::move(tag), x_pos, y_pos, 25 * message.length(), 50, "") {
+    type = LABEL_SPRITE;
 }
 
-void LabelSprite::Draw(int elapsed_time) {
-    SDL_DestroyTexture(texture);
-    SDL_Color white = { 255, 255, 255 };
-    SDL_Surface* message_surface = TTF_RenderText_Solid(window->GetFont(), message.c_str(), white);
-    texture = SDL_CreateTextureFromSurface(window->GetRenderer(), message_surface);
-    SDL_FreeSurface(message_surface);
-    SDL_RenderCopy(window->GetRenderer(), texture, NULL, &boundary);
+// Draws the message of the label. The texture handle for the message is requested from the window the first time
+// the label is drawn, the text itself is rendered once by the window and then reused. The handle is requested again if
+// the window has reclaimed it while the label was not drawn.
+void LabelSprite::Draw(DrawList& draw_list) {
+    if (!window->TouchTextTexture(state.texture)) {
+        state.texture = window->GetTextTexture(message);
+    }
+    draw_list.Add(state.texture, &state.boundary, state.layer);
+}
+
+// Returns the message to show.
+const std::string& LabelSprite::GetMessage() {
+    return message;
 }
 
 LabelSprite::~LabelSprite() {
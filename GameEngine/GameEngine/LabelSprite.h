@@ -9,14 +9,17 @@
 
 // Class to represent text labels.
 class LabelSprite : public Sprite {
-    
+
     public:
     
     // Factory function to control object creation.
     static LabelSprite* GetInstance(std::string tag, std::string message, int x_pos, int y_pos);
     
-    // Draws a static image representing the sprite.
-    virtual void Draw(int);
+    // Draws the message of the label.
+    virtual void Draw(DrawList& draw_list);
+    
+    // Returns the message to show.
+    const std::string& GetMessage();
     
     virtual ~LabelSprite();
     
@@ -29,6 +32,6 @@ class LabelSprite : public Sprite {
     
     // The message to show.
     std::string message;
-    
+
 };
 #endif
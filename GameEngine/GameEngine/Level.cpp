@@ -1,8 +1,123 @@
+#include <cstring>
+#include <stdexcept>
+#include <algorithm>
 #include "Level.h"
 #include "Window.h"
 #include "Engine.h"
+#include "Trace.h"
 
-Level::Level(int goal):goal(goal), is_loaded(false), is_timelisteners_paused(false) {
+// The header at the start of every level snapshot (see Level::SaveSnapshot), followed by a record for each sprite and
+// the strings of the sprites. The size is the size of the whole snapshot.
+struct SnapshotHeader {
+    char magic[4];
+    Uint32 version, size, sprite_count, next_sprite_id, is_timelisteners_paused;
+};
+
+// The record of a sprite in a level snapshot: the identifier and class of the sprite, the image change delay of an
+// animated sprite, where the strings of the sprite start (relative to the start of the snapshot) and the state of the
+// sprite. The strings are the tag followed by the file name of a static or moving sprite, the number of images and the
+// images of an animated sprite, the message of a label or the text of a text input sprite. Each string is stored as its
+// length followed by its characters.
+struct SnapshotSprite {
+    Uint32 id, type;
+    Sint32 image_change_delay;
+    Uint32 strings_offset;
+    Sprite::State state;
+};
+
+static const char LEVEL_SNAPSHOT_MAGIC[4] = {'G', 'E', 'L', 'S'};
+static const Uint32 LEVEL_SNAPSHOT_VERSION = 1;
+
+// Appends a 32 bit number to a snapshot.
+static void AppendCount(std::vector<Uint8>& buffer, Uint32 count) {
+    const Uint8* bytes = (const Uint8*)&count;
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(count));
+}
+
+// Appends a string to a snapshot.
+static void AppendString(std::vector<Uint8>& buffer, const std::string& text) {
+    AppendCount(buffer, (Uint32)text.size());
+    buffer.insert(buffer.end(), text.begin(), text.end());
+}
+
+// Reads a 32 bit number from a snapshot at the position and moves the position past it, or returns false if the number
+// does not fit in the snapshot.
+static bool ReadCount(const std::vector<Uint8>& buffer, size_t& position, Uint32& count) {
+    if (position > buffer.size() || buffer.size() - position < sizeof(count)) {
+        return false;
+    }
+    memcpy(&count, buffer.data() + position, sizeof(count));
+    position += sizeof(count);
+    return true;
+}
+
+// Reads a string from a snapshot at the position as a pointer to its characters and its length, and moves the position
+// past it. Returns false if the string does not fit in the snapshot.
+static bool ReadString(const std::vector<Uint8>& buffer, size_t& position, const char*& text, Uint32& length) {
+    if (!ReadCount(buffer, position, length) || buffer.size() - position < length) {
+        return false;
+    }
+    text = (const char*)buffer.data() + position;
+    position += length;
+    return true;
+}
+
+// Returns the number of strings after the tag of a sprite of the specified class in a snapshot, or -1 if the number is
+// stored in the snapshot.
+static int GetSnapshotStringCount(Uint32 type) {
+    switch (type) {
+        case Sprite::STATIC_SPRITE:
+        case Sprite::MOVING_SPRITE:
+        case Sprite::LABEL_SPRITE:
+        case Sprite::TEXT_INPUT_SPRITE:
+            return 1;
+        case Sprite::ANIMATED_SPRITE:
+            return -1;
+        default:
+            return 0;
+    }
+}
+
+// Creates a sprite of a snapshot again from its record and strings, without listeners. The position and the rest of the
+// state are set from the record afterwards. Returns a null pointer for custom sprites.
+static Sprite* CreateSnapshotSprite(const SnapshotSprite& record, const std::vector<Uint8>& buffer, size_t offset) {
+    size_t position = offset + record.strings_offset;
+    const char* text;
+    Uint32 length;
+    ReadString(buffer, position, text, length);
+    std::string tag(text, length);
+    if (record.type == Sprite::ANIMATED_SPRITE) {
+        Uint32 image_count;
+        ReadCount(buffer, position, image_count);
+        std::vector<std::string> images;
+        images.reserve(image_count);
+        for (int i = 0; i < image_count; i++) {
+            ReadString(buffer, position, text, length);
+            images.emplace_back(text, length);
+        }
+        return AnimatedSprite::GetInstance(std::move(tag), std::move(images), record.image_change_delay, 0, 0, 0, 0);
+    }
+    if (GetSnapshotStringCount(record.type) == 0) {
+        return nullptr;
+    }
+    ReadString(buffer, position, text, length);
+    std::string asset(text, length);
+    switch (record.type) {
+        case Sprite::STATIC_SPRITE:
+            return StaticSprite::GetInstance(std::move(tag), std::move(asset), 0, 0, 0, 0);
+        case Sprite::MOVING_SPRITE:
+            return MovingSprite::GetInstance(std::move(tag), std::move(asset), 0, 0, 0, 0, 0, 0);
+        case Sprite::LABEL_SPRITE:
+            return LabelSprite::GetInstance(std::move(tag), std::move(asset), 0, 0);
+        default: {
+            TextInputSprite* text_input = TextInputSprite::GetInstance(std::move(tag), 0, 0);
+            text_input->SetText(asset);
+            return text_input;
+        }
+    }
+}
+
+Level::Level(int goal):goal(goal), is_loaded(false), is_timelisteners_paused(false), window(nullptr), next_sprite_id(1) {
     
 }
 
@@ -11,6 +126,7 @@ Level::Level(int goal):goal(goal), is_loaded(false), is_timelisteners_paused(fal
 // When the sprite has access to the render, it can create its texture. This is done here by calling Sprite::SetUpTexture.
 // After these steps, the sprite can be added to the vector of sprites which will be rendererd during the next iteration of the main event loop.
 void Level::AddSprite(Sprite* sprite) {
+    sprite->SetId(next_sprite_id++);
     sprites.push_back(sprite);
     if (is_loaded) {
         window->LoadSprite(sprite);
@@ -23,20 +139,50 @@ void Level::RemoveSprite(Sprite* sprite) {
     sprite->SetIsRemoved(true);
 }
 
+// Deletes all sprites that have been marked for removal. The remaining sprites are moved down in one pass,
+// which keeps them in the order they were added.
 void Level::CleanUpSprites() {
+    TRACE_ZONE("Level::CleanUpSprites");
+    int kept_count = 0;
     for (int i = 0; i < sprites.size(); i++) {
         if (sprites[i]->GetIsRemoved()) {
             delete sprites[i];
-            sprites.erase(sprites.begin() + i);
+        } else {
+            sprites[kept_count++] = sprites[i];
         }
     }
+    sprites.resize(kept_count);
+}
+
+// Reserves the storage of the vector of sprites.
+void Level::ReserveSprites(int count) {
+    sprites.reserve(count);
 }
 
 // Returns a vector of all sprites that have been added to the window.
-std::vector<Sprite*> Level::GetSprites() {
+const std::vector<Sprite*>& Level::GetSprites() {
     return sprites;
 }
 
+// Returns the number of sprites in the level.
+int Level::GetSpriteCount() {
+    return (int)sprites.size();
+}
+
+// Returns the sprite with the specified index.
+Sprite* Level::GetSprite(int index) {
+    return sprites[index];
+}
+
+// Finds the sprite with a binary search, since identifiers are handed out in the order the sprites are added and both
+// cleaning up and restoring a snapshot keep that order.
+Sprite* Level::FindSprite(Uint32 id) {
+    std::vector<Sprite*>::iterator it = std::lower_bound(sprites.begin(), sprites.end(), id, [](Sprite* lhs, Uint32 id) {
+        return lhs->GetId() < id;
+    });
+    return it != sprites.end() && (*it)->GetId() == id ? *it : nullptr;
+}
+
 // Sets the background of the level by loading the image located at the the path specified as argument.
 // The background is added to the level as a new StaticSprite which is then by calling Window::AddSprite.
 void Level::SetBackground(std::string background_image_path) {
@@ -62,8 +208,8 @@ void Level::SetWindow(Window* window) {
 // Adds a new time listener to the internal map that contains all time listeners.
 // The delay is used as key, meaning that two time listeners with the same delay cannot be
 // registered at the same time.
-void Level::AddTimeListener(std::function<void(void)> listener, int delay) {
-    time_listeners[delay] = listener;
+void Level::AddTimeListener(std::function<void(void)> listener, int delay, std::string name) {
+    time_listeners[delay] = {listener, name != "" ? name : "level.time[" + std::to_string(delay) + "ms]"};
 }
 
 // Pauses all time listeners that have been added to this level by setting the flag time_listeners_paused.
@@ -71,8 +217,200 @@ void Level::SetTimeListenersPaused(bool is_timelisteners_paused) {
     this->is_timelisteners_paused = is_timelisteners_paused;
 }
 
+// Returns true as soon as an animating sprite is found.
+bool Level::GetIsAnimating() {
+    for (int i = 0; i < sprites.size(); i++) {
+        if (sprites[i]->GetIsAnimating()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Finds the earliest frame of the time listeners of the level, evaluated as in HandleTime, and of the sprites.
+// The time listeners of the level are left out while they are paused.
+int Level::GetNextTimeListenerFrame(int frame, int fps) {
+    int next_frame = -1;
+    if (!is_timelisteners_paused) {
+        for (std::pair<const int, NamedListener<std::function<void(void)>>>& entry : time_listeners) {
+            int rhs = (int)(round(((fps / 1000.0 ) * entry.first)));
+            int listener_frame = rhs > 0 ? frame + (rhs - frame % rhs) % rhs : frame;
+            if (next_frame == -1 || listener_frame < next_frame) {
+                next_frame = listener_frame;
+            }
+        }
+    }
+    for (int i = 0; i < sprites.size(); i++) {
+        int sprite_frame = sprites[i]->GetNextTimeListenerFrame(frame, fps);
+        if (sprite_frame != -1 && (next_frame == -1 || sprite_frame < next_frame)) {
+            next_frame = sprite_frame;
+        }
+    }
+    return next_frame;
+}
+
+// Adds the number of sprites, the state of each sprite and the paused flag to the hash.
+void Level::HashState(StateHash& hash) {
+    TRACE_ZONE("Level::HashState");
+    hash.Add((Sint64)sprites.size());
+    for (int i = 0; i < sprites.size(); i++) {
+        sprites[i]->HashState(hash);
+    }
+    hash.Add(is_timelisteners_paused);
+}
+
+// Writes the header and the records first and appends the strings of each sprite after them, since the size of the records
+// is known up front. The buffer keeps its storage, so snapshots of a level of the same size do not allocate.
+void Level::SaveSnapshot(std::vector<Uint8>& buffer, size_t offset) {
+    TRACE_ZONE("Level::SaveSnapshot");
+    buffer.resize(offset + sizeof(SnapshotHeader) + sprites.size() * sizeof(SnapshotSprite));
+    for (int i = 0; i < sprites.size(); i++) {
+        Sprite* sprite = sprites[i];
+        SnapshotSprite record;
+        record.id = sprite->GetId();
+        record.type = sprite->GetType();
+        record.image_change_delay = 0;
+        record.strings_offset = (Uint32)(buffer.size() - offset);
+        record.state = sprite->GetState();
+        AppendString(buffer, sprite->GetTag());
+        switch (record.type) {
+            case Sprite::STATIC_SPRITE:
+            case Sprite::MOVING_SPRITE:
+                AppendString(buffer, sprite->GetFileName());
+                break;
+            case Sprite::ANIMATED_SPRITE: {
+                AnimatedSprite* animated_sprite = static_cast<AnimatedSprite*>(sprite);
+                const std::vector<std::string>& images = animated_sprite->GetImages();
+                record.image_change_delay = animated_sprite->GetImageChangeDelay();
+                AppendCount(buffer, (Uint32)images.size());
+                for (int k = 0; k < images.size(); k++) {
+                    AppendString(buffer, images[k]);
+                }
+                break;
+            }
+            case Sprite::LABEL_SPRITE:
+                AppendString(buffer, static_cast<LabelSprite*>(sprite)->GetMessage());
+                break;
+            case Sprite::TEXT_INPUT_SPRITE:
+                AppendString(buffer, static_cast<TextInputSprite*>(sprite)->GetText());
+                break;
+            default:
+                break;
+        }
+        memcpy(buffer.data() + offset + sizeof(SnapshotHeader) + i * sizeof(SnapshotSprite), &record, sizeof(record));
+    }
+    SnapshotHeader header;
+    memcpy(header.magic, LEVEL_SNAPSHOT_MAGIC, sizeof(LEVEL_SNAPSHOT_MAGIC));
+    header.version = LEVEL_SNAPSHOT_VERSION;
+    header.size = (Uint32)(buffer.size() - offset);
+    header.sprite_count = (Uint32)sprites.size();
+    header.next_sprite_id = next_sprite_id;
+    header.is_timelisteners_paused = is_timelisteners_paused;
+    memcpy(buffer.data() + offset, &header, sizeof(header));
+}
+
+// Checks the whole snapshot before anything is changed, so that a damaged snapshot leaves the level as it was.
+// The sprites of both the level and the snapshot are ordered by identifier, so they are matched by walking both in
+// order. The sprites to keep are collected in a second vector that then replaces the vector of sprites. Every sprite that
+// is deleted or created is reported, a sprite that is deleted and created again under the same identifier only once.
+const std::vector<Level::ReplacedSprite>& Level::RestoreSnapshot(const std::vector<Uint8>& buffer, size_t offset) {
+    TRACE_ZONE("Level::RestoreSnapshot");
+    CheckSnapshot(buffer, offset);
+    SnapshotHeader header;
+    memcpy(&header, buffer.data() + offset, sizeof(header));
+    restored_sprites.clear();
+    restored_sprites.reserve(header.sprite_count);
+    replaced_sprites.clear();
+    int next = 0;
+    for (int i = 0; i < header.sprite_count; i++) {
+        SnapshotSprite record;
+        memcpy(&record, buffer.data() + offset + sizeof(SnapshotHeader) + i * sizeof(SnapshotSprite), sizeof(record));
+        while (next < sprites.size() && sprites[next]->GetId() < record.id) {
+            replaced_sprites.push_back({sprites[next]->GetId(), nullptr});
+            delete sprites[next++];
+        }
+        Sprite* sprite = nullptr;
+        if (next < sprites.size() && sprites[next]->GetId() == record.id) {
+            if (sprites[next]->GetType() == record.type) {
+                sprite = sprites[next];
+            } else {
+                delete sprites[next];
+            }
+            next++;
+        }
+        if (sprite == nullptr) {
+            sprite = CreateSnapshotSprite(record, buffer, offset);
+            replaced_sprites.push_back({record.id, sprite});
+            if (sprite == nullptr) {
+                continue;
+            }
+            sprite->SetId(record.id);
+            if (is_loaded) {
+                window->LoadSprite(sprite);
+            }
+        } else if (record.type == Sprite::TEXT_INPUT_SPRITE) {
+            TextInputSprite* text_input = static_cast<TextInputSprite*>(sprite);
+            size_t position = offset + record.strings_offset;
+            const char* text;
+            Uint32 length;
+            ReadString(buffer, position, text, length);
+            ReadString(buffer, position, text, length);
+            if (text_input->GetText().size() != length || memcmp(text_input->GetText().data(), text, length) != 0) {
+                text_input->SetText(std::string(text, length));
+            }
+        }
+        sprite->SetState(record.state);
+        restored_sprites.push_back(sprite);
+    }
+    while (next < sprites.size()) {
+        replaced_sprites.push_back({sprites[next]->GetId(), nullptr});
+        delete sprites[next++];
+    }
+    sprites.swap(restored_sprites);
+    restored_sprites.clear();
+    next_sprite_id = header.next_sprite_id;
+    is_timelisteners_paused = header.is_timelisteners_paused != 0;
+    return replaced_sprites;
+}
+
+// Checks the header, that the records fit in the snapshot with identifiers in increasing order and that the strings of each sprite fit.
+void Level::CheckSnapshot(const std::vector<Uint8>& buffer, size_t offset) {
+    SnapshotHeader header;
+    if (offset > buffer.size() || buffer.size() - offset < sizeof(header)) {
+        throw std::runtime_error("The level snapshot has an unknown format!");
+    }
+    memcpy(&header, buffer.data() + offset, sizeof(header));
+    if (memcmp(header.magic, LEVEL_SNAPSHOT_MAGIC, sizeof(LEVEL_SNAPSHOT_MAGIC)) != 0 || header.version != LEVEL_SNAPSHOT_VERSION) {
+        throw std::runtime_error("The level snapshot has an unknown format!");
+    }
+    bool is_valid = header.size == buffer.size() - offset && header.sprite_count <= (header.size - sizeof(header)) / sizeof(SnapshotSprite);
+    Uint32 last_id = 0;
+    for (int i = 0; is_valid && i < header.sprite_count; i++) {
+        SnapshotSprite record;
+        memcpy(&record, buffer.data() + offset + sizeof(SnapshotHeader) + i * sizeof(SnapshotSprite), sizeof(record));
+        size_t position = offset + record.strings_offset;
+        const char* text;
+        Uint32 length;
+        int string_count = GetSnapshotStringCount(record.type);
+        is_valid = record.id > last_id && record.id < header.next_sprite_id && ReadString(buffer, position, text, length);
+        if (is_valid && string_count == -1) {
+            Uint32 image_count;
+            is_valid = ReadCount(buffer, position, image_count) && image_count > 0;
+            string_count = is_valid ? (int)image_count : 0;
+        }
+        for (int k = 0; is_valid && k < string_count; k++) {
+            is_valid = ReadString(buffer, position, text, length);
+        }
+        last_id = record.id;
+    }
+    if (!is_valid) {
+        throw std::runtime_error("The level snapshot is damaged!");
+    }
+}
+
 // Delegates an event to the sprites that have been added to the level and the time listeners added to the level.
 void Level::DelegateEvent(SDL_Event& event) {
+    TRACE_ZONE("Level::DelegateEvent");
     if (event.type == Engine::GetTimeEventType()) {
         HandleTime(event);
     }
@@ -87,25 +425,48 @@ void Level::DelegateEvent(SDL_Event& event) {
 // Example:
 // if the current fps is set to 30 and the delay for a time event listener is set to 60. Then that specific time event listener
 // should be called every second main event loop iteration.
+// The number of listeners called is added to the metrics of the window, and the listeners are timed if the window has a listener profiler.
 void Level::HandleTime(SDL_Event& event) {
+    TRACE_ZONE("Level::HandleTime");
     if (!is_timelisteners_paused) {
-        for (std::pair<const int, std::function<void(void)>>& entry : time_listeners) {
+        int invocations = 0;
+        ListenerProfiler* profiler = window != nullptr ? window->GetListenerProfiler() : nullptr;
+        for (std::pair<const int, NamedListener<std::function<void(void)>>>& entry : time_listeners) {
             int fps = *((int*)event.user.data1);
             int frame_counter = *((int*)event.user.data2);
             int rhs = (int)(round(((fps / 1000.0 ) * entry.first)));
             if (rhs > 0) {
                 int result = frame_counter % rhs;
                 if (result == 0) {
-                    entry.second();
+                    ListenerProfiler::Call(profiler, entry.second);
+                    invocations++;
                 }
             } else {
-                entry.second();
+                ListenerProfiler::Call(profiler, entry.second);
+                invocations++;
             }
         }
+        if (invocations > 0 && window != nullptr && window->GetMetrics() != nullptr) {
+            window->GetMetrics()->Add(Metrics::LISTENER_INVOCATIONS, invocations);
+        }
     }
 }
 
+// Adds a task to the tasks tied to the lifetime of the level, removing the tasks that are already done.
+void Level::AddTask(Task task) {
+    for (int i = (int)tasks.size() - 1; i >= 0; i--) {
+        if (tasks[i].IsDone()) {
+            tasks.erase(tasks.begin() + i);
+        }
+    }
+    tasks.push_back(task);
+}
+
+// Cancels the tasks tied to the lifetime of the level and deletes all sprites.
 Level::~Level() {
+    for (int i = 0; i < tasks.size(); i++) {
+        tasks[i].Cancel();
+    }
     for (int i = 0; i < sprites.size(); i++) {
         delete sprites[i];
     }
@@ -3,15 +3,24 @@
 
 #include "Sprite.h"
 #include "StaticSprite.h"
+#include "Task.h"
 
 class Window; // Forward declaration neeeded to avoid cyclic dependency.
 
 class Level {
 public:
     
+    // A sprite whose object was replaced when a snapshot was restored (see RestoreSnapshot): its identifier, and the sprite
+    // that has the identifier now, or a null pointer if the level no longer has a sprite with the identifier.
+    struct ReplacedSprite {
+        Uint32 id;
+        Sprite* sprite;
+    };
+    
     Level(int goal);
     
     // Adds a new sprite to this level by taking in a sprite pointer as argument.
+    // The sprite is given an identifier that is higher than the identifiers of all sprites added before it (see Sprite::GetId).
     void AddSprite(Sprite* sprite); // TODO: implement layers? Could maybe be done with a tree set to hold the sprites instead of a vector
     
     // Removes an existing sprite from this level by taking in a sprite pointer as argument.
@@ -20,8 +29,22 @@ public:
     
     void CleanUpSprites();
     
-    // Returns a vector of all sprites that have been added to the level.
-    std::vector<Sprite*> GetSprites();
+    // Reserves storage for the specified number of sprites, so that adding that many sprites does not grow the storage
+    // again (see LevelFile::CreateLevel).
+    void ReserveSprites(int count);
+    
+    // Returns a vector of all sprites that have been added to the level. The vector is not copied, so it changes when
+    // sprites are added or cleaned up.
+    const std::vector<Sprite*>& GetSprites();
+    
+    // Returns the number of sprites in the level.
+    int GetSpriteCount();
+    
+    // Returns the sprite with the specified index, in the order the sprites were added.
+    Sprite* GetSprite(int index);
+    
+    // Returns the sprite with the specified identifier (see Sprite::GetId), or a null pointer if it is not in the level.
+    Sprite* FindSprite(Uint32 id);
     
     // Sets the background of the level by loading the image located at the the path specified as argument.
     void SetBackground(std::string background_image_path);
@@ -39,21 +62,56 @@ public:
     // together with a delay (in milliseconds).
     // This function will then be called repeatedly each time the delay expires. The minimum delay is equal to the fps value. If the delay is set
     // to a value below the fps, then the time event listener will be called in each iteration of the main event loop.
-    void AddTimeListener(std::function<void(void)> listener, int delay);
+    // The name is what the listener is reported as by the listener profiler (see ListenerProfiler), by default "level.time" followed by the delay.
+    void AddTimeListener(std::function<void(void)> listener, int delay, std::string name = "");
     
     // Pauses all time listeners that have been added to this level
     void SetTimeListenersPaused(bool is_timelisteners_paused);
     
+    // Returns true if any sprite in the level is animating (see Sprite::GetIsAnimating).
+    bool GetIsAnimating();
+    
+    // Returns the first frame from the specified frame on in which a time listener of the level or of one of its sprites
+    // is called at the specified number of frames per second, or -1 if no time listener is ever called.
+    int GetNextTimeListenerFrame(int frame, int fps);
+    
+    // Adds the state of the level and all its sprites, in the order they were added, to the specified hash.
+    void HashState(StateHash& hash);
+    
+    // Saves the dynamic state of the level into the specified buffer, replacing its contents: the state of each sprite
+    // (see Sprite::State), what is needed to create each sprite again, the text of text input sprites and whether the time
+    // listeners are paused. The time listeners themselves are called by frame number, so their timers are part of the
+    // state of the engine. Reusing the same buffer for each snapshot means that no memory is allocated once it is large enough.
+    // The snapshot is only meant to be restored by the same build of the engine. With an offset, the snapshot is saved
+    // after the specified number of bytes at the start of the buffer, which are left as they are.
+    void SaveSnapshot(std::vector<Uint8>& buffer, size_t offset = 0);
+    
+    // Restores the dynamic state of the level from a snapshot saved by SaveSnapshot. Sprites are matched by identifier:
+    // sprites that exist in both keep their objects and get the state from the snapshot, so pointers to them stay valid.
+    // Sprites added after the snapshot was saved are deleted and sprites deleted since are created again as new objects.
+    // Sprites created again have no listeners or tasks, and custom sprites (see Sprite::Type) cannot be created again.
+    // Returns the sprites whose objects were deleted or created, ordered by identifier, so that a game holding pointers to
+    // sprites can rebind them. The vector is reused by the next restore. Must not be called while the sprites of the level
+    // are delegated events. Throws if the buffer is not a level snapshot, in which case the level is left as it was.
+    // The offset is the offset the snapshot was saved at.
+    const std::vector<ReplacedSprite>& RestoreSnapshot(const std::vector<Uint8>& buffer, size_t offset = 0);
+    
     // Receives an event and delegates it.
     void DelegateEvent(SDL_Event& event);
     
-    ~Level();
+    // Ties the lifetime of a task to the level, the task is cancelled when the level is deleted (see Engine::RunAsync).
+    void AddTask(Task task);
     
+    ~Level();
+
 private:
     
     // Handles the time events emitted by the game engine. Calls the registererd time listeners (if any).
     void HandleTime(SDL_Event& event);
     
+    // Internal helper function that checks that a buffer holds a complete level snapshot. Throws if it does not.
+    void CheckSnapshot(const std::vector<Uint8>& buffer, size_t offset);
+    
     // A vector that contains all sprites that have been added to this level.
     std::vector<Sprite*> sprites;
     
@@ -67,10 +125,24 @@ private:
     Window* window;
     
     // A data structure to hold all time event listeners registererd (if any) together with the delay for each listener.
-    std::map<int, std::function<void(void)>> time_listeners;
+    std::map<int, NamedListener<std::function<void(void)>>> time_listeners;
     
     // The goal for this level, specified with an integer.
     int goal;
+    
+    // The tasks tied to the lifetime of the level.
+    std::vector<Task> tasks;
+    
+    // The identifier of the next sprite added to the level.
+    Uint32 next_sprite_id;
+    
+    // The sprites of the level while a snapshot is restored, and the sprites whose objects the last restore replaced, kept
+    // between restores so that their storage is reused.
+    std::vector<Sprite*> restored_sprites;
+    std::vector<ReplacedSprite> replaced_sprites;
+    
+    // Gives the microbenchmarks access to the internal functions they measure.
+    friend class Microbenchmark;
 };
 
 #endif
@@ -0,0 +1,346 @@
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <stdexcept>
+#include <memory>
+#include "LevelFile.h"
+#include "StaticSprite.h"
+#include "MovingSprite.h"
+#include "AnimatedSprite.h"
+#include "LabelSprite.h"
+
+// The header at the start of every binary level file.
+static const char LEVEL_FILE_MAGIC[4] = {'G', 'E', 'L', 'V'};
+
+// The number of 32 bit fields of the header and of a sprite record, which are all stored as little endian words.
+static const int HEADER_WORDS = sizeof(LevelFile::Header) / sizeof(Uint32);
+static const int SPRITE_RECORD_WORDS = sizeof(LevelFile::SpriteRecord) / sizeof(Uint32);
+
+static_assert(sizeof(LevelFile::Header) == HEADER_WORDS * sizeof(Uint32), "The header must consist of 32 bit fields only.");
+static_assert(sizeof(LevelFile::SpriteRecord) == SPRITE_RECORD_WORDS * sizeof(Uint32), "A sprite record must consist of 32 bit fields only.");
+
+// Converts an array of 32 bit words between little endian and the byte order of the machine, which does nothing on little endian machines.
+static void SwapWords(void* words, size_t count) {
+    Uint32* word = (Uint32*)words;
+    for (size_t i = 0; i < count; i++) {
+        word[i] = SDL_SwapLE32(word[i]);
+    }
+}
+
+// Writes an array of 32 bit words as little endian.
+static void WriteWords(std::ofstream& file, const Uint32* words, size_t count) {
+    std::vector<Uint32> swapped(words, words + count);
+    SwapWords(swapped.data(), count);
+    file.write((const char*)swapped.data(), count * sizeof(Uint32));
+}
+
+// Returns true if the section with the specified number of entries of the specified size at the specified offset ends
+// before the specified end (the end of the file or of the next section).
+static bool IsInFile(Uint32 offset, Uint32 count, size_t entry_size, size_t end) {
+    return offset <= end && count <= (end - offset) / entry_size;
+}
+
+LevelFile::LevelFile(int goal):goal(goal), background(-1) {
+}
+
+// Parses the file line by line. Errors are reported with the number of the line they occured on.
+LevelFile* LevelFile::ReadText(std::string path) {
+    std::ifstream input(path.c_str());
+    if (!input) {
+        throw std::runtime_error("Failed to open the level file!");
+    }
+    LevelFile* level_file = new LevelFile();
+    std::string line;
+    for (int line_number = 1; std::getline(input, line); line_number++) {
+        try {
+            level_file->ParseStatement(line);
+        } catch (const std::exception& error) {
+            delete level_file;
+            throw std::runtime_error("Error on line " + std::to_string(line_number) + " of the level file: " + error.what());
+        }
+    }
+    return level_file;
+}
+
+// Checks the header and the index before reading each section of the file straight into where it is kept, with one read
+// per section. The sprite records are read as they are, since they are stored exactly like they are laid out in memory
+// (apart from the byte order on big endian machines). The sprites are checked against the string table and the image
+// lists, so that a level file that is read can always be turned into a level.
+LevelFile* LevelFile::ReadBinary(std::string path) {
+    std::ifstream input(path.c_str(), std::ios::binary | std::ios::ate);
+    if (!input) {
+        throw std::runtime_error("Failed to open the level file!");
+    }
+    size_t file_size = (size_t)input.tellg();
+    input.seekg(0);
+    Header header;
+    if (!input.read((char*)&header, sizeof(header))) {
+        throw std::runtime_error("The level file has an unknown format!");
+    }
+    SwapWords(&header.version, HEADER_WORDS - 1);
+    if (memcmp(header.magic, LEVEL_FILE_MAGIC, sizeof(LEVEL_FILE_MAGIC)) != 0 || header.version != VERSION) {
+        throw std::runtime_error("The level file has an unknown format!");
+    }
+    if (header.file_size != file_size || header.string_count == UINT32_MAX || header.image_offset < header.string_offset
+        || !IsInFile(header.string_offset, header.string_count + 1, sizeof(Uint32), header.image_offset)
+        || !IsInFile(header.image_offset, header.image_count, sizeof(Uint32), file_size)
+        || !IsInFile(header.sprite_offset, header.sprite_count, sizeof(SpriteRecord), file_size)) {
+        throw std::runtime_error("The level file is damaged!");
+    }
+
+    // The string table is read as a whole, since its strings are copied out of it.
+    std::vector<char> string_table(header.image_offset - header.string_offset);
+    input.seekg(header.string_offset);
+    input.read(string_table.data(), string_table.size());
+    std::vector<Uint32> string_offsets(header.string_count + 1);
+    memcpy(string_offsets.data(), string_table.data(), string_offsets.size() * sizeof(Uint32));
+    SwapWords(string_offsets.data(), string_offsets.size());
+    size_t characters_offset = string_offsets.size() * sizeof(Uint32);
+
+    std::unique_ptr<LevelFile> level_file(new LevelFile(header.goal));
+    bool is_valid = header.background < (Sint32)header.string_count;
+    level_file->strings.reserve(header.string_count);
+    for (int i = 0; is_valid && i < header.string_count; i++) {
+        is_valid = string_offsets[i] <= string_offsets[i + 1] && string_offsets[i + 1] <= string_table.size() - characters_offset;
+        if (is_valid) {
+            level_file->strings.emplace_back(string_table.data() + characters_offset + string_offsets[i], string_offsets[i + 1] - string_offsets[i]);
+            level_file->string_indices.emplace(level_file->strings.back(), i);
+        }
+    }
+    level_file->images.resize(header.image_count);
+    input.seekg(header.image_offset);
+    input.read((char*)level_file->images.data(), header.image_count * sizeof(Uint32));
+    SwapWords(level_file->images.data(), header.image_count);
+    level_file->sprites.resize(header.sprite_count);
+    input.seekg(header.sprite_offset);
+    input.read((char*)level_file->sprites.data(), header.sprite_count * sizeof(SpriteRecord));
+    SwapWords(level_file->sprites.data(), header.sprite_count * SPRITE_RECORD_WORDS);
+
+    is_valid = is_valid && input;
+    for (int i = 0; is_valid && i < level_file->images.size(); i++) {
+        is_valid = level_file->images[i] < header.string_count;
+    }
+    for (int i = 0; is_valid && i < level_file->sprites.size(); i++) {
+        is_valid = level_file->IsValidSprite(level_file->sprites[i]);
+    }
+    if (!is_valid) {
+        throw std::runtime_error("The level file is damaged!");
+    }
+    level_file->background = header.background;
+    return level_file.release();
+}
+
+// Reads the file and creates the level. The file is held in a unique_ptr, so it is deleted both when the level has been
+// created and when creating it throws (for example from a sprite factory), since the level does not refer to it.
+Level* LevelFile::Load(std::string path) {
+    std::unique_ptr<LevelFile> level_file(ReadBinary(path));
+    return level_file->CreateLevel();
+}
+
+// Writes the header, the string table, the image lists and the sprite records, in that order. The string table starts
+// with the offset of each string (and the offset of the end of the last string) among the characters that follow it.
+void LevelFile::WriteBinary(std::string path) {
+    std::vector<Uint32> string_offsets(1, 0);
+    string_offsets.reserve(strings.size() + 1);
+    for (int i = 0; i < strings.size(); i++) {
+        string_offsets.push_back(string_offsets.back() + (Uint32)strings[i].size());
+    }
+    Uint32 characters_size = string_offsets.back();
+
+    Header header;
+    memcpy(header.magic, LEVEL_FILE_MAGIC, sizeof(LEVEL_FILE_MAGIC));
+    header.version = VERSION;
+    header.goal = goal;
+    header.background = background;
+    header.string_count = (Uint32)strings.size();
+    header.string_offset = sizeof(Header);
+    header.image_count = (Uint32)images.size();
+    header.image_offset = header.string_offset + (Uint32)(string_offsets.size() * sizeof(Uint32)) + characters_size;
+    header.sprite_count = (Uint32)sprites.size();
+    header.sprite_offset = header.image_offset + (Uint32)(images.size() * sizeof(Uint32));
+    header.file_size = header.sprite_offset + (Uint32)(sprites.size() * sizeof(SpriteRecord));
+
+    std::ofstream file(path.c_str(), std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open the level file!");
+    }
+    file.write(header.magic, sizeof(header.magic));
+    WriteWords(file, &header.version, HEADER_WORDS - 1);
+    WriteWords(file, string_offsets.data(), string_offsets.size());
+    for (int i = 0; i < strings.size(); i++) {
+        file.write(strings[i].data(), strings[i].size());
+    }
+    WriteWords(file, images.data(), images.size());
+    WriteWords(file, (const Uint32*)sprites.data(), sprites.size() * SPRITE_RECORD_WORDS);
+    if (!file) {
+        throw std::runtime_error("Failed to write the level file!");
+    }
+}
+
+// Creates the sprites in the order they were added, after the background. The vector of sprites of the level is reserved
+// for all of them first, so it is allocated once instead of growing while the sprites are added. The level is held in a
+// unique_ptr until it is returned, so that it and the sprites added so far are deleted if creating a sprite throws.
+Level* LevelFile::CreateLevel() {
+    std::unique_ptr<Level> level(new Level(goal));
+    level->ReserveSprites((int)sprites.size() + (background >= 0 ? 1 : 0));
+    if (background >= 0) {
+        level->SetBackground(strings[background]);
+    }
+    for (int i = 0; i < sprites.size(); i++) {
+        level->AddSprite(CreateSprite(sprites[i]));
+    }
+    return level.release();
+}
+
+// Sets the background image of the level.
+void LevelFile::SetBackground(std::string image) {
+    background = (Sint32)AddString(image);
+}
+
+// Looks the string up in the index of the string table.
+Uint32 LevelFile::AddString(const std::string& text) {
+    std::map<std::string, Uint32>::iterator it = string_indices.find(text);
+    if (it != string_indices.end()) {
+        return it->second;
+    }
+    strings.push_back(text);
+    string_indices.emplace(text, (Uint32)strings.size() - 1);
+    return (Uint32)strings.size() - 1;
+}
+
+// Adds the images to the string table and their indices to the image lists.
+Uint32 LevelFile::AddImages(const std::vector<std::string>& images) {
+    Uint32 first_image = (Uint32)this->images.size();
+    for (int i = 0; i < images.size(); i++) {
+        this->images.push_back(AddString(images[i]));
+    }
+    return first_image;
+}
+
+// Adds the sprite after checking that it refers to strings and images of the file.
+void LevelFile::AddSprite(const SpriteRecord& sprite) {
+    if (!IsValidSprite(sprite)) {
+        throw std::runtime_error("The sprite refers to a string or image that has not been added to the level file!");
+    }
+    sprites.push_back(sprite);
+}
+
+// Returns the number of sprites in the level file.
+int LevelFile::GetSpriteCount() {
+    return (int)sprites.size();
+}
+
+// Reads the keyword of the statement, the arguments of the keyword and the options that may follow the arguments of a sprite.
+// Empty lines and comments are skipped.
+void LevelFile::ParseStatement(const std::string& line) {
+    std::istringstream statement(line.substr(0, line.find('#')));
+    std::string keyword;
+    if (!(statement >> keyword)) {
+        return;
+    }
+    SpriteRecord sprite = {};
+    std::string tag, asset;
+    if (keyword == "level") {
+        statement >> goal;
+    } else if (keyword == "background") {
+        statement >> std::quoted(asset);
+        SetBackground(asset);
+    } else if (keyword == "static" || keyword == "moving") {
+        sprite.type = keyword == "static" ? STATIC_SPRITE : MOVING_SPRITE;
+        statement >> std::quoted(tag) >> std::quoted(asset) >> sprite.x >> sprite.y >> sprite.width >> sprite.height;
+        if (sprite.type == MOVING_SPRITE) {
+            statement >> sprite.dx >> sprite.dy;
+        }
+        sprite.asset = AddString(asset);
+        sprite.asset_count = 1;
+    } else if (keyword == "animated") {
+        sprite.type = ANIMATED_SPRITE;
+        int image_count = 0;
+        statement >> std::quoted(tag) >> sprite.x >> sprite.y >> sprite.width >> sprite.height >> sprite.delay >> image_count;
+        std::vector<std::string> animation(std::max(image_count, 0));
+        for (int i = 0; i < animation.size(); i++) {
+            statement >> std::quoted(animation[i]);
+        }
+        if (statement && image_count < 1) {
+            throw std::runtime_error("an animated sprite needs at least one image!");
+        }
+        sprite.asset = AddImages(animation);
+        sprite.asset_count = image_count;
+    } else if (keyword == "label") {
+        sprite.type = LABEL_SPRITE;
+        statement >> std::quoted(tag) >> sprite.x >> sprite.y >> std::quoted(asset);
+        sprite.asset = AddString(asset);
+        sprite.asset_count = 1;
+    } else {
+        throw std::runtime_error("unknown statement '" + keyword + "'!");
+    }
+    if (!statement) {
+        throw std::runtime_error("missing or invalid arguments to '" + keyword + "'!");
+    }
+    if (keyword == "level" || keyword == "background") {
+        return;
+    }
+    std::string option;
+    while (statement >> option) {
+        if (option == "layer" && statement >> sprite.layer) {
+            continue;
+        } else if (option == "hidden") {
+            sprite.flags |= HIDDEN;
+        } else {
+            throw std::runtime_error("invalid option '" + option + "'!");
+        }
+    }
+    sprite.tag = AddString(tag);
+    AddSprite(sprite);
+}
+
+// Returns true if the tag and the asset of the sprite are in the string table, or the images in the image lists.
+bool LevelFile::IsValidSprite(const SpriteRecord& sprite) {
+    if (sprite.tag >= strings.size()) {
+        return false;
+    }
+    switch (sprite.type) {
+        case STATIC_SPRITE:
+        case MOVING_SPRITE:
+        case LABEL_SPRITE:
+            return sprite.asset < strings.size();
+        case ANIMATED_SPRITE:
+            return sprite.asset_count > 0 && sprite.asset < images.size() && sprite.asset_count <= images.size() - sprite.asset;
+        default:
+            return false;
+    }
+}
+
+// Creates the sprite with the factory of its type, and sets the layer and visibility unless they are the defaults.
+Sprite* LevelFile::CreateSprite(const SpriteRecord& sprite) {
+    Sprite* created_sprite = nullptr;
+    switch (sprite.type) {
+        case STATIC_SPRITE:
+            created_sprite = StaticSprite::GetInstance(strings[sprite.tag], strings[sprite.asset], sprite.x, sprite.y, sprite.width, sprite.height);
+            break;
+        case MOVING_SPRITE:
+            created_sprite = MovingSprite::GetInstance(strings[sprite.tag], strings[sprite.asset], sprite.x, sprite.y, sprite.width, sprite.height, sprite.dx, sprite.dy);
+            break;
+        case ANIMATED_SPRITE: {
+            std::vector<std::string> animation;
+            animation.reserve(sprite.asset_count);
+            for (int i = 0; i < sprite.asset_count; i++) {
+                animation.push_back(strings[images[sprite.asset + i]]);
+            }
+            created_sprite = AnimatedSprite::GetInstance(strings[sprite.tag], animation, sprite.delay, sprite.x, sprite.y, sprite.width, sprite.height);
+            break;
+        }
+        default:
+            created_sprite = LabelSprite::GetInstance(strings[sprite.tag], strings[sprite.asset], sprite.x, sprite.y);
+            break;
+    }
+    if (sprite.layer != 0) {
+        created_sprite->SetLayer(sprite.layer);
+    }
+    if (sprite.flags & HIDDEN) {
+        created_sprite->SetIsVisible(false);
+    }
+    return created_sprite;
+}
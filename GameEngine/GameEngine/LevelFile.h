@@ -0,0 +1,133 @@
+#ifndef __GameEngine__LevelFile__
+#define __GameEngine__LevelFile__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <SDL2/SDL.h>
+#include "Level.h"
+
+// A level described as data instead of code: the goal and background of the level and one record for each sprite, which
+// holds the type, tag, image (or message), boundary, velocity, layer and visibility of the sprite. Collisions are detected
+// on the boundary of each sprite, so the boundary is also the collision data of the sprite.
+// A level file is either written in the text format by hand and converted (see ReadText and Tools/LevelConverter.cpp),
+// or written directly in the binary format, which is what games load (see Load and Engine::LoadLevel).
+//
+// The text format has one statement on each line, where strings may be quoted to contain spaces and # starts a comment:
+//     level <goal>
+//     background <image>
+//     static <tag> <image> <x> <y> <width> <height> [layer <layer>] [hidden]
+//     moving <tag> <image> <x> <y> <width> <height> <dx> <dy> [layer <layer>] [hidden]
+//     animated <tag> <x> <y> <width> <height> <delay> <image count> <image>... [layer <layer>] [hidden]
+//     label <tag> <x> <y> <message> [layer <layer>] [hidden]
+//
+// The binary format is little endian and made to be loaded in bulk: a Header with an index of the sections of the file,
+// the string table (the offset of each string followed by the characters of all strings), the image lists of animated
+// sprites (string indices) and the sprite records (SpriteRecord). All strings (tags, images and messages) are stored once
+// in the string table and referred to by index, and every section has a fixed size per entry, which means that the loader
+// knows the size of everything up front and never parses anything.
+class LevelFile {
+
+public:
+    
+    // The type of a sprite, which decides the class of the sprite that is created.
+    enum SpriteType {STATIC_SPRITE = 0, MOVING_SPRITE = 1, ANIMATED_SPRITE = 2, LABEL_SPRITE = 3};
+    
+    // Flags of a sprite record.
+    enum SpriteFlag {HIDDEN = 1};
+    
+    // A sprite. The tag and the asset are string indices, where the asset is the image of a static or moving sprite and
+    // the message of a label. For an animated sprite, the asset is the index of the first image in the image lists and
+    // the asset count is the number of images. The delay is the image change delay of an animated sprite (in milliseconds).
+    struct SpriteRecord {
+        Uint32 type, flags;
+        Sint32 layer;
+        Sint32 x, y, width, height, dx, dy;
+        Uint32 tag, asset, asset_count;
+        Sint32 delay;
+    };
+    
+    // The first bytes of a binary level file: the magic "GELV", the version of the format, the goal of the level, the string
+    // index of the background image (or -1 if there is none) and the index: the number of entries in and the byte offset of
+    // each section of the file.
+    struct Header {
+        char magic[4];
+        Uint32 version;
+        Sint32 goal;
+        Sint32 background;
+        Uint32 string_count, string_offset;
+        Uint32 image_count, image_offset;
+        Uint32 sprite_count, sprite_offset;
+        Uint32 file_size;
+    };
+    
+    // The version of the binary format.
+    static const Uint32 VERSION = 1;
+    
+    // Creates a new, empty level file with the specified goal.
+    LevelFile(int goal = 0);
+    
+    // Reads a level file in the text format. Throws if the file cannot be read or has an error, naming the line of the error.
+    static LevelFile* ReadText(std::string path);
+    
+    // Reads a level file in the binary format. Throws if the file cannot be read or is not a valid level file.
+    static LevelFile* ReadBinary(std::string path);
+    
+    // Reads the binary level file at the specified path and creates its level (see CreateLevel).
+    static Level* Load(std::string path);
+    
+    // Writes the level file in the binary format. Throws if the file cannot be written.
+    void WriteBinary(std::string path);
+    
+    // Creates a level with the background and the sprites of the file. The storage of the level is reserved for all sprites
+    // up front, so that a level with many sprites is created without growing its storage again and again.
+    Level* CreateLevel();
+    
+    // Sets the background image of the level.
+    void SetBackground(std::string image);
+    
+    // Returns the index of the string in the string table, adding it if it is not in the table yet.
+    Uint32 AddString(const std::string& text);
+    
+    // Adds a list of images for an animated sprite and returns the index of its first image in the image lists.
+    Uint32 AddImages(const std::vector<std::string>& images);
+    
+    // Adds a sprite. The strings and images referred to must have been added first. Throws if they have not.
+    void AddSprite(const SpriteRecord& sprite);
+    
+    // Returns the number of sprites in the level file.
+    int GetSpriteCount();
+
+private:
+    
+    // Private in order to guard against value semantics.
+    LevelFile(const LevelFile& other_file);
+    
+    // Private in order to guard against value semantics.
+    const LevelFile& operator=(const LevelFile& other_file);
+    
+    // Internal helper function that parses one statement of the text format.
+    void ParseStatement(const std::string& line);
+    
+    // Internal helper function that returns true if a sprite only refers to strings and images of the file.
+    bool IsValidSprite(const SpriteRecord& sprite);
+    
+    // Internal helper function that creates the sprite of a record.
+    Sprite* CreateSprite(const SpriteRecord& sprite);
+    
+    // The goal of the level and the string index of the background image, or -1.
+    int goal;
+    Sint32 background;
+    
+    // The string table, and the index of each string in it.
+    std::vector<std::string> strings;
+    std::map<std::string, Uint32> string_indices;
+    
+    // The image lists of the animated sprites, as string indices.
+    std::vector<Uint32> images;
+    
+    // The sprites, in the order they are added to the level.
+    std::vector<SpriteRecord> sprites;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#include <algorithm>
+#include <iomanip>
+#include "ListenerProfiler.h"
+
+ListenerProfiler::ListenerProfiler() {
+}
+
+// Adds the call to the entry with the specified name, creating the entry the first time the name is seen.
+void ListenerProfiler::Record(const std::string& name, double time) {
+    std::lock_guard<std::mutex> lock(entries_mutex);
+    std::map<std::string, Entry>::iterator entry = entries.find(name);
+    if (entry == entries.end()) {
+        entry = entries.insert(std::make_pair(name, Entry{name, 0, 0, 0})).first;
+    }
+    entry->second.calls++;
+    entry->second.total_time += time;
+    if (time > entry->second.max_time) {
+        entry->second.max_time = time;
+    }
+}
+
+// Copies the entries, sorts them by total time and keeps the first ones.
+std::vector<ListenerProfiler::Entry> ListenerProfiler::GetTopEntries(int count) {
+    std::vector<Entry> top_entries;
+    {
+        std::lock_guard<std::mutex> lock(entries_mutex);
+        for (std::pair<const std::string, Entry>& entry : entries) {
+            top_entries.push_back(entry.second);
+        }
+    }
+    std::sort(top_entries.begin(), top_entries.end(), [](const Entry& lhs, const Entry& rhs) {
+        return lhs.total_time > rhs.total_time;
+    });
+    if (count >= 0 && top_entries.size() > count) {
+        top_entries.resize(count);
+    }
+    return top_entries;
+}
+
+// Prints one row for each of the top entries with the number of calls, the total time, the mean time of a call and the
+// maximum time of a call.
+void ListenerProfiler::PrintReport(std::ostream& out, int count) {
+    std::vector<Entry> top_entries = GetTopEntries(count);
+    out << std::left << std::setw(44) << "listener" << std::right << std::setw(10) << "calls" << std::setw(12) << "total (ms)"
+        << std::setw(12) << "mean (us)" << std::setw(12) << "max (ms)" << std::endl;
+    for (int i = 0; i < top_entries.size(); i++) {
+        out << std::left << std::setw(44) << top_entries[i].name << std::right << std::setw(10) << top_entries[i].calls
+            << std::fixed << std::setprecision(3) << std::setw(12) << top_entries[i].total_time
+            << std::setw(12) << top_entries[i].total_time / top_entries[i].calls * 1000 << std::setw(12) << top_entries[i].max_time << std::endl;
+    }
+}
+
+// Removes all entries.
+void ListenerProfiler::Reset() {
+    std::lock_guard<std::mutex> lock(entries_mutex);
+    entries.clear();
+}
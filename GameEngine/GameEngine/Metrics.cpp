@@ -0,0 +1,133 @@
+#include "Metrics.h"
+#include "Level.h"
+#include "AllocationCounter.h"
+
+// The number of levels and tags that each sample has room for from the start, so that sampling a typical game does not
+// allocate even before the ring buffer has been filled once.
+static const int RESERVED_LEVELS = 4;
+static const int RESERVED_TAGS = 8;
+
+Metrics::Metrics(int capacity):samples(capacity > 0 ? capacity : 1), next_sample(0), sample_count(0), last_allocation_count(AllocationCounter::GetAllocationCount()), last_allocated_bytes(AllocationCounter::GetAllocatedBytes()) {
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        counters[i] = 0;
+    }
+    for (int i = 0; i < samples.size(); i++) {
+        samples[i].level_sprite_counts.reserve(RESERVED_LEVELS);
+        samples[i].tag_counts.reserve(RESERVED_TAGS);
+    }
+}
+
+// Adds a value to a counter. Relaxed ordering is enough since the counters are only read when the frame is done.
+void Metrics::Add(Counter counter, long value) {
+    counters[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+// Writes the counters into the next slot of the ring buffer and resets them. The sprites of each level are counted,
+// and the sprites of the current level are counted by tag.
+void Metrics::TakeSample(int frame, const std::vector<Level*>& levels, Level* current_level, int draw_calls) {
+    Sample& sample = samples[next_sample];
+    sample.frame = frame;
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        sample.values[i] = counters[i].exchange(0, std::memory_order_relaxed);
+    }
+    long allocation_count = AllocationCounter::GetAllocationCount();
+    sample.values[ALLOCATIONS] = allocation_count - last_allocation_count;
+    last_allocation_count = allocation_count;
+    long allocated_bytes = AllocationCounter::GetAllocatedBytes();
+    sample.values[ALLOCATED_BYTES] = allocated_bytes - last_allocated_bytes;
+    last_allocated_bytes = allocated_bytes;
+    sample.values[DRAW_CALLS] = draw_calls;
+    sample.values[SPRITES] = current_level != nullptr ? current_level->GetSpriteCount() : 0;
+    sample.level_sprite_counts.resize(levels.size());
+    for (int i = 0; i < levels.size(); i++) {
+        sample.level_sprite_counts[i] = levels[i]->GetSpriteCount();
+    }
+    for (std::pair<const std::string, int>& entry : tag_counts) {
+        entry.second = 0;
+    }
+    if (current_level != nullptr) {
+        for (int i = 0; i < current_level->GetSpriteCount(); i++) {
+            tag_counts[current_level->GetSprite(i)->GetTag()]++;
+        }
+    }
+    sample.tag_counts.clear();
+    for (std::pair<const std::string, int>& entry : tag_counts) {
+        if (entry.second > 0) {
+            sample.tag_counts.push_back(entry);
+        }
+    }
+    next_sample = (next_sample + 1) % samples.size();
+    sample_count++;
+}
+
+// Returns the number of samples kept.
+int Metrics::GetSampleCount() {
+    return sample_count < samples.size() ? (int)sample_count : (int)samples.size();
+}
+
+// Returns a sample, where index 0 is the oldest sample kept.
+const Metrics::Sample& Metrics::GetSample(int index) {
+    int oldest = sample_count < samples.size() ? 0 : next_sample;
+    return samples[(oldest + index) % samples.size()];
+}
+
+// Returns the value of a counter in the last sample.
+long Metrics::GetLast(Counter counter) {
+    if (sample_count == 0) {
+        return 0;
+    }
+    return samples[(next_sample + samples.size() - 1) % samples.size()].values[counter];
+}
+
+// Returns the name of a counter.
+std::string Metrics::GetCounterName(Counter counter) {
+    static const char* names[COUNTER_COUNT] = {"sprites", "draw_calls", "texture_uploads", "image_loads", "text_renders",
+                                               "collision_pairs_tested", "collisions_reported", "events_dispatched",
+                                               "listener_invocations", "allocations", "allocated_bytes"};
+    return names[counter];
+}
+
+// Writes a header row followed by one row for each sample, oldest first.
+void Metrics::ExportCsv(std::ostream& out) {
+    out << "frame";
+    for (int i = 0; i < COUNTER_COUNT; i++) {
+        out << "," << GetCounterName((Counter)i);
+    }
+    out << ",level_sprites,tags" << std::endl;
+    for (int i = 0; i < GetSampleCount(); i++) {
+        const Sample& sample = GetSample(i);
+        out << sample.frame;
+        for (int k = 0; k < COUNTER_COUNT; k++) {
+            out << "," << sample.values[k];
+        }
+        out << ",";
+        for (int k = 0; k < sample.level_sprite_counts.size(); k++) {
+            out << (k > 0 ? ";" : "") << sample.level_sprite_counts[k];
+        }
+        out << ",";
+        for (int k = 0; k < sample.tag_counts.size(); k++) {
+            out << (k > 0 ? ";" : "") << sample.tag_counts[k].first << "=" << sample.tag_counts[k].second;
+        }
+        out << std::endl;
+    }
+}
+
+// Writes one JSON object for each sample, oldest first. Tags are written as they are, so they should not contain quotes.
+void Metrics::ExportJsonLines(std::ostream& out) {
+    for (int i = 0; i < GetSampleCount(); i++) {
+        const Sample& sample = GetSample(i);
+        out << "{\"frame\": " << sample.frame;
+        for (int k = 0; k < COUNTER_COUNT; k++) {
+            out << ", \"" << GetCounterName((Counter)k) << "\": " << sample.values[k];
+        }
+        out << ", \"level_sprites\": [";
+        for (int k = 0; k < sample.level_sprite_counts.size(); k++) {
+            out << (k > 0 ? ", " : "") << sample.level_sprite_counts[k];
+        }
+        out << "], \"tags\": {";
+        for (int k = 0; k < sample.tag_counts.size(); k++) {
+            out << (k > 0 ? ", " : "") << "\"" << sample.tag_counts[k].first << "\": " << sample.tag_counts[k].second;
+        }
+        out << "}}" << std::endl;
+    }
+}
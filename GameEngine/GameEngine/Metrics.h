@@ -0,0 +1,97 @@
+#ifndef __GameEngine__Metrics__
+#define __GameEngine__Metrics__
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+
+class Level; // Forward declaration neeeded to avoid cyclic dependency.
+
+// Counters of the work done by the engine in each frame. The counters are incremented by the engine, the window, the levels
+// and the sprites while a frame is simulated and rendered, and sampled once per frame into a ring buffer together with
+// the number of sprites in each level and the number of sprites with each tag in the current level.
+// The samples can be queried in code or exported as CSV or JSON lines.
+class Metrics {
+
+public:
+    
+    // The counters. All counters except SPRITES and DRAW_CALLS count what has happened since the previous sample.
+    enum Counter {
+        SPRITES,                // The number of sprites in the current level.
+        DRAW_CALLS,             // The number of draw commands produced by the frame.
+        TEXTURE_UPLOADS,        // The number of textures created from surfaces.
+        IMAGE_LOADS,            // The number of calls to IMG_Load.
+        TEXT_RENDERS,           // The number of calls to TTF_RenderText.
+        COLLISION_PAIRS_TESTED, // The number of sprite pairs tested for collision.
+        COLLISIONS_REPORTED,    // The number of collisions reported to the collision listener.
+        EVENTS_DISPATCHED,      // The number of events delegated by the engine.
+        LISTENER_INVOCATIONS,   // The number of event, time and collision listeners called.
+        ALLOCATIONS,            // The number of heap allocations in the whole program, or 0 if they are not counted (see AllocationCounter).
+        ALLOCATED_BYTES,        // The number of bytes allocated in the whole program.
+        COUNTER_COUNT
+    };
+    
+    // The values of the counters in one frame.
+    struct Sample {
+        int frame;
+        long values[COUNTER_COUNT];
+        std::vector<int> level_sprite_counts;
+        std::vector<std::pair<std::string, int>> tag_counts;
+    };
+    
+    // Creates a new metrics object that keeps the samples of the specified number of frames.
+    Metrics(int capacity = 600);
+    
+    // Adds a value to a counter. May be called from any thread.
+    void Add(Counter counter, long value = 1);
+    
+    // Samples the counters for the specified frame and resets them. The sprites are counted in the specified levels.
+    void TakeSample(int frame, const std::vector<Level*>& levels, Level* current_level, int draw_calls);
+    
+    // Returns the number of samples kept, which is at most the capacity.
+    int GetSampleCount();
+    
+    // Returns a sample, where index 0 is the oldest sample kept.
+    const Sample& GetSample(int index);
+    
+    // Returns the value of a counter in the last sample, or 0 if no sample has been taken.
+    long GetLast(Counter counter);
+    
+    // Returns the name of a counter as used in the exported files.
+    static std::string GetCounterName(Counter counter);
+    
+    // Writes the samples as CSV with one row per frame. The tag counts are written as tag=count pairs separated by semicolons.
+    void ExportCsv(std::ostream& out);
+    
+    // Writes the samples as JSON lines with one object per frame.
+    void ExportJsonLines(std::ostream& out);
+
+private:
+    
+    // Private in order to guard against value semantics.
+    Metrics(const Metrics& other_metrics);
+    
+    // Private in order to guard against value semantics.
+    const Metrics& operator=(const Metrics& other_metrics);
+    
+    // The counters since the last sample.
+    std::atomic<long> counters[COUNTER_COUNT];
+    
+    // The ring buffer of samples. The slots are reused, so that sampling does not allocate once the buffer is full.
+    std::vector<Sample> samples;
+    
+    // The index of the slot the next sample is written to and the number of samples taken so far.
+    int next_sample;
+    long sample_count;
+    
+    // The number of allocations and allocated bytes at the last sample.
+    long last_allocation_count;
+    long last_allocated_bytes;
+    
+    // The number of sprites with each tag, reused between samples.
+    std::map<std::string, int> tag_counts;
+};
+
+#endif
@@ -5,17 +5,31 @@
 
 // Factory function to control object creation.
 MovingSprite* MovingSprite::GetInstance(std::string tag, std::string file_name, int x_pos, int y_pos, int width, int height, int dx, int dy) {
-    return new MovingSprite(tag, file_name, x_pos, y_pos, width, height, dx, dy);
+    return new MovingSprite(std::move(tag), std::move(file_name), x_pos, y_pos, width, height, dx, dy);
 }
 
-MovingSprite::MovingSprite(std::string tag, std::string file_name, int x_pos, int y_pos, int width, int height, int dx, int dy):dx(dx), dy(dy), Sprite(tag, x_pos, y_pos, width, height, file_name) {
+MovingSprite::MovingSprite(std::string tag, std::string file_name, int x_pos, int y_pos, int width, int height, int dx, int dy):Sprite(std::move(tag), x_pos, y_pos, width, height, std::move(file_name)) {
+    type = MOVING_SPRITE;
+    state.dx = dx;
+    state.dy = dy;
 }
 
-// Draws the sprite with the specified change in x and y each iteration of the main event loop.
-void MovingSprite::Draw(int time_elapsed) {
-    boundary.x = boundary.x + dx;
-    boundary.y = boundary.y + dy;
-    SDL_RenderCopy(window->GetRenderer(), texture, NULL, &boundary);
+// Moves the sprite with the specified change in x and y each iteration of the main event loop.
+void MovingSprite::Update(int time_elapsed) {
+    state.boundary.x = state.boundary.x + state.dx;
+    state.boundary.y = state.boundary.y + state.dy;
+}
+
+// Returns true if the sprite moves.
+bool MovingSprite::GetIsAnimating() {
+    return state.dx != 0 || state.dy != 0;
+}
+
+// Adds the state of the sprite, including the change in x and y, to the hash.
+void MovingSprite::HashState(StateHash& hash) {
+    Sprite::HashState(hash);
+    hash.Add(state.dx);
+    hash.Add(state.dy);
 }
 
 MovingSprite::~MovingSprite() {
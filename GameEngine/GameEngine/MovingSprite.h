@@ -8,21 +8,26 @@
 
 // Class to represent moving sprites.
 class MovingSprite : public Sprite {
-    
+
 public:
     
     // Factory function to control object creation.
     static MovingSprite* GetInstance(std::string tag, std::string file_name, int x_pos, int y_pos, int width, int height, int dx, int dy);
     
-    // Draws the sprite with the specified change in x and y each iteration of the main event loop.
-    virtual void Draw(int);
+    // Moves the sprite with the specified change in x and y each iteration of the main event loop.
+    virtual void Update(int time_elapsed);
+    
+    // Returns true if the sprite moves, ie. if the change in x or y is not 0.
+    virtual bool GetIsAnimating();
+    
+    // Adds the state of the sprite, including the change in x and y, to the hash.
+    virtual void HashState(StateHash& hash);
     
     virtual ~MovingSprite();
 private:
     MovingSprite(std::string tag, std::string file_name, int x_pos, int y_pos, int width, int height, int dx, int dy); // Guard against value semantic
     MovingSprite(const MovingSprite& other_sprite); // Guard against value semantic
     const MovingSprite& operator=(const MovingSprite& other_sprite); // Guard against value semantic
-    int dx, dy;
 };
 
 #endif
@@ -0,0 +1,169 @@
+#include <cstdio>
+#include <algorithm>
+#include "PerformanceOverlay.h"
+
+// The number of frames in the graph, and the width of the bar of each frame.
+static const int GRAPH_FRAMES = 120;
+static const int GRAPH_BAR_WIDTH = 2;
+
+// The layout of the overlay in pixels: the panel in the upper left corner, the height of a line of text, the height of
+// the phase bar and the height of the graph, which is two frame budgets tall.
+static const int MARGIN = 8;
+static const int PADDING = 6;
+static const int LINE_HEIGHT = 14;
+static const int TEXT_LINES = 4;
+static const int PHASE_BAR_HEIGHT = 8;
+static const int GRAPH_HEIGHT = 48;
+static const int PANEL_WIDTH = GRAPH_FRAMES * GRAPH_BAR_WIDTH + 2 * PADDING;
+static const int PANEL_HEIGHT = TEXT_LINES * LINE_HEIGHT + PHASE_BAR_HEIGHT + GRAPH_HEIGHT + 4 * PADDING;
+
+// The time between two updates of the text and bars.
+static const std::chrono::milliseconds UPDATE_INTERVAL(250);
+
+// The printable characters that get a texture.
+static const char FIRST_GLYPH = ' ';
+static const char LAST_GLYPH = '~';
+
+// The colors of the phases: polling, rendering, waiting for the simulation and the delay.
+static const SDL_Color PHASE_COLORS[4] = {{80, 160, 255, 255}, {90, 220, 90, 255}, {255, 170, 50, 255}, {140, 140, 140, 255}};
+
+PerformanceOverlay::PerformanceOverlay(int fps):frame_budget(1000.0 / fps), frame_history(GRAPH_FRAMES, 0), frame_count(0), sums(), max_frame_time(0), summed_frames(0), last_stats(), last_update(std::chrono::steady_clock::now()), glyph_height(0), graph_bars(GRAPH_FRAMES), phase_bars(), last_render_time(0) {
+    glyphs.reserve(TEXT_LINES * 64);
+}
+
+// Adds the frame to the graph and to the sums of the current update interval.
+void PerformanceOverlay::RecordFrame(const FrameStats& stats) {
+    frame_history[frame_count % GRAPH_FRAMES] = stats.frame_time;
+    frame_count++;
+    sums.frame_time += stats.frame_time;
+    sums.poll_time += stats.poll_time;
+    sums.render_time += stats.render_time;
+    sums.wait_time += stats.wait_time;
+    sums.delay_time += stats.delay_time;
+    max_frame_time = std::max(max_frame_time, stats.frame_time);
+    summed_frames++;
+    last_stats = stats;
+}
+
+// Draws the translucent panel, the graph, the budget line, the phase bars and the text, and measures how long it took.
+void PerformanceOverlay::Render(SDL_Renderer* renderer, TTF_Font* font) {
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    if (glyph_textures.empty()) {
+        SetUpGlyphs(renderer, font);
+    }
+    if (start_time - last_update >= UPDATE_INTERVAL) {
+        last_update = start_time;
+        Update();
+    }
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_Rect panel = {MARGIN, MARGIN, PANEL_WIDTH, PANEL_HEIGHT};
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 160);
+    SDL_RenderFillRect(renderer, &panel);
+    SDL_SetRenderDrawColor(renderer, 90, 220, 90, 255);
+    SDL_RenderFillRects(renderer, graph_bars.data(), (int)graph_bars.size());
+    SDL_Rect budget_line = {MARGIN + PADDING, MARGIN + PANEL_HEIGHT - PADDING - GRAPH_HEIGHT / 2, GRAPH_FRAMES * GRAPH_BAR_WIDTH, 1};
+    SDL_SetRenderDrawColor(renderer, 255, 80, 80, 255);
+    SDL_RenderFillRect(renderer, &budget_line);
+    for (int i = 0; i < 4; i++) {
+        SDL_SetRenderDrawColor(renderer, PHASE_COLORS[i].r, PHASE_COLORS[i].g, PHASE_COLORS[i].b, PHASE_COLORS[i].a);
+        SDL_RenderFillRect(renderer, &phase_bars[i]);
+    }
+    for (int i = 0; i < glyphs.size(); i++) {
+        SDL_RenderCopy(renderer, glyphs[i].texture, NULL, &glyphs[i].destination);
+    }
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    std::chrono::steady_clock::time_point stop_time = std::chrono::steady_clock::now();
+    last_render_time = std::chrono::duration<double, std::milli>(stop_time - start_time).count();
+}
+
+// Returns the time the last call to Render took.
+double PerformanceOverlay::GetLastRenderTime() {
+    return last_render_time;
+}
+
+// Renders each character on its own, so that any text can be drawn by copying the textures of its characters without
+// rendering text while the game runs. Characters that fail to render are drawn as nothing.
+void PerformanceOverlay::SetUpGlyphs(SDL_Renderer* renderer, TTF_Font* font) {
+    SDL_Color white = {255, 255, 255, 255};
+    for (char c = FIRST_GLYPH; c <= LAST_GLYPH; c++) {
+        char text[2] = {c, '\0'};
+        SDL_Surface* surface = TTF_RenderText_Solid(font, text, white);
+        SDL_Texture* texture = nullptr;
+        int width = 0, height = 0;
+        if (surface != nullptr) {
+            texture = SDL_CreateTextureFromSurface(renderer, surface);
+            SDL_FreeSurface(surface);
+        }
+        if (texture != nullptr) {
+            SDL_QueryTexture(texture, NULL, NULL, &width, &height);
+        }
+        glyph_textures.push_back(texture);
+        glyph_widths.push_back(width);
+        glyph_height = std::max(glyph_height, height);
+    }
+}
+
+// Averages the frames recorded since the last update and lays out the text, the graph (oldest frame to the left, clipped
+// at two frame budgets) and the phase bar (stacked from the left, one frame budget wide). The text is formatted into
+// fixed buffers, so updating does not allocate.
+void PerformanceOverlay::Update() {
+    int frames = std::max(summed_frames, 1);
+    double frame_time = sums.frame_time / frames;
+    double phase_times[4] = {sums.poll_time / frames, sums.render_time / frames, sums.wait_time / frames, sums.delay_time / frames};
+    char lines[TEXT_LINES][96];
+    snprintf(lines[0], sizeof(lines[0]), "%.1f fps  %.2f ms  max %.2f ms", frame_time > 0 ? 1000.0 / frame_time : 0.0, frame_time, max_frame_time);
+    snprintf(lines[1], sizeof(lines[1]), "poll %.2f render %.2f wait %.2f delay %.2f", phase_times[0], phase_times[1], phase_times[2], phase_times[3]);
+    snprintf(lines[2], sizeof(lines[2]), "sprites %ld  draw calls %ld", last_stats.sprites, last_stats.draw_calls);
+    snprintf(lines[3], sizeof(lines[3]), "textures %.1f MB  overlay %.2f ms", last_stats.texture_bytes / (1024.0 * 1024.0), last_render_time);
+    glyphs.clear();
+    for (int i = 0; i < TEXT_LINES; i++) {
+        AddText(MARGIN + PADDING, MARGIN + PADDING + i * LINE_HEIGHT, lines[i]);
+    }
+
+    int phase_top = MARGIN + 2 * PADDING + TEXT_LINES * LINE_HEIGHT;
+    int phase_left = MARGIN + PADDING;
+    int phase_width = GRAPH_FRAMES * GRAPH_BAR_WIDTH;
+    for (int i = 0; i < 4; i++) {
+        int width = (int)std::min(phase_times[i] / frame_budget * phase_width, (double)(MARGIN + PADDING + phase_width - phase_left));
+        phase_bars[i] = {phase_left, phase_top, std::max(width, 0), PHASE_BAR_HEIGHT};
+        phase_left += phase_bars[i].w;
+    }
+
+    int graph_bottom = MARGIN + PANEL_HEIGHT - PADDING;
+    for (int i = 0; i < GRAPH_FRAMES; i++) {
+        double time = frame_count >= GRAPH_FRAMES || i >= GRAPH_FRAMES - frame_count ? frame_history[(frame_count + i) % GRAPH_FRAMES] : 0;
+        int height = (int)(std::min(time / (2 * frame_budget), 1.0) * GRAPH_HEIGHT);
+        graph_bars[i] = {MARGIN + PADDING + i * GRAPH_BAR_WIDTH, graph_bottom - height, GRAPH_BAR_WIDTH - 1, height};
+    }
+
+    sums = FrameStats();
+    max_frame_time = 0;
+    summed_frames = 0;
+}
+
+// Lays out the characters of the text, scaling the character textures down to the line height.
+void PerformanceOverlay::AddText(int x, int y, const char* text) {
+    if (glyph_height == 0) {
+        return;
+    }
+    int height = LINE_HEIGHT - 2;
+    for (const char* c = text; *c != '\0'; c++) {
+        if (*c < FIRST_GLYPH || *c > LAST_GLYPH) {
+            continue;
+        }
+        int index = *c - FIRST_GLYPH;
+        int width = glyph_widths[index] * height / glyph_height;
+        if (glyph_textures[index] != nullptr && *c != ' ') {
+            glyphs.push_back({glyph_textures[index], {x, y, width, height}});
+        }
+        x += width;
+    }
+}
+
+PerformanceOverlay::~PerformanceOverlay() {
+    for (int i = 0; i < glyph_textures.size(); i++) {
+        if (glyph_textures[i] != nullptr) {
+            SDL_DestroyTexture(glyph_textures[i]);
+        }
+    }
+}
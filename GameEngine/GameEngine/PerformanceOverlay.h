@@ -0,0 +1,96 @@
+#ifndef __GameEngine__PerformanceOverlay__
+#define __GameEngine__PerformanceOverlay__
+
+#include <vector>
+#include <chrono>
+#include <SDL2/SDL.h>
+#include <SDL2_ttf/SDL_ttf.h>
+
+// A debug display drawn by the window on top of the level. It shows the frame rate and frame time, a graph of the last
+// frame times, a bar with the time of each phase of the main event loop (polling, rendering, waiting for the simulation
+// and the delay), the number of sprites and draw calls and the memory used by the textures of the window.
+// The overlay is meant to be cheap enough to leave on while measuring: each character is rendered to a texture only once,
+// the bars of the graph are drawn with a single call, and the text and bars are only rebuilt a few times per second.
+// The time the overlay takes is shown by the overlay itself and left out of the frame times (see Engine::SetOverlayVisible).
+class PerformanceOverlay {
+
+public:
+    
+    // The numbers of one frame shown by the overlay. Times are in milliseconds.
+    struct FrameStats {
+        double frame_time, poll_time, render_time, wait_time, delay_time;
+        long sprites, draw_calls, texture_bytes;
+    };
+    
+    // Creates a new overlay for an engine running at the specified number of frames per second.
+    PerformanceOverlay(int fps);
+    
+    // Records the numbers of a frame. Called by the engine at the end of each frame.
+    void RecordFrame(const FrameStats& stats);
+    
+    // Draws the overlay with the renderer, rebuilding the text and bars first if it is time to. The characters are rendered
+    // with the font the first time the overlay is drawn. Must be called from the thread that created the window.
+    void Render(SDL_Renderer* renderer, TTF_Font* font);
+    
+    // Returns the time (in milliseconds) the last call to Render took.
+    double GetLastRenderTime();
+    
+    // Destroys the textures of the characters.
+    ~PerformanceOverlay();
+
+private:
+    
+    // A character to draw: the texture it is copied from and where it is copied to.
+    struct Glyph {
+        SDL_Texture* texture;
+        SDL_Rect destination;
+    };
+    
+    // Private in order to guard against value semantics.
+    PerformanceOverlay(const PerformanceOverlay& other_overlay);
+    
+    // Private in order to guard against value semantics.
+    const PerformanceOverlay& operator=(const PerformanceOverlay& other_overlay);
+    
+    // Internal helper function that renders a texture for each printable character.
+    void SetUpGlyphs(SDL_Renderer* renderer, TTF_Font* font);
+    
+    // Internal helper function that rebuilds the text, the graph and the phase bar from the frames recorded since the last update.
+    void Update();
+    
+    // Internal helper function that adds the characters of a line of text at the specified position.
+    void AddText(int x, int y, const char* text);
+    
+    // The frame budget (1000 / fps milliseconds), which the graph and the phase bar are scaled to.
+    double frame_budget;
+    
+    // The frame times of the last frames, used as a ring buffer, and the number of frames recorded so far.
+    std::vector<double> frame_history;
+    long frame_count;
+    
+    // The sums of the times since the last update, the longest frame since the last update and the number of frames summed.
+    FrameStats sums;
+    double max_frame_time;
+    int summed_frames;
+    
+    // The numbers of the last frame.
+    FrameStats last_stats;
+    
+    // The time of the last update.
+    std::chrono::steady_clock::time_point last_update;
+    
+    // The texture of each printable character, and the width of each texture.
+    std::vector<SDL_Texture*> glyph_textures;
+    std::vector<int> glyph_widths;
+    int glyph_height;
+    
+    // What is drawn, rebuilt by Update: the characters of the text, the bars of the graph and the bar of each phase.
+    std::vector<Glyph> glyphs;
+    std::vector<SDL_Rect> graph_bars;
+    SDL_Rect phase_bars[4];
+    
+    // The time the last call to Render took.
+    double last_render_time;
+};
+
+#endif
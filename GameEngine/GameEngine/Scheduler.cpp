@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <map>
+#include <stdexcept>
+#include "Scheduler.h"
+#include "AllocationCounter.h"
+#include "Trace.h"
+
+Scheduler::Scheduler(ThreadPool* thread_pool):thread_pool(thread_pool), is_dirty(true), remaining_systems(0) {
+}
+
+// Adds a system to the scheduler. The system is not added to the dependency graph until the next frame is executed,
+// which means that systems may be added from within other systems or listeners.
+void Scheduler::AddSystem(std::string name, std::function<void(void)> system, std::vector<std::string> reads, std::vector<std::string> writes, std::vector<std::string> dependencies) {
+    System new_system;
+    new_system.name = name;
+    new_system.function = system;
+    new_system.reads = reads;
+    new_system.writes = writes;
+    new_system.dependencies = dependencies;
+    new_system.dependency_count = 0;
+    new_system.stage = 0;
+    new_system.last_time = 0;
+    new_system.total_time = 0;
+    new_system.run_count = 0;
+    new_system.last_allocations = 0;
+    new_system.last_allocated_bytes = 0;
+    new_system.total_allocations = 0;
+    new_system.trace_zone = Trace::RegisterZone(name);
+    std::lock_guard<std::mutex> lock(added_mutex);
+    added_systems.push_back(new_system);
+}
+
+// Executes all systems once. The calling thread dispatches the systems that are ready and executes one of them itself,
+// the rest are handed to the thread pool. This means that a chain of dependent systems runs entirely on the calling
+// thread without any hand-over cost, and that only systems which can actually run in parallel use the worker threads.
+void Scheduler::Run() {
+    AddPendingSystems();
+    if (is_dirty) {
+        Build();
+    }
+    std::unique_lock<std::mutex> lock(run_mutex);
+    pending_dependencies.resize(systems.size());
+    ready_systems.clear();
+    for (int i = 0; i < systems.size(); i++) {
+        pending_dependencies[i] = systems[i].dependency_count;
+        if (pending_dependencies[i] == 0) {
+            ready_systems.push_back(i);
+        }
+    }
+    remaining_systems = (int)systems.size();
+    while (remaining_systems > 0) {
+        if (ready_systems.empty()) {
+            run_condition.wait(lock);
+            continue;
+        }
+        int index = ready_systems.back();
+        ready_systems.pop_back();
+        while (thread_pool != nullptr && !ready_systems.empty()) {
+            int parallel_index = ready_systems.back();
+            ready_systems.pop_back();
+            thread_pool->Submit([this, parallel_index] { Execute(parallel_index); });
+        }
+        lock.unlock();
+        Execute(index);
+        lock.lock();
+    }
+    if (system_error) {
+        std::exception_ptr error = system_error;
+        system_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+// Prints the systems grouped by stage. A system is placed in the stage after the latest stage of its dependencies.
+void Scheduler::PrintSchedule(std::ostream& out) {
+    AddPendingSystems();
+    if (is_dirty) {
+        Build();
+    }
+    int stage_count = 0;
+    for (int i = 0; i < systems.size(); i++) {
+        stage_count = std::max(stage_count, systems[i].stage + 1);
+    }
+    for (int stage = 0; stage < stage_count; stage++) {
+        out << "stage " << stage << ":" << std::endl;
+        for (int i = 0; i < systems.size(); i++) {
+            if (systems[i].stage == stage) {
+                out << "  " << systems[i].name;
+                bool is_first = true;
+                for (int j = 0; j < systems.size(); j++) {
+                    for (int k = 0; k < systems[j].dependents.size(); k++) {
+                        if (systems[j].dependents[k] == i) {
+                            out << (is_first ? " (after " : ", ") << systems[j].name;
+                            is_first = false;
+                        }
+                    }
+                }
+                out << (is_first ? "" : ")") << std::endl;
+            }
+        }
+    }
+}
+
+// Prints the time spent in each system in the last frame and the average over all frames.
+void Scheduler::PrintTimings(std::ostream& out) {
+    out << std::left << std::setw(24) << "system" << std::right << std::setw(12) << "last (ms)" << std::setw(12) << "avg (ms)" << std::setw(10) << "runs"
+        << std::setw(10) << "allocs" << std::endl;
+    for (int i = 0; i < systems.size(); i++) {
+        double average = systems[i].run_count > 0 ? systems[i].total_time / systems[i].run_count : 0;
+        out << std::left << std::setw(24) << systems[i].name << std::right << std::fixed << std::setprecision(3)
+            << std::setw(12) << systems[i].last_time << std::setw(12) << average << std::setw(10) << systems[i].run_count
+            << std::setw(10) << systems[i].last_allocations << std::endl;
+    }
+}
+
+// Returns the time the named system took in the last frame.
+double Scheduler::GetLastTime(std::string name) {
+    for (int i = 0; i < systems.size(); i++) {
+        if (systems[i].name == name) {
+            return systems[i].last_time;
+        }
+    }
+    return -1;
+}
+
+// Returns the total time the named system has taken in all frames.
+double Scheduler::GetTotalTime(std::string name) {
+    for (int i = 0; i < systems.size(); i++) {
+        if (systems[i].name == name) {
+            return systems[i].total_time;
+        }
+    }
+    return -1;
+}
+
+// Returns the number of allocations the named system made in the last frame.
+long Scheduler::GetLastAllocations(std::string name) {
+    for (int i = 0; i < systems.size(); i++) {
+        if (systems[i].name == name) {
+            return systems[i].last_allocations;
+        }
+    }
+    return -1;
+}
+
+// Returns the number of bytes the named system allocated in the last frame.
+long Scheduler::GetLastAllocatedBytes(std::string name) {
+    for (int i = 0; i < systems.size(); i++) {
+        if (systems[i].name == name) {
+            return systems[i].last_allocated_bytes;
+        }
+    }
+    return -1;
+}
+
+// Returns the sum of the allocations of the systems in the last frame.
+long Scheduler::GetLastFrameAllocations() {
+    long allocations = 0;
+    for (int i = 0; i < systems.size(); i++) {
+        allocations += systems[i].last_allocations;
+    }
+    return allocations;
+}
+
+// Returns the total number of allocations the named system has made in all frames.
+long Scheduler::GetTotalAllocations(std::string name) {
+    for (int i = 0; i < systems.size(); i++) {
+        if (systems[i].name == name) {
+            return systems[i].total_allocations;
+        }
+    }
+    return -1;
+}
+
+// Returns the names of the systems in the schedule. Systems added since the last frame are not included until the next frame.
+std::vector<std::string> Scheduler::GetSystemNames() {
+    std::vector<std::string> names;
+    for (int i = 0; i < systems.size(); i++) {
+        names.push_back(systems[i].name);
+    }
+    return names;
+}
+
+// Moves the systems added since the last frame into the schedule.
+void Scheduler::AddPendingSystems() {
+    std::lock_guard<std::mutex> lock(added_mutex);
+    if (!added_systems.empty()) {
+        systems.insert(systems.end(), added_systems.begin(), added_systems.end());
+        added_systems.clear();
+        is_dirty = true;
+    }
+}
+
+// Builds the dependency graph. A system depends on an earlier system if one of them writes a resource that the other one
+// reads or writes, and on every system named in its explicit dependencies. The stage of each system is the length of the
+// longest chain of dependencies leading up to it, which is also used to detect cycles.
+void Scheduler::Build() {
+    std::map<std::string, int> indices;
+    for (int i = 0; i < systems.size(); i++) {
+        systems[i].dependents.clear();
+        systems[i].dependency_count = 0;
+        systems[i].stage = -1;
+        indices[systems[i].name] = i;
+    }
+    for (int i = 0; i < systems.size(); i++) {
+        std::vector<bool> has_edge(systems.size(), false);
+        for (int j = 0; j < i; j++) {
+            if (Intersects(systems[i].writes, systems[j].writes) || Intersects(systems[i].reads, systems[j].writes) || Intersects(systems[i].writes, systems[j].reads)) {
+                has_edge[j] = true;
+            }
+        }
+        for (int k = 0; k < systems[i].dependencies.size(); k++) {
+            std::map<std::string, int>::iterator entry = indices.find(systems[i].dependencies[k]);
+            if (entry == indices.end()) {
+                throw std::runtime_error("Unknown system dependency: " + systems[i].dependencies[k]);
+            }
+            if (entry->second != i) {
+                has_edge[entry->second] = true;
+            }
+        }
+        for (int j = 0; j < systems.size(); j++) {
+            if (has_edge[j]) {
+                systems[j].dependents.push_back(i);
+                systems[i].dependency_count++;
+            }
+        }
+    }
+    std::vector<int> pending(systems.size());
+    std::vector<int> ready;
+    for (int i = 0; i < systems.size(); i++) {
+        pending[i] = systems[i].dependency_count;
+        if (pending[i] == 0) {
+            systems[i].stage = 0;
+            ready.push_back(i);
+        }
+    }
+    int visited = 0;
+    while (!ready.empty()) {
+        int index = ready.back();
+        ready.pop_back();
+        visited++;
+        for (int k = 0; k < systems[index].dependents.size(); k++) {
+            System& dependent = systems[systems[index].dependents[k]];
+            dependent.stage = std::max(dependent.stage, systems[index].stage + 1);
+            if (--pending[systems[index].dependents[k]] == 0) {
+                ready.push_back(systems[index].dependents[k]);
+            }
+        }
+    }
+    if (visited != systems.size()) {
+        throw std::runtime_error("The system dependencies contain a cycle!");
+    }
+    is_dirty = false;
+}
+
+// Executes a system and records the time it took. When done, every dependent system whose dependencies are now all done
+// is made ready and the dispatching thread is woken up.
+void Scheduler::Execute(int index) {
+    System& system = systems[index];
+    TRACE_ZONE_ID(system.trace_zone);
+    long start_allocations = AllocationCounter::GetThreadAllocationCount();
+    long start_bytes = AllocationCounter::GetThreadAllocatedBytes();
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    std::exception_ptr error;
+    try {
+        system.function();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    std::chrono::steady_clock::time_point stop_time = std::chrono::steady_clock::now();
+    system.last_time = std::chrono::duration<double, std::milli>(stop_time - start_time).count();
+    system.total_time += system.last_time;
+    system.run_count++;
+    system.last_allocations = AllocationCounter::GetThreadAllocationCount() - start_allocations;
+    system.last_allocated_bytes = AllocationCounter::GetThreadAllocatedBytes() - start_bytes;
+    system.total_allocations += system.last_allocations;
+    std::lock_guard<std::mutex> lock(run_mutex);
+    if (error && !system_error) {
+        system_error = error;
+    }
+    for (int k = 0; k < system.dependents.size(); k++) {
+        if (--pending_dependencies[system.dependents[k]] == 0) {
+            ready_systems.push_back(system.dependents[k]);
+        }
+    }
+    remaining_systems--;
+    run_condition.notify_all();
+}
+
+// Checks if two lists of resources have any resource in common.
+bool Scheduler::Intersects(const std::vector<std::string>& lhs, const std::vector<std::string>& rhs) {
+    for (int i = 0; i < lhs.size(); i++) {
+        for (int j = 0; j < rhs.size(); j++) {
+            if (lhs[i] == rhs[j]) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
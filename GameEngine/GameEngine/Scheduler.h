@@ -0,0 +1,131 @@
+#ifndef __GameEngine__Scheduler__
+#define __GameEngine__Scheduler__
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include "ThreadPool.h"
+
+// Runs the systems that make up one frame of the simulation.
+// Each system declares the resources it reads and writes (any names, such as "sprites" or "score") and optionally the
+// names of systems it depends on. Two systems that access the same resource where at least one of them writes it are
+// ordered by the order they were added in. The resulting dependency graph is executed each frame, and systems that do
+// not depend on each other are executed in parallel on the worker threads of a thread pool.
+class Scheduler {
+
+public:
+    
+    // Creates a new scheduler that executes independent systems on the specified thread pool.
+    // If the thread pool is a null pointer, all systems are executed one at a time on the thread calling Run.
+    Scheduler(ThreadPool* thread_pool);
+    
+    // Adds a system to the scheduler together with the resources it reads and writes and the names of the systems that
+    // must be executed before it.
+    void AddSystem(std::string name, std::function<void(void)> system, std::vector<std::string> reads, std::vector<std::string> writes, std::vector<std::string> dependencies);
+    
+    // Executes all systems once, respecting the dependencies between them. Returns when all systems are done.
+    // If a system throws an exception, the remaining systems are still executed and the first exception is rethrown.
+    void Run();
+    
+    // Prints the schedule, ie. the stages that the systems are grouped in and the dependencies of each system.
+    // All systems within a stage may run in parallel.
+    void PrintSchedule(std::ostream& out);
+    
+    // Prints the time spent in each system in the last frame and on average, and the number of allocations of each system in the last frame.
+    void PrintTimings(std::ostream& out);
+    
+    // Returns the time (in milliseconds) the named system took in the last frame, or -1 if there is no such system.
+    double GetLastTime(std::string name);
+    
+    // Returns the total time (in milliseconds) the named system has taken in all frames, or -1 if there is no such system.
+    double GetTotalTime(std::string name);
+    
+    // Returns the number of allocations the named system made in the last frame, or -1 if there is no such system.
+    // The allocations are counted on the thread executing the system (see AllocationCounter), which means that allocations
+    // made by other threads at the same time are not included.
+    long GetLastAllocations(std::string name);
+    
+    // Returns the number of bytes the named system allocated in the last frame, or -1 if there is no such system.
+    long GetLastAllocatedBytes(std::string name);
+    
+    // Returns the number of allocations all systems made in the last frame.
+    long GetLastFrameAllocations();
+    
+    // Returns the total number of allocations the named system has made in all frames, or -1 if there is no such system.
+    long GetTotalAllocations(std::string name);
+    
+    // Returns the names of the systems in the schedule, in the order they were added.
+    std::vector<std::string> GetSystemNames();
+
+private:
+    
+    // A system together with its dependencies, timings and the id of its trace zone (see Trace).
+    struct System {
+        std::string name;
+        std::function<void(void)> function;
+        std::vector<std::string> reads, writes, dependencies;
+        std::vector<int> dependents;
+        int dependency_count, stage;
+        double last_time, total_time;
+        long run_count;
+        long last_allocations, last_allocated_bytes, total_allocations;
+        int trace_zone;
+    };
+    
+    // Private in order to guard against value semantics.
+    Scheduler(const Scheduler& other_scheduler);
+    
+    // Private in order to guard against value semantics.
+    const Scheduler& operator=(const Scheduler& other_scheduler);
+    
+    // Moves the systems added since the last frame into the schedule.
+    void AddPendingSystems();
+    
+    // Builds the dependency graph from the declared resources and dependencies. Throws if the graph contains a cycle.
+    void Build();
+    
+    // Executes a system, records its time and makes the systems depending on it ready when their dependencies are done.
+    void Execute(int index);
+    
+    // Internal helper function to check if two lists of resources have any resource in common.
+    static bool Intersects(const std::vector<std::string>& lhs, const std::vector<std::string>& rhs);
+    
+    // The thread pool used to execute systems in parallel.
+    ThreadPool* thread_pool;
+    
+    // The systems added to the scheduler, in the order they were added.
+    std::vector<System> systems;
+    
+    // The systems added since the last frame.
+    std::vector<System> added_systems;
+    
+    // Guards the systems added since the last frame.
+    std::mutex added_mutex;
+    
+    // A flag to indicate that systems have been added since the dependency graph was built.
+    bool is_dirty;
+    
+    // Guards the state of the frame being executed.
+    std::mutex run_mutex;
+    
+    // Signals that a system is done.
+    std::condition_variable run_condition;
+    
+    // The number of dependencies left for each system in the frame being executed.
+    std::vector<int> pending_dependencies;
+    
+    // The systems ready to be executed in the frame being executed.
+    std::vector<int> ready_systems;
+    
+    // The number of systems not yet done in the frame being executed.
+    int remaining_systems;
+    
+    // The first exception thrown by a system in the frame being executed.
+    std::exception_ptr system_error;
+};
+
+#endif
@@ -0,0 +1,46 @@
+#include "Script.h"
+
+// Creates the script object returned to the caller of the coroutine.
+Script Script::promise_type::get_return_object() {
+    return Script(std::coroutine_handle<promise_type>::from_promise(*this));
+}
+
+// Suspends the script when created.
+std::suspend_always Script::promise_type::initial_suspend() noexcept {
+    return std::suspend_always();
+}
+
+// Suspends the script when it finishes.
+std::suspend_always Script::promise_type::final_suspend() noexcept {
+    return std::suspend_always();
+}
+
+// Called when the script finishes.
+void Script::promise_type::return_void() {
+}
+
+// Stores an exception thrown by the script.
+void Script::promise_type::unhandled_exception() {
+    error = std::current_exception();
+}
+
+Script::Script(std::coroutine_handle<promise_type> handle):handle(handle) {
+}
+
+Script::Script(Script&& other_script):handle(other_script.handle) {
+    other_script.handle = nullptr;
+}
+
+// Hands over the ownership of the coroutine to the caller.
+std::coroutine_handle<Script::promise_type> Script::Release() {
+    std::coroutine_handle<promise_type> released_handle = handle;
+    handle = nullptr;
+    return released_handle;
+}
+
+// Destroys the coroutine if it has not been handed over to the engine.
+Script::~Script() {
+    if (handle) {
+        handle.destroy();
+    }
+}
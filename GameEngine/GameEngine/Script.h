@@ -0,0 +1,68 @@
+#ifndef __GameEngine__Script__
+#define __GameEngine__Script__
+
+#include <coroutine>
+#include <exception>
+
+// The return type of gameplay scripts written as C++20 coroutines.
+// A script is a function returning Script that uses co_await on the awaitables returned by Engine::Delay,
+// Engine::NextFrame, Engine::WaitForKey and Engine::WaitForCollision. The script does not start running until it is
+// passed to Engine::StartScript, after which it is resumed by the engine each time the condition it awaits is fulfilled.
+// Example:
+// Script SpawnWave(Engine* engine) {
+//     for (int i = 0; i < 10; i++) {
+//         engine->GetCurrentLevel()->AddSprite(...);
+//         co_await engine->Delay(500);
+//     }
+// }
+class Script {
+
+public:
+    
+    // The coroutine promise used by the compiler, not used directly.
+    struct promise_type {
+    
+        // Creates the script object returned to the caller of the coroutine.
+        Script get_return_object();
+    
+        // Suspends the script when created, the engine starts it when Engine::StartScript is called.
+        std::suspend_always initial_suspend() noexcept;
+    
+        // Suspends the script when it finishes so that the engine can destroy it.
+        std::suspend_always final_suspend() noexcept;
+    
+        // Called when the script finishes.
+        void return_void();
+    
+        // Stores an exception thrown by the script so that it can be rethrown by the engine.
+        void unhandled_exception();
+    
+        // The exception thrown by the script (if any).
+        std::exception_ptr error;
+    };
+    
+    // Moves the coroutine from another script object.
+    Script(Script&& other_script);
+    
+    // Destroys the coroutine if it has not been handed over to the engine.
+    ~Script();
+    
+    // Hands over the ownership of the coroutine to the caller.
+    std::coroutine_handle<promise_type> Release();
+
+private:
+    
+    // Private in order to guard against value semantics.
+    Script(const Script& other_script);
+    
+    // Private in order to guard against value semantics.
+    const Script& operator=(const Script& other_script);
+    
+    // Creates a script object owning the specified coroutine.
+    Script(std::coroutine_handle<promise_type> handle);
+    
+    // The coroutine owned by this script object.
+    std::coroutine_handle<promise_type> handle;
+};
+
+#endif
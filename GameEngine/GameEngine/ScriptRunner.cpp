@@ -0,0 +1,178 @@
+#include "ScriptRunner.h"
+
+ScriptRunner::ScriptRunner():frame(0), timer_sequence(0) {
+}
+
+// Delays are always suspended, even a delay of zero frames resumes the script in the next frame.
+bool ScriptRunner::DelayAwaiter::await_ready() {
+    return false;
+}
+
+// Adds the script to the timer queue.
+void ScriptRunner::DelayAwaiter::await_suspend(Handle handle) {
+    Timer timer;
+    timer.frame = runner->frame + (frames > 0 ? frames : 1);
+    timer.sequence = runner->timer_sequence++;
+    timer.handle = handle;
+    runner->timers.push(timer);
+}
+
+void ScriptRunner::DelayAwaiter::await_resume() {
+}
+
+bool ScriptRunner::KeyAwaiter::await_ready() {
+    return false;
+}
+
+// Adds the script to the waiters for the key.
+void ScriptRunner::KeyAwaiter::await_suspend(Handle handle) {
+    this->handle = handle;
+    runner->key_waiters[key_code].push_back(this);
+}
+
+// Returns the key event that woke up the script.
+SDL_Event ScriptRunner::KeyAwaiter::await_resume() {
+    return event;
+}
+
+bool ScriptRunner::CollisionAwaiter::await_ready() {
+    return false;
+}
+
+// Adds the script to the waiters for the tag pair.
+void ScriptRunner::CollisionAwaiter::await_suspend(Handle handle) {
+    this->handle = handle;
+    runner->collision_waiters[tags].push_back(this);
+}
+
+// Returns the colliding sprites that woke up the script.
+std::pair<Sprite*, Sprite*> ScriptRunner::CollisionAwaiter::await_resume() {
+    return sprites;
+}
+
+// Takes over the ownership of a script and queues it to be started in the next call to Update.
+void ScriptRunner::Start(Script script) {
+    Handle handle = script.Release();
+    if (handle) {
+        scripts.insert(handle.address());
+        ready_scripts.push_back(handle);
+    }
+}
+
+// Returns an awaitable that resumes the awaiting script after the specified number of frames.
+ScriptRunner::DelayAwaiter ScriptRunner::Delay(long frames) {
+    DelayAwaiter awaiter;
+    awaiter.runner = this;
+    awaiter.frames = frames;
+    return awaiter;
+}
+
+// Returns an awaitable that resumes the awaiting script when the specified key is pressed.
+ScriptRunner::KeyAwaiter ScriptRunner::WaitForKey(int key_code) {
+    KeyAwaiter awaiter;
+    awaiter.runner = this;
+    awaiter.key_code = key_code;
+    SDL_zero(awaiter.event);
+    return awaiter;
+}
+
+// Returns an awaitable that resumes the awaiting script when two sprites with the specified tags collide.
+ScriptRunner::CollisionAwaiter ScriptRunner::WaitForCollision(std::string tag1, std::string tag2) {
+    CollisionAwaiter awaiter;
+    awaiter.runner = this;
+    awaiter.tags = std::make_pair(tag1, tag2);
+    awaiter.sprites = std::make_pair((Sprite*)nullptr, (Sprite*)nullptr);
+    return awaiter;
+}
+
+// Moves all scripts waiting for the pressed key to the scripts to resume in the next call to Update.
+void ScriptRunner::NotifyKey(SDL_Event& event) {
+    std::map<int, std::vector<KeyAwaiter*>>::iterator entry = key_waiters.find(event.key.keysym.sym);
+    if (entry != key_waiters.end()) {
+        for (int i = 0; i < entry->second.size(); i++) {
+            entry->second[i]->event = event;
+            ready_scripts.push_back(entry->second[i]->handle);
+        }
+        key_waiters.erase(entry);
+    }
+}
+
+// Returns true if any script is waiting for a collision.
+bool ScriptRunner::HasCollisionWaiters() {
+    return !collision_waiters.empty();
+}
+
+// Moves all scripts waiting for a collision between the tags of the sprites to the scripts to resume in the next call to Update.
+// The engine reports each collision in both orders, which means that only the exact order of the tags needs to be looked up.
+void ScriptRunner::NotifyCollision(Sprite* sprite1, Sprite* sprite2) {
+    std::map<std::pair<std::string, std::string>, std::vector<CollisionAwaiter*>>::iterator entry = collision_waiters.find(std::make_pair(sprite1->GetTag(), sprite2->GetTag()));
+    if (entry != collision_waiters.end()) {
+        for (int i = 0; i < entry->second.size(); i++) {
+            entry->second[i]->sprites = std::make_pair(sprite1, sprite2);
+            ready_scripts.push_back(entry->second[i]->handle);
+        }
+        collision_waiters.erase(entry);
+    }
+}
+
+// Resumes all scripts that are due in the specified frame followed by the scripts that have been woken up since the last call.
+// Scripts that are woken up while the scripts are resumed (eg. started by another script) are resumed in the next call.
+// The scripts have already been taken off the timers and the ready scripts, so a script that throws must not keep the scripts
+// after it from being resumed: the first exception is kept and rethrown after the loop.
+void ScriptRunner::Update(long frame) {
+    this->frame = frame;
+    resuming_scripts.clear();
+    while (!timers.empty() && timers.top().frame <= frame) {
+        resuming_scripts.push_back(timers.top().handle);
+        timers.pop();
+    }
+    resuming_scripts.insert(resuming_scripts.end(), ready_scripts.begin(), ready_scripts.end());
+    ready_scripts.clear();
+    std::exception_ptr first_error;
+    for (int i = 0; i < resuming_scripts.size(); i++) {
+        std::exception_ptr error = Resume(resuming_scripts[i]);
+        if (error && !first_error) {
+            first_error = error;
+        }
+    }
+    if (first_error) {
+        std::rethrow_exception(first_error);
+    }
+}
+
+// Returns the number of scripts that have not finished yet.
+int ScriptRunner::GetScriptCount() {
+    return (int)scripts.size();
+}
+
+// Woken up scripts are resumed in the next call to Update, so they are due before any timer.
+long ScriptRunner::GetNextFrame() {
+    if (!ready_scripts.empty()) {
+        return frame;
+    }
+    return timers.empty() ? -1 : timers.top().frame;
+}
+
+// Resumes a script. If the script has finished, it is destroyed and any exception thrown by the script is returned.
+std::exception_ptr ScriptRunner::Resume(Handle handle) {
+    handle.resume();
+    if (!handle.done()) {
+        return nullptr;
+    }
+    std::exception_ptr error = handle.promise().error;
+    scripts.erase(handle.address());
+    handle.destroy();
+    return error;
+}
+
+// Orders timers by frame and then by the order they were added.
+bool ScriptRunner::Timer::operator>(const Timer& other_timer) const {
+    return frame > other_timer.frame || (frame == other_timer.frame && sequence > other_timer.sequence);
+}
+
+// Destroys all scripts that have not finished yet.
+ScriptRunner::~ScriptRunner() {
+    for (std::set<void*>::iterator script = scripts.begin(); script != scripts.end(); script++) {
+        Handle::from_address(*script).destroy();
+    }
+}
@@ -0,0 +1,140 @@
+#ifndef __GameEngine__ScriptRunner__
+#define __GameEngine__ScriptRunner__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <queue>
+#include <utility>
+#include <coroutine>
+#include <exception>
+#include <SDL2/SDL.h>
+#include "Script.h"
+#include "Sprite.h"
+
+// Keeps track of all running scripts (see Script) and resumes each of them when the condition it awaits is fulfilled.
+// A suspended script is only stored in the data structure for the condition it awaits: scripts waiting for a delay are kept
+// in a priority queue ordered by the frame they are due, and scripts waiting for a key or a collision are kept in maps that are
+// only looked up when such an event occurs. This means that waiting scripts cost nothing in frames where they are not resumed.
+class ScriptRunner {
+
+public:
+    
+    // The coroutine handle of a script.
+    typedef std::coroutine_handle<Script::promise_type> Handle;
+    
+    // Awaitable that resumes the script after a number of frames.
+    struct DelayAwaiter {
+        ScriptRunner* runner;
+        long frames;
+        bool await_ready();
+        void await_suspend(Handle handle);
+        void await_resume();
+    };
+    
+    // Awaitable that resumes the script when the specified key is pressed. Returns the key event.
+    struct KeyAwaiter {
+        ScriptRunner* runner;
+        int key_code;
+        Handle handle;
+        SDL_Event event;
+        bool await_ready();
+        void await_suspend(Handle handle);
+        SDL_Event await_resume();
+    };
+    
+    // Awaitable that resumes the script when a sprite with the first tag collides with a sprite with the second tag.
+    // Returns the colliding sprites in the same order as the tags.
+    struct CollisionAwaiter {
+        ScriptRunner* runner;
+        std::pair<std::string, std::string> tags;
+        Handle handle;
+        std::pair<Sprite*, Sprite*> sprites;
+        bool await_ready();
+        void await_suspend(Handle handle);
+        std::pair<Sprite*, Sprite*> await_resume();
+    };
+    
+    ScriptRunner();
+    
+    // Takes over the ownership of a script and starts it the next time Update is called.
+    void Start(Script script);
+    
+    // Returns an awaitable that resumes the awaiting script after the specified number of frames (at least one).
+    DelayAwaiter Delay(long frames);
+    
+    // Returns an awaitable that resumes the awaiting script when the specified key is pressed.
+    KeyAwaiter WaitForKey(int key_code);
+    
+    // Returns an awaitable that resumes the awaiting script when two sprites with the specified tags collide.
+    CollisionAwaiter WaitForCollision(std::string tag1, std::string tag2);
+    
+    // Wakes up the scripts waiting for the key in the specified key event.
+    void NotifyKey(SDL_Event& event);
+    
+    // Returns true if any script is waiting for a collision.
+    bool HasCollisionWaiters();
+    
+    // Wakes up the scripts waiting for a collision between sprites with the tags of the specified sprites.
+    void NotifyCollision(Sprite* sprite1, Sprite* sprite2);
+    
+    // Resumes all scripts that are due in the specified frame or have been woken up since the last call.
+    // If a script throws an exception, the script is destroyed and the exception is rethrown once all the other scripts have
+    // been resumed. If several scripts throw, the first exception is rethrown.
+    void Update(long frame);
+    
+    // Returns the number of scripts that have not finished yet.
+    int GetScriptCount();
+    
+    // Returns the first frame in which Update resumes a script: the frame of the earliest delay, or the frame of the last
+    // call to Update if a script has been woken up since then. Returns -1 if all scripts wait for keys or collisions.
+    long GetNextFrame();
+    
+    // Destroys all scripts that have not finished yet.
+    ~ScriptRunner();
+
+private:
+    
+    // A script waiting for the frame it is due. The sequence number keeps scripts due in the same frame in the order they started waiting.
+    struct Timer {
+        long frame, sequence;
+        Handle handle;
+        bool operator>(const Timer& other_timer) const;
+    };
+    
+    // Private in order to guard against value semantics.
+    ScriptRunner(const ScriptRunner& other_runner);
+    
+    // Private in order to guard against value semantics.
+    const ScriptRunner& operator=(const ScriptRunner& other_runner);
+    
+    // Resumes a script and destroys it if it has finished. Returns the exception the script ended with, if any.
+    std::exception_ptr Resume(Handle handle);
+    
+    // The scripts waiting for a delay, ordered by the frame they are due.
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    
+    // The scripts to resume in the next call to Update.
+    std::vector<Handle> ready_scripts;
+    
+    // The scripts being resumed in the current call to Update.
+    std::vector<Handle> resuming_scripts;
+    
+    // The scripts waiting for a key, by key code.
+    std::map<int, std::vector<KeyAwaiter*>> key_waiters;
+    
+    // The scripts waiting for a collision, by tag pair.
+    std::map<std::pair<std::string, std::string>, std::vector<CollisionAwaiter*>> collision_waiters;
+    
+    // The addresses of all scripts that have not finished yet.
+    std::set<void*> scripts;
+    
+    // The current frame.
+    long frame;
+    
+    // The sequence number given to the next timer.
+    long timer_sequence;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "SimulationBatch.h"
+
+SimulationBatch::SimulationBatch(int engine_count, int fps, int window_width, int window_height, std::function<void(Engine*, int)> set_up):thread_count(0), step_count(0), run_time(0) {
+    for (int i = 0; i < engine_count; i++) {
+        Engine* engine = new Engine("SimulationBatch", fps, window_width, window_height, true);
+        engines.push_back(engine);
+        set_up(engine, i);
+    }
+}
+
+// Simulates the frames on the specified number of threads. The engines are handed out one at a time through an atomic counter,
+// which balances the load between the threads even if some games are more expensive than others.
+void SimulationBatch::Run(int frames, int thread_count) {
+    if (thread_count <= 0) {
+        thread_count = (int)std::thread::hardware_concurrency();
+    }
+    if (thread_count <= 0) {
+        thread_count = 1;
+    }
+    this->thread_count = thread_count;
+    std::atomic<int> next_engine(0);
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_count; i++) {
+        threads.push_back(std::thread([this, frames, &next_engine] {
+            for (int index = next_engine++; index < engines.size(); index = next_engine++) {
+                for (int frame = 0; frame < frames; frame++) {
+                    engines[index]->Step();
+                }
+            }
+        }));
+    }
+    for (int i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    std::chrono::steady_clock::time_point stop_time = std::chrono::steady_clock::now();
+    run_time = std::chrono::duration<double>(stop_time - start_time).count();
+    step_count = (long)frames * engines.size();
+}
+
+// Returns the engine with the specified index.
+Engine* SimulationBatch::GetEngine(int index) {
+    return engines[index];
+}
+
+// Returns the number of engines in the batch.
+int SimulationBatch::GetEngineCount() {
+    return (int)engines.size();
+}
+
+// Returns the total number of frames simulated in the last call to Run.
+long SimulationBatch::GetStepCount() {
+    return step_count;
+}
+
+// Returns the aggregate number of frames simulated per second in the last call to Run.
+double SimulationBatch::GetStepsPerSecond() {
+    return run_time > 0 ? step_count / run_time : 0;
+}
+
+// Prints a summary of the last call to Run.
+void SimulationBatch::PrintReport(std::ostream& out) {
+    out << engines.size() << " engines, " << thread_count << " threads, " << step_count << " steps in " << run_time << " s ("
+        << GetStepsPerSecond() << " steps/s, " << GetStepsPerSecond() / thread_count << " steps/s per thread)" << std::endl;
+}
+
+// Deletes all engines.
+SimulationBatch::~SimulationBatch() {
+    for (int i = 0; i < engines.size(); i++) {
+        delete engines[i];
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef __GameEngine__SimulationBatch__
+#define __GameEngine__SimulationBatch__
+
+#include <iostream>
+#include <vector>
+#include <functional>
+#include "Engine.h"
+
+// Runs many independent headless engines in parallel, for example to play thousands of games at once for AI training or balancing.
+// Each engine has its own levels, sprites, random generator and clock, and the engines are spread over all cores.
+// Batches should be built without GAMEENGINE_ALLOCATION_COUNTING (see AllocationCounter), since the counting adds two atomic
+// increments shared by all threads to every allocation, which keeps the throughput from scaling with the number of threads.
+class SimulationBatch {
+
+public:
+    
+    // Creates the specified number of headless engines with the specified fps and window size.
+    // The set up function is called for each engine together with its index, and is expected to add the levels of the game.
+    SimulationBatch(int engine_count, int fps, int window_width, int window_height, std::function<void(Engine*, int)> set_up);
+    
+    // Simulates the specified number of frames in every engine, using the specified number of threads (all cores by default).
+    // Each thread takes one engine at a time and simulates all its frames before taking the next one, so the threads never wait for each other.
+    void Run(int frames, int thread_count = 0);
+    
+    // Returns the engine with the specified index.
+    Engine* GetEngine(int index);
+    
+    // Returns the number of engines in the batch.
+    int GetEngineCount();
+    
+    // Returns the total number of frames simulated in the last call to Run, summed over all engines.
+    long GetStepCount();
+    
+    // Returns the aggregate number of frames simulated per second in the last call to Run.
+    double GetStepsPerSecond();
+    
+    // Prints the number of engines, threads, frames and the aggregate steps per second of the last call to Run.
+    void PrintReport(std::ostream& out = std::cout);
+    
+    // Deletes all engines.
+    ~SimulationBatch();
+
+private:
+    
+    // Private in order to guard against value semantics.
+    SimulationBatch(const SimulationBatch& other_batch);
+    
+    // Private in order to guard against value semantics.
+    const SimulationBatch& operator=(const SimulationBatch& other_batch);
+    
+    // The engines in the batch.
+    std::vector<Engine*> engines;
+    
+    // The number of threads used in the last call to Run.
+    int thread_count;
+    
+    // The total number of frames simulated in the last call to Run.
+    long step_count;
+    
+    // The wall clock time (in seconds) of the last call to Run.
+    double run_time;
+};
+
+#endif
@@ -0,0 +1,437 @@
+#include <stdexcept>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include "SnapshotClient.h"
+#include "StaticSprite.h"
+#include "AnimatedSprite.h"
+#include "LabelSprite.h"
+#include "Trace.h"
+
+// The magic of the packets of a snapshot, of a hello and of an acknowledgement.
+static const char SNAPSHOT_MAGIC[4] = {'G', 'E', 'S', 'N'};
+static const char HELLO_MAGIC[4] = {'G', 'E', 'H', 'I'};
+static const char ACKNOWLEDGEMENT_MAGIC[4] = {'G', 'E', 'A', 'K'};
+
+// The number of updates without a snapshot after which the hello is sent again, in case it or the server was lost.
+static const int HELLO_INTERVAL = 60;
+
+// The size of the receive buffer asked for, which should hold a whole snapshot of a large level.
+static const int RECEIVE_BUFFER_SIZE = 4 * 1024 * 1024;
+
+// The largest packet received.
+static const int MAX_PACKET_SIZE = 65536;
+
+// The tag of all replicas. Tags are not sent by the server.
+static const char* REPLICA_TAG = "replica";
+
+// Maps a number written by ZigZag (see SnapshotServer.cpp) back to the difference.
+static int UnZigZag(Uint32 number) {
+    return (int)(number >> 1) ^ -(int)(number & 1);
+}
+
+// Reads a string written as its length followed by its characters. Returns false if it does not fit in the packet.
+static bool ReadString(const std::vector<Uint8>& packet, size_t& position, std::string& text) {
+    Uint32 length;
+    if (!SnapshotServer::ReadNumber(packet, position, length) || length > packet.size() - position) {
+        return false;
+    }
+    text.assign((const char*)packet.data() + position, length);
+    position += length;
+    return true;
+}
+
+// Connects a socket to the port on the loopback interface, so that only packets from the server are received.
+SnapshotClient::SnapshotClient(int port, double tick_time):tick_time(tick_time), time_since_snapshot(0), collected_tick(0), collected_count(0), newest_snapshot(-1), packet(MAX_PACKET_SIZE), updates_without_snapshot(0), snapshot_count(0), bytes_received(0) {
+    client_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (client_socket < 0) {
+        throw std::runtime_error("Failed to create the snapshot socket!");
+    }
+    int buffer_size = RECEIVE_BUFFER_SIZE;
+    setsockopt(client_socket, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (connect(client_socket, (sockaddr*)&address, sizeof(address)) < 0 || fcntl(client_socket, F_SETFL, O_NONBLOCK) < 0) {
+        close(client_socket);
+        throw std::runtime_error("Failed to connect to snapshot port " + std::to_string(port) + "!");
+    }
+    for (int i = 0; i < SnapshotServer::SNAPSHOT_HISTORY; i++) {
+        snapshots[i].tick = 0;
+    }
+    SendMessage(HELLO_MAGIC, 0);
+}
+
+// Only the newest complete snapshot is applied, since the replicas are moved towards the newest positions anyway.
+// Each complete snapshot is acknowledged, so that the server sends the next delta against the newest one the client has.
+void SnapshotClient::Update(Level* level, double time_elapsed) {
+    TRACE_ZONE("SnapshotClient::Update");
+    Snapshot* newest = nullptr;
+    ssize_t size;
+    while ((size = recv(client_socket, packet.data(), packet.size(), 0)) >= 0) {
+        bytes_received += (long)size;
+        if (CollectPacket(size)) {
+            Snapshot* snapshot = DecodeSnapshot();
+            if (snapshot != nullptr) {
+                newest = snapshot;
+                SendMessage(ACKNOWLEDGEMENT_MAGIC, snapshot->tick);
+            }
+        }
+    }
+    if (newest != nullptr && level != nullptr) {
+        ApplySnapshot(level, *newest);
+        snapshot_count++;
+        updates_without_snapshot = 0;
+    } else if (++updates_without_snapshot % HELLO_INTERVAL == 0) {
+        SendMessage(HELLO_MAGIC, 0);
+    }
+    time_since_snapshot += time_elapsed;
+    if (level != nullptr) {
+        Interpolate(level);
+    }
+}
+
+// Returns the tick of the newest snapshot decoded, which is the one applied last.
+int SnapshotClient::GetTick() {
+    return newest_snapshot >= 0 ? snapshots[newest_snapshot].tick : 0;
+}
+
+// Returns the number of snapshots applied so far.
+long SnapshotClient::GetSnapshotCount() {
+    return snapshot_count;
+}
+
+// Returns the number of bytes received so far.
+long SnapshotClient::GetBytesReceived() {
+    return bytes_received;
+}
+
+// Finds the replica with a binary search, since the replicas are ordered by identifier.
+Sprite* SnapshotClient::GetReplica(Level* level, Uint32 id) {
+    std::vector<Replica>::iterator it = std::lower_bound(replicas.begin(), replicas.end(), id, [](const Replica& lhs, Uint32 id) {
+        return lhs.id < id;
+    });
+    return it != replicas.end() && it->id == id && it->sprite_id != 0 ? level->FindSprite(it->sprite_id) : nullptr;
+}
+
+SnapshotClient::~SnapshotClient() {
+    close(client_socket);
+}
+
+// Sends the magic, followed by the tick if it is not 0.
+void SnapshotClient::SendMessage(const char* magic, int tick) {
+    Uint8 message[8];
+    memcpy(message, magic, 4);
+    Uint32 message_tick = (Uint32)tick;
+    memcpy(message + 4, &message_tick, sizeof(message_tick));
+    send(client_socket, message, tick != 0 ? 8 : 4, 0);
+}
+
+// Collects the packets of the newest snapshot seen. A packet of a newer snapshot drops the packets collected so far, and
+// packets of snapshots that are older or already decoded are ignored. The storage of the collected packets is reused.
+bool SnapshotClient::CollectPacket(size_t size) {
+    SnapshotServer::PacketHeader header;
+    if (size < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, packet.data(), sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 || header.packet_index >= header.packet_count) {
+        return false;
+    }
+    int newest_tick = newest_snapshot >= 0 ? snapshots[newest_snapshot].tick : 0;
+    if ((int)header.tick <= newest_tick || (int)header.tick < collected_tick) {
+        return false;
+    }
+    if ((int)header.tick > collected_tick) {
+        collected_tick = (int)header.tick;
+        collected_count = 0;
+        if (collected_packets.size() < header.packet_count) {
+            collected_packets.resize(header.packet_count);
+        }
+        for (int i = 0; i < collected_packets.size(); i++) {
+            collected_packets[i].clear();
+        }
+    }
+    if (header.packet_index >= collected_packets.size() || !collected_packets[header.packet_index].empty()) {
+        return false;
+    }
+    collected_packets[header.packet_index].assign(packet.begin(), packet.begin() + size);
+    collected_count++;
+    return collected_count == header.packet_count;
+}
+
+// Decodes the packets in order into the oldest kept snapshot, which is never the baseline: the baseline was acknowledged,
+// and the server only sends deltas against snapshots it still keeps, which are the newer ones. The appearances are pruned
+// each time the ring of snapshots has been filled once more, which bounds them by the appearances of the kept snapshots.
+SnapshotClient::Snapshot* SnapshotClient::DecodeSnapshot() {
+    TRACE_ZONE("SnapshotClient::DecodeSnapshot");
+    SnapshotServer::PacketHeader header;
+    memcpy(&header, collected_packets[0].data(), sizeof(header));
+    static const std::vector<SnapshotServer::Entity> no_entities;
+    const std::vector<SnapshotServer::Entity>* baseline = &no_entities;
+    if (header.baseline_tick != 0) {
+        baseline = nullptr;
+        for (int i = 0; i < SnapshotServer::SNAPSHOT_HISTORY; i++) {
+            if (snapshots[i].tick == (int)header.baseline_tick) {
+                baseline = &snapshots[i].entities;
+            }
+        }
+        if (baseline == nullptr) {
+            return nullptr;
+        }
+    }
+    int index = (newest_snapshot + 1) % SnapshotServer::SNAPSHOT_HISTORY;
+    if (&snapshots[index].entities == baseline) {
+        return nullptr;
+    }
+    Snapshot& snapshot = snapshots[index];
+    snapshot.tick = 0;
+    snapshot.entities.clear();
+    int baseline_index = 0;
+    for (int i = 0; i < header.packet_count; i++) {
+        if (!DecodePacket(collected_packets[i], *baseline, baseline_index, snapshot.entities)) {
+            return nullptr;
+        }
+    }
+    snapshot.entities.insert(snapshot.entities.end(), baseline->begin() + baseline_index, baseline->end());
+    if (snapshot.entities.size() != header.entity_count) {
+        snapshot.entities.clear();
+        return nullptr;
+    }
+    snapshot.tick = (int)header.tick;
+    newest_snapshot = index;
+    collected_count = 0;
+    if (index == 0) {
+        PruneAppearances();
+    }
+    return &snapshot;
+}
+
+// Reads each entry of the packet. The entities of the baseline before the entry are unchanged and copied as they are,
+// the entity of a removed entry is skipped and the fields of any other entry are applied to the entity of the baseline,
+// or to a new entity.
+bool SnapshotClient::DecodePacket(const std::vector<Uint8>& packet, const std::vector<SnapshotServer::Entity>& baseline, int& baseline_index, std::vector<SnapshotServer::Entity>& entities) {
+    size_t position = sizeof(SnapshotServer::PacketHeader);
+    Uint32 id = 0;
+    while (position < packet.size()) {
+        Uint32 id_difference, number;
+        if (!SnapshotServer::ReadNumber(packet, position, id_difference) || position >= packet.size()) {
+            return false;
+        }
+        id += id_difference;
+        if (!entities.empty() && entities.back().id >= id) {
+            return false;
+        }
+        while (baseline_index < baseline.size() && baseline[baseline_index].id < id) {
+            entities.push_back(baseline[baseline_index++]);
+        }
+        SnapshotServer::Entity entity;
+        memset(&entity, 0, sizeof(entity));
+        bool is_new = baseline_index >= baseline.size() || baseline[baseline_index].id != id;
+        if (!is_new) {
+            entity = baseline[baseline_index++];
+        }
+        entity.id = id;
+        Uint8 mask = packet[position++];
+        if (mask == 0) {
+            continue;
+        }
+        if (mask & SnapshotServer::X) {
+            if (!SnapshotServer::ReadNumber(packet, position, number)) {
+                return false;
+            }
+            entity.x = (Sint16)(entity.x + UnZigZag(number));
+        }
+        if (mask & SnapshotServer::Y) {
+            if (!SnapshotServer::ReadNumber(packet, position, number)) {
+                return false;
+            }
+            entity.y = (Sint16)(entity.y + UnZigZag(number));
+        }
+        if (mask & SnapshotServer::SIZE) {
+            Uint32 width, height;
+            if (!SnapshotServer::ReadNumber(packet, position, width) || !SnapshotServer::ReadNumber(packet, position, height)) {
+                return false;
+            }
+            entity.width = (Uint16)width;
+            entity.height = (Uint16)height;
+        }
+        int byte_count = ((mask & SnapshotServer::LAYER) != 0) + ((mask & SnapshotServer::FLAGS) != 0) + ((mask & SnapshotServer::IMAGE) != 0);
+        if (byte_count > packet.size() - position) {
+            return false;
+        }
+        if (mask & SnapshotServer::LAYER) {
+            entity.layer = packet[position++];
+        }
+        if (mask & SnapshotServer::FLAGS) {
+            entity.flags = packet[position++];
+        }
+        if (mask & SnapshotServer::IMAGE) {
+            entity.image_index = packet[position++];
+        }
+        if (mask & SnapshotServer::APPEARANCE) {
+            if (!SnapshotServer::ReadNumber(packet, position, entity.appearance) || position >= packet.size()) {
+                return false;
+            }
+            entity.type = packet[position++];
+        }
+        if (mask & SnapshotServer::APPEARANCE_STRINGS) {
+            SnapshotServer::Appearance appearance;
+            appearance.type = entity.type;
+            Uint32 string_count;
+            if (!SnapshotServer::ReadNumber(packet, position, string_count) || string_count > packet.size() - position) {
+                return false;
+            }
+            appearance.strings.resize(string_count);
+            for (int i = 0; i < string_count; i++) {
+                if (!ReadString(packet, position, appearance.strings[i])) {
+                    return false;
+                }
+            }
+            std::unordered_map<Uint32, SnapshotServer::Appearance>::iterator it = appearances.find(entity.appearance);
+            if (it == appearances.end()) {
+                appearances.emplace(entity.appearance, std::move(appearance));
+            } else if (it->second.type != appearance.type || it->second.strings != appearance.strings) {
+                it->second = std::move(appearance);
+                changed_appearances.push_back(entity.appearance);
+            }
+        }
+        entities.push_back(entity);
+    }
+    return true;
+}
+
+// Walks the replicas and the entities of the snapshot in the order of their identifiers. Replicas of sprites that are not
+// in the snapshot are removed, and sprites that are new, have changed their appearance or whose replica has been removed
+// (for example by the window, when it was drawn outside) get a new replica. Every replica then gets the state of its
+// entity, except for the position, which it is moved to from where it is drawn now (see Interpolate). A replica whose
+// appearance has been replaced by the server is also created again.
+void SnapshotClient::ApplySnapshot(Level* level, const Snapshot& snapshot) {
+    TRACE_ZONE("SnapshotClient::ApplySnapshot");
+    std::sort(changed_appearances.begin(), changed_appearances.end());
+    merged_replicas.clear();
+    int old_index = 0;
+    for (int i = 0; i < snapshot.entities.size(); i++) {
+        const SnapshotServer::Entity& entity = snapshot.entities[i];
+        while (old_index < replicas.size() && replicas[old_index].id < entity.id) {
+            RemoveReplica(level, replicas[old_index++]);
+        }
+        Replica replica = {entity.id, 0, entity.appearance, entity.x, entity.y, entity.x, entity.y, 0};
+        if (old_index < replicas.size() && replicas[old_index].id == entity.id) {
+            replica = replicas[old_index++];
+        }
+        Sprite* sprite = replica.sprite_id != 0 ? level->FindSprite(replica.sprite_id) : nullptr;
+        bool is_changed = replica.appearance != entity.appearance
+            || (!changed_appearances.empty() && std::binary_search(changed_appearances.begin(), changed_appearances.end(), entity.appearance));
+        if (sprite != nullptr && (sprite->GetIsRemoved() || is_changed)) {
+            level->RemoveSprite(sprite);
+            sprite = nullptr;
+        }
+        if (sprite == nullptr) {
+            sprite = CreateReplica(entity);
+            if (sprite != nullptr) {
+                level->AddSprite(sprite);
+            }
+            replica.sprite_id = sprite != nullptr ? sprite->GetId() : 0;
+            replica.appearance = entity.appearance;
+            replica.previous_x = entity.x;
+            replica.previous_y = entity.y;
+        } else {
+            replica.previous_x = sprite->GetX();
+            replica.previous_y = sprite->GetY();
+        }
+        replica.x = entity.x;
+        replica.y = entity.y;
+        replica.image_index = entity.image_index;
+        if (sprite != nullptr) {
+            Sprite::State state = sprite->GetState();
+            state.boundary.w = entity.width;
+            state.boundary.h = entity.height;
+            state.layer = entity.layer;
+            state.is_visible = (entity.flags & SnapshotServer::VISIBLE) != 0;
+            sprite->SetState(state);
+        }
+        merged_replicas.push_back(replica);
+    }
+    while (old_index < replicas.size()) {
+        RemoveReplica(level, replicas[old_index++]);
+    }
+    replicas.swap(merged_replicas);
+    changed_appearances.clear();
+    time_since_snapshot = 0;
+}
+
+// Creates the replica with a tag of its own. An animated replica changes its image in every frame, and is told which image
+// to show before each frame (see Interpolate).
+Sprite* SnapshotClient::CreateReplica(const SnapshotServer::Entity& entity) {
+    std::unordered_map<Uint32, SnapshotServer::Appearance>::iterator it = appearances.find(entity.appearance);
+    if (it == appearances.end() || it->second.strings.empty() || it->second.strings[0].empty()) {
+        return nullptr;
+    }
+    const SnapshotServer::Appearance& appearance = it->second;
+    switch (appearance.type) {
+        case Sprite::ANIMATED_SPRITE:
+            return AnimatedSprite::GetInstance(REPLICA_TAG, appearance.strings, 0, entity.x, entity.y, entity.width, entity.height);
+        case Sprite::LABEL_SPRITE:
+        case Sprite::TEXT_INPUT_SPRITE:
+            return LabelSprite::GetInstance(REPLICA_TAG, appearance.strings[0], entity.x, entity.y);
+        default:
+            return StaticSprite::GetInstance(REPLICA_TAG, appearance.strings[0], entity.x, entity.y, entity.width, entity.height);
+    }
+}
+
+// Collects the hashes of the entities of all kept snapshots, sorted, and erases every appearance that is not among them.
+void SnapshotClient::PruneAppearances() {
+    used_appearances.clear();
+    for (int i = 0; i < SnapshotServer::SNAPSHOT_HISTORY; i++) {
+        for (int k = 0; snapshots[i].tick != 0 && k < snapshots[i].entities.size(); k++) {
+            used_appearances.push_back(snapshots[i].entities[k].appearance);
+        }
+    }
+    std::sort(used_appearances.begin(), used_appearances.end());
+    std::unordered_map<Uint32, SnapshotServer::Appearance>::iterator it = appearances.begin();
+    while (it != appearances.end()) {
+        if (std::binary_search(used_appearances.begin(), used_appearances.end(), it->first)) {
+            it++;
+        } else {
+            it = appearances.erase(it);
+        }
+    }
+}
+
+// Removes the sprite of the replica from the level, unless it has been removed already.
+void SnapshotClient::RemoveReplica(Level* level, const Replica& replica) {
+    Sprite* sprite = replica.sprite_id != 0 ? level->FindSprite(replica.sprite_id) : nullptr;
+    if (sprite != nullptr) {
+        level->RemoveSprite(sprite);
+    }
+}
+
+// Moves each replica along the line from where it was drawn when the snapshot was applied to its position in the snapshot,
+// reaching it when the next snapshot is due. The image index of an animated sprite on the server is the image it shows
+// next, so the replica is set to show the image before it.
+void SnapshotClient::Interpolate(Level* level) {
+    TRACE_ZONE("SnapshotClient::Interpolate");
+    double progress = tick_time > 0 ? std::min(1.0, time_since_snapshot / tick_time) : 1.0;
+    for (int i = 0; i < replicas.size(); i++) {
+        const Replica& replica = replicas[i];
+        Sprite* sprite = replica.sprite_id != 0 ? level->FindSprite(replica.sprite_id) : nullptr;
+        if (sprite == nullptr) {
+            continue;
+        }
+        Sprite::State state = sprite->GetState();
+        state.boundary.x = replica.previous_x + (int)lround((replica.x - replica.previous_x) * progress);
+        state.boundary.y = replica.previous_y + (int)lround((replica.y - replica.previous_y) * progress);
+        if (sprite->GetType() == Sprite::ANIMATED_SPRITE) {
+            int image_count = (int)static_cast<AnimatedSprite*>(sprite)->GetImages().size();
+            state.image_index = (replica.image_index + image_count - 1) % image_count;
+        }
+        sprite->SetState(state);
+    }
+}
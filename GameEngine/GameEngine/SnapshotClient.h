@@ -0,0 +1,137 @@
+#ifndef __GameEngine__SnapshotClient__
+#define __GameEngine__SnapshotClient__
+
+#include <vector>
+#include <unordered_map>
+#include <SDL2/SDL.h>
+#include "Level.h"
+#include "SnapshotServer.h"
+
+// Receives the snapshots of a SnapshotServer on a localhost port and applies them to a local level, which is then drawn
+// like any other level (see Engine::ConnectToServer). The client does not simulate anything itself: each sprite of the
+// server has a replica sprite in the local level that only draws, created from the appearance sent by the server
+// (static, moving and custom sprites are drawn as static sprites and text input sprites as labels).
+// The packets of a snapshot are collected until all of them have arrived, and the snapshot is then decoded against the
+// snapshot it is a delta against, applied and acknowledged. Snapshots that cannot be completed or decoded are dropped,
+// which makes the server send the next snapshot against an older one. The client keeps the last snapshots it decoded,
+// since the server may send a delta against any snapshot that has been acknowledged, and the appearances that these snapshots
+// use. The server may use a hash for another appearance once no snapshot it keeps uses it, in which case it sends the strings
+// again and the replicas of the old appearance are created again.
+// Replicas are moved smoothly from where they were drawn to the position of the newest snapshot over one tick of the
+// server, which means that the client draws the server one tick late.
+class SnapshotClient {
+
+public:
+    
+    // Creates a new client of the server on the specified port of 127.0.0.1 and says hello to the server. The tick time
+    // is the time (in milliseconds) between two snapshots of the server. Throws if the socket cannot be created.
+    SnapshotClient(int port, double tick_time);
+    
+    // Reads the packets that have arrived, applies the newest complete snapshot to the level and moves the replicas
+    // towards their positions in it by the time elapsed (in milliseconds).
+    void Update(Level* level, double time_elapsed);
+    
+    // Returns the tick of the last snapshot applied, or 0 if no snapshot has been received yet.
+    int GetTick();
+    
+    // Returns the number of snapshots applied so far.
+    long GetSnapshotCount();
+    
+    // Returns the number of bytes received so far.
+    long GetBytesReceived();
+    
+    // Returns the replica of the sprite with the specified identifier in the level of the server, or a null pointer.
+    Sprite* GetReplica(Level* level, Uint32 id);
+    
+    // Closes the socket. The replicas are left in the level.
+    ~SnapshotClient();
+
+private:
+    
+    // A sprite of the server: its identifier on the server, the identifier of its replica in the local level (or 0 if it has
+    // no replica), its appearance, the position the replica is moved from and to, and the image it shows.
+    struct Replica {
+        Uint32 id;
+        Uint32 sprite_id;
+        Uint32 appearance;
+        int previous_x, previous_y;
+        int x, y;
+        int image_index;
+    };
+    
+    // A decoded snapshot: its tick and its entities ordered by identifier.
+    struct Snapshot {
+        int tick;
+        std::vector<SnapshotServer::Entity> entities;
+    };
+    
+    // Private in order to guard against value semantics.
+    SnapshotClient(const SnapshotClient& other_client);
+    
+    // Private in order to guard against value semantics.
+    const SnapshotClient& operator=(const SnapshotClient& other_client);
+    
+    // Internal helper function that sends a message with the specified magic, followed by the tick if it is not 0.
+    void SendMessage(const char* magic, int tick);
+    
+    // Internal helper function that collects the packet of the specified size in the receive buffer. Returns true if the
+    // snapshot of the packet is complete.
+    bool CollectPacket(size_t size);
+    
+    // Internal helper function that decodes the collected packets. Returns the decoded snapshot, or a null pointer if the
+    // packets could not be decoded.
+    Snapshot* DecodeSnapshot();
+    
+    // Internal helper function that reads the entries of a packet into the decoded snapshot, merging them with the baseline.
+    bool DecodePacket(const std::vector<Uint8>& packet, const std::vector<SnapshotServer::Entity>& baseline, int& baseline_index, std::vector<SnapshotServer::Entity>& entities);
+    
+    // Internal helper function that creates, updates and removes the replicas so that they match a snapshot.
+    void ApplySnapshot(Level* level, const Snapshot& snapshot);
+    
+    // Internal helper function that creates the replica of an entity, or returns a null pointer if its appearance is unknown.
+    Sprite* CreateReplica(const SnapshotServer::Entity& entity);
+    
+    // Internal helper function that drops the appearances that no kept snapshot uses.
+    void PruneAppearances();
+    
+    // Internal helper function that removes the sprite of a replica from the level.
+    void RemoveReplica(Level* level, const Replica& replica);
+    
+    // Internal helper function that moves the replicas towards their positions in the newest snapshot.
+    void Interpolate(Level* level);
+    
+    // The socket, connected to the server.
+    int client_socket;
+    
+    // The time between two snapshots of the server, and the time since the newest snapshot was applied.
+    double tick_time, time_since_snapshot;
+    
+    // The packets of the snapshot being collected, its tick and the number of packets collected.
+    std::vector<std::vector<Uint8>> collected_packets;
+    int collected_tick;
+    int collected_count;
+    
+    // The last snapshots decoded, used as a ring, and the index of the newest one (or -1).
+    Snapshot snapshots[SnapshotServer::SNAPSHOT_HISTORY];
+    int newest_snapshot;
+    
+    // The appearances sent by the server, by hash, the hashes whose appearance has been replaced since a snapshot was last
+    // applied and the hashes used by the kept snapshots (only used while pruning the appearances).
+    std::unordered_map<Uint32, SnapshotServer::Appearance> appearances;
+    std::vector<Uint32> changed_appearances;
+    std::vector<Uint32> used_appearances;
+    
+    // The sprites of the server ordered by identifier, and the vector they are merged into when a snapshot is applied.
+    std::vector<Replica> replicas;
+    std::vector<Replica> merged_replicas;
+    
+    // The buffer packets are received into.
+    std::vector<Uint8> packet;
+    
+    // The number of updates since a snapshot was applied, the number of snapshots applied and the number of bytes received.
+    int updates_without_snapshot;
+    long snapshot_count;
+    long bytes_received;
+};
+
+#endif
@@ -0,0 +1,423 @@
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include "SnapshotServer.h"
+#include "AnimatedSprite.h"
+#include "LabelSprite.h"
+#include "TextInputSprite.h"
+#include "StateHash.h"
+#include "Trace.h"
+
+// The magic of the packets of a snapshot, of a hello and of an acknowledgement.
+static const char SNAPSHOT_MAGIC[4] = {'G', 'E', 'S', 'N'};
+static const char HELLO_MAGIC[4] = {'G', 'E', 'H', 'I'};
+static const char ACKNOWLEDGEMENT_MAGIC[4] = {'G', 'E', 'A', 'K'};
+
+// The largest packet read from a client. Clients only send hellos and acknowledgements.
+static const int MAX_MESSAGE_SIZE = 64;
+
+// Clamps a value to the range of a 16 bit integer.
+static Sint16 ClampSigned(int value) {
+    return (Sint16)std::max(-32768, std::min(32767, value));
+}
+
+// Clamps a value to the range of an unsigned 16 bit integer.
+static Uint16 ClampUnsigned(int value) {
+    return (Uint16)std::max(0, std::min(65535, value));
+}
+
+// Maps a difference to an unsigned number, so that small negative differences are written as small numbers too.
+static Uint32 ZigZag(int difference) {
+    return ((Uint32)difference << 1) ^ (Uint32)(difference >> 31);
+}
+
+// Appends a string as its length followed by its characters.
+static void AppendString(std::vector<Uint8>& packet, const std::string& text) {
+    SnapshotServer::AppendNumber(packet, (Uint32)text.size());
+    packet.insert(packet.end(), text.begin(), text.end());
+}
+
+// Opens a socket on the loopback interface only. The socket never blocks, since the server reads it once in each tick.
+SnapshotServer::SnapshotServer(int port):port(port), newest_snapshot(-1), packet_count(0), last_entry_id(0), bytes_sent(0), last_bytes_sent(0) {
+    server_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (server_socket < 0) {
+        throw std::runtime_error("Failed to create the snapshot socket!");
+    }
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    socklen_t address_size = sizeof(address);
+    if (bind(server_socket, (sockaddr*)&address, sizeof(address)) < 0 || getsockname(server_socket, (sockaddr*)&address, &address_size) < 0
+        || fcntl(server_socket, F_SETFL, O_NONBLOCK) < 0) {
+        close(server_socket);
+        throw std::runtime_error("Failed to listen on snapshot port " + std::to_string(port) + "!");
+    }
+    this->port = ntohs(address.sin_port);
+    for (int i = 0; i < SNAPSHOT_HISTORY; i++) {
+        snapshots[i].tick = 0;
+    }
+}
+
+// The snapshot is taken once and encoded for each client against the snapshot it acknowledged last. Clients that have
+// not been heard from for CLIENT_TIMEOUT ticks are dropped before anything is sent.
+void SnapshotServer::Send(int tick, Level* level) {
+    TRACE_ZONE("SnapshotServer::Send");
+    ReceiveMessages(tick);
+    for (int i = (int)clients.size() - 1; i >= 0; i--) {
+        if (tick - clients[i].last_heard_tick > CLIENT_TIMEOUT) {
+            clients.erase(clients.begin() + i);
+        }
+    }
+    newest_snapshot = (newest_snapshot + 1) % SNAPSHOT_HISTORY;
+    Snapshot& snapshot = snapshots[newest_snapshot];
+    TakeSnapshot(tick, level, snapshot);
+    last_bytes_sent = 0;
+    for (int i = 0; i < clients.size(); i++) {
+        EncodeDelta(FindSnapshot(clients[i].acknowledged_tick), snapshot);
+        for (int k = 0; k < packet_count; k++) {
+            sendto(server_socket, packets[k].data(), packets[k].size(), 0, (sockaddr*)&clients[i].address, sizeof(clients[i].address));
+            last_bytes_sent += (long)packets[k].size();
+        }
+    }
+    bytes_sent += last_bytes_sent;
+}
+
+// Returns the port the server listens on.
+int SnapshotServer::GetPort() {
+    return port;
+}
+
+// Returns the number of clients.
+int SnapshotServer::GetClientCount() {
+    return (int)clients.size();
+}
+
+// Returns the number of bytes sent so far.
+long SnapshotServer::GetBytesSent() {
+    return bytes_sent;
+}
+
+// Returns the number of bytes sent by the last call to Send.
+long SnapshotServer::GetLastBytesSent() {
+    return last_bytes_sent;
+}
+
+// Quantizes the state of the sprite. The appearance is hashed from the same strings as GetAppearance returns, in the same
+// order, but without copying them.
+SnapshotServer::Entity SnapshotServer::GetEntity(Sprite* sprite) {
+    const Sprite::State& state = sprite->GetState();
+    Entity entity;
+    entity.id = sprite->GetId();
+    entity.x = ClampSigned(state.boundary.x);
+    entity.y = ClampSigned(state.boundary.y);
+    entity.width = ClampUnsigned(state.boundary.w);
+    entity.height = ClampUnsigned(state.boundary.h);
+    entity.type = (Uint8)sprite->GetType();
+    entity.layer = (Uint8)std::max(0, std::min(255, state.layer));
+    entity.image_index = (Uint8)state.image_index;
+    entity.flags = state.is_visible ? VISIBLE : 0;
+    StateHash hash(entity.type);
+    switch (sprite->GetType()) {
+        case Sprite::ANIMATED_SPRITE: {
+            const std::vector<std::string>& images = static_cast<AnimatedSprite*>(sprite)->GetImages();
+            hash.Add((Sint64)images.size());
+            for (int i = 0; i < images.size(); i++) {
+                hash.Add(images[i]);
+            }
+            break;
+        }
+        case Sprite::LABEL_SPRITE:
+            hash.Add(1);
+            hash.Add(static_cast<LabelSprite*>(sprite)->GetMessage());
+            break;
+        case Sprite::TEXT_INPUT_SPRITE:
+            hash.Add(1);
+            hash.Add(static_cast<TextInputSprite*>(sprite)->GetText());
+            break;
+        default:
+            hash.Add(1);
+            hash.Add(sprite->GetFileName());
+            break;
+    }
+    entity.appearance = (Uint32)(hash.GetValue() ^ (hash.GetValue() >> 32));
+    return entity;
+}
+
+// Copies the strings of the sprite that GetEntity hashes.
+SnapshotServer::Appearance SnapshotServer::GetAppearance(Sprite* sprite) {
+    Appearance appearance;
+    appearance.type = (Uint8)sprite->GetType();
+    switch (sprite->GetType()) {
+        case Sprite::ANIMATED_SPRITE:
+            appearance.strings = static_cast<AnimatedSprite*>(sprite)->GetImages();
+            break;
+        case Sprite::LABEL_SPRITE:
+            appearance.strings.push_back(static_cast<LabelSprite*>(sprite)->GetMessage());
+            break;
+        case Sprite::TEXT_INPUT_SPRITE:
+            appearance.strings.push_back(static_cast<TextInputSprite*>(sprite)->GetText());
+            break;
+        default:
+            appearance.strings.push_back(sprite->GetFileName());
+            break;
+    }
+    return appearance;
+}
+
+// Compares the strings of the sprite that GetAppearance copies.
+bool SnapshotServer::HasAppearance(Sprite* sprite, const Appearance& appearance) {
+    if (appearance.type != (Uint8)sprite->GetType()) {
+        return false;
+    }
+    switch (sprite->GetType()) {
+        case Sprite::ANIMATED_SPRITE:
+            return appearance.strings == static_cast<AnimatedSprite*>(sprite)->GetImages();
+        case Sprite::LABEL_SPRITE:
+            return appearance.strings.size() == 1 && appearance.strings[0] == static_cast<LabelSprite*>(sprite)->GetMessage();
+        case Sprite::TEXT_INPUT_SPRITE:
+            return appearance.strings.size() == 1 && appearance.strings[0] == static_cast<TextInputSprite*>(sprite)->GetText();
+        default:
+            return appearance.strings.size() == 1 && appearance.strings[0] == sprite->GetFileName();
+    }
+}
+
+// Appends the number seven bits at a time, lowest bits first.
+void SnapshotServer::AppendNumber(std::vector<Uint8>& packet, Uint32 number) {
+    while (number >= 0x80) {
+        packet.push_back((Uint8)(number | 0x80));
+        number >>= 7;
+    }
+    packet.push_back((Uint8)number);
+}
+
+// Reads the number seven bits at a time. A number has at most five bytes.
+bool SnapshotServer::ReadNumber(const std::vector<Uint8>& packet, size_t& position, Uint32& number) {
+    number = 0;
+    for (int shift = 0; shift < 35 && position < packet.size(); shift += 7) {
+        Uint8 byte = packet[position++];
+        number |= (Uint32)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+SnapshotServer::~SnapshotServer() {
+    close(server_socket);
+}
+
+// Reads all packets that have arrived. A hello from a new address adds a client, and an acknowledgement moves the
+// acknowledged tick of its client forward (acknowledgements may arrive out of order). Anything else is ignored.
+void SnapshotServer::ReceiveMessages(int tick) {
+    Uint8 message[MAX_MESSAGE_SIZE];
+    sockaddr_in address;
+    socklen_t address_size = sizeof(address);
+    ssize_t size;
+    while ((size = recvfrom(server_socket, message, sizeof(message), 0, (sockaddr*)&address, &address_size)) >= 0) {
+        address_size = sizeof(address);
+        if (size < 4) {
+            continue;
+        }
+        Client* client = nullptr;
+        for (int i = 0; i < clients.size(); i++) {
+            if (clients[i].address.sin_addr.s_addr == address.sin_addr.s_addr && clients[i].address.sin_port == address.sin_port) {
+                client = &clients[i];
+            }
+        }
+        if (memcmp(message, HELLO_MAGIC, sizeof(HELLO_MAGIC)) == 0) {
+            if (client == nullptr) {
+                clients.push_back({address, 0, tick});
+            } else {
+                client->last_heard_tick = tick;
+            }
+        } else if (memcmp(message, ACKNOWLEDGEMENT_MAGIC, sizeof(ACKNOWLEDGEMENT_MAGIC)) == 0 && size >= 8 && client != nullptr) {
+            Uint32 acknowledged_tick;
+            memcpy(&acknowledged_tick, message + 4, sizeof(acknowledged_tick));
+            client->acknowledged_tick = std::max(client->acknowledged_tick, (int)acknowledged_tick);
+            client->last_heard_tick = tick;
+        }
+    }
+}
+
+// The sprites of a level are kept in the order they were added, which is the order of their identifiers, so the entities
+// are ordered by identifier without sorting. The storage of the snapshot that is replaced is reused. The appearances that
+// were only used by the replaced snapshot are dropped first, so that their hashes are free again.
+void SnapshotServer::TakeSnapshot(int tick, Level* level, Snapshot& snapshot) {
+    TRACE_ZONE("SnapshotServer::TakeSnapshot");
+    for (int i = 0; i < snapshot.appearances.size(); i++) {
+        std::unordered_map<Uint32, KeptAppearance>::iterator it = kept_appearances.find(snapshot.appearances[i]);
+        if (--it->second.snapshot_count == 0) {
+            kept_appearances.erase(it);
+        }
+    }
+    snapshot.tick = tick;
+    snapshot.entities.clear();
+    snapshot.appearances.clear();
+    if (level == nullptr) {
+        return;
+    }
+    const std::vector<Sprite*>& sprites = level->GetSprites();
+    for (int i = 0; i < sprites.size(); i++) {
+        Entity entity = GetEntity(sprites[i]);
+        entity.appearance = KeepAppearance(sprites[i], entity.appearance);
+        snapshot.entities.push_back(entity);
+        snapshot.appearances.push_back(entity.appearance);
+    }
+    std::sort(snapshot.appearances.begin(), snapshot.appearances.end());
+    snapshot.appearances.erase(std::unique(snapshot.appearances.begin(), snapshot.appearances.end()), snapshot.appearances.end());
+    for (int i = 0; i < snapshot.appearances.size(); i++) {
+        kept_appearances[snapshot.appearances[i]].snapshot_count++;
+    }
+}
+
+// Probes the hashes from the hash of the entity on, like open addressing. The strings are compared for every sprite in
+// every snapshot, since a sprite may change to an appearance with the same hash, but this reads the same strings as
+// computing the hash did. A new appearance is kept with no snapshots, and counted once the snapshot is complete.
+Uint32 SnapshotServer::KeepAppearance(Sprite* sprite, Uint32 hash) {
+    while (true) {
+        std::unordered_map<Uint32, KeptAppearance>::iterator it = kept_appearances.find(hash);
+        if (it == kept_appearances.end()) {
+            kept_appearances.emplace(hash, KeptAppearance{GetAppearance(sprite), 0});
+            return hash;
+        }
+        if (HasAppearance(sprite, it->second.appearance)) {
+            return hash;
+        }
+        hash++;
+    }
+}
+
+// Returns the kept snapshot of the tick. Tick 0 is never kept, since it stands for no snapshot.
+SnapshotServer::Snapshot* SnapshotServer::FindSnapshot(int tick) {
+    for (int i = 0; tick > 0 && i < SNAPSHOT_HISTORY; i++) {
+        if (snapshots[i].tick == tick) {
+            return &snapshots[i];
+        }
+    }
+    return nullptr;
+}
+
+// Walks the entities of both snapshots in the order of their identifiers. Entities only in the baseline are written as
+// removed, entities only in the snapshot with all their fields and entities in both with the fields that changed. The
+// strings of an appearance are written the first time it occurs in the delta, unless it occurs in the baseline, in which
+// case the client already knows it, since a hash is not used for another appearance while a snapshot using it is kept.
+void SnapshotServer::EncodeDelta(const Snapshot* baseline, const Snapshot& snapshot) {
+    TRACE_ZONE("SnapshotServer::EncodeDelta");
+    PacketHeader header;
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.tick = (Uint32)snapshot.tick;
+    header.baseline_tick = baseline != nullptr ? (Uint32)baseline->tick : 0;
+    header.entity_count = (Uint32)snapshot.entities.size();
+    header.packet_index = 0;
+    header.packet_count = 0;
+    packet_count = 0;
+    sent_appearances.clear();
+    static const std::vector<Entity> no_entities;
+    const std::vector<Entity>& old_entities = baseline != nullptr ? baseline->entities : no_entities;
+    int old_index = 0;
+    for (int i = 0; i <= snapshot.entities.size(); i++) {
+        Uint32 id = i < snapshot.entities.size() ? snapshot.entities[i].id : 0xffffffff;
+        while (old_index < old_entities.size() && old_entities[old_index].id < id) {
+            entry.clear();
+            entry.push_back(0);
+            AppendEntry(old_entities[old_index++].id, header);
+        }
+        if (i == snapshot.entities.size()) {
+            break;
+        }
+        const Entity& entity = snapshot.entities[i];
+        Entity old_entity;
+        memset(&old_entity, 0, sizeof(old_entity));
+        bool is_new = old_index >= old_entities.size() || old_entities[old_index].id != id;
+        if (!is_new) {
+            old_entity = old_entities[old_index++];
+        }
+        Uint8 mask = 0;
+        mask |= entity.x != old_entity.x || is_new ? X : 0;
+        mask |= entity.y != old_entity.y || is_new ? Y : 0;
+        mask |= entity.width != old_entity.width || entity.height != old_entity.height || is_new ? SIZE : 0;
+        mask |= entity.layer != old_entity.layer || is_new ? LAYER : 0;
+        mask |= entity.flags != old_entity.flags || is_new ? FLAGS : 0;
+        mask |= entity.image_index != old_entity.image_index || is_new ? IMAGE : 0;
+        mask |= entity.appearance != old_entity.appearance || entity.type != old_entity.type || is_new ? APPEARANCE : 0;
+        if (mask == 0) {
+            continue;
+        }
+        if ((mask & APPEARANCE) != 0 && (baseline == nullptr || !std::binary_search(baseline->appearances.begin(), baseline->appearances.end(), entity.appearance))) {
+            std::vector<Uint32>::iterator it = std::lower_bound(sent_appearances.begin(), sent_appearances.end(), entity.appearance);
+            if (it == sent_appearances.end() || *it != entity.appearance) {
+                sent_appearances.insert(it, entity.appearance);
+                mask |= APPEARANCE_STRINGS;
+            }
+        }
+        entry.clear();
+        entry.push_back(mask);
+        if (mask & X) {
+            AppendNumber(entry, ZigZag(entity.x - old_entity.x));
+        }
+        if (mask & Y) {
+            AppendNumber(entry, ZigZag(entity.y - old_entity.y));
+        }
+        if (mask & SIZE) {
+            AppendNumber(entry, entity.width);
+            AppendNumber(entry, entity.height);
+        }
+        if (mask & LAYER) {
+            entry.push_back(entity.layer);
+        }
+        if (mask & FLAGS) {
+            entry.push_back(entity.flags);
+        }
+        if (mask & IMAGE) {
+            entry.push_back(entity.image_index);
+        }
+        if (mask & APPEARANCE) {
+            AppendNumber(entry, entity.appearance);
+            entry.push_back(entity.type);
+        }
+        if (mask & APPEARANCE_STRINGS) {
+            const Appearance& appearance = kept_appearances[entity.appearance].appearance;
+            AppendNumber(entry, (Uint32)appearance.strings.size());
+            for (int k = 0; k < appearance.strings.size(); k++) {
+                AppendString(entry, appearance.strings[k]);
+            }
+        }
+        AppendEntry(id, header);
+    }
+    if (packet_count == 0) {
+        if (packets.empty()) {
+            packets.push_back(std::vector<Uint8>());
+        }
+        packets[0].resize(sizeof(header));
+        packet_count = 1;
+    }
+    for (int i = 0; i < packet_count; i++) {
+        header.packet_index = (Uint16)i;
+        header.packet_count = (Uint16)packet_count;
+        memcpy(packets[i].data(), &header, sizeof(header));
+    }
+}
+
+// Starts a new packet with room for the header if there is no packet yet or the entry does not fit in the current one.
+// The identifier of the first entry of a packet is written relative to 0, so that each packet can be read on its own.
+void SnapshotServer::AppendEntry(Uint32 id, const PacketHeader& header) {
+    if (packet_count == 0 || packets[packet_count - 1].size() + entry.size() + 5 > MAX_PACKET_SIZE) {
+        if (packet_count == packets.size()) {
+            packets.push_back(std::vector<Uint8>());
+        }
+        packets[packet_count].resize(sizeof(header));
+        packet_count++;
+        last_entry_id = 0;
+    }
+    std::vector<Uint8>& packet = packets[packet_count - 1];
+    AppendNumber(packet, id - last_entry_id);
+    packet.insert(packet.end(), entry.begin(), entry.end());
+    last_entry_id = id;
+}
@@ -0,0 +1,186 @@
+#ifndef __GameEngine__SnapshotServer__
+#define __GameEngine__SnapshotServer__
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <netinet/in.h>
+#include <SDL2/SDL.h>
+#include "Level.h"
+
+// Sends the state of the sprites of a level to rendering clients (see SnapshotClient) over UDP on a localhost port, so that
+// the game runs on a headless server engine and thin clients only draw what the server simulates (see Engine::ServeSnapshots).
+// A client says hello to the server, and from then on the server sends it a snapshot of the level in every tick (frame).
+//
+// A snapshot holds one Entity for each sprite, quantized to what a client needs to draw it: the position and size in
+// 16 bits, the layer, the visibility and the image of an animation in 8 bits each, and the appearance of the sprite (its
+// class and images or message) as a hash. The strings of an appearance are only sent to a client that cannot know them.
+// The server keeps the appearances of the hashes in its kept snapshots and checks that a hash is only ever used for one
+// appearance while it is kept, moving an appearance whose hash collides with another one to the next free hash.
+// Each snapshot is delta-compressed against the last snapshot the client has acknowledged: only the sprites that were added,
+// removed or changed since are sent, and a changed sprite only sends the fields that changed, positions as the difference
+// to the acknowledged position. The server keeps the last snapshots, so a client that misses a snapshot is sent the delta
+// against an older one, and a client that has not acknowledged any of them is sent the whole snapshot.
+//
+// A snapshot is split into packets of at most MAX_PACKET_SIZE bytes, each with a PacketHeader followed by the entries of
+// some of the sprites in the order of their identifiers. An entry is the difference between the identifier of the sprite
+// and the identifier of the entry before it, a mask of the fields that follow (a mask of 0 means that the sprite was
+// removed) and the fields. Numbers are written with seven bits in each byte, and differences are zigzag encoded first.
+// A client acknowledges a snapshot once all its packets have arrived, with a packet of the magic "GEAK" and the tick.
+class SnapshotServer {
+
+public:
+    
+    // The state of a sprite as sent to the clients. The sprite is identified by its identifier in the level of the server.
+    struct Entity {
+        Uint32 id;
+        Uint32 appearance;
+        Sint16 x, y;
+        Uint16 width, height;
+        Uint8 type, layer, image_index, flags;
+    };
+    
+    // The class of a sprite and the strings that are needed to create it again: the file name of a static, moving or custom
+    // sprite, the images of an animated sprite, the message of a label or the text of a text input sprite.
+    struct Appearance {
+        Uint8 type;
+        std::vector<std::string> strings;
+    };
+    
+    // The first bytes of each packet of a snapshot: the magic "GESN", the tick of the snapshot and of the snapshot it is a
+    // delta against (or 0 for a whole snapshot), the number of sprites in the snapshot and which packet of the snapshot this is.
+    struct PacketHeader {
+        char magic[4];
+        Uint32 tick, baseline_tick;
+        Uint32 entity_count;
+        Uint16 packet_index, packet_count;
+    };
+    
+    // The fields of an entry, as bits of its mask. APPEARANCE_STRINGS means that the strings of the appearance follow its hash.
+    enum Field {X = 1, Y = 2, SIZE = 4, LAYER = 8, FLAGS = 16, IMAGE = 32, APPEARANCE = 64, APPEARANCE_STRINGS = 128};
+    
+    // The flags of an entity.
+    enum EntityFlag {VISIBLE = 1};
+    
+    // The largest packet sent, which fits in the payload of a single Ethernet frame.
+    static const int MAX_PACKET_SIZE = 1200;
+    
+    // The number of snapshots kept to compute deltas against.
+    static const int SNAPSHOT_HISTORY = 32;
+    
+    // The number of ticks without a packet from a client after which the client is dropped.
+    static const int CLIENT_TIMEOUT = 600;
+    
+    // Creates a new server listening on the specified port of 127.0.0.1. If the port is 0, a free port is chosen
+    // (see GetPort). Throws if the port cannot be listened on.
+    SnapshotServer(int port);
+    
+    // Reads the hellos and acknowledgements that have arrived, takes a snapshot of the level and sends it to each client.
+    // The tick must be greater than the tick of the last call. A null level is sent as a level without sprites.
+    void Send(int tick, Level* level);
+    
+    // Returns the port the server listens on.
+    int GetPort();
+    
+    // Returns the number of clients.
+    int GetClientCount();
+    
+    // Returns the number of bytes sent to all clients so far, and the number of bytes sent by the last call to Send.
+    long GetBytesSent();
+    long GetLastBytesSent();
+    
+    // Returns the entity of a sprite, with the hash of its appearance. Positions and sizes beyond 16 bits are clamped.
+    static Entity GetEntity(Sprite* sprite);
+    
+    // Returns the appearance of a sprite.
+    static Appearance GetAppearance(Sprite* sprite);
+    
+    // Returns true if the sprite has the appearance, comparing its class and strings without copying them.
+    static bool HasAppearance(Sprite* sprite, const Appearance& appearance);
+    
+    // Appends a number to a packet, using seven bits of each byte, where the highest bit marks that more bytes follow.
+    static void AppendNumber(std::vector<Uint8>& packet, Uint32 number);
+    
+    // Reads a number appended by AppendNumber at the position and moves the position past it. Returns false if the
+    // number does not fit in the packet.
+    static bool ReadNumber(const std::vector<Uint8>& packet, size_t& position, Uint32& number);
+    
+    // Closes the port.
+    ~SnapshotServer();
+
+private:
+    
+    // A client: its address, the tick of the last snapshot it acknowledged (or 0) and the tick it was last heard from.
+    struct Client {
+        sockaddr_in address;
+        int acknowledged_tick;
+        int last_heard_tick;
+    };
+    
+    // A snapshot sent to the clients: the entities ordered by identifier and the hashes of their appearances, sorted.
+    struct Snapshot {
+        int tick;
+        std::vector<Entity> entities;
+        std::vector<Uint32> appearances;
+    };
+    
+    // An appearance used by the kept snapshots, and the number of kept snapshots that use it.
+    struct KeptAppearance {
+        Appearance appearance;
+        int snapshot_count;
+    };
+    
+    // Private in order to guard against value semantics.
+    SnapshotServer(const SnapshotServer& other_server);
+    
+    // Private in order to guard against value semantics.
+    const SnapshotServer& operator=(const SnapshotServer& other_server);
+    
+    // Internal helper function that reads the packets that have arrived from clients.
+    void ReceiveMessages(int tick);
+    
+    // Internal helper function that takes a snapshot of the level, replacing the kept snapshot.
+    void TakeSnapshot(int tick, Level* level, Snapshot& snapshot);
+    
+    // Internal helper function that returns the hash of the appearance of a sprite: the hash of the entity if it is free or
+    // used for the same appearance, and otherwise the next hash that is. A free hash is given the appearance of the sprite.
+    Uint32 KeepAppearance(Sprite* sprite, Uint32 hash);
+    
+    // Internal helper function that returns the kept snapshot of the tick, or a null pointer.
+    Snapshot* FindSnapshot(int tick);
+    
+    // Internal helper function that splits the delta between two snapshots into packets. The baseline is a null pointer for
+    // a whole snapshot.
+    void EncodeDelta(const Snapshot* baseline, const Snapshot& snapshot);
+    
+    // Internal helper function that appends the entry being written for the sprite with the specified identifier to the
+    // packets, starting a new packet if it does not fit in the current one.
+    void AppendEntry(Uint32 id, const PacketHeader& header);
+    
+    // The socket, and the port it listens on.
+    int server_socket;
+    int port;
+    
+    // The clients that have said hello.
+    std::vector<Client> clients;
+    
+    // The last snapshots, used as a ring, and the index of the newest one (or -1).
+    Snapshot snapshots[SNAPSHOT_HISTORY];
+    int newest_snapshot;
+    
+    // The appearances used by the kept snapshots, by hash.
+    std::unordered_map<Uint32, KeptAppearance> kept_appearances;
+    
+    // The packets of the snapshot being sent, the number of them in use, the entry being written, the identifier of the
+    // last entry written to the current packet and the hashes of the appearances whose strings have been written, sorted.
+    std::vector<std::vector<Uint8>> packets;
+    int packet_count;
+    std::vector<Uint8> entry;
+    Uint32 last_entry_id;
+    std::vector<Uint32> sent_appearances;
+    
+    // The number of bytes sent so far and by the last call to Send.
+    long bytes_sent, last_bytes_sent;
+};
+
+#endif
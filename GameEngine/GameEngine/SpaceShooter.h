@@ -0,0 +1,35 @@
+#ifndef __GameEngine__SpaceShooter__
+#define __GameEngine__SpaceShooter__
+
+#include "Engine.h"
+
+// The space shooter game. All state of a game is kept in an instance of this class, which makes it possible
+// to run many games at once in different engines (see the --batch option in main).
+class SpaceShooter {
+
+public:
+    
+    // Sets up the first level of the game in the specified engine.
+    SpaceShooter(Engine* game_engine);
+    
+    // Starts the game, called when the player has entered a name.
+    void PlayerNameEnteredListener();
+
+private:
+    
+    void GameOver(Sprite* sprite1, Sprite* sprite2);
+    void DestroySprites(Sprite* sprite1, Sprite* sprite2);
+    void CollisionListener(Sprite* sprite1, Sprite* sprite2);
+    void EnemyCreationListenerLevel1();
+    void BulletCreationListenerLevel1(SDL_Event& event, Sprite* sprite);
+    void SetUpLevel1();
+    
+    Engine* game_engine;
+    Level* level1;
+    Sprite* player;
+    Sprite* text_input;
+    Sprite* name_input_message;
+    Sprite* overlay;
+};
+
+#endif
@@ -2,12 +2,15 @@
 #include "Sprite.h"
 #include "Engine.h"
 #include "Window.h"
+#include "Trace.h"
 
-Sprite::Sprite(std::string tag, int x_pos, int y_pos, int width, int height, std::string file_name):tag(tag), file_name(file_name), texture(NULL), is_removed(false), is_visible(true) {
-    boundary.x = x_pos;
-    boundary.y = y_pos;
-    boundary.h = height;
-    boundary.w = width;
+Sprite::Sprite(std::string tag, int x_pos, int y_pos, int width, int height, std::string file_name):tag(std::move(tag)), window(nullptr), file_name(std::move(file_name)), type(CUSTOM_SPRITE), id(0), state() {
+    state.boundary.x = x_pos;
+    state.boundary.y = y_pos;
+    state.boundary.h = height;
+    state.boundary.w = width;
+    state.texture = -1;
+    state.is_visible = true;
 }
 
 // Sets the window member variable.
@@ -18,74 +21,126 @@ void Sprite::SetWindow(Window* window) {
 // Adds a new event listener to the interal map that contains all event listeners.
 // The keycode is used as key, meaning that two event listeners with the same keycode cannot be
 // registered at the same time.
-void Sprite::AddEventListener(std::function<void(SDL_Event&, Sprite*)> listener, int key_code) {
-    event_listeners[key_code] = listener;
+void Sprite::AddEventListener(std::function<void(SDL_Event&, Sprite*)> listener, int key_code, std::string name) {
+    event_listeners[key_code] = {listener, name != "" ? name : tag + ".event[" + std::to_string(key_code) + "]"};
 }
 
 // Adds a new time listener to the internal map that contains all time listeners.
 // The delay is used as key, meaning that two time listeners with the same delay cannot be
 // registered at the same time.
-void Sprite::AddTimeListener(std::function<void(Sprite*)> listener, int delay) {
-    time_listeners[delay] = listener;
+void Sprite::AddTimeListener(std::function<void(Sprite*)> listener, int delay, std::string name) {
+    time_listeners[delay] = {listener, name != "" ? name : tag + ".time[" + std::to_string(delay) + "ms]"};
+}
+
+// Adds a task to the tasks tied to the lifetime of the sprite. Tasks that are already done are removed first so that
+// the list does not grow for sprites that launch many tasks.
+void Sprite::AddTask(Task task) {
+    for (int i = (int)tasks.size() - 1; i >= 0; i--) {
+        if (tasks[i].IsDone()) {
+            tasks.erase(tasks.begin() + i);
+        }
+    }
+    tasks.push_back(task);
 }
 
 // Sets the X value of the upper right coordinate for the sprite.
 void Sprite::SetX(int x) {
-    boundary.x = x;
+    state.boundary.x = x;
 }
 
 // Sets the Y value of the upper right coordinate for the sprite.
 void Sprite::SetY(int y) {
-    boundary.y = y;
+    state.boundary.y = y;
 }
 
 // Returns the X value of the upper right coordinate for the sprite.
 int Sprite::GetX() {
-    return boundary.x;
+    return state.boundary.x;
 }
 
 // Returns the Y value of the upper right coordinate for the sprite.
 int Sprite::GetY() {
-    return boundary.y;
+    return state.boundary.y;
 }
 
 // Returns the width of the sprite.
 int Sprite::GetWidth() {
-    return boundary.w;
+    return state.boundary.w;
 }
 
 // Returns the height of the sprite.
 int Sprite::GetHeight() {
-    return boundary.h;
+    return state.boundary.h;
 }
 
 // Returns the tag of the sprite.
-std::string Sprite::GetTag() {
+const std::string& Sprite::GetTag() {
     return tag;
 }
 
+// Returns the file name of the image shown for the sprite.
+const std::string& Sprite::GetFileName() {
+    return file_name;
+}
+
+// Returns the class of the sprite.
+Sprite::Type Sprite::GetType() {
+    return type;
+}
+
+// Returns the identifier of the sprite.
+Uint32 Sprite::GetId() {
+    return id;
+}
+
+// Sets the identifier of the sprite.
+void Sprite::SetId(Uint32 id) {
+    this->id = id;
+}
+
+// Returns the dynamic state of the sprite.
+const Sprite::State& Sprite::GetState() {
+    return state;
+}
+
+// Copies the dynamic state into the sprite.
+void Sprite::SetState(const State& state) {
+    this->state = state;
+}
+
 // Sets a flag that indicates that the sprite will be removed.
 void Sprite::SetIsRemoved(bool is_removed) {
-    this->is_removed = true;
+    state.is_removed = true;
 }
 
 // Returns the flag that indicate if the sprite is marked for removal or not.
 bool Sprite::GetIsRemoved() {
-    return is_removed;
+    return state.is_removed;
 }
 
 // Sets the flag that indicates that the sprite is visible.
 void Sprite::SetIsVisible(bool is_visible) {
-    this->is_visible = is_visible;
+    state.is_visible = is_visible;
 }
 
 // Returns the flag that indicates if the sprite is visible or not.
 bool Sprite::GetIsVisible() {
-    return is_visible;
+    return state.is_visible;
+}
+
+// Sets the layer of the sprite.
+void Sprite::SetLayer(int layer) {
+    state.layer = layer;
+}
+
+// Returns the layer of the sprite.
+int Sprite::GetLayer() {
+    return state.layer;
 }
 
 // Delegates an event to the correct handler.
 void Sprite::DelegateEvent(SDL_Event& event) {
+    TRACE_ZONE("Sprite::DelegateEvent");
     if (event.type == SDL_MOUSEMOTION || event.type == SDL_MOUSEBUTTONDOWN || event.type == SDL_MOUSEBUTTONUP || event.type == SDL_MOUSEWHEEL) {
         HandleEvent(event, true);
     } else if (event.type == Engine::GetTimeEventType()) {
@@ -99,18 +154,26 @@ void Sprite::DelegateEvent(SDL_Event& event) {
 // This is done by checking that the event source corresponds to the key or button registererd for the listner.
 // For mouse events, the position of the mouse coursor is checked if inside the sprite boundary as well before
 // calling the event listener.
+// The number of listeners called is added to the metrics of the window, and the listeners are timed if the window has a listener profiler.
 void Sprite::HandleEvent(SDL_Event& event, bool mouse_event) {
-    for (std::pair<const int, std::function<void(SDL_Event&, Sprite*)>>& entry : event_listeners) {
+    TRACE_ZONE("Sprite::HandleEvent");
+    int invocations = 0;
+    ListenerProfiler* profiler = window != nullptr ? window->GetListenerProfiler() : nullptr;
+    for (std::pair<const int, NamedListener<std::function<void(SDL_Event&, Sprite*)>>>& entry : event_listeners) {
         if (mouse_event && entry.first == event.type) {
             if (Contains(event.button.x, event.button.y)) {
-                entry.second(event, this);
+                ListenerProfiler::Call(profiler, entry.second, event, this);
+                invocations++;
             }
         } else if (!mouse_event && entry.first == event.key.keysym.sym) {
-            entry.second(event, this);
+            ListenerProfiler::Call(profiler, entry.second, event, this);
+            invocations++;
         } else if (entry.first == event.type) { // Other types of events (text input...)
-            entry.second(event, this);
+            ListenerProfiler::Call(profiler, entry.second, event, this);
+            invocations++;
         }
     }
+    CountListenerInvocations(invocations);
 }
 
 // Iterates through each time listener and evaluates if the time listener should be called.
@@ -119,24 +182,37 @@ void Sprite::HandleEvent(SDL_Event& event, bool mouse_event) {
 // if the current fps is set to 30 and the delay for a time event listener is set to 60. Then that specific time event listener
 // should be called every second main event loop iteration.
 void Sprite::HandleTime(SDL_Event& event) {
-    for (std::pair<const int, std::function<void(Sprite*)>>& entry : time_listeners) {
+    TRACE_ZONE("Sprite::HandleTime");
+    int invocations = 0;
+    ListenerProfiler* profiler = window != nullptr ? window->GetListenerProfiler() : nullptr;
+    for (std::pair<const int, NamedListener<std::function<void(Sprite*)>>>& entry : time_listeners) {
         int fps = *((int*)event.user.data1);
         int frame_counter = *((int*)event.user.data2);
         int rhs = (int)(round(((fps / 1000.0 ) * entry.first)));
         if (rhs > 0) {
             int result = frame_counter % rhs;
             if (result == 0) {
-                entry.second(this);
+                ListenerProfiler::Call(profiler, entry.second, this);
+                invocations++;
             }
         } else {
-            entry.second(this);
+            ListenerProfiler::Call(profiler, entry.second, this);
+            invocations++;
         }
     }
+    CountListenerInvocations(invocations);
+}
+
+// Adds the number of listeners called to the metrics of the window, if the sprite has been loaded into a window.
+void Sprite::CountListenerInvocations(int invocations) {
+    if (invocations > 0 && window != nullptr && window->GetMetrics() != nullptr) {
+        window->GetMetrics()->Add(Metrics::LISTENER_INVOCATIONS, invocations);
+    }
 }
 
 // Checks if any given x and y value are within the bounds of the sprite.
 bool Sprite::Contains(int x, int y) {
-    return x >= boundary.x && x <= (boundary.x + boundary.w) && y >= boundary.y && y <= (boundary.y + boundary.h);
+    return x >= state.boundary.x && x <= (state.boundary.x + state.boundary.w) && y >= state.boundary.y && y <= (state.boundary.y + state.boundary.h);
 }
 
 // Checks if any given sprite is within the bounds of this sprite.
@@ -153,27 +229,62 @@ bool Sprite::Contains(Sprite* other_sprite) {
             || Contains(lower_right.x, lower_right.y);
 }
 
-// Sets up the texture and loads the image used by the sprite.
-// If a texture is already present when this function is called, then that texture is first destroyed.
-// This is to enable change of texture after the sprite is created without leaking memory.
+// Sets up the texture used by the sprite by asking the window for a handle to the image.
+// The window loads the image when the handle is first requested (and throws there if it cannot), while the texture
+// itself is only created the first time it is rendered. Textures are shared between all sprites that use the same image.
 void Sprite::SetUpTexture() {
+    TRACE_ZONE("Sprite::SetUpTexture");
     if (file_name != "") {
-        if (texture != nullptr) {
-            SDL_DestroyTexture(texture);
-        }
-        SDL_Surface* surface = IMG_Load(file_name.c_str());
-        if (surface == nullptr) {
-            throw std::runtime_error("Failed to create sprite!");
-        } else {
-            texture = SDL_CreateTextureFromSurface(window->GetRenderer(), surface);
-            SDL_FreeSurface(surface);
-            if (texture == nullptr) {
-                throw std::runtime_error("Failed to create sprite!");
-            }
+        state.texture = window->GetImageTexture(file_name);
+    }
+}
+
+// Adds the boundary, flags, layer and texture of the sprite to the hash.
+void Sprite::HashState(StateHash& hash) {
+    TRACE_ZONE("Sprite::HashState");
+    hash.Add(state.boundary.x);
+    hash.Add(state.boundary.y);
+    hash.Add(state.boundary.w);
+    hash.Add(state.boundary.h);
+    hash.Add(state.is_removed);
+    hash.Add(state.is_visible);
+    hash.Add(state.layer);
+    hash.Add(state.texture);
+}
+
+// Does nothing by default, subclasses override this to change their state in each iteration of the main event loop.
+void Sprite::Update(int time_elapsed) {
+}
+
+// The base class does not change in Update.
+bool Sprite::GetIsAnimating() {
+    return false;
+}
+
+// Finds the next frame that is a multiple of the number of frames between calls of each time listener, as evaluated by HandleTime.
+int Sprite::GetNextTimeListenerFrame(int frame, int fps) {
+    int next_frame = -1;
+    for (std::pair<const int, NamedListener<std::function<void(Sprite*)>>>& entry : time_listeners) {
+        int rhs = (int)(round(((fps / 1000.0 ) * entry.first)));
+        int listener_frame = rhs > 0 ? frame + (rhs - frame % rhs) % rhs : frame;
+        if (next_frame == -1 || listener_frame < next_frame) {
+            next_frame = listener_frame;
         }
     }
+    return next_frame;
 }
 
+// Adds a draw command for the texture of the sprite covering the boundary of the sprite.
+void Sprite::Draw(DrawList& draw_list) {
+    if (state.texture != -1) {
+        draw_list.Add(state.texture, &state.boundary, state.layer);
+    }
+}
+
+// The texture is owned by the window and is not destroyed here.
+// Cancels the tasks tied to the lifetime of the sprite.
 Sprite::~Sprite() {
-    SDL_DestroyTexture(texture);
+    for (int i = 0; i < tasks.size(); i++) {
+        tasks[i].Cancel();
+    }
 }
\ No newline at end of file
@@ -6,25 +6,53 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <functional>
 #include <SDL2/SDL.h>
 #include <SDL2_image/SDL_image.h>
+#include "DrawList.h"
+#include "Task.h"
+#include "StateHash.h"
+#include "ListenerProfiler.h"
 
 class Window;
 
 // Root class for sprite class hierarchy. This class is not supposed to be instantiated directly.
 // Instead subclasses are used for different types of sprites.
 class Sprite {
-    
+
 public:
     
+    // The class of a sprite, which a level snapshot needs in order to create a sprite again (see Level::SaveSnapshot).
+    // Sprites of classes outside the engine are custom sprites, which cannot be created again.
+    enum Type {CUSTOM_SPRITE, STATIC_SPRITE, MOVING_SPRITE, ANIMATED_SPRITE, LABEL_SPRITE, TEXT_INPUT_SPRITE};
+    
+    // The dynamic state of a sprite, ie. everything about the sprite that changes while a level is played apart from the
+    // text of a text input sprite. It is kept in one plain struct so that a level snapshot saves and restores the state
+    // of a sprite with a single copy. The fields after the flags are only used by the subclass named in their comment.
+    struct State {
+        SDL_Rect boundary;
+        int texture;
+        int layer;
+        bool is_removed;
+        bool is_visible;
+        int dx, dy; // MovingSprite: the change in x and y in each iteration of the main event loop.
+        int image_index; // AnimatedSprite: the index of the next image.
+        double time_since_last_draw; // AnimatedSprite: the time since the image changed.
+    };
+    
     // Sets the window member variable.
     void SetWindow(Window* window);
-
-    // Adds an event listener to the sprite.
-    void AddEventListener(std::function<void(SDL_Event&, Sprite*)> listener, int key_code);
     
-    // Adds a time listener to the sprite with a delay specified in milliseconds.
-    void AddTimeListener(std::function<void(Sprite*)> listener, int delay);
+    // Adds an event listener to the sprite. The name is what the listener is reported as by the listener profiler
+    // (see ListenerProfiler), by default the tag of the sprite followed by the key code.
+    void AddEventListener(std::function<void(SDL_Event&, Sprite*)> listener, int key_code, std::string name = "");
+    
+    // Adds a time listener to the sprite with a delay specified in milliseconds. The name is what the listener is reported as
+    // by the listener profiler, by default the tag of the sprite followed by the delay.
+    void AddTimeListener(std::function<void(Sprite*)> listener, int delay, std::string name = "");
+    
+    // Ties the lifetime of a task to the sprite, the task is cancelled when the sprite is deleted (see Engine::RunAsync).
+    void AddTask(Task task);
     
     // Sets the X value of the upper right coordinate for the sprite.
     void SetX(int x);
@@ -40,12 +68,30 @@ public:
     
     // Returns the width of the sprite.
     int GetWidth();
-
+    
     // Returns the height of the sprite.
     int GetHeight();
     
     // Returns the tag of the sprite.
-    std::string GetTag();
+    const std::string& GetTag();
+    
+    // Returns the file name of the image shown for the sprite, or an empty string if the sprite shows no image file.
+    const std::string& GetFileName();
+    
+    // Returns the class of the sprite.
+    Type GetType();
+    
+    // Returns the identifier of the sprite, which is unique within the level the sprite is added to (see Level::AddSprite).
+    Uint32 GetId();
+    
+    // Sets the identifier of the sprite. Called by the level the sprite is added to.
+    void SetId(Uint32 id);
+    
+    // Returns the dynamic state of the sprite.
+    const State& GetState();
+    
+    // Replaces the dynamic state of the sprite, as when a level snapshot is restored.
+    void SetState(const State& state);
     
     // Sets a flag that indicates that the sprite will be removed.
     void SetIsRemoved(bool is_removed);
@@ -59,6 +105,12 @@ public:
     // Returns the flag that indicates if the sprite is visible or not.
     bool GetIsVisible();
     
+    // Sets the layer of the sprite. Sprites in a lower layer are drawn before sprites in a higher layer.
+    void SetLayer(int layer);
+    
+    // Returns the layer of the sprite.
+    int GetLayer();
+    
     // Delegates an event to the correct handler.
     void DelegateEvent(SDL_Event& event);
     
@@ -69,13 +121,30 @@ public:
     bool Contains(Sprite* sprite);
     
     // Sets up the texture used by the sprite.
-    void SetUpTexture();
+    virtual void SetUpTexture();
     
-    // Draws the sprite according to the behavior specified in the subclass.
-    virtual void Draw(int time_elapsed) = 0;
+    // Adds the dynamic state of the sprite (position, flags, texture etc.) to the specified hash.
+    // Subclasses with additional state override this and call the base class version first.
+    virtual void HashState(StateHash& hash);
     
-    virtual ~Sprite();
+    // Updates the state of the sprite (position, animation etc.) according to the behavior specified in the subclass.
+    // Called once in each iteration of the main event loop, before the sprite is drawn.
+    virtual void Update(int time_elapsed);
+    
+    // Returns true if Update changes the sprite, ie. if the sprite moves or animates by itself. Sprites that only change in
+    // their listeners are not animating, which lets the engine idle while nothing happens (see Engine::SetIdleThrottling).
+    virtual bool GetIsAnimating();
     
+    // Returns the first frame from the specified frame on in which a time listener of the sprite is called at the specified
+    // number of frames per second, or -1 if the sprite has no time listeners.
+    int GetNextTimeListenerFrame(int frame, int fps);
+    
+    // Adds the draw commands for the sprite to the specified draw list. Does not touch any SDL resources,
+    // the actual rendering is done by the window when the draw list is rendered.
+    virtual void Draw(DrawList& draw_list);
+    
+    virtual ~Sprite();
+
 protected:
     
     // Protected in order to guard against value semantics but still allows for creating subclasses.
@@ -84,15 +153,17 @@ protected:
     // The window to which the sprite is added.
     Window* window;
     
-    // The boundary for which the sprite is contained within.
-    SDL_Rect boundary;
-    
     // The file name for the image shown on screen for the sprite.
     std::string file_name;
     
-    // The texture for the image shown on screen for the sprite.
-    SDL_Texture* texture;
+    // The class of the sprite, set by the constructor of each subclass.
+    Type type;
     
+    // The dynamic state of the sprite: the boundary for which the sprite is contained within, the handle of the texture
+    // for the image shown on screen for the sprite (or -1 if there is no texture, the texture itself is owned by the window),
+    // the layer of the sprite, the removal and visibility flags and the fields of the subclasses.
+    State state;
+
 private:
     
     // Private in order to guard against value semantics.
@@ -107,22 +178,26 @@ private:
     // Internal helper function to which time events are delegated.
     void HandleTime(SDL_Event& event);
     
+    // Internal helper function that adds the number of listeners called to the metrics of the window.
+    void CountListenerInvocations(int invocations);
+    
     // Map containng all event listeners added for the sprite and the keycode for each listener.
-    std::map<int, std::function<void(SDL_Event&, Sprite*)>> event_listeners;
+    std::map<int, NamedListener<std::function<void(SDL_Event&, Sprite*)>>> event_listeners;
     
     // Map containng all time listeners added for the sprite and the delay for each listener.
-    std::map<int, std::function<void(Sprite*)>> time_listeners;
+    std::map<int, NamedListener<std::function<void(Sprite*)>>> time_listeners;
+    
+    // The tasks tied to the lifetime of the sprite.
+    std::vector<Task> tasks;
     
     // A tag added to the sprite which can be used when evaluating collisions.
     std::string tag;
     
-    // A flag to indicate if the sprite is marked for removal or not.
-    bool is_removed;
-    
-    // A flag to indicate if the sprite is visible or not.
-    bool is_visible;
-    
+    // The identifier of the sprite within its level.
+    Uint32 id;
     
+    // Gives the microbenchmarks access to the internal functions they measure.
+    friend class Microbenchmark;
 };
 
 #endif
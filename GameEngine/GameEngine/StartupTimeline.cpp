@@ -0,0 +1,68 @@
+#include <iomanip>
+#include <algorithm>
+#include "StartupTimeline.h"
+
+StartupTimeline::StartupTimeline():start_time(std::chrono::steady_clock::now()), main_thread(std::this_thread::get_id()) {
+}
+
+// Converts both ends of the phase to milliseconds since the start of the timeline.
+void StartupTimeline::Record(const std::string& name, std::chrono::steady_clock::time_point start_time) {
+    std::chrono::steady_clock::time_point stop_time = std::chrono::steady_clock::now();
+    Phase phase;
+    phase.name = name;
+    phase.start = std::chrono::duration<double, std::milli>(start_time - this->start_time).count();
+    phase.duration = std::chrono::duration<double, std::milli>(stop_time - start_time).count();
+    phase.thread = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lock(phases_mutex);
+    phases.push_back(phase);
+}
+
+// Records the phase unless the timeline is a null pointer.
+void StartupTimeline::Record(StartupTimeline* timeline, const std::string& name, std::chrono::steady_clock::time_point start_time) {
+    if (timeline != nullptr) {
+        timeline->Record(name, start_time);
+    }
+}
+
+// Returns a copy of the phases, since they may be recorded to while the copy is used.
+std::vector<StartupTimeline::Phase> StartupTimeline::GetPhases() {
+    std::lock_guard<std::mutex> lock(phases_mutex);
+    return phases;
+}
+
+// Returns the end of the last phase recorded with the name.
+double StartupTimeline::GetEndTime(const std::string& name) {
+    std::lock_guard<std::mutex> lock(phases_mutex);
+    for (int i = (int)phases.size() - 1; i >= 0; i--) {
+        if (phases[i].name == name) {
+            return phases[i].start + phases[i].duration;
+        }
+    }
+    return -1;
+}
+
+// Prints a table sorted by start time, where phases that ran at the same time on different threads overlap.
+void StartupTimeline::Print(std::ostream& out) {
+    std::vector<Phase> sorted_phases = GetPhases();
+    std::stable_sort(sorted_phases.begin(), sorted_phases.end(), [](const Phase& lhs, const Phase& rhs) {
+        return lhs.start < rhs.start;
+    });
+    std::vector<std::thread::id> threads;
+    out << "Startup timeline:" << std::endl;
+    out << "    " << std::left << std::setw(24) << "phase" << std::right << std::setw(10) << "start" << std::setw(10) << "time"
+        << "  thread" << std::endl;
+    for (int i = 0; i < sorted_phases.size(); i++) {
+        const Phase& phase = sorted_phases[i];
+        std::string thread = "main";
+        if (phase.thread != main_thread) {
+            int index = (int)(std::find(threads.begin(), threads.end(), phase.thread) - threads.begin());
+            if (index == threads.size()) {
+                threads.push_back(phase.thread);
+            }
+            thread = "worker " + std::to_string(index + 1);
+        }
+        out << "    " << std::left << std::setw(24) << phase.name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(7) << phase.start << " ms" << std::setw(7) << phase.duration << " ms  " << thread << std::endl;
+    }
+    out << std::defaultfloat;
+}
@@ -0,0 +1,65 @@
+#ifndef __GameEngine__StartupTimeline__
+#define __GameEngine__StartupTimeline__
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <thread>
+
+// Records the phases of starting up an engine (initializing SDL, creating the window, loading the font etc.) relative to
+// the time the timeline was created, together with the thread each phase ran on, so that slow or serialized phases show
+// up when the timeline is printed. Phases may be recorded from several threads at once.
+// The engine creates the timeline first thing in its constructor and records the time of the first rendered frame last
+// (see Engine::GetStartupTimeline). Debug builds print the timeline once the first frame has been rendered.
+class StartupTimeline {
+
+public:
+    
+    // A phase of the startup. Times are in milliseconds since the timeline was created.
+    struct Phase {
+        std::string name;
+        double start, duration;
+        std::thread::id thread;
+    };
+    
+    // Creates a new, empty timeline that starts now.
+    StartupTimeline();
+    
+    // Records a phase with the specified name that started at the specified time and ends now, on the calling thread.
+    void Record(const std::string& name, std::chrono::steady_clock::time_point start_time);
+    
+    // Records a phase as above if the timeline is not a null pointer, so that optional timelines are recorded with one call.
+    static void Record(StartupTimeline* timeline, const std::string& name, std::chrono::steady_clock::time_point start_time);
+    
+    // Returns the phases recorded so far, in the order they ended.
+    std::vector<Phase> GetPhases();
+    
+    // Returns the time (in milliseconds since the timeline was created) at which the named phase ended, or -1 if it has not been recorded.
+    double GetEndTime(const std::string& name);
+    
+    // Prints the phases in the order they started, with the time each started and took and the thread it ran on. The thread
+    // that created the timeline is printed as "main" and other threads are numbered in the order they first recorded a phase.
+    void Print(std::ostream& out);
+
+private:
+    
+    // Private in order to guard against value semantics.
+    StartupTimeline(const StartupTimeline& other_timeline);
+    
+    // Private in order to guard against value semantics.
+    const StartupTimeline& operator=(const StartupTimeline& other_timeline);
+    
+    // The time the timeline was created, and the thread that created it.
+    std::chrono::steady_clock::time_point start_time;
+    std::thread::id main_thread;
+    
+    // The phases recorded so far.
+    std::vector<Phase> phases;
+    
+    // Guards the phases, which are recorded from several threads.
+    std::mutex phases_mutex;
+};
+
+#endif
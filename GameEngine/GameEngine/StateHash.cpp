@@ -0,0 +1,37 @@
+#include "StateHash.h"
+
+// The FNV-1a offset basis and prime for 64 bit hashes.
+static const Uint64 FNV_OFFSET_BASIS = 14695981039346656037ULL;
+static const Uint64 FNV_PRIME = 1099511628211ULL;
+
+StateHash::StateHash(Uint64 seed):value(FNV_OFFSET_BASIS ^ seed) {
+}
+
+// Adds an integer value to the hash, one byte at a time starting with the least significant byte so that the hash is the
+// same on all platforms.
+void StateHash::Add(Sint64 value) {
+    unsigned char bytes[8];
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = (unsigned char)(((Uint64)value >> (i * 8)) & 0xff);
+    }
+    AddBytes(bytes, 8);
+}
+
+// Adds the length and the characters of a string to the hash.
+void StateHash::Add(const std::string& value) {
+    Add((Sint64)value.size());
+    AddBytes((const unsigned char*)value.data(), value.size());
+}
+
+// Returns the current value of the hash.
+Uint64 StateHash::GetValue() {
+    return value;
+}
+
+// Adds a sequence of bytes to the hash.
+void StateHash::AddBytes(const unsigned char* bytes, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        value ^= bytes[i];
+        value *= FNV_PRIME;
+    }
+}
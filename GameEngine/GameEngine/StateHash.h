@@ -0,0 +1,34 @@
+#ifndef __GameEngine__StateHash__
+#define __GameEngine__StateHash__
+
+#include <string>
+#include <SDL2/SDL.h>
+
+// A cheap 64 bit hash (FNV-1a) used to fingerprint the state of the simulation in each frame.
+// Values are added one at a time, and the order in which they are added matters.
+class StateHash {
+
+public:
+    
+    // Creates a new hash, starting from the specified value (for example the hash of the previous frame).
+    StateHash(Uint64 seed);
+    
+    // Adds an integer value to the hash.
+    void Add(Sint64 value);
+    
+    // Adds a string to the hash.
+    void Add(const std::string& value);
+    
+    // Returns the current value of the hash.
+    Uint64 GetValue();
+
+private:
+    
+    // Internal helper function that adds a sequence of bytes to the hash.
+    void AddBytes(const unsigned char* bytes, size_t length);
+    
+    // The current value of the hash.
+    Uint64 value;
+};
+
+#endif
@@ -5,20 +5,22 @@
 
 // Factory function to control object creation.
 StaticSprite* StaticSprite::GetInstance(std::string tag, std::string file_name, int x_pos, int y_pos, int width, int height) {
-    return new StaticSprite(tag, file_name, x_pos, y_pos, width, height);
+    return new StaticSprite(std::move(tag), std::move(file_name), x_pos, y_pos, width, height);
 }
 
-StaticSprite::StaticSprite(std::string tag, std::string file_name, int x_pos, int y_pos, int width, int height):Sprite(tag, x_pos, y_pos, width, height, file_name) {
-    
+StaticSprite::StaticSprite(std::string tag, std::string file_name, int x_pos, int y_pos, int width, int height):Sprite(std::move(tag), x_pos, y_pos, width, height, std::move(file_name)) {
+    type = STATIC_SPRITE;
 }
 
 // Draws a static image representing the sprite.
-void StaticSprite::Draw(int time_elapsed) {
-    if (boundary.w != 0 && boundary.h != 0) {
-        SDL_RenderCopy(window->GetRenderer(), texture, NULL, &boundary);
-
-    } else {
-        SDL_RenderCopy(window->GetRenderer(), texture, NULL, NULL);
+// A sprite without width or height covers the whole window.
+void StaticSprite::Draw(DrawList& draw_list) {
+    if (state.texture != -1) {
+        if (state.boundary.w != 0 && state.boundary.h != 0) {
+            draw_list.Add(state.texture, &state.boundary, state.layer);
+        } else {
+            draw_list.Add(state.texture, nullptr, state.layer);
+        }
     }
 }
 
@@ -15,7 +15,7 @@ public:
     static StaticSprite* GetInstance(std::string tag, std::string file_name, int x_pos, int y_pos, int width, int height);
     
     // Draws a static image representing the sprite.
-    virtual void Draw(int time_elapsed);
+    virtual void Draw(DrawList& draw_list);
     
     virtual ~StaticSprite();
 private:
@@ -0,0 +1,24 @@
+#include "Task.h"
+
+Task::Task() {
+}
+
+Task::Task(std::shared_ptr<State> state):state(state) {
+}
+
+// Cancels the task by setting the shared cancellation flag, which is checked before the work starts and before the continuation is called.
+void Task::Cancel() {
+    if (state) {
+        state->is_cancelled = true;
+    }
+}
+
+// Returns true if the task has been cancelled.
+bool Task::IsCancelled() {
+    return state && state->is_cancelled;
+}
+
+// Returns true if the task has finished.
+bool Task::IsDone() {
+    return !state || state->is_done;
+}
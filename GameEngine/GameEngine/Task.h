@@ -0,0 +1,46 @@
+#ifndef __GameEngine__Task__
+#define __GameEngine__Task__
+
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <exception>
+
+// A handle to a task launched with Engine::RunAsync. Copies of a task refer to the same task.
+// Cancelling a task that has not started skips its work, and cancelling a task that has not yet had its continuation
+// called means that the continuation is never called. The work itself is not interrupted if it is already running.
+class Task {
+
+public:
+    
+    // Creates an empty task handle that does not refer to any task.
+    Task();
+    
+    // Cancels the task.
+    void Cancel();
+    
+    // Returns true if the task has been cancelled.
+    bool IsCancelled();
+    
+    // Returns true if the task has finished, ie. its continuation has been called or it has been cancelled and finished its work.
+    bool IsDone();
+
+private:
+    
+    // The state shared between the task handles, the worker thread and the engine.
+    struct State {
+        std::function<void(void)> work, continuation;
+        std::atomic<bool> is_cancelled, is_done;
+        std::exception_ptr error;
+    };
+    
+    // Creates a task handle for the specified state.
+    Task(std::shared_ptr<State> state);
+    
+    // The state of the task.
+    std::shared_ptr<State> state;
+    
+    friend class TaskRunner;
+};
+
+#endif
@@ -0,0 +1,73 @@
+#include <algorithm>
+#include "TaskRunner.h"
+
+TaskRunner::TaskRunner(ThreadPool* thread_pool):thread_pool(thread_pool) {
+}
+
+// Launches a task by submitting its work to the thread pool. When the work is done (or skipped because the task was cancelled),
+// the task is queued for RunContinuations.
+Task TaskRunner::Launch(std::function<void(void)> work, std::function<void(void)> continuation) {
+    std::shared_ptr<Task::State> state = std::make_shared<Task::State>();
+    state->work = work;
+    state->continuation = continuation;
+    state->is_cancelled = false;
+    state->is_done = false;
+    pending_tasks.push_back(state);
+    thread_pool->Submit([this, state] {
+        if (!state->is_cancelled) {
+            try {
+                state->work();
+            } catch (...) {
+                state->error = std::current_exception();
+            }
+        }
+        std::lock_guard<std::mutex> lock(finished_mutex);
+        finished_tasks.push_back(state);
+    });
+    return Task(state);
+}
+
+// Calls the continuations of the tasks that have finished their work. The finished tasks are taken in one go, so the lock is only
+// held for a swap and continuations are free to launch new tasks.
+void TaskRunner::RunContinuations() {
+    {
+        std::lock_guard<std::mutex> lock(finished_mutex);
+        continuing_tasks.swap(finished_tasks);
+    }
+    if (continuing_tasks.empty()) {
+        return;
+    }
+    std::exception_ptr error;
+    for (int i = 0; i < continuing_tasks.size(); i++) {
+        std::shared_ptr<Task::State> state = continuing_tasks[i];
+        if (state->error) {
+            if (!state->is_cancelled && !error) {
+                error = state->error;
+            }
+        } else if (!state->is_cancelled && state->continuation != nullptr) {
+            state->continuation();
+        }
+        state->work = nullptr;
+        state->continuation = nullptr;
+        state->is_done = true;
+    }
+    continuing_tasks.clear();
+    pending_tasks.erase(std::remove_if(pending_tasks.begin(), pending_tasks.end(), [](const std::shared_ptr<Task::State>& state) {
+        return (bool)state->is_done;
+    }), pending_tasks.end());
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// Cancels all tasks that have not finished yet.
+void TaskRunner::CancelAll() {
+    for (int i = 0; i < pending_tasks.size(); i++) {
+        pending_tasks[i]->is_cancelled = true;
+    }
+}
+
+// Returns the number of tasks that have not finished yet.
+int TaskRunner::GetPendingCount() {
+    return (int)pending_tasks.size();
+}
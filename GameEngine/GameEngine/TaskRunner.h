@@ -0,0 +1,58 @@
+#ifndef __GameEngine__TaskRunner__
+#define __GameEngine__TaskRunner__
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include "Task.h"
+#include "ThreadPool.h"
+
+// Runs the work of tasks on the worker threads of a thread pool and calls their continuations on the simulation thread.
+// Finished tasks are queued by the worker threads and their continuations are called the next time RunContinuations is called,
+// which means that the simulation never waits for a task.
+class TaskRunner {
+
+public:
+    
+    // Creates a new task runner that runs the work of tasks on the specified thread pool.
+    TaskRunner(ThreadPool* thread_pool);
+    
+    // Launches a task that runs the work on a worker thread and then calls the continuation from RunContinuations.
+    Task Launch(std::function<void(void)> work, std::function<void(void)> continuation);
+    
+    // Calls the continuations of all tasks that have finished their work since the last call, unless they have been cancelled.
+    // If the work of a task threw an exception, the exception is rethrown instead of calling the continuation.
+    void RunContinuations();
+    
+    // Cancels all tasks that have not finished yet.
+    void CancelAll();
+    
+    // Returns the number of tasks that have not finished yet.
+    int GetPendingCount();
+
+private:
+    
+    // Private in order to guard against value semantics.
+    TaskRunner(const TaskRunner& other_runner);
+    
+    // Private in order to guard against value semantics.
+    const TaskRunner& operator=(const TaskRunner& other_runner);
+    
+    // The thread pool used to run the work of tasks.
+    ThreadPool* thread_pool;
+    
+    // The tasks that have been launched but not finished.
+    std::vector<std::shared_ptr<Task::State>> pending_tasks;
+    
+    // The tasks whose work has finished, waiting for their continuations to be called.
+    std::vector<std::shared_ptr<Task::State>> finished_tasks;
+    
+    // The tasks whose continuations are being called.
+    std::vector<std::shared_ptr<Task::State>> continuing_tasks;
+    
+    // Guards the finished tasks, which are added to by the worker threads.
+    std::mutex finished_mutex;
+};
+
+#endif
@@ -0,0 +1,234 @@
+#include <sstream>
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "TelemetryServer.h"
+#include "AllocationCounter.h"
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+// A client closing the connection early must not kill the game with SIGPIPE. Linux has a flag for each send, while macOS
+// has an option for the socket (see Answer).
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// The time the thread waits for a connection before it checks if the server has been stopped.
+static const int ACCEPT_TIMEOUT = 100;
+
+// The longest request that is read, and the time a client has to send it.
+static const int MAX_REQUEST_SIZE = 4096;
+static const int REQUEST_TIMEOUT = 1;
+
+// Returns the resident memory of the process in bytes, or -1 where it is not available.
+static long GetResidentMemory() {
+#if defined(__APPLE__)
+    mach_task_basic_info_data_t info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+        return -1;
+    }
+    return (long)info.resident_size;
+#elif defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    long size = 0, resident = 0;
+    if (!(statm >> size >> resident)) {
+        return -1;
+    }
+    return resident * sysconf(_SC_PAGESIZE);
+#else
+    return -1;
+#endif
+}
+
+// Opens a socket on the loopback interface only, so that the metrics are not exposed to the network.
+TelemetryServer::TelemetryServer(int port):published_buffer(-1), port(port), request_count(0), is_stopped(false) {
+    buffers[0].sequence = 0;
+    buffers[1].sequence = 0;
+    server_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (server_socket < 0) {
+        throw std::runtime_error("Failed to create the telemetry socket!");
+    }
+    int is_reused = 1;
+    setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &is_reused, sizeof(is_reused));
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    socklen_t address_size = sizeof(address);
+    if (bind(server_socket, (sockaddr*)&address, sizeof(address)) < 0 || listen(server_socket, 8) < 0
+        || getsockname(server_socket, (sockaddr*)&address, &address_size) < 0) {
+        close(server_socket);
+        throw std::runtime_error("Failed to listen on telemetry port " + std::to_string(port) + "!");
+    }
+    this->port = ntohs(address.sin_port);
+    server_thread = std::thread(&TelemetryServer::Serve, this);
+}
+
+// Writes the snapshot to the buffer that was not published last. The sequence number of the buffer is odd while it is
+// written, which tells a reader copying the buffer at the same time that its copy is torn.
+void TelemetryServer::Publish(const Snapshot& snapshot) {
+    int index = published_buffer.load(std::memory_order_relaxed) == 0 ? 1 : 0;
+    Buffer& buffer = buffers[index];
+    buffer.sequence.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    buffer.snapshot = snapshot;
+    buffer.sequence.fetch_add(1, std::memory_order_release);
+    published_buffer.store(index, std::memory_order_release);
+}
+
+// Copies the published buffer, and copies it again if its sequence number shows that it was written in the meantime.
+bool TelemetryServer::GetSnapshot(Snapshot& snapshot) {
+    while (true) {
+        int index = published_buffer.load(std::memory_order_acquire);
+        if (index < 0) {
+            return false;
+        }
+        Buffer& buffer = buffers[index];
+        Uint32 sequence = buffer.sequence.load(std::memory_order_acquire);
+        if (sequence % 2 != 0) {
+            continue;
+        }
+        snapshot = buffer.snapshot;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (buffer.sequence.load(std::memory_order_relaxed) == sequence) {
+            return true;
+        }
+    }
+}
+
+// Returns the port the server listens on.
+int TelemetryServer::GetPort() {
+    return port;
+}
+
+// Returns the number of requests answered.
+long TelemetryServer::GetRequestCount() {
+    return request_count;
+}
+
+// Writes each value as a gauge or counter with a HELP and TYPE line, as expected by Prometheus.
+std::string TelemetryServer::Format(const Snapshot& snapshot) {
+    std::ostringstream out;
+    out << "# HELP gameengine_frames_total Frames simulated.\n# TYPE gameengine_frames_total counter\n";
+    out << "gameengine_frames_total " << snapshot.frame << "\n";
+    out << "# HELP gameengine_fps Target frames per second.\n# TYPE gameengine_fps gauge\n";
+    out << "gameengine_fps " << snapshot.fps << "\n";
+    out << "# HELP gameengine_hitches_total Frames slower than the hitch threshold.\n# TYPE gameengine_hitches_total counter\n";
+    out << "gameengine_hitches_total " << snapshot.hitches << "\n";
+    out << "# HELP gameengine_frame_time_ms Frame time percentiles since the start.\n# TYPE gameengine_frame_time_ms gauge\n";
+    out << "gameengine_frame_time_ms{quantile=\"0.5\"} " << snapshot.frame_time_p50 << "\n";
+    out << "gameengine_frame_time_ms{quantile=\"0.9\"} " << snapshot.frame_time_p90 << "\n";
+    out << "gameengine_frame_time_ms{quantile=\"0.99\"} " << snapshot.frame_time_p99 << "\n";
+    out << "gameengine_frame_time_ms{quantile=\"1\"} " << snapshot.frame_time_max << "\n";
+    out << "# HELP gameengine_frame_time_mean_ms Mean frame time since the start.\n# TYPE gameengine_frame_time_mean_ms gauge\n";
+    out << "gameengine_frame_time_mean_ms " << snapshot.frame_time_mean << "\n";
+    for (int i = 0; i < Metrics::COUNTER_COUNT; i++) {
+        std::string name = "gameengine_" + Metrics::GetCounterName((Metrics::Counter)i);
+        out << "# HELP " << name << " Value of the counter in the last frame.\n# TYPE " << name << " gauge\n";
+        out << name << " " << snapshot.counters[i] << "\n";
+    }
+    out << "# HELP gameengine_level_sprites Sprites in each level.\n# TYPE gameengine_level_sprites gauge\n";
+    for (int i = 0; i < snapshot.level_count; i++) {
+        out << "gameengine_level_sprites{level=\"" << i << "\"} " << snapshot.level_sprite_counts[i] << "\n";
+    }
+    out << "# HELP gameengine_tag_sprites Sprites with each tag in the current level.\n# TYPE gameengine_tag_sprites gauge\n";
+    for (int i = 0; i < snapshot.tag_count; i++) {
+        out << "gameengine_tag_sprites{tag=\"";
+        for (const char* c = snapshot.tags[i]; *c != '\0'; c++) {
+            if (*c == '"' || *c == '\\') {
+                out << '\\';
+            }
+            out << *c;
+        }
+        out << "\"} " << snapshot.tag_sprite_counts[i] << "\n";
+    }
+    return out.str();
+}
+
+// Waits for connections with a timeout, so that a stopped server is noticed within ACCEPT_TIMEOUT milliseconds.
+void TelemetryServer::Serve() {
+    while (!is_stopped) {
+        pollfd server_poll;
+        server_poll.fd = server_socket;
+        server_poll.events = POLLIN;
+        if (poll(&server_poll, 1, ACCEPT_TIMEOUT) <= 0) {
+            continue;
+        }
+        int connection = accept(server_socket, nullptr, nullptr);
+        if (connection >= 0) {
+            Answer(connection);
+            close(connection);
+        }
+    }
+}
+
+// Reads the request line and the headers, and answers GET /metrics (or /) with the snapshot followed by the metrics of
+// the process. Anything else is answered with 404. The connection is closed after the answer (HTTP/1.0).
+void TelemetryServer::Answer(int connection) {
+    timeval timeout;
+    timeout.tv_sec = REQUEST_TIMEOUT;
+    timeout.tv_usec = 0;
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+    int is_nosigpipe = 1;
+    setsockopt(connection, SOL_SOCKET, SO_NOSIGPIPE, &is_nosigpipe, sizeof(is_nosigpipe));
+#endif
+    std::string request;
+    char data[512];
+    while (request.size() < MAX_REQUEST_SIZE && request.find("\r\n\r\n") == std::string::npos) {
+        ssize_t size = recv(connection, data, sizeof(data), 0);
+        if (size <= 0) {
+            break;
+        }
+        request.append(data, size);
+    }
+    std::string status = "200 OK";
+    std::string body;
+    if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0) {
+        Snapshot snapshot;
+        if (GetSnapshot(snapshot)) {
+            body = Format(snapshot);
+        }
+        body += "# HELP gameengine_allocations_total Heap allocations of the process.\n# TYPE gameengine_allocations_total counter\n";
+        body += "gameengine_allocations_total " + std::to_string(AllocationCounter::GetAllocationCount()) + "\n";
+        body += "# HELP gameengine_allocated_bytes_total Bytes allocated by the process.\n# TYPE gameengine_allocated_bytes_total counter\n";
+        body += "gameengine_allocated_bytes_total " + std::to_string(AllocationCounter::GetAllocatedBytes()) + "\n";
+        long resident_memory = GetResidentMemory();
+        if (resident_memory >= 0) {
+            body += "# HELP process_resident_memory_bytes Resident memory of the process.\n# TYPE process_resident_memory_bytes gauge\n";
+            body += "process_resident_memory_bytes " + std::to_string(resident_memory) + "\n";
+        }
+    } else {
+        status = "404 Not Found";
+        body = "Not found, the metrics are served at /metrics.\n";
+    }
+    std::string response = "HTTP/1.0 " + status + "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+                           + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t size = send(connection, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (size <= 0) {
+            break;
+        }
+        sent += size;
+    }
+    request_count++;
+}
+
+TelemetryServer::~TelemetryServer() {
+    is_stopped = true;
+    if (server_thread.joinable()) {
+        server_thread.join();
+    }
+    close(server_socket);
+}
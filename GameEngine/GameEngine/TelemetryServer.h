@@ -0,0 +1,97 @@
+#ifndef __GameEngine__TelemetryServer__
+#define __GameEngine__TelemetryServer__
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <SDL2/SDL.h>
+#include "Metrics.h"
+
+// Serves live metrics of an engine over HTTP on a localhost TCP port, so that a long running game can be watched (for
+// example scraped by Prometheus) without touching the game itself. Each request for /metrics is answered with the latest
+// snapshot in the Prometheus text format, together with the allocations and the resident memory of the whole process.
+// The engine publishes snapshots (see Publish) and the server answers requests on a background thread. The snapshot is
+// double buffered with a sequence number in each buffer: publishing writes the buffer that was not published last and
+// never waits, and a reader that finds the buffer being written while it copies it simply copies it again.
+class TelemetryServer {
+
+public:
+    
+    // The number of levels and tags that a snapshot has room for. Further levels and tags are left out.
+    static constexpr int MAX_LEVELS = 8;
+    static constexpr int MAX_TAGS = 16;
+    
+    // The metrics of the engine at the end of a frame. Times are in milliseconds. The snapshot is a plain structure of
+    // fixed size, so that it can be copied between the buffers without allocating.
+    struct Snapshot {
+        long frame;
+        int fps;
+        long hitches;
+        double frame_time_mean, frame_time_p50, frame_time_p90, frame_time_p99, frame_time_max;
+        long counters[Metrics::COUNTER_COUNT];
+        int level_count;
+        int level_sprite_counts[MAX_LEVELS];
+        int tag_count;
+        char tags[MAX_TAGS][32];
+        int tag_sprite_counts[MAX_TAGS];
+    };
+    
+    // Creates a new server listening on the specified port of 127.0.0.1 and starts its thread. If the port is 0, a free
+    // port is chosen (see GetPort). Throws if the port cannot be listened on.
+    TelemetryServer(int port);
+    
+    // Publishes a snapshot, which is served until the next one is published. Must only be called from one thread at a time.
+    void Publish(const Snapshot& snapshot);
+    
+    // Copies the latest snapshot. Returns false if no snapshot has been published yet.
+    bool GetSnapshot(Snapshot& snapshot);
+    
+    // Returns the port the server listens on.
+    int GetPort();
+    
+    // Returns the number of requests answered so far.
+    long GetRequestCount();
+    
+    // Formats a snapshot in the Prometheus text format.
+    static std::string Format(const Snapshot& snapshot);
+    
+    // Stops the thread and closes the port.
+    ~TelemetryServer();
+
+private:
+    
+    // A snapshot together with its sequence number, which is odd while the snapshot is being written.
+    struct Buffer {
+        std::atomic<Uint32> sequence;
+        Snapshot snapshot;
+    };
+    
+    // Private in order to guard against value semantics.
+    TelemetryServer(const TelemetryServer& other_server);
+    
+    // Private in order to guard against value semantics.
+    const TelemetryServer& operator=(const TelemetryServer& other_server);
+    
+    // Internal helper function run by the thread, which accepts and answers requests until the server is stopped.
+    void Serve();
+    
+    // Internal helper function that reads a request from a connection and answers it.
+    void Answer(int connection);
+    
+    // The two buffers, and the index of the one published last (or -1 if none has been published).
+    Buffer buffers[2];
+    std::atomic<int> published_buffer;
+    
+    // The listening socket and its port.
+    int server_socket;
+    int port;
+    
+    // The number of requests answered.
+    std::atomic<long> request_count;
+    
+    // A flag to stop the thread, and the thread itself.
+    std::atomic<bool> is_stopped;
+    std::thread server_thread;
+};
+
+#endif
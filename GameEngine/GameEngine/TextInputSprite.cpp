@@ -6,33 +6,50 @@ TextInputSprite* TextInputSprite::GetInstance(std::string tag, int x_pos, int y_
 }
 
 TextInputSprite::TextInputSprite(std::string tag, int x_pos, int y_pos):Sprite(tag, x_pos, y_pos, 12, 50, "") {
+    type = TEXT_INPUT_SPRITE;
     std::function<void(SDL_Event&, Sprite*)> text_input_handler_function = std::bind(&TextInputSprite::HandleTextInput, this, std::placeholders::_1);
     AddEventListener(text_input_handler_function, SDL_TEXTINPUT);
 }
 
 // Returns the current text entered.
-std::string TextInputSprite::GetText() {
+const std::string& TextInputSprite::GetText() {
     return text;
 }
 
-void TextInputSprite::Draw(int time_elapsed) {
-    SDL_RenderCopy(window->GetRenderer(), texture, NULL, &boundary);
+// Replaces the text and sets up the texture for it.
+void TextInputSprite::SetText(const std::string& text) {
+    this->text = text;
+    SetUpTexture();
+}
+
+// Sets up the texture for the text entered so far by asking the window for a handle to the rendered text.
+void TextInputSprite::SetUpTexture() {
+    if (window != nullptr && text != "") {
+        state.texture = window->GetTextTexture(text);
+    }
+}
+
+// Draws the text entered so far, setting up the texture again if the window has reclaimed it while the sprite was not drawn.
+void TextInputSprite::Draw(DrawList& draw_list) {
+    if (text != "" && !window->TouchTextTexture(state.texture)) {
+        SetUpTexture();
+    }
+    Sprite::Draw(draw_list);
+}
+
+// Adds the state of the sprite, including the text entered so far, to the hash.
+void TextInputSprite::HashState(StateHash& hash) {
+    Sprite::HashState(hash);
+    hash.Add(text);
 }
 
 void TextInputSprite::HandleTextInput(SDL_Event& event) {
-    boundary.w = boundary.w  + 25;
-    boundary.x = boundary.x - 12;
+    state.boundary.w = state.boundary.w  + 25;
+    state.boundary.x = state.boundary.x - 12;
     
     text += event.text.text;
     
-    if (window->GetRenderer() != nullptr) {
-        SDL_Color white = { 255, 255, 255 };
-        SDL_DestroyTexture(texture);
-        SDL_Surface* text_surface = TTF_RenderText_Solid(window->GetFont(), text.c_str(), white);
-        texture = SDL_CreateTextureFromSurface(window->GetRenderer(), text_surface);
-        SDL_FreeSurface(text_surface);
-    }
-    
+    SetUpTexture();
 }
 
 TextInputSprite::~TextInputSprite() {
@@ -9,17 +9,27 @@
 
 // Class to represent text input sprites.
 class TextInputSprite : public Sprite {
-    
+
 public:
     
     // Factory function to control object creation.
     static TextInputSprite* GetInstance(std::string tag, int x_pos, int y_pos);
     
     // Returns the current text entered.
-    std::string GetText();
+    const std::string& GetText();
+    
+    // Replaces the text entered so far, as when a level snapshot is restored. The boundary is not changed, since it is
+    // part of the state of the sprite (see Sprite::SetState).
+    void SetText(const std::string& text);
+    
+    // Sets up the texture for the text entered so far.
+    virtual void SetUpTexture();
     
-    // Draws a static image representing the sprite.
-    virtual void Draw(int);
+    // Draws the text entered so far.
+    virtual void Draw(DrawList& draw_list);
+    
+    // Adds the state of the sprite, including the text entered so far, to the hash.
+    virtual void HashState(StateHash& hash);
     
     virtual ~TextInputSprite();
 private:
@@ -34,6 +44,6 @@ private:
     
     // The current text of the input field.
     std::string text;
-    
+
 };
 #endif
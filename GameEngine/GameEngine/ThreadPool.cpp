@@ -0,0 +1,59 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int thread_count):is_stopped(false) {
+    if (thread_count < 1) {
+        thread_count = 1;
+    }
+    for (int i = 0; i < thread_count; i++) {
+        threads.push_back(std::thread(&ThreadPool::RunWorker, this));
+    }
+}
+
+// Queues a task and wakes up one of the worker threads.
+void ThreadPool::Submit(std::function<void(void)> task) {
+    {
+        std::lock_guard<std::mutex> lock(task_mutex);
+        tasks.push_back(task);
+    }
+    task_condition.notify_one();
+}
+
+// Returns the number of worker threads in the pool.
+int ThreadPool::GetThreadCount() {
+    return (int)threads.size();
+}
+
+// Returns the number of hardware threads minus one, leaving one hardware thread for the thread that submits the tasks.
+int ThreadPool::GetDefaultThreadCount() {
+    int hardware_threads = (int)std::thread::hardware_concurrency();
+    return hardware_threads > 1 ? hardware_threads - 1 : 1;
+}
+
+// Waits for tasks and executes them one at a time until the pool is stopped and the queue is empty.
+void ThreadPool::RunWorker() {
+    while (true) {
+        std::function<void(void)> task;
+        {
+            std::unique_lock<std::mutex> lock(task_mutex);
+            task_condition.wait(lock, [this] { return is_stopped || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;
+            }
+            task = tasks.front();
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+// Stops the pool and waits for all worker threads to terminate.
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(task_mutex);
+        is_stopped = true;
+    }
+    task_condition.notify_all();
+    for (int i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+}
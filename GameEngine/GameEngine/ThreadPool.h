@@ -0,0 +1,58 @@
+#ifndef __GameEngine__ThreadPool__
+#define __GameEngine__ThreadPool__
+
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// A fixed set of worker threads that execute submitted tasks in the order they were submitted.
+class ThreadPool {
+
+public:
+    
+    // Creates a new thread pool and starts the specified number of worker threads (at least one).
+    ThreadPool(int thread_count);
+    
+    // Queues a task to be executed by one of the worker threads.
+    void Submit(std::function<void(void)> task);
+    
+    // Returns the number of worker threads in the pool.
+    int GetThreadCount();
+    
+    // Returns a suitable number of worker threads for the machine (the number of hardware threads minus one, at least one).
+    static int GetDefaultThreadCount();
+    
+    // Lets the worker threads finish the tasks already queued and then stops them.
+    ~ThreadPool();
+
+private:
+    
+    // Private in order to guard against value semantics.
+    ThreadPool(const ThreadPool& other_pool);
+    
+    // Private in order to guard against value semantics.
+    const ThreadPool& operator=(const ThreadPool& other_pool);
+    
+    // Entry point of each worker thread. Executes queued tasks until the pool is stopped.
+    void RunWorker();
+    
+    // The worker threads.
+    std::vector<std::thread> threads;
+    
+    // The tasks waiting to be executed.
+    std::deque<std::function<void(void)>> tasks;
+    
+    // Guards the task queue.
+    std::mutex task_mutex;
+    
+    // Signals that a task has been queued or that the pool is stopped.
+    std::condition_variable task_condition;
+    
+    // A flag to indicate that the pool is stopped.
+    bool is_stopped;
+};
+
+#endif
@@ -0,0 +1,233 @@
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <stdexcept>
+#include "Trace.h"
+
+// The number of events in the ring buffer of each thread. Must be a power of two. At 16 bytes per event this is 4 MB per
+// thread, which holds a few hundred frames worth of zones, enough for a headless replay between two drains of the collector.
+static const Uint32 BUFFER_CAPACITY = 1 << 18;
+
+// The time the collector thread sleeps between draining the ring buffers.
+static const std::chrono::milliseconds DRAIN_INTERVAL(2);
+
+// The version of the trace file format.
+static const Uint8 TRACE_VERSION = 1;
+
+// An event in a ring buffer: the time in nanoseconds since the trace started and the zone id shifted left by one, with the
+// lowest bit set for leaving the zone.
+struct TraceEvent {
+    Uint64 time;
+    Uint32 zone;
+};
+
+// The ring buffer of a thread. Only the thread writes events and moves the head, and only the collector reads events and
+// moves the tail, so the two only need to agree on the head and the tail.
+struct ThreadBuffer {
+    TraceEvent events[BUFFER_CAPACITY];
+    std::atomic<Uint32> head, tail;
+    std::atomic<long> dropped_count;
+    Uint64 last_written_time;
+    int index;
+};
+
+// The ring buffers of all threads that have recorded an event. The buffers are never freed, since a thread may exit at any
+// time and the collector may still have events of it to drain.
+static std::vector<std::unique_ptr<ThreadBuffer>> thread_buffers;
+static std::mutex thread_buffers_mutex;
+
+// The ring buffer of the calling thread, or a null pointer if the thread has not recorded an event yet.
+static thread_local ThreadBuffer* thread_buffer = nullptr;
+
+// The names of the registered zones, indexed by id, and the number of them that have been written to the trace file.
+static std::vector<std::string> zone_names;
+static int written_zone_count = 0;
+static std::mutex zone_names_mutex;
+
+// A flag to indicate if a trace is running, and the time it started.
+static std::atomic<bool> is_tracing(false);
+static std::chrono::steady_clock::time_point start_time;
+
+// The trace file and the collector thread that writes to it.
+static std::ofstream trace_file;
+static std::thread collector;
+static bool is_stopping = false;
+static std::mutex collector_mutex;
+static std::condition_variable collector_condition;
+
+// Writes a number to the trace file with seven bits in each byte.
+static void WriteCount(Uint64 value) {
+    while (value >= 0x80) {
+        trace_file.put((char)((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    trace_file.put((char)value);
+}
+
+// Returns the ring buffer of the calling thread, creating and registering it the first time.
+static ThreadBuffer* GetThreadBuffer() {
+    if (thread_buffer == nullptr) {
+        std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+        buffer->head = 0;
+        buffer->tail = 0;
+        buffer->dropped_count = 0;
+        buffer->last_written_time = 0;
+        std::lock_guard<std::mutex> lock(thread_buffers_mutex);
+        buffer->index = (int)thread_buffers.size();
+        thread_buffer = buffer.get();
+        thread_buffers.push_back(std::move(buffer));
+    }
+    return thread_buffer;
+}
+
+// Adds an event to the ring buffer of the calling thread. Returns false and counts the event as dropped if the buffer is full.
+static bool Record(Uint32 zone) {
+    Uint64 time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count();
+    ThreadBuffer* buffer = GetThreadBuffer();
+    Uint32 head = buffer->head.load(std::memory_order_relaxed);
+    if (head - buffer->tail.load(std::memory_order_acquire) == BUFFER_CAPACITY) {
+        buffer->dropped_count.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    TraceEvent& event = buffer->events[head & (BUFFER_CAPACITY - 1)];
+    event.time = time;
+    event.zone = zone;
+    buffer->head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+// Drains the ring buffers of all threads into the trace file. The events are taken out of each buffer before the zone names
+// are written, so that every zone an event refers to has been registered (zones are registered before they are entered)
+// and its name is written before the event.
+static void Drain() {
+    std::vector<ThreadBuffer*> buffers;
+    {
+        std::lock_guard<std::mutex> lock(thread_buffers_mutex);
+        for (int i = 0; i < thread_buffers.size(); i++) {
+            buffers.push_back(thread_buffers[i].get());
+        }
+    }
+    std::vector<Uint32> heads;
+    for (int i = 0; i < buffers.size(); i++) {
+        heads.push_back(buffers[i]->head.load(std::memory_order_acquire));
+    }
+    {
+        std::lock_guard<std::mutex> lock(zone_names_mutex);
+        for (; written_zone_count < zone_names.size(); written_zone_count++) {
+            trace_file.put(Trace::ZONE_RECORD);
+            WriteCount(written_zone_count);
+            WriteCount(zone_names[written_zone_count].size());
+            trace_file.write(zone_names[written_zone_count].data(), zone_names[written_zone_count].size());
+        }
+    }
+    for (int i = 0; i < buffers.size(); i++) {
+        ThreadBuffer* buffer = buffers[i];
+        Uint32 tail = buffer->tail.load(std::memory_order_relaxed);
+        if (heads[i] != tail) {
+            trace_file.put(Trace::EVENTS_RECORD);
+            WriteCount(buffer->index);
+            WriteCount(heads[i] - tail);
+            for (; tail != heads[i]; tail++) {
+                const TraceEvent& event = buffer->events[tail & (BUFFER_CAPACITY - 1)];
+                WriteCount(event.time >= buffer->last_written_time ? event.time - buffer->last_written_time : 0);
+                WriteCount(event.zone);
+                buffer->last_written_time = event.time;
+            }
+            buffer->tail.store(tail, std::memory_order_release);
+        }
+        long dropped = buffer->dropped_count.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0) {
+            trace_file.put(Trace::DROPPED_RECORD);
+            WriteCount(buffer->index);
+            WriteCount(dropped);
+        }
+    }
+}
+
+// The loop of the collector thread, which drains the ring buffers until the trace is stopped.
+static void Collect() {
+    std::unique_lock<std::mutex> lock(collector_mutex);
+    while (!is_stopping) {
+        collector_condition.wait_for(lock, DRAIN_INTERVAL);
+        Drain();
+    }
+}
+
+// Opens the file, writes the header and starts the collector thread. Events left in the ring buffers from an earlier trace
+// are skipped, and the times of the threads start over.
+void Trace::Start(std::string path) {
+    if (is_tracing) {
+        throw std::runtime_error("A trace is already running.");
+    }
+    trace_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!trace_file) {
+        throw std::runtime_error("Could not open the trace file " + path + ".");
+    }
+    trace_file.write("GETR", 4);
+    trace_file.put(TRACE_VERSION);
+    {
+        std::lock_guard<std::mutex> lock(thread_buffers_mutex);
+        for (int i = 0; i < thread_buffers.size(); i++) {
+            thread_buffers[i]->tail.store(thread_buffers[i]->head.load(std::memory_order_acquire), std::memory_order_release);
+            thread_buffers[i]->dropped_count = 0;
+            thread_buffers[i]->last_written_time = 0;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(zone_names_mutex);
+        written_zone_count = 0;
+    }
+    start_time = std::chrono::steady_clock::now();
+    is_stopping = false;
+    collector = std::thread(Collect);
+    is_tracing = true;
+}
+
+// Stops recording, wakes the collector so that it drains the last events and waits for it to finish.
+void Trace::Stop() {
+    if (!is_tracing) {
+        return;
+    }
+    is_tracing = false;
+    {
+        std::lock_guard<std::mutex> lock(collector_mutex);
+        is_stopping = true;
+    }
+    collector_condition.notify_one();
+    collector.join();
+    trace_file.close();
+}
+
+// Returns true if the zones are compiled in.
+bool Trace::IsCompiledIn() {
+#ifdef GAMEENGINE_TRACING
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Adds the name to the list of zones. The name is written to the trace file the next time the collector drains the buffers.
+int Trace::RegisterZone(std::string name) {
+    std::lock_guard<std::mutex> lock(zone_names_mutex);
+    zone_names.push_back(name);
+    return (int)zone_names.size() - 1;
+}
+
+// Records entering the zone if a trace is running.
+bool Trace::Begin(int zone) {
+    if (!is_tracing.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    return Record((Uint32)zone << 1);
+}
+
+// Records leaving the zone. Leaving is recorded even if the trace was stopped in between, so that the zone is not left open.
+void Trace::End(int zone) {
+    Record((Uint32)zone << 1 | 1);
+}
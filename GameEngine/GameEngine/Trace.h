@@ -0,0 +1,92 @@
+#ifndef __GameEngine__Trace__
+#define __GameEngine__Trace__
+
+#include <string>
+#include <SDL2/SDL.h>
+
+// Instrumentation zones for profiling the engine. A zone is a scope marked with TRACE_ZONE("name"), and while a trace is
+// running (see Trace::Start) the time each zone is entered and left is recorded.
+// The zones are only compiled in if GAMEENGINE_TRACING is defined (for example with -DGAMEENGINE_TRACING), otherwise the
+// macros expand to nothing and cost nothing at all. With the zones compiled in, a zone costs two timestamps and two writes
+// to a ring buffer of the calling thread while tracing, and a single check of a flag otherwise.
+// The ring buffers are lock free with one writer (the thread) and one reader (the collector thread), which drains them
+// into the trace file every few milliseconds. A ring buffer that is full drops events rather than waiting for the collector.
+//
+// The trace file is binary: the magic "GETR" and a version byte, followed by records that each start with a kind byte.
+// All numbers are written with seven bits in each byte, where the high bit marks that more bytes follow.
+//   ZONE_RECORD: zone id, name length, name bytes. Written before the first event of the zone.
+//   EVENTS_RECORD: thread index, event count, and for each event the nanoseconds since the previous event of the thread
+//                  and the zone id shifted left by one, with the lowest bit set for leaving the zone.
+//   DROPPED_RECORD: thread index and the number of events dropped since the last record.
+// Tools/TraceSummary.cpp summarizes a trace into inclusive and exclusive times per zone.
+#ifdef GAMEENGINE_TRACING
+#define TRACE_CONCATENATE_INNER(lhs, rhs) lhs##rhs
+#define TRACE_CONCATENATE(lhs, rhs) TRACE_CONCATENATE_INNER(lhs, rhs)
+#define TRACE_ZONE(name) static const int TRACE_CONCATENATE(trace_zone_id_, __LINE__) = Trace::RegisterZone(name); \
+                         TraceZone TRACE_CONCATENATE(trace_zone_, __LINE__)(TRACE_CONCATENATE(trace_zone_id_, __LINE__))
+#define TRACE_ZONE_ID(zone) TraceZone TRACE_CONCATENATE(trace_zone_, __LINE__)(zone)
+#else
+#define TRACE_ZONE(name)
+#define TRACE_ZONE_ID(zone)
+#endif
+
+// Records the zones of all threads into a trace file. All functions are static since there is one trace for the whole program.
+class Trace {
+
+public:
+    
+    // The kinds of records in a trace file.
+    enum RecordKind {ZONE_RECORD = 1, EVENTS_RECORD = 2, DROPPED_RECORD = 3};
+    
+    // Starts writing a trace to the file at the specified path and starts the collector thread. Throws if the file cannot be opened.
+    static void Start(std::string path);
+    
+    // Stops the trace, drains the remaining events and closes the file. Does nothing if no trace is running.
+    static void Stop();
+    
+    // Returns true if the zones are compiled in (see GAMEENGINE_TRACING).
+    static bool IsCompiledIn();
+    
+    // Registers a zone name and returns its id. Called once for each zone, the first time it is entered.
+    static int RegisterZone(std::string name);
+    
+    // Records that the calling thread entered a zone. Returns false if nothing was recorded, either because no trace is
+    // running or because the ring buffer of the thread is full, in which case leaving the zone is not recorded either.
+    static bool Begin(int zone);
+    
+    // Records that the calling thread left a zone.
+    static void End(int zone);
+};
+
+// A scope that is recorded as a zone, created by the TRACE_ZONE macro.
+class TraceZone {
+
+public:
+    
+    // Records entering the zone.
+    TraceZone(int zone):zone(zone), is_recorded(Trace::Begin(zone)) {
+    }
+    
+    // Records leaving the zone, if entering it was recorded.
+    ~TraceZone() {
+        if (is_recorded) {
+            Trace::End(zone);
+        }
+    }
+
+private:
+    
+    // Private in order to guard against value semantics.
+    TraceZone(const TraceZone& other_zone);
+    
+    // Private in order to guard against value semantics.
+    const TraceZone& operator=(const TraceZone& other_zone);
+    
+    // The id of the zone.
+    int zone;
+    
+    // A flag to indicate if entering the zone was recorded.
+    bool is_recorded;
+};
+
+#endif
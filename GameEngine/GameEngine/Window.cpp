@@ -1,15 +1,37 @@
+#include <thread>
+#include <exception>
 #include <SDL2/SDL.h>
 #include <SDL2_ttf/SDL_ttf.h>
 #include "Window.h"
 #include "Level.h"
+#include "Trace.h"
 
-Window::Window(std::string title, int width, int height):title(title), width(width), height(height){
-    InitSDL();
-    InitSDLImage();
-    InitSDLttf();
-    SetUpWindow();
-    SetUpRenderer();
-    SDL_RenderPresent(renderer);
+// The number of draw lists a text texture may go undrawn before its handle is reclaimed. The render thread destroys the
+// textures of reclaimed handles as often.
+static const long TEXT_TEXTURE_LIFETIME = 120;
+
+// A texture handle holds its slot in the lowest bits and the generation of the slot above them, which keeps the handles
+// positive and lets a slot be reused a couple of thousand times before a stale handle could match again.
+static const int TEXTURE_SLOT_BITS = 20;
+static const int TEXTURE_SLOT_MASK = (1 << TEXTURE_SLOT_BITS) - 1;
+static const int TEXTURE_GENERATION_MASK = (1 << (31 - TEXTURE_SLOT_BITS)) - 1;
+
+Window::Window(std::string title, int width, int height, bool is_headless, StartupTimeline* startup_timeline):title(title), width(width), height(height), window(nullptr), renderer(nullptr), current_level(nullptr), font(nullptr), metrics(nullptr), listener_profiler(nullptr), overlay(nullptr), is_headless(is_headless), startup_timeline(startup_timeline), draw_count(0), texture_bytes(0), render_count(0) {
+    if (!is_headless) {
+        SetUpSDL();
+    }
+}
+
+// Initiates the subsystems that have not been initiated yet.
+void Window::InitSubsystems(Uint32 subsystems) {
+    if (is_headless || (SDL_WasInit(subsystems) & subsystems) == subsystems) {
+        return;
+    }
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    if (SDL_InitSubSystem(subsystems) != 0) {
+        throw std::runtime_error("Failed to init SDL subsystem!");
+    }
+    StartupTimeline::Record(startup_timeline, "sdl.subsystems", start_time);
 }
 
 // Returns the renderer used by the window.
@@ -22,8 +44,39 @@ TTF_Font* Window::GetFont() {
     return font;
 }
 
+// Sets the metrics that the window and its sprites count their work in.
+void Window::SetMetrics(Metrics* metrics) {
+    this->metrics = metrics;
+}
+
+// Returns the metrics of the window.
+Metrics* Window::GetMetrics() {
+    return metrics;
+}
+
+// Sets the listener profiler of the window.
+void Window::SetListenerProfiler(ListenerProfiler* listener_profiler) {
+    this->listener_profiler = listener_profiler;
+}
+
+// Returns the listener profiler of the window.
+ListenerProfiler* Window::GetListenerProfiler() {
+    return listener_profiler;
+}
+
+// Sets the performance overlay of the window.
+void Window::SetOverlay(PerformanceOverlay* overlay) {
+    this->overlay = overlay;
+}
+
+// Returns the performance overlay of the window.
+PerformanceOverlay* Window::GetOverlay() {
+    return overlay;
+}
+
 // Iterates through all sprites in the specified level and loads them.
 void Window::LoadLevel(Level* level) {
+    TRACE_ZONE("Window::LoadLevel");
     for (int i = 0; i < level->GetSprites().size(); i++) {
         LoadSprite(level->GetSprites()[i]);
     }
@@ -34,27 +87,238 @@ void Window::LoadLevel(Level* level) {
 
 // Sends the window to a sprite and sets up the texture for the sprite.
 void Window::LoadSprite(Sprite* sprite) {
+    TRACE_ZONE("Window::LoadSprite");
     sprite->SetWindow(this);
     sprite->SetUpTexture();
 }
 
-// Renders all sprites that have been added to the level that is currently loaded and that are positioned wihtin the window.
-// This is done by iterating through all sprites and calling Sprite::Draw. If a sprite is found that is not within the boundaries of the window,
-// then that specific sprite is removed. This includes both freeing the memory allocated by the sprite object
-// and removing it from the vector of sprites.
-void Window::DrawSprites(int time_elapsed) {
-    SDL_RenderClear(renderer);
+// Updates all sprites that have been added to the level that is currently loaded and that are positioned wihtin the window.
+// This is done by iterating through all sprites and calling Sprite::Update followed by Sprite::Draw for the visible ones.
+// If a sprite is found that is not within the boundaries of the window, then that specific sprite is marked for removal.
+// The sprite is then deleted by the level when Level::CleanUpSprites is called.
+void Window::UpdateSprites(int time_elapsed, DrawList& draw_list, FrameArena* arena) {
+    TRACE_ZONE("Window::UpdateSprites");
+    draw_list.Clear();
+    {
+        std::lock_guard<std::mutex> lock(texture_mutex);
+        draw_count++;
+        if (draw_count % TEXT_TEXTURE_LIFETIME == 0) {
+            ReclaimTextTextures();
+        }
+    }
     for (int i = 0; i < current_level->GetSprites().size(); i++) {
         Sprite* current_sprite = current_level->GetSprites()[i];
         if (!Contains(current_sprite)) {
             current_level->RemoveSprite(current_sprite); // TODO: add remove(index) to avoid duplicate iteration
         } else {
+            current_sprite->Update(time_elapsed);
             if (current_sprite->GetIsVisible()) {
-                current_sprite->Draw(time_elapsed);
+                current_sprite->Draw(draw_list);
             }
         }
     }
+    draw_list.Sort(arena);
+}
+
+// Renders all commands in the draw list in order, draws the overlay on top and presents the result on screen.
+// Does nothing for a headless window.
+void Window::Render(DrawList& draw_list) {
+    TRACE_ZONE("Window::Render");
+    if (is_headless) {
+        return;
+    }
+    SDL_RenderClear(renderer);
+    const std::vector<DrawCommand>& commands = draw_list.GetCommands();
+    for (int i = 0; i < commands.size(); i++) {
+        const DrawCommand& command = commands[i];
+        SDL_Texture* texture = ResolveTexture(command.texture);
+        if (texture != nullptr) {
+            if (command.alpha != 255) {
+                SDL_SetTextureAlphaMod(texture, command.alpha);
+            }
+            SDL_RenderCopy(renderer, texture, command.has_source ? &command.source : NULL, command.has_destination ? &command.destination : NULL);
+            if (command.alpha != 255) {
+                SDL_SetTextureAlphaMod(texture, 255);
+            }
+        }
+    }
+    if (overlay != nullptr) {
+        std::lock_guard<std::mutex> lock(texture_mutex);
+        overlay->Render(renderer, font);
+    }
     SDL_RenderPresent(renderer);
+    render_count++;
+    if (render_count % TEXT_TEXTURE_LIFETIME == 0) {
+        DestroyReclaimedTextures();
+    }
+}
+
+// Returns a handle to the texture for the image located at the path specified as argument.
+int Window::GetImageTexture(std::string file_name) {
+    return GetTextureHandle(file_name, false);
+}
+
+// Returns a handle to a texture with the specified text.
+int Window::GetTextTexture(std::string text) {
+    return GetTextureHandle(text, true);
+}
+
+// Records the draw list the text was drawn in, if the handle still holds its slot.
+bool Window::TouchTextTexture(int handle) {
+    if (handle < 0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(texture_mutex);
+    int slot = handle & TEXTURE_SLOT_MASK;
+    if (slot >= texture_handles.size() || texture_handles[slot] != handle) {
+        return false;
+    }
+    texture_last_drawn[slot] = draw_count;
+    return true;
+}
+
+// Returns the handle registered for the key, or registers a new handle if this is the first time the key is requested.
+// The image is loaded (or the text is rendered) right away, so that a missing image fails where the sprite is set up rather
+// than in the middle of a frame on the render thread, and only the texture is created when the handle is first rendered.
+// A reclaimed slot is reused with the next generation, which means that a handle in a draw list that is rendered after its
+// slot has been reclaimed resolves to no texture rather than to the texture of another key.
+int Window::GetTextureHandle(std::string key, bool is_text) {
+    TRACE_ZONE("Window::GetTextureHandle");
+    std::lock_guard<std::mutex> lock(texture_mutex);
+    std::map<std::string, int>& handles = is_text ? text_handles : image_handles;
+    std::map<std::string, int>::iterator entry = handles.find(key);
+    if (entry != handles.end()) {
+        texture_last_drawn[entry->second & TEXTURE_SLOT_MASK] = draw_count;
+        return entry->second;
+    }
+    SDL_Surface* surface = nullptr;
+    if (!is_headless) {
+        if (is_text) {
+            SDL_Color white = { 255, 255, 255 };
+            surface = TTF_RenderText_Solid(font, key.c_str(), white);
+        } else {
+            surface = IMG_Load(key.c_str());
+        }
+        if (metrics != nullptr) {
+            metrics->Add(is_text ? Metrics::TEXT_RENDERS : Metrics::IMAGE_LOADS);
+        }
+        if (surface == nullptr) {
+            throw std::runtime_error("Failed to create sprite!");
+        }
+    }
+    int slot;
+    if (!free_texture_slots.empty()) {
+        slot = free_texture_slots.back();
+        free_texture_slots.pop_back();
+    } else {
+        slot = (int)texture_keys.size();
+        texture_keys.push_back("");
+        texture_is_text.push_back(false);
+        texture_handles.push_back(-1);
+        texture_generations.push_back(0);
+        texture_last_drawn.push_back(0);
+        texture_surfaces.push_back(nullptr);
+    }
+    int handle = slot | (texture_generations[slot] << TEXTURE_SLOT_BITS);
+    texture_keys[slot] = key;
+    texture_is_text[slot] = is_text;
+    texture_handles[slot] = handle;
+    texture_last_drawn[slot] = draw_count;
+    texture_surfaces[slot] = surface;
+    handles[key] = handle;
+    return handle;
+}
+
+// Returns the SDL texture for a handle. The first time a handle is rendered the texture is created from the surface loaded
+// when the handle was registered, replacing the texture of the key the slot held before, if any. The registry lock is only
+// taken on this slow path.
+SDL_Texture* Window::ResolveTexture(int handle) {
+    TRACE_ZONE("Window::ResolveTexture");
+    if (handle < 0) {
+        return nullptr;
+    }
+    int slot = handle & TEXTURE_SLOT_MASK;
+    if (slot >= textures.size()) {
+        textures.resize(slot + 1, nullptr);
+        texture_created_handles.resize(slot + 1, -1);
+        texture_sizes.resize(slot + 1, 0);
+    }
+    if (texture_created_handles[slot] != handle) {
+        SDL_Surface* surface;
+        {
+            std::lock_guard<std::mutex> lock(texture_mutex);
+            if (texture_handles[slot] != handle) {
+                return nullptr;
+            }
+            surface = texture_surfaces[slot];
+            texture_surfaces[slot] = nullptr;
+        }
+        if (textures[slot] != nullptr) {
+            SDL_DestroyTexture(textures[slot]);
+            textures[slot] = nullptr;
+            texture_bytes -= texture_sizes[slot];
+            texture_sizes[slot] = 0;
+        }
+        if (surface == nullptr) {
+            return nullptr;
+        }
+        textures[slot] = SDL_CreateTextureFromSurface(renderer, surface);
+        if (metrics != nullptr) {
+            metrics->Add(Metrics::TEXTURE_UPLOADS);
+        }
+        SDL_FreeSurface(surface);
+        if (textures[slot] == nullptr) {
+            throw std::runtime_error("Failed to create sprite!");
+        }
+        texture_created_handles[slot] = handle;
+        int texture_width = 0, texture_height = 0;
+        SDL_QueryTexture(textures[slot], NULL, NULL, &texture_width, &texture_height);
+        texture_sizes[slot] = (long)texture_width * texture_height * 4;
+        texture_bytes += texture_sizes[slot];
+    }
+    return textures[slot];
+}
+
+// Reclaims the handles of texts that have not been drawn for a while: the key is forgotten, a text that was never rendered
+// is freed and the slot is handed out again with the next generation. Called with the texture mutex held, by the simulation
+// thread, which means that the handles handed out only depend on what the sprites draw and not on the render thread.
+// The textures of the reclaimed handles are destroyed by the render thread (see DestroyReclaimedTextures).
+void Window::ReclaimTextTextures() {
+    TRACE_ZONE("Window::ReclaimTextTextures");
+    for (int slot = 0; slot < texture_keys.size(); slot++) {
+        if (texture_handles[slot] == -1 || !texture_is_text[slot] || draw_count - texture_last_drawn[slot] <= TEXT_TEXTURE_LIFETIME) {
+            continue;
+        }
+        text_handles.erase(texture_keys[slot]);
+        texture_keys[slot].clear();
+        texture_handles[slot] = -1;
+        texture_generations[slot] = (texture_generations[slot] + 1) & TEXTURE_GENERATION_MASK;
+        if (texture_surfaces[slot] != nullptr) {
+            SDL_FreeSurface(texture_surfaces[slot]);
+            texture_surfaces[slot] = nullptr;
+        }
+        free_texture_slots.push_back(slot);
+    }
+}
+
+// Destroys the textures whose handles have been reclaimed, so that labels with changing text do not fill up video memory.
+void Window::DestroyReclaimedTextures() {
+    TRACE_ZONE("Window::DestroyReclaimedTextures");
+    std::lock_guard<std::mutex> lock(texture_mutex);
+    for (int slot = 0; slot < textures.size(); slot++) {
+        if (textures[slot] != nullptr && texture_created_handles[slot] != texture_handles[slot]) {
+            SDL_DestroyTexture(textures[slot]);
+            textures[slot] = nullptr;
+            texture_created_handles[slot] = -1;
+            texture_bytes -= texture_sizes[slot];
+            texture_sizes[slot] = 0;
+        }
+    }
+}
+
+// Returns the size of the loaded textures.
+long Window::GetTextureBytes() {
+    return texture_bytes;
 }
 
 // Returns the width of the window.
@@ -67,56 +331,118 @@ int Window::GetHeight() {
     return height;
 }
 
-// Internal helper function to initiate SDL.
+// SDL_image and SDL_ttf do not depend on SDL being initiated or on each other, so they are initiated on threads of their own
+// while the main thread initiates SDL and creates the window and the renderer, which must be done on the main thread.
+// The threads are always joined before an error is passed on, and everything that was set up is released again.
+void Window::SetUpSDL() {
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    std::exception_ptr image_error, font_error, sdl_error;
+    std::thread image_thread([this, &image_error] {
+        try {
+            InitSDLImage();
+        } catch (...) {
+            image_error = std::current_exception();
+        }
+    });
+    std::thread font_thread([this, &font_error] {
+        try {
+            InitSDLttf();
+        } catch (...) {
+            font_error = std::current_exception();
+        }
+    });
+    try {
+        InitSDL();
+        SetUpWindow();
+        SetUpRenderer();
+    } catch (...) {
+        sdl_error = std::current_exception();
+    }
+    image_thread.join();
+    font_thread.join();
+    std::exception_ptr error = sdl_error ? sdl_error : (image_error ? image_error : font_error);
+    if (error) {
+        TearDownSDL();
+        std::rethrow_exception(error);
+    }
+    SDL_RenderPresent(renderer);
+    StartupTimeline::Record(startup_timeline, "window.set_up", start_time);
+}
+
+// Releases the renderer, the window and the font if they were created and quits SDL and its extensions.
+void Window::TearDownSDL() {
+    if (renderer != nullptr) {
+        SDL_DestroyRenderer(renderer);
+        renderer = nullptr;
+    }
+    if (window != nullptr) {
+        SDL_DestroyWindow(window);
+        window = nullptr;
+    }
+    if (font != nullptr) {
+        TTF_CloseFont(font);
+        font = nullptr;
+    }
+    TTF_Quit();
+    IMG_Quit();
+    SDL_Quit();
+}
+
+// Internal helper function to initiate SDL. Only the video subsystem (which includes the event subsystem) is needed to
+// run a game, other subsystems are initiated when they are first needed (see InitSubsystems).
 void Window::InitSDL() {
-    if (SDL_Init(SDL_INIT_EVERYTHING) != 0){
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    if (SDL_Init(SDL_INIT_VIDEO) != 0){
         throw std::runtime_error("Failed to init game engine!");
     }
+    StartupTimeline::Record(startup_timeline, "sdl.init", start_time);
 }
 
 // Internal helper function to initiate SDL_Image.
 void Window::InitSDLImage() {
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
     int img_flags = IMG_INIT_PNG;
     if (!(IMG_Init( img_flags ) & img_flags )) {
-        SDL_Quit();
         throw std::runtime_error("Failed to init game engine!");
     }
+    StartupTimeline::Record(startup_timeline, "sdl_image.init", start_time);
 }
 
 // Internal helper function to initiate SDL_ttf.
 void Window::InitSDLttf() {
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
     if (TTF_Init() == -1) {
-        SDL_Quit();
         throw std::runtime_error("Failed to init game engine!");
     }
     font = TTF_OpenFont("resources/framework/font.ttf", 48);
     if (font == nullptr) {
-        SDL_Quit();
         throw std::runtime_error("Failed to load the specified font!");
     } else {
         TTF_SetFontOutline(font, 1);
     }
+    StartupTimeline::Record(startup_timeline, "sdl_ttf.load_font", start_time);
 }
 
 // Internal helper function to set up a renderer for the window.
 void Window::SetUpRenderer() {
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
     renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
     if (renderer == nullptr){
-        SDL_DestroyWindow(window);
-        SDL_Quit();
         throw std::runtime_error("Failed to init game engine!");
     } else {
         SDL_RenderClear(renderer);
     }
+    StartupTimeline::Record(startup_timeline, "sdl.create_renderer", start_time);
 }
 
 // Internal helper function to set up the actual window.
 void Window::SetUpWindow() {
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
     window = SDL_CreateWindow(title.c_str(), 0, 0, width, height, SDL_WINDOW_SHOWN);
     if (window == nullptr){
-        SDL_Quit();
         throw std::runtime_error("Failed to init game engine!");
     }
+    StartupTimeline::Record(startup_timeline, "sdl.create_window", start_time);
 }
 
 // Checks if any given x and y value are within the bounds of the window.
@@ -141,8 +467,22 @@ bool Window::Contains(Sprite* sprite) {
 
 // Destroys SDL resources and quits the SDL framework.
 Window::~Window() {
+    if (is_headless) {
+        return;
+    }
+    for (int i = 0; i < texture_surfaces.size(); i++) {
+        if (texture_surfaces[i] != nullptr) {
+            SDL_FreeSurface(texture_surfaces[i]);
+        }
+    }
+    for (int i = 0; i < textures.size(); i++) {
+        if (textures[i] != nullptr) {
+            SDL_DestroyTexture(textures[i]);
+        }
+    }
     TTF_CloseFont(font);
     TTF_Quit();
+    IMG_Quit();
     SDL_DestroyWindow(window);
     SDL_DestroyRenderer(renderer);
     SDL_Quit();
@@ -4,36 +4,96 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <map>
+#include <mutex>
 #include <SDL2_ttf/SDL_ttf.h>
 #include "Sprite.h"
 #include "StaticSprite.h"
+#include "DrawList.h"
+#include "Metrics.h"
+#include "ListenerProfiler.h"
+#include "PerformanceOverlay.h"
+#include "StartupTimeline.h"
 
 class Level; // Forward declaration neeeded to avoid cyclic dependency.
 
 // The underlaying window used by the game engine.
 class Window {
-    
+
 public:
     
     // Creates a new window object and sets the member variable title based on the string sent as argument
     // and boundary as well as height and width based on the height and width sent as arguments.
-    Window(std::string title, int width, int height);
+    // A headless window does not initiate SDL and never renders anything, but keeps track of sprites and textures as usual.
+    // Only the video subsystem of SDL is initiated (see InitSubsystems). SDL_image and SDL_ttf are initiated and the font is
+    // loaded on threads of their own while the window and the renderer are created. Each step is recorded on the startup
+    // timeline, if one is specified.
+    Window(std::string title, int width, int height, bool is_headless = false, StartupTimeline* startup_timeline = nullptr);
+    
+    // Initiates the specified SDL subsystems (for example SDL_INIT_AUDIO or SDL_INIT_GAMECONTROLLER) unless they have been
+    // initiated already. Must be called from the thread that created the window. Does nothing for a headless window.
+    // Throws if a subsystem cannot be initiated.
+    void InitSubsystems(Uint32 subsystems);
     
     // Returns the renderer used by the window.
     SDL_Renderer* GetRenderer();
     
     // Return the font used by sprites that need to display text.
     TTF_Font* GetFont();
-
+    
+    // Sets the metrics that the window and its sprites count their work in.
+    void SetMetrics(Metrics* metrics);
+    
+    // Returns the metrics of the window, or a null pointer if the window has no metrics.
+    Metrics* GetMetrics();
+    
+    // Sets the profiler that the levels and sprites of the window time their listeners with, or a null pointer to stop timing them.
+    void SetListenerProfiler(ListenerProfiler* listener_profiler);
+    
+    // Returns the listener profiler of the window, or a null pointer if listener profiling is disabled.
+    ListenerProfiler* GetListenerProfiler();
+    
+    // Sets the performance overlay drawn on top of the level, or a null pointer to hide it.
+    void SetOverlay(PerformanceOverlay* overlay);
+    
+    // Returns the performance overlay of the window, or a null pointer if it is hidden.
+    PerformanceOverlay* GetOverlay();
+    
     // Loads all the sprites included in the specified level.
     void LoadLevel(Level* level);
     
     // Loads a spcecific sprite.
     void LoadSprite(Sprite* sprite);
     
-    // Renders all sprites that have been added to the window and that are positioned wihtin the window.
-    // Deletes any sprite that is positioned outside the window and frees any memory associated with the sprite object.
-    void DrawSprites(int time_elapsed);
+    // Updates all sprites that have been added to the window and that are positioned wihtin the window and adds their
+    // draw commands to the specified draw list. Marks any sprite that is positioned outside the window for removal.
+    // Does not touch any SDL resources and may be called from the simulation thread. The temporary memory needed to sort
+    // the draw list is allocated from the arena, if one is specified.
+    void UpdateSprites(int time_elapsed, DrawList& draw_list, FrameArena* arena = nullptr);
+    
+    // Renders the specified draw list followed by the performance overlay (if any) and presents it on screen.
+    // Must be called from the thread that created the window.
+    void Render(DrawList& draw_list);
+    
+    // Returns a handle to the texture for the image located at the path specified as argument. The image is loaded the
+    // first time the path is requested, and throws a std::runtime_error if it cannot be loaded, while the texture is only
+    // created the first time it is rendered. A headless window does not load images. May be called from any thread.
+    int GetImageTexture(std::string file_name);
+    
+    // Returns a handle to a texture with the specified text rendered with the font of the window. The text is rendered the
+    // first time it is requested, and throws a std::runtime_error if it cannot be rendered, while the texture is only
+    // created the first time it is rendered. A headless window does not render texts. May be called from any thread.
+    // Text handles that have not been drawn for a while are reclaimed (see TouchTextTexture), so that labels with changing
+    // text do not fill up the window with texts that are never drawn again.
+    int GetTextTexture(std::string text);
+    
+    // Marks the text texture of a handle as drawn in the current frame, which keeps the handle from being reclaimed.
+    // Returns false if the handle has been reclaimed (or is -1), in which case the sprite must request a new handle with
+    // GetTextTexture. Called by text sprites each time they are drawn.
+    bool TouchTextTexture(int handle);
+    
+    // Returns the number of bytes of the textures currently loaded by the window, counting four bytes per pixel.
+    long GetTextureBytes();
     
     // Returns the width of the window.
     int GetWidth();
@@ -42,9 +102,15 @@ public:
     int GetHeight();
     
     ~Window();
-    
+
 private:
     
+    // Internal helper function that initiates SDL, SDL_image and SDL_ttf and sets up the window and the renderer.
+    void SetUpSDL();
+    
+    // Internal helper function that releases whatever SetUpSDL managed to set up before it failed.
+    void TearDownSDL();
+    
     // Internal helper function to initiate SDL.
     void InitSDL();
     
@@ -60,6 +126,19 @@ private:
     // Internal helper function to set up the actual window.
     void SetUpWindow();
     
+    // Internal helper function that returns the handle for the specified texture key, creating a new handle if needed.
+    int GetTextureHandle(std::string key, bool is_text);
+    
+    // Internal helper function that returns the SDL texture for a handle, creating it from the loaded image or rendered text
+    // if needed. Returns a null pointer for a handle that has been reclaimed.
+    SDL_Texture* ResolveTexture(int handle);
+    
+    // Internal helper function that reclaims the handles of text textures that have not been drawn for a while.
+    void ReclaimTextTextures();
+    
+    // Internal helper function that destroys the textures of reclaimed handles.
+    void DestroyReclaimedTextures();
+    
     // Internal helper function to check if the window contain the specified x and y value.
     bool Contains(int x, int y);
     
@@ -83,6 +162,59 @@ private:
     
     // The font used by sprites that need to display text.
     TTF_Font* font;
+    
+    // The metrics that the window and its sprites count their work in (owned by the engine).
+    Metrics* metrics;
+    
+    // The profiler that the levels and sprites of the window time their listeners with (owned by the engine), if any.
+    ListenerProfiler* listener_profiler;
+    
+    // The performance overlay drawn on top of the level (owned by the engine), if any.
+    PerformanceOverlay* overlay;
+    
+    // A flag to indicate if the window is headless.
+    bool is_headless;
+    
+    // The timeline that the steps of setting up the window are recorded on (owned by the engine), if any.
+    StartupTimeline* startup_timeline;
+    
+    // Guards the texture handle registry below, which is shared between the simulation thread and the render thread, and the
+    // font, which is used both to render texts and to render the glyphs of the overlay.
+    std::mutex texture_mutex;
+    
+    // The texture handles registered for image paths and texts.
+    std::map<std::string, int> image_handles, text_handles;
+    
+    // A handle is a slot combined with the generation of the slot (see Window.cpp). The following are indexed by slot:
+    // the image path or text of the slot (empty for a free slot), a flag to indicate if the slot holds a text texture,
+    // the handle currently held by the slot (or -1 if it is free), the generation of the slot, the number of the last draw
+    // list the texture was drawn in, and the loaded image or rendered text that has not been made into a texture yet.
+    std::vector<std::string> texture_keys;
+    std::vector<bool> texture_is_text;
+    std::vector<int> texture_handles;
+    std::vector<int> texture_generations;
+    std::vector<long> texture_last_drawn;
+    std::vector<SDL_Surface*> texture_surfaces;
+    
+    // The slots of reclaimed text handles, reused before new slots are added.
+    std::vector<int> free_texture_slots;
+    
+    // The number of draw lists produced by UpdateSprites so far. Guarded by the texture mutex.
+    long draw_count;
+    
+    // The SDL textures indexed by slot, and the handle each of them was created for. Only accessed by the render thread.
+    std::vector<SDL_Texture*> textures;
+    std::vector<int> texture_created_handles;
+    
+    // The size in bytes of each loaded texture, and of all of them. Only written by the render thread.
+    std::vector<long> texture_sizes;
+    long texture_bytes;
+    
+    // The number of draw lists rendered so far.
+    long render_count;
+    
+    // Gives the microbenchmarks access to the internal functions they measure.
+    friend class Microbenchmark;
 };
 
 #endif
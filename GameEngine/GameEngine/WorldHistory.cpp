@@ -0,0 +1,182 @@
+#include <cstring>
+#include <algorithm>
+#include "WorldHistory.h"
+#include "Trace.h"
+
+// Appends a number to a delta using seven bits of each byte, where the highest bit marks that more bytes follow.
+static void AppendNumber(std::vector<Uint8>& delta, size_t number) {
+    while (number >= 0x80) {
+        delta.push_back((Uint8)(number | 0x80));
+        number >>= 7;
+    }
+    delta.push_back((Uint8)number);
+}
+
+// Reads a number appended by AppendNumber at the position and moves the position past it.
+static size_t ReadNumber(const std::vector<Uint8>& delta, size_t& position) {
+    size_t number = 0;
+    int shift = 0;
+    while (delta[position] & 0x80) {
+        number |= (size_t)(delta[position++] & 0x7f) << shift;
+        shift += 7;
+    }
+    number |= (size_t)delta[position++] << shift;
+    return number;
+}
+
+WorldHistory::WorldHistory(int capacity):capacity(std::max(capacity, 1)) {
+}
+
+// Encodes the delta from the new state back to the state of the previous newest frame, and then keeps the new state as
+// the newest. The oldest frame is reused for the new frame when the history is full, so that its storage is reused.
+void WorldHistory::Record(int frame, std::vector<Uint8>& state, const std::vector<SDL_Event>& input) {
+    TRACE_ZONE("WorldHistory::Record");
+    Frame new_frame;
+    if (frames.size() == capacity) {
+        new_frame = std::move(frames.front());
+        frames.pop_front();
+    }
+    if (!frames.empty()) {
+        EncodeDelta(state, newest_state, frames.back().delta);
+    }
+    new_frame.frame = frame;
+    new_frame.delta.clear();
+    new_frame.input.assign(input.begin(), input.end());
+    frames.push_back(std::move(new_frame));
+    newest_state.swap(state);
+}
+
+// Applies the deltas from the newest frame back to the frame on a copy of the newest state.
+bool WorldHistory::GetState(int frame, std::vector<Uint8>& state) {
+    TRACE_ZONE("WorldHistory::GetState");
+    int index = FindFrame(frame);
+    if (index == -1) {
+        return false;
+    }
+    state.assign(newest_state.begin(), newest_state.end());
+    for (int i = (int)frames.size() - 2; i >= index; i--) {
+        ApplyDelta(state, frames[i].delta);
+    }
+    return true;
+}
+
+// Applies the deltas from the newest frame back to the frame on the newest state itself, dropping each frame passed.
+bool WorldHistory::Rewind(int frame, std::vector<Uint8>& state) {
+    TRACE_ZONE("WorldHistory::Rewind");
+    int index = FindFrame(frame);
+    if (index == -1) {
+        return false;
+    }
+    while (frames.size() > index + 1) {
+        frames.pop_back();
+        ApplyDelta(newest_state, frames.back().delta);
+    }
+    frames.back().delta.clear();
+    state.assign(newest_state.begin(), newest_state.end());
+    return true;
+}
+
+// Returns true if the state of the frame is kept.
+bool WorldHistory::HasFrame(int frame) {
+    return FindFrame(frame) != -1;
+}
+
+// Returns the oldest frame kept.
+int WorldHistory::GetOldestFrame() {
+    return frames.empty() ? -1 : frames.front().frame;
+}
+
+// Returns the newest frame kept.
+int WorldHistory::GetNewestFrame() {
+    return frames.empty() ? -1 : frames.back().frame;
+}
+
+// Returns the number of frames kept.
+int WorldHistory::GetFrameCount() {
+    return (int)frames.size();
+}
+
+// Returns the input delegated in the frame.
+const std::vector<SDL_Event>& WorldHistory::GetInput(int frame) {
+    return frames[FindFrame(frame)].input;
+}
+
+// Replaces the input of the frame.
+void WorldHistory::SetInput(int frame, const std::vector<SDL_Event>& input) {
+    frames[FindFrame(frame)].input = input;
+}
+
+// Sums the sizes of the newest state, the deltas and the input kept.
+long WorldHistory::GetMemoryUsage() {
+    long bytes = (long)newest_state.size();
+    for (int i = 0; i < frames.size(); i++) {
+        bytes += (long)(frames[i].delta.size() + frames[i].input.size() * sizeof(SDL_Event));
+    }
+    return bytes;
+}
+
+// Drops all frames.
+void WorldHistory::Clear() {
+    frames.clear();
+    newest_state.clear();
+}
+
+// Finds the frame with a binary search, since the frames are kept in increasing order.
+int WorldHistory::FindFrame(int frame) {
+    std::deque<Frame>::iterator it = std::lower_bound(frames.begin(), frames.end(), frame, [](const Frame& lhs, int frame) {
+        return lhs.frame < frame;
+    });
+    return it != frames.end() && it->frame == frame ? (int)(it - frames.begin()) : -1;
+}
+
+// Compares the states eight bytes at a time and writes the size of the state to, followed by each run of changed words as
+// the number of unchanged bytes before it, the length of the run and the bytes of the run xor:ed with the bytes of the state
+// from. Bytes beyond the end of the state from count as zero, so that states of different sizes can be encoded.
+void WorldHistory::EncodeDelta(const std::vector<Uint8>& from, const std::vector<Uint8>& to, std::vector<Uint8>& delta) {
+    TRACE_ZONE("WorldHistory::EncodeDelta");
+    delta.clear();
+    AppendNumber(delta, to.size());
+    size_t common_words = std::min(from.size(), to.size()) / sizeof(Uint64);
+    size_t words = (to.size() + sizeof(Uint64) - 1) / sizeof(Uint64);
+    size_t last_end = 0;
+    size_t word = 0;
+    while (word < words) {
+        while (word < common_words && memcmp(from.data() + word * sizeof(Uint64), to.data() + word * sizeof(Uint64), sizeof(Uint64)) == 0) {
+            word++;
+        }
+        if (word == words) {
+            break;
+        }
+        size_t run_start = word * sizeof(Uint64);
+        while (word < words && (word >= common_words || memcmp(from.data() + word * sizeof(Uint64), to.data() + word * sizeof(Uint64), sizeof(Uint64)) != 0)) {
+            word++;
+        }
+        size_t run_end = std::min(word * sizeof(Uint64), to.size());
+        AppendNumber(delta, run_start - last_end);
+        AppendNumber(delta, run_end - run_start);
+        size_t position = delta.size();
+        delta.resize(position + run_end - run_start);
+        for (size_t i = run_start; i < run_end; i++) {
+            delta[position++] = to[i] ^ (i < from.size() ? from[i] : 0);
+        }
+        last_end = run_end;
+    }
+}
+
+// Resizes the state to the size of the state the delta was encoded to (new bytes are zero, just like when the delta was
+// encoded) and xors each run of changed bytes into it.
+void WorldHistory::ApplyDelta(std::vector<Uint8>& state, const std::vector<Uint8>& delta) {
+    TRACE_ZONE("WorldHistory::ApplyDelta");
+    size_t position = 0;
+    state.resize(ReadNumber(delta, position));
+    size_t offset = 0;
+    while (position < delta.size()) {
+        offset += ReadNumber(delta, position);
+        size_t length = ReadNumber(delta, position);
+        for (size_t i = 0; i < length; i++) {
+            state[offset + i] ^= delta[position + i];
+        }
+        offset += length;
+        position += length;
+    }
+}
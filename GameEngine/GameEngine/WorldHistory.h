@@ -0,0 +1,95 @@
+#ifndef __GameEngine__WorldHistory__
+#define __GameEngine__WorldHistory__
+
+#include <vector>
+#include <deque>
+#include <SDL2/SDL.h>
+
+// Keeps the state of the world (the engine and its current level, as saved by the engine) at the end of each of the last
+// frames, so that the engine can jump back to any of them and simulate forward again (see Engine::KeepHistory).
+// Only the state of the newest frame is kept as it is. Each older frame is kept as a delta that turns the state of the frame
+// after it into the state of the frame: the bytes that differ between the two states xor:ed together, with the runs of
+// unchanged bytes left out. A frame is restored by applying the deltas from the newest frame backwards, which makes the
+// most recent frames, the ones rollback needs most often, the cheapest to restore. The memory of each frame is proportional
+// to how much changed in the frame, and the number of frames is fixed, so the memory of the history is bounded.
+// The input events delegated in each frame are kept with the frame, so that the frames after a restored frame can be
+// simulated again with the same input, or with input that has been corrected since (see SetInput).
+class WorldHistory {
+
+public:
+    
+    // Creates a new, empty history that keeps the specified number of frames.
+    WorldHistory(int capacity);
+    
+    // Adds the state at the end of the specified frame, which must be later than the newest frame kept, together with the
+    // input delegated in the frame. The oldest frame is dropped if the history is full. The state is swapped with the
+    // state kept for the previous frame, which means that the buffer passed in gets storage that can be reused.
+    void Record(int frame, std::vector<Uint8>& state, const std::vector<SDL_Event>& input);
+    
+    // Writes the state at the end of the specified frame to the buffer without changing the history.
+    // Returns false if the frame is not kept.
+    bool GetState(int frame, std::vector<Uint8>& state);
+    
+    // Drops the frames after the specified frame, which makes it the newest frame, and writes its state to the buffer.
+    // Returns false without changing the history if the frame is not kept.
+    bool Rewind(int frame, std::vector<Uint8>& state);
+    
+    // Returns true if the state of the specified frame is kept.
+    bool HasFrame(int frame);
+    
+    // Returns the oldest and the newest frame kept, or -1 if the history is empty.
+    int GetOldestFrame();
+    int GetNewestFrame();
+    
+    // Returns the number of frames kept.
+    int GetFrameCount();
+    
+    // Returns the input delegated in the specified frame, which must be kept.
+    const std::vector<SDL_Event>& GetInput(int frame);
+    
+    // Replaces the input of the specified frame, which must be kept, as when input for the frame arrives late. The new
+    // input is delegated when the frame is simulated again.
+    void SetInput(int frame, const std::vector<SDL_Event>& input);
+    
+    // Returns the number of bytes used by the states and the deltas kept.
+    long GetMemoryUsage();
+    
+    // Drops all frames.
+    void Clear();
+
+private:
+    
+    // A frame kept by the history: the delta from the state of the next frame to the state of this frame (empty for the
+    // newest frame, whose state is kept as it is) and the input delegated in the frame.
+    struct Frame {
+        int frame;
+        std::vector<Uint8> delta;
+        std::vector<SDL_Event> input;
+    };
+    
+    // Private in order to guard against value semantics.
+    WorldHistory(const WorldHistory& other_history);
+    
+    // Private in order to guard against value semantics.
+    const WorldHistory& operator=(const WorldHistory& other_history);
+    
+    // Internal helper function that returns the index of the specified frame, or -1 if the frame is not kept.
+    int FindFrame(int frame);
+    
+    // Internal helper function that writes the delta that turns the state from into the state to.
+    static void EncodeDelta(const std::vector<Uint8>& from, const std::vector<Uint8>& to, std::vector<Uint8>& delta);
+    
+    // Internal helper function that applies a delta written by EncodeDelta to a state.
+    static void ApplyDelta(std::vector<Uint8>& state, const std::vector<Uint8>& delta);
+    
+    // The maximum number of frames kept.
+    int capacity;
+    
+    // The frames kept, from the oldest to the newest.
+    std::deque<Frame> frames;
+    
+    // The state at the end of the newest frame.
+    std::vector<Uint8> newest_state;
+};
+
+#endif
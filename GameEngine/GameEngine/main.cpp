@@ -1,93 +1,151 @@
 #include <iostream>
-#include <time.h>
+#include <string>
+#include <fstream>
+#include <vector>
 #include <math.h>
 #include "Engine.h"
+#include "SimulationBatch.h"
+#include "SpaceShooter.h"
+#include "Trace.h"
 
 using namespace std;
 
-Engine* game_engine = new Engine("SpaceShooter", 60, 800, 640);
-Level* level1 = new Level(5);
-Sprite* player = AnimatedSprite::GetInstance("player", {"resources/game/player_space_ship1.png", "resources/game/player_space_ship2.png", "resources/game/player_space_ship3.png"}, 300, 300, 515, 128, 128);
-Sprite* text_input = TextInputSprite::GetInstance("text_input", 400, 325);
-Sprite* name_input_message = LabelSprite::GetInstance("name_message", "enter your name:", 208, 290);
-Sprite* overlay = StaticSprite::GetInstance("overlay", "resources/game/transparent.png", 0, 0, 0, 0);
-
-void GameOver(Sprite* sprite1, Sprite* sprite2) {
-    overlay->SetIsVisible(true);
-    Sprite* game_over_message = LabelSprite::GetInstance("game_over_message", "Game Over!", 280, 290);
-    game_engine->GetCurrentLevel()->AddSprite(game_over_message);
-    game_engine->GetCurrentLevel()->SetTimeListenersPaused(true);
-    for (int i = 0; i < game_engine->GetCurrentLevel()->GetSprites().size(); i++) {
-        if (game_engine->GetCurrentLevel()->GetSprites()[i]->GetTag() == "enemy") {
-            game_engine->GetCurrentLevel()->RemoveSprite(game_engine->GetCurrentLevel()->GetSprites()[i]);
+// Runs the game in a window, or with the option --batch <games> <frames> [threads] runs the specified number of headless games
+// in parallel (skipping the name entry) on the specified number of threads (all cores by default) and reports the aggregate
+// number of frames simulated per second.
+// With the option --seed <seed> the game runs in deterministic mode and prints the final state hash when it exits.
+// With the option --record <file> the input of the session is recorded to the file, and with --replay <file> a recorded
+// session is replayed. Adding --headless to a replay simulates the session as fast as possible without a window.
+// With the option --metrics <file> the metrics of the last frames are written to the file as JSON lines when the game exits.
+// With the option --hitch-log <file> a record of each frame that takes longer than the hitch threshold is written to the file,
+// and --hitch-threshold <milliseconds> sets the threshold. The frame time percentiles are printed when the game exits.
+// With the option --profile-listeners the listeners are timed and the most expensive ones are printed when the game exits.
+// With the options --flight-dump-on-hitch <file> and --flight-dump-on-crash <file> the flight recorder is written to the file
+// on a hitch or a crash, and with --flight-dump <file> it is written when the game exits (see FlightRecorder).
+// With the option --telemetry <port> the metrics are served at http://127.0.0.1:<port>/metrics while the game runs.
+// With the option --overlay the performance overlay is shown from the start (it is toggled with F3).
+// With the option --no-idle-throttling the game runs at full rate even while nothing happens (see Engine::SetIdleThrottling).
+// With the option --trace <file> the trace zones are recorded to the file (see Trace), which requires a build with GAMEENGINE_TRACING.
+// With the option --serve <port> the game runs headless (skipping the name entry) and sends snapshots of its level to clients
+// on the port (see Engine::ServeSnapshots), and with --connect <port> a window only draws the snapshots of such a server.
+int main(int argc, const char * argv[]) {
+    if ((argc == 4 || argc == 5) && string(argv[1]) == "--batch") {
+        vector<SpaceShooter*> games;
+        SimulationBatch batch(atoi(argv[2]), 60, 800, 640, [&games](Engine* engine, int index) {
+            SpaceShooter* game = new SpaceShooter(engine);
+            game->PlayerNameEnteredListener();
+            games.push_back(game);
+        });
+        batch.Run(atoi(argv[3]), argc == 5 ? atoi(argv[4]) : 0);
+        batch.PrintReport();
+        for (int i = 0; i < games.size(); i++) {
+            delete games[i];
         }
+        return 0;
     }
-}
-
-void DestroySprites(Sprite* sprite1, Sprite* sprite2) {
-    game_engine->GetCurrentLevel()->RemoveSprite(sprite1);
-    game_engine->GetCurrentLevel()->RemoveSprite(sprite2);
-}
-
-void CollisionListener(Sprite* sprite1, Sprite* sprite2) {
-    if ((sprite1->GetTag() == "bullet" && sprite2->GetTag() == "enemy") || (sprite2->GetTag() == "bullet" && sprite1->GetTag() == "enemy")) {
-        DestroySprites(sprite1, sprite2);
-    } else if ((sprite1->GetTag() == "player" && sprite2->GetTag() == "enemy") || (sprite2->GetTag() == "player" && sprite1->GetTag() == "enemy")) {
-        DestroySprites(sprite1, sprite2);
-        GameOver(sprite1, sprite2);
+    if (argc == 3 && string(argv[1]) == "--connect") {
+        Engine* client_engine = new Engine("SpaceShooter", 60, 800, 640);
+        Level* level = new Level(0);
+        client_engine->AddLevel(level);
+        client_engine->SetCurrentLevel(level);
+        client_engine->ConnectToServer(atoi(argv[2]));
+        client_engine->Run();
+        cout << "Snapshots received: " << client_engine->GetSnapshotClient()->GetSnapshotCount() << " (" << client_engine->GetSnapshotClient()->GetBytesReceived() << " bytes)" << endl;
+        delete client_engine;
+        return 0;
     }
-}
-
-void PlayerRightMove(SDL_Event& event, Sprite* sprite) {
-    sprite->SetX(sprite->GetX() + 20);
-}
-
-void PlayerLeftMove(SDL_Event& event, Sprite* sprite) {
-    sprite->SetX(sprite->GetX() - 20);
-}
-
-void EnemyCreationListenerLevel1() {
-    int x_pos = rand() % game_engine->GetWindowWidth() + 100;
-    if (x_pos < (game_engine->GetWindowWidth() - 100)) {
-        Sprite* tmpSprite = MovingSprite::GetInstance("enemy" ,"resources/game/level1_enemy.png", x_pos, 0, 100, 100, 0, 2);
-        level1->AddSprite(tmpSprite);
+    
+    bool is_headless = false;
+    bool is_serving = false;
+    bool is_profiling_listeners = false;
+    bool is_overlay_visible = false;
+    bool is_idle_throttling = true;
+    string metrics_path;
+    string trace_path;
+    string flight_dump_path;
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]) == "--headless") {
+            is_headless = true;
+        } else if (i + 1 < argc && string(argv[i]) == "--serve") {
+            is_headless = true;
+            is_serving = true;
+        } else if (string(argv[i]) == "--profile-listeners") {
+            is_profiling_listeners = true;
+        } else if (string(argv[i]) == "--overlay") {
+            is_overlay_visible = true;
+        } else if (string(argv[i]) == "--no-idle-throttling") {
+            is_idle_throttling = false;
+        } else if (i + 1 < argc && string(argv[i]) == "--metrics") {
+            metrics_path = argv[i + 1];
+        } else if (i + 1 < argc && string(argv[i]) == "--trace") {
+            trace_path = argv[i + 1];
+        } else if (i + 1 < argc && string(argv[i]) == "--flight-dump") {
+            flight_dump_path = argv[i + 1];
+        }
     }
-}
-
-void BulletCreationListenerLevel1(SDL_Event& event, Sprite* sprite) {
-    int x_pos = player->GetX()+54;
-    Sprite* tmpSprite = MovingSprite::GetInstance("bullet", "resources/game/level1_bullet.png", x_pos, 505, 19, 43, 0, -10);
-    level1->AddSprite(tmpSprite);
-}
-
-void PlayerNameEnteredListener() {
-    overlay->SetIsVisible(false);
-    level1->RemoveSprite(name_input_message);
-    level1->RemoveSprite(text_input);
-    player->AddEventListener(PlayerRightMove, SDLK_RIGHT);
-    player->AddEventListener(PlayerLeftMove, SDLK_LEFT);
-    level1->AddTimeListener(EnemyCreationListenerLevel1, 1000);
-    player->AddEventListener(BulletCreationListenerLevel1, SDLK_SPACE);
-    level1->AddSprite(player);
-}
-
-void SetUpLevel1() {
-    level1->SetBackground("resources/game/level1_background.png");
-    level1->AddSprite(overlay);
-    level1->AddSprite(text_input);
-    level1->AddSprite(name_input_message);
-    game_engine->AddLevel(level1);
-    game_engine->SetCurrentLevel(level1);
-}
-
-int main(int argc, const char * argv[]) {
-    srand(time(NULL));
-    SetUpLevel1();
-    game_engine->AddEventListener(PlayerNameEnteredListener, SDLK_RETURN);
-    game_engine->SetCollisionListener(CollisionListener);
-
+    Engine* game_engine = new Engine("SpaceShooter", 60, 800, 640, is_headless);
+    SpaceShooter* game = new SpaceShooter(game_engine);
+    game_engine->SetListenerProfiling(is_profiling_listeners);
+    game_engine->SetOverlayVisible(is_overlay_visible);
+    game_engine->SetIdleThrottling(is_idle_throttling);
+    for (int i = 1; i + 1 < argc; i++) {
+        if (string(argv[i]) == "--seed") {
+            game_engine->SetDeterministic(atoi(argv[i + 1]));
+        } else if (string(argv[i]) == "--record") {
+            game_engine->RecordInput(argv[i + 1]);
+        } else if (string(argv[i]) == "--replay") {
+            game_engine->ReplayInput(argv[i + 1]);
+        } else if (string(argv[i]) == "--hitch-log") {
+            game_engine->LogHitches(argv[i + 1]);
+        } else if (string(argv[i]) == "--hitch-threshold") {
+            game_engine->SetHitchThreshold(atof(argv[i + 1]));
+        } else if (string(argv[i]) == "--flight-dump-on-hitch") {
+            game_engine->DumpFlightRecorderOnHitch(argv[i + 1]);
+        } else if (string(argv[i]) == "--flight-dump-on-crash") {
+            game_engine->DumpFlightRecorderOnCrash(argv[i + 1]);
+        } else if (string(argv[i]) == "--telemetry") {
+            game_engine->ServeTelemetry(atoi(argv[i + 1]));
+            cout << "Serving telemetry at http://127.0.0.1:" << game_engine->GetTelemetryServer()->GetPort() << "/metrics" << endl;
+        } else if (string(argv[i]) == "--serve") {
+            game_engine->ServeSnapshots(atoi(argv[i + 1]));
+            game->PlayerNameEnteredListener();
+            cout << "Serving snapshots on port " << game_engine->GetSnapshotServer()->GetPort() << endl;
+        }
+    }
+    if (is_headless && !is_serving && !game_engine->GetIsReplaying()) {
+        cerr << "The option --headless requires --replay or --serve." << endl;
+        delete game;
+        delete game_engine;
+        return 1;
+    }
+    if (!trace_path.empty()) {
+        if (!Trace::IsCompiledIn()) {
+            cerr << "The trace zones are not compiled in, build with -DGAMEENGINE_TRACING to record them." << endl;
+        }
+        Trace::Start(trace_path);
+    }
+    
     game_engine->Run();
+    Trace::Stop();
+    if (game_engine->GetIsDeterministic()) {
+        cout << "State hash after " << game_engine->GetFrameCount() << " frames: " << hex << game_engine->GetStateHash() << dec << endl;
+    }
+    cout << "Frame times: ";
+    game_engine->GetFrameTimes()->Print(cout);
+    cout << "Hitches: " << game_engine->GetHitchCount() << endl;
+    cout << "Frames skipped while idle: " << game_engine->GetIdleFrameCount() << endl;
+    if (is_profiling_listeners) {
+        game_engine->PrintListenerReport(cout);
+    }
+    if (!metrics_path.empty()) {
+        ofstream metrics_file(metrics_path.c_str());
+        game_engine->GetMetrics()->ExportJsonLines(metrics_file);
+    }
+    if (!flight_dump_path.empty()) {
+        game_engine->DumpFlightRecorder(flight_dump_path);
+    }
     
+    delete game;
     delete game_engine;
     return 0;
 }
@@ -0,0 +1,111 @@
+// Decodes a flight recorder dump written by the engine (see FlightRecorder) into readable text: one line per frame with
+// its times and counts, followed by the input events delegated in the frame, and a summary of the frame times at the end.
+// The dump must have been written on a machine with the same byte order.
+//
+// Built from this file alone (the SDL headers are needed for the integer types of FlightRecorder.h).
+// Usage: FlightRecorderDecoder <dump file>
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstring>
+#include "../GameEngine/FlightRecorder.h"
+
+using namespace std;
+
+// Returns the name of the reason a dump was written.
+string GetReasonName(Uint32 reason) {
+    switch (reason) {
+        case FlightRecorder::ON_DEMAND:
+            return "on demand";
+        case FlightRecorder::ON_HITCH:
+            return "on a hitch";
+        case FlightRecorder::ON_CRASH:
+            return "on a crash";
+    }
+    return "for an unknown reason";
+}
+
+// Describes an input event.
+string DescribeEvent(const FlightRecorder::EventRecord& event) {
+    string code = to_string(event.code);
+    if (event.code >= 32 && event.code < 127) {
+        code = "'" + string(1, (char)event.code) + "' (" + code + ")";
+    }
+    string position = " at " + to_string(event.x) + ", " + to_string(event.y);
+    switch (event.type) {
+        case SDL_KEYDOWN:
+            return "key down " + code;
+        case SDL_KEYUP:
+            return "key up " + code;
+        case SDL_TEXTINPUT:
+            return "text input " + code;
+        case SDL_MOUSEBUTTONDOWN:
+            return "mouse button " + to_string(event.code) + " down" + position;
+        case SDL_MOUSEBUTTONUP:
+            return "mouse button " + to_string(event.code) + " up" + position;
+        case SDL_MOUSEMOTION:
+            return "mouse motion" + position;
+        case SDL_MOUSEWHEEL:
+            return "mouse wheel";
+    }
+    return "event of type " + to_string(event.type);
+}
+
+int main(int argc, const char * argv[]) {
+    if (argc != 2) {
+        cerr << "Usage: FlightRecorderDecoder <dump file>" << endl;
+        return 2;
+    }
+    ifstream in(argv[1], ios::binary);
+    FlightRecorder::DumpHeader header;
+    if (!in.read((char*)&header, sizeof(header)) || memcmp(header.magic, "GEFR", 4) != 0 || header.version != FlightRecorder::VERSION) {
+        cerr << argv[1] << " is not a flight recorder dump of a supported version." << endl;
+        return 1;
+    }
+    vector<FlightRecorder::FrameRecord> frames(header.frame_count);
+    vector<FlightRecorder::EventRecord> events(header.event_count);
+    if (!in.read((char*)frames.data(), frames.size() * sizeof(FlightRecorder::FrameRecord))
+        || !in.read((char*)events.data(), events.size() * sizeof(FlightRecorder::EventRecord))) {
+        cerr << argv[1] << " ends before all records." << endl;
+        return 1;
+    }
+
+    cout << "Dump written " << GetReasonName(header.reason) << " in frame " << header.frame << " at " << header.fps << " fps, "
+         << frames.size() << " frames and " << events.size() << " input events" << endl;
+    cout << setw(8) << "frame" << setw(10) << "time ms" << setw(9) << "poll" << setw(9) << "render" << setw(9) << "wait"
+         << setw(9) << "delay" << setw(9) << "sprites" << setw(7) << "draws" << setw(8) << "events" << setw(11) << "listeners"
+         << setw(11) << "collisions" << setw(8) << "allocs" << endl;
+    cout << fixed << setprecision(3);
+    // Events older than the oldest frame kept are skipped, since the frames they belong to are gone.
+    int next_event = 0;
+    while (next_event < events.size() && !frames.empty() && events[next_event].frame < frames[0].frame) {
+        next_event++;
+    }
+    double total_time = 0;
+    int slowest_frame = 0;
+    for (int i = 0; i < frames.size(); i++) {
+        const FlightRecorder::FrameRecord& frame = frames[i];
+        cout << setw(8) << frame.frame << setw(10) << frame.frame_time << setw(9) << frame.poll_time << setw(9) << frame.render_time
+             << setw(9) << frame.wait_time << setw(9) << frame.delay_time << setw(9) << frame.sprites << setw(7) << frame.draw_calls
+             << setw(8) << frame.events << setw(11) << frame.listener_invocations << setw(11) << frame.collisions
+             << setw(8) << frame.allocations << endl;
+        for (; next_event < events.size() && events[next_event].frame <= frame.frame; next_event++) {
+            cout << "        " << DescribeEvent(events[next_event]) << endl;
+        }
+        total_time += frame.frame_time;
+        if (frame.frame_time > frames[slowest_frame].frame_time) {
+            slowest_frame = i;
+        }
+    }
+    for (; next_event < events.size(); next_event++) {
+        cout << "        " << DescribeEvent(events[next_event]) << " (frame " << events[next_event].frame << ", not simulated)" << endl;
+    }
+    if (!frames.empty()) {
+        cout << "Mean frame time " << total_time / frames.size() << " ms, slowest frame " << frames[slowest_frame].frame
+             << " (" << frames[slowest_frame].frame_time << " ms)" << endl;
+    }
+    return 0;
+}
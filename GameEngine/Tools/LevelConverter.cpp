@@ -0,0 +1,38 @@
+// Converts a level file in the text format to the binary format loaded by games (see LevelFile), and prints the number of
+// sprites and strings of the level. With --check, a binary level file is instead read and its sprites counted, which tells
+// whether the engine is able to load it.
+//
+// Built from this file together with all sources of the engine except main.cpp.
+// Usage: LevelConverter <text level file> <binary level file>
+//        LevelConverter --check <binary level file>
+
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include "../GameEngine/LevelFile.h"
+
+using namespace std;
+
+int main(int argc, const char * argv[]) {
+    if (argc != 3) {
+        cerr << "Usage: LevelConverter <text level file> <binary level file>" << endl;
+        cerr << "       LevelConverter --check <binary level file>" << endl;
+        return 2;
+    }
+    try {
+        if (string(argv[1]) == "--check") {
+            LevelFile* level_file = LevelFile::ReadBinary(argv[2]);
+            cout << argv[2] << " is a valid level file with " << level_file->GetSpriteCount() << " sprites." << endl;
+            delete level_file;
+            return 0;
+        }
+        LevelFile* level_file = LevelFile::ReadText(argv[1]);
+        level_file->WriteBinary(argv[2]);
+        cout << "Wrote " << level_file->GetSpriteCount() << " sprites to " << argv[2] << "." << endl;
+        delete level_file;
+    } catch (const exception& error) {
+        cerr << error.what() << endl;
+        return 1;
+    }
+    return 0;
+}
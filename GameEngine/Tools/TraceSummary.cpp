@@ -0,0 +1,206 @@
+// Summarizes a trace file written by the engine (see Trace) into the time spent in each zone. The inclusive time of a zone
+// is the time from entering to leaving it, and the exclusive time is the inclusive time minus the time spent in the zones
+// entered inside it. A zone entered again inside itself (recursion) only counts towards the inclusive time once.
+// Zones whose events were dropped are left open or closed without being entered; they are skipped and reported.
+//
+// Built from this file alone (the SDL headers are needed for the integer types of Trace.h).
+// Usage: TraceSummary <trace file> [--top <count>]
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "../GameEngine/Trace.h"
+
+using namespace std;
+
+// The times of a zone, summed over all threads.
+struct ZoneSummary {
+    string name;
+    long calls;
+    Uint64 inclusive_time, exclusive_time, max_time;
+};
+
+// A zone that a thread has entered but not yet left.
+struct OpenZone {
+    Uint32 zone;
+    Uint64 start_time, child_time;
+};
+
+// The state of a thread while its events are read: the time of its last event, the zones it is in and how many times
+// it is in each zone.
+struct ThreadState {
+    Uint64 time;
+    vector<OpenZone> open_zones;
+    map<Uint32, int> depths;
+};
+
+// Reads a number written with seven bits in each byte. Returns false at the end of the file.
+bool ReadCount(istream& in, Uint64& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = in.get();
+        if (byte == EOF) {
+            return false;
+        }
+        value |= (Uint64)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns the summary of a zone, adding it if the zone has not been seen yet.
+ZoneSummary& GetSummary(vector<ZoneSummary>& summaries, Uint32 zone) {
+    if (zone >= summaries.size()) {
+        summaries.resize(zone + 1, {"", 0, 0, 0, 0});
+    }
+    if (summaries[zone].name.empty()) {
+        summaries[zone].name = "zone " + to_string(zone);
+    }
+    return summaries[zone];
+}
+
+// Leaves the innermost open zone of a thread at the specified time and adds its times to its summary and to the zone around it.
+void CloseZone(ThreadState& thread, vector<ZoneSummary>& summaries, Uint64 time) {
+    OpenZone open_zone = thread.open_zones.back();
+    thread.open_zones.pop_back();
+    Uint64 inclusive_time = time - open_zone.start_time;
+    ZoneSummary& summary = GetSummary(summaries, open_zone.zone);
+    summary.calls++;
+    summary.exclusive_time += inclusive_time > open_zone.child_time ? inclusive_time - open_zone.child_time : 0;
+    summary.max_time = max(summary.max_time, inclusive_time);
+    if (--thread.depths[open_zone.zone] == 0) {
+        summary.inclusive_time += inclusive_time;
+    }
+    if (!thread.open_zones.empty()) {
+        thread.open_zones.back().child_time += inclusive_time;
+    }
+}
+
+// Formats nanoseconds as milliseconds.
+string FormatTime(Uint64 time) {
+    ostringstream out;
+    out << fixed << setprecision(3) << time / 1000000.0;
+    return out.str();
+}
+
+int main(int argc, const char * argv[]) {
+    if (argc < 2) {
+        cerr << "Usage: TraceSummary <trace file> [--top <count>]" << endl;
+        return 2;
+    }
+    int top = 30;
+    for (int i = 2; i < argc; i++) {
+        if (i + 1 < argc && string(argv[i]) == "--top") {
+            top = atoi(argv[++i]);
+        } else {
+            cerr << "Unknown option " << argv[i] << endl;
+            return 2;
+        }
+    }
+    ifstream in(argv[1], ios::binary);
+    char magic[4];
+    if (!in.read(magic, 4) || string(magic, 4) != "GETR" || in.get() != 1) {
+        cerr << argv[1] << " is not a trace file of a supported version." << endl;
+        return 1;
+    }
+
+    vector<ZoneSummary> summaries;
+    vector<ThreadState> threads;
+    long event_count = 0, dropped_count = 0, unmatched_count = 0;
+    Uint64 end_time = 0;
+    bool is_truncated = false;
+    int kind;
+    while (!is_truncated && (kind = in.get()) != EOF) {
+        Uint64 zone = 0, thread_index = 0, count = 0;
+        if (kind == Trace::ZONE_RECORD) {
+            Uint64 length;
+            string name;
+            is_truncated = !ReadCount(in, zone) || !ReadCount(in, length);
+            if (!is_truncated) {
+                name.resize(length);
+                is_truncated = !in.read(&name[0], length);
+            }
+            if (!is_truncated) {
+                GetSummary(summaries, (Uint32)zone).name = name;
+            }
+        } else if (kind == Trace::EVENTS_RECORD) {
+            is_truncated = !ReadCount(in, thread_index) || !ReadCount(in, count);
+            if (!is_truncated && thread_index >= threads.size()) {
+                threads.resize(thread_index + 1, {0, {}, {}});
+            }
+            for (Uint64 i = 0; i < count && !is_truncated; i++) {
+                Uint64 delta, event;
+                is_truncated = !ReadCount(in, delta) || !ReadCount(in, event);
+                if (is_truncated) {
+                    break;
+                }
+                ThreadState& thread = threads[thread_index];
+                thread.time += delta;
+                end_time = max(end_time, thread.time);
+                event_count++;
+                Uint32 event_zone = (Uint32)(event >> 1);
+                if ((event & 1) == 0) {
+                    thread.open_zones.push_back({event_zone, thread.time, 0});
+                    thread.depths[event_zone]++;
+                    continue;
+                }
+                // Leaving a zone that is not the innermost one means that the events of the zones inside it were dropped,
+                // so those are closed as well. Leaving a zone that was never entered is skipped.
+                if (thread.depths[event_zone] == 0) {
+                    unmatched_count++;
+                    continue;
+                }
+                while (thread.open_zones.back().zone != event_zone) {
+                    CloseZone(thread, summaries, thread.time);
+                    unmatched_count++;
+                }
+                CloseZone(thread, summaries, thread.time);
+            }
+        } else if (kind == Trace::DROPPED_RECORD) {
+            is_truncated = !ReadCount(in, thread_index) || !ReadCount(in, count);
+            if (!is_truncated) {
+                dropped_count += count;
+            }
+        } else {
+            cerr << "Unknown record kind " << kind << ", the rest of the trace is skipped." << endl;
+            break;
+        }
+    }
+    for (int i = 0; i < threads.size(); i++) {
+        unmatched_count += threads[i].open_zones.size();
+    }
+
+    vector<ZoneSummary> sorted_summaries;
+    for (int i = 0; i < summaries.size(); i++) {
+        if (summaries[i].calls > 0) {
+            sorted_summaries.push_back(summaries[i]);
+        }
+    }
+    sort(sorted_summaries.begin(), sorted_summaries.end(), [](const ZoneSummary& lhs, const ZoneSummary& rhs) {
+        return lhs.exclusive_time > rhs.exclusive_time;
+    });
+    cout << event_count << " events on " << threads.size() << " threads over " << FormatTime(end_time) << " ms" << endl;
+    cout << left << setw(32) << "zone" << right << setw(10) << "calls" << setw(16) << "inclusive ms" << setw(16) << "exclusive ms"
+         << setw(14) << "mean us" << setw(14) << "max us" << endl;
+    for (int i = 0; i < sorted_summaries.size() && i < top; i++) {
+        const ZoneSummary& summary = sorted_summaries[i];
+        cout << left << setw(32) << summary.name << right << setw(10) << summary.calls
+             << setw(16) << FormatTime(summary.inclusive_time) << setw(16) << FormatTime(summary.exclusive_time)
+             << setw(14) << fixed << setprecision(2) << summary.inclusive_time / 1000.0 / summary.calls
+             << setw(14) << summary.max_time / 1000.0 << endl;
+    }
+    if (dropped_count > 0 || unmatched_count > 0) {
+        cout << dropped_count << " events were dropped and " << unmatched_count << " zones were not entered and left in the trace." << endl;
+    }
+    if (is_truncated) {
+        cout << "The trace ends in the middle of a record." << endl;
+    }
+    return 0;
+}